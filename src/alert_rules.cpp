@@ -0,0 +1,197 @@
+#include "alert_rules.h"
+#include "pattern_sequencer.h"
+
+#include <math.h>
+
+// The board's alerts. Thresholds of the cat safety and free-fall rules are
+// replaced from their parameters at boot and whenever they change.
+const AlertRule alertRules[ALERT_RULE_COUNT] = {
+   // name             kind          severity        channel / rule     operand       threshold hyst  hold ms window ms  pattern
+   { "low_battery",    ALERT_BELOW,  ALERT_WARNING,  ALERT_BATTERY,     0,            3.6,      0.1,  2000,   0,         &patternWarning },
+   { "no_usb",         ALERT_BELOW,  ALERT_INFO,     ALERT_USB,         0,            4.0,      0.3,  1000,   0,         nullptr },
+   { "power_critical", ALERT_ALL_OF, ALERT_CRITICAL, ALERT_LOW_BATTERY, ALERT_NO_USB, 0,        0,    0,      0,         &patternPowerAlarm },
+   { "cat_safety",     ALERT_FALL,   ALERT_CRITICAL, ALERT_PRESSURE,    0,            10.0,     1.0,  2000,   600000,    &patternCatAlarm },
+   { "free_fall",      ALERT_ABOVE,  ALERT_WARNING,  ALERT_TOUCH_DELTA, 0,            15000,    3000, 0,      0,         &patternFreeFall },
+   { "overheat",       ALERT_ABOVE,  ALERT_WARNING,  ALERT_TEMPERATURE, 0,            60.0,     5.0,  5000,   0,         &patternWarning },
+};
+
+AlertState alertStates[ALERT_RULE_COUNT];
+AlertEngine alertEngine;
+
+bool AlertEngine::begin(const AlertRule* rules, AlertState* states, int count) {
+   ruleCount = 0;
+   firstCombined = ALERT_NONE;
+   for (int channel = 0; channel < ALERT_CHANNELS; channel++) {
+     firstRule[channel] = ALERT_NONE;
+   }
+   eventHead = 0;
+   eventCount = 0;
+   evaluationCount = 0;
+   droppedCount = 0;
+   if (count < 0 || count > INT16_MAX) return false;
+
+   // Link each rule behind the previous one on its channel, keeping table order
+   int16_t lastRule[ALERT_CHANNELS];
+   int16_t lastCombined = ALERT_NONE;
+   for (int i = 0; i < count; i++) {
+     const AlertRule& rule = rules[i];
+     bool combined = rule.kind == ALERT_ALL_OF || rule.kind == ALERT_ANY_OF;
+     if (combined ? (rule.channel >= i || rule.operand >= i || rule.holdMs != 0)
+                  : (rule.kind > ALERT_FALL || rule.channel >= ALERT_CHANNELS)) return false;
+
+     AlertState& state = states[i];
+     state = AlertState();
+     state.threshold = rule.threshold;
+     state.next = ALERT_NONE;
+     int16_t& first = combined ? firstCombined : firstRule[rule.channel];
+     int16_t& last = combined ? lastCombined : lastRule[rule.channel];
+     if (first == ALERT_NONE) first = i;
+     else states[last].next = i;
+     last = i;
+   }
+
+   this->rules = rules;
+   this->states = states;
+   ruleCount = count;
+   return true;
+}
+
+void AlertEngine::setThreshold(int rule, float threshold) {
+   if (valid(rule)) states[rule].threshold = threshold;
+}
+
+void AlertEngine::sample(int channel, float value, uint32_t nowMs) {
+   if (ruleCount == 0 || channel < 0 || channel >= ALERT_CHANNELS || isnan(value)) return;
+
+   bool changed = false;
+   for (int16_t i = firstRule[channel]; i != ALERT_NONE; i = states[i].next) {
+     changed |= evaluate(i, value, nowMs);
+   }
+   if (!changed) return;
+
+   // Operands come first in the table, so one pass settles combinations of combinations
+   for (int16_t i = firstCombined; i != ALERT_NONE; i = states[i].next) {
+     const AlertRule& rule = rules[i];
+     bool first = states[rule.channel].active;
+     bool second = states[rule.operand].active;
+     bool condition = rule.kind == ALERT_ALL_OF ? (first && second) : (first || second);
+     evaluationCount++;
+     update(i, condition, (float)(first + second), nowMs);
+   }
+}
+
+bool AlertEngine::evaluate(int index, float value, uint32_t nowMs) {
+   const AlertRule& rule = rules[index];
+   const AlertState& state = states[index];
+   evaluationCount++;
+
+   // Past the threshold to raise; back past it by the hysteresis to clear
+   float margin = state.active ? rule.hysteresis : 0;
+   bool condition;
+   switch (rule.kind) {
+     case ALERT_ABOVE:
+       condition = value > state.threshold - margin;
+       break;
+     case ALERT_BELOW:
+       condition = value < state.threshold + margin;
+       break;
+     case ALERT_RISE:
+       value = change(index, value, nowMs);
+       condition = value > state.threshold - margin;
+       break;
+     default:   // ALERT_FALL, reported as the drop
+       value = -change(index, value, nowMs);
+       condition = value > state.threshold - margin;
+       break;
+   }
+   return update(index, condition, value, nowMs);
+}
+
+bool AlertEngine::update(int index, bool condition, float value, uint32_t nowMs) {
+   AlertState& state = states[index];
+   state.value = value;
+   if (!condition) {
+     state.pending = false;
+     if (!state.active) return false;
+     state.active = false;
+     queue(index, false, value, nowMs);
+     return true;
+   }
+
+   if (state.active) return false;
+   if (!state.pending) {
+     state.pending = true;
+     state.since = nowMs;
+   }
+   if (nowMs - state.since < rules[index].holdMs) return false;
+   state.pending = false;
+   state.active = true;
+   state.raised++;
+   queue(index, true, value, nowMs);
+   return true;
+}
+
+float AlertEngine::change(int index, float value, uint32_t nowMs) {
+   const AlertRule& rule = rules[index];
+   AlertState& state = states[index];
+   uint32_t spacing = rule.windowMs / ALERT_RATE_SLOTS;
+
+   // After a gap in the samples the reference would be far older than the window
+   if (state.checkpoints > 0 && nowMs - state.checkTime[state.oldest] > 2 * rule.windowMs) {
+     state.checkpoints = 0;
+     state.oldest = 0;
+   }
+
+   int newest = (state.oldest + state.checkpoints - 1) % ALERT_RATE_SLOTS;
+   if (state.checkpoints == 0 || nowMs - state.checkTime[newest] >= spacing) {
+     int slot;
+     if (state.checkpoints < ALERT_RATE_SLOTS) {
+       slot = (state.oldest + state.checkpoints) % ALERT_RATE_SLOTS;
+       state.checkpoints++;
+     } else {
+       slot = state.oldest;
+       state.oldest = (state.oldest + 1) % ALERT_RATE_SLOTS;
+     }
+     state.checkValue[slot] = value;
+     state.checkTime[slot] = nowMs;
+   }
+   return value - state.checkValue[state.oldest];
+}
+
+void AlertEngine::queue(int rule, bool raised, float value, uint32_t nowMs) {
+   // A full queue keeps the older events; the rule states stay current anyway
+   if (eventCount == ALERT_EVENT_QUEUE) {
+     droppedCount++;
+     return;
+   }
+   AlertEvent& event = events[(eventHead + eventCount) % ALERT_EVENT_QUEUE];
+   event.rule = rule;
+   event.raised = raised;
+   event.value = value;
+   event.timeMs = nowMs;
+   eventCount++;
+}
+
+bool AlertEngine::poll(AlertEvent& event) {
+   if (eventCount == 0) return false;
+   event = events[eventHead];
+   eventHead = (eventHead + 1) % ALERT_EVENT_QUEUE;
+   eventCount--;
+   return true;
+}
+
+int AlertEngine::top() const {
+   int best = ALERT_NONE;
+   for (int i = 0; i < ruleCount; i++) {
+     if (states[i].active && (best == ALERT_NONE || rules[i].severity > rules[best].severity)) best = i;
+   }
+   return best;
+}
+
+int AlertEngine::activeCount(int minSeverity) const {
+   int n = 0;
+   for (int i = 0; i < ruleCount; i++) {
+     if (states[i].active && rules[i].severity >= minSeverity) n++;
+   }
+   return n;
+}
@@ -0,0 +1,158 @@
+#ifndef ALERT_RULES_H
+#define ALERT_RULES_H
+
+#include <stdint.h>
+
+// Declarative alert rules over the sampled channels
+//
+// Every alert is a row in a compiled table instead of an if in some mode:
+//   ALERT_ABOVE / ALERT_BELOW   channel value past the threshold
+//   ALERT_RISE / ALERT_FALL     change of the channel over windowMs past the
+//                               threshold (same units as the channel)
+//   ALERT_ALL_OF / ALERT_ANY_OF both / either of two earlier rules active,
+//                               raised and cleared with them (no hold)
+// A condition has to hold for holdMs before the rule is raised, and the rule
+// clears once the value is back past the threshold by the hysteresis, so a
+// noisy reading near the threshold does not flap. The caller feeds every new
+// sample of a channel through sample(), whatever mode is on screen; only the
+// rules on that channel are evaluated (linked per channel in begin()), then
+// the combined rules if anything changed. Raise and clear transitions are
+// queued as events for the outputs (display, buzzer and LED, MQTT).
+//
+// Rate of change without keeping the samples: each rate rule keeps
+// ALERT_RATE_SLOTS checkpoints spaced windowMs / ALERT_RATE_SLOTS apart and
+// compares against the oldest, so the change is measured over the window to
+// within one spacing whatever the channel's sample rate.
+//
+// Rule state lives in an array the caller provides; nothing is allocated.
+// No Arduino dependencies: tools/alert_bench.cpp checks the semantics and
+// measures evaluation throughput on thousands of rules.
+
+#define ALERT_RATE_SLOTS      4
+#define ALERT_EVENT_QUEUE     16
+#define ALERT_NONE            -1
+
+enum AlertChannel {
+   ALERT_PRESSURE,            // hPa
+   ALERT_TEMPERATURE,         // degC
+   ALERT_HUMIDITY,            // %RH
+   ALERT_BATTERY,             // V
+   ALERT_USB,                 // V
+   ALERT_TOUCH_DELTA,         // |right - left| touch reading
+   ALERT_CHANNELS
+};
+
+enum AlertKind {
+   ALERT_ABOVE,
+   ALERT_BELOW,
+   ALERT_RISE,
+   ALERT_FALL,
+   ALERT_ALL_OF,
+   ALERT_ANY_OF
+};
+
+enum AlertSeverity {
+   ALERT_INFO,                // Reported only
+   ALERT_WARNING,             // Pattern plays once
+   ALERT_CRITICAL             // Pattern repeats until cleared
+};
+
+struct Pattern;
+
+struct AlertRule {
+   const char* name;
+   uint8_t kind;
+   uint8_t severity;
+   uint16_t channel;          // AlertChannel; the first rule for ALL_OF / ANY_OF
+   uint16_t operand;          // The second rule for ALL_OF / ANY_OF
+   float threshold;
+   float hysteresis;
+   uint32_t holdMs;
+   uint32_t windowMs;         // RISE / FALL only
+   const Pattern* pattern;    // Buzzer and LED on raise, nullptr silent
+};
+
+struct AlertState {
+   float threshold;           // The table's, or set at runtime from a parameter
+   float value;               // Last value (or change) evaluated
+   uint32_t since;            // Condition true since, while pending
+   uint32_t raised;           // Times raised
+   int16_t next;              // Next rule on the same channel
+   bool pending;
+   bool active;
+   uint8_t checkpoints;       // Rate rules: checkpoints filled
+   uint8_t oldest;
+   float checkValue[ALERT_RATE_SLOTS];
+   uint32_t checkTime[ALERT_RATE_SLOTS];
+};
+
+struct AlertEvent {
+   int16_t rule;
+   bool raised;               // false: cleared
+   float value;
+   uint32_t timeMs;
+};
+
+class AlertEngine {
+public:
+   // rules and states have count entries; combined rules may only refer to
+   // rules before them. Returns false (and evaluates nothing) on a bad table.
+   bool begin(const AlertRule* rules, AlertState* states, int count);
+
+   // New sample of a channel; NaN (sensor missing) is skipped
+   void sample(int channel, float value, uint32_t nowMs);
+
+   // Oldest queued raise / clear, false when there is none
+   bool poll(AlertEvent& event);
+
+   void setThreshold(int rule, float threshold);
+   float threshold(int rule) const { return valid(rule) ? states[rule].threshold : 0; }
+
+   bool active(int rule) const { return valid(rule) && states[rule].active; }
+   const AlertRule& rule(int index) const { return rules[index]; }
+   const AlertState& state(int index) const { return states[index]; }
+   int count() const { return ruleCount; }
+
+   // Active rule of the highest severity (the first in the table among
+   // equals), ALERT_NONE when everything is clear
+   int top() const;
+   int activeCount(int minSeverity) const;
+
+   uint32_t evaluations() const { return evaluationCount; }
+   uint32_t eventsDropped() const { return droppedCount; }
+
+private:
+   bool valid(int rule) const { return rule >= 0 && rule < ruleCount; }
+   bool evaluate(int rule, float value, uint32_t nowMs);
+   bool update(int rule, bool condition, float value, uint32_t nowMs);
+   float change(int rule, float value, uint32_t nowMs);
+   void queue(int rule, bool raised, float value, uint32_t nowMs);
+
+   const AlertRule* rules = nullptr;
+   AlertState* states = nullptr;
+   int ruleCount = 0;
+   int16_t firstRule[ALERT_CHANNELS];
+   int16_t firstCombined = ALERT_NONE;
+   AlertEvent events[ALERT_EVENT_QUEUE];
+   uint8_t eventHead = 0;
+   uint8_t eventCount = 0;
+   uint32_t evaluationCount = 0;
+   uint32_t droppedCount = 0;
+};
+
+// The board's rules, in the order of the table in alert_rules.cpp
+enum AlertRuleId {
+   ALERT_LOW_BATTERY,
+   ALERT_NO_USB,
+   ALERT_POWER_CRITICAL,
+   ALERT_CAT_SAFETY,
+   ALERT_FREE_FALL,
+   ALERT_OVERHEAT,
+   ALERT_RULE_COUNT
+};
+
+extern const AlertRule alertRules[ALERT_RULE_COUNT];
+extern AlertState alertStates[ALERT_RULE_COUNT];
+extern AlertEngine alertEngine;
+
+#endif
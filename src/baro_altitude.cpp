@@ -0,0 +1,98 @@
+#include "baro_altitude.h"
+
+#include <math.h>
+
+AltitudeEstimator baroAltitude;
+
+#define BARO_SCALE_M          44330.77f
+#define BARO_EXPONENT         0.190263f
+#define BARO_RATIO_STEP       ((BARO_RATIO_MAX - BARO_RATIO_MIN) / (BARO_TABLE_SIZE - 1))
+
+// Altitude at QNH 1 over the pressure ratio; shared by every estimator
+static float table[BARO_TABLE_SIZE];
+static bool tableBuilt = false;
+
+float AltitudeEstimator::exactAltitude(float pressureHpa, float qnhHpa) {
+   return BARO_SCALE_M * (1.0f - powf(pressureHpa / qnhHpa, BARO_EXPONENT));
+}
+
+float AltitudeEstimator::pressureAltitude(float pressureHpa, float qnhHpa) {
+   float ratio = pressureHpa / qnhHpa;
+   if (!tableBuilt || !(ratio >= BARO_RATIO_MIN && ratio < BARO_RATIO_MAX)) {
+     return exactAltitude(pressureHpa, qnhHpa);
+   }
+   float x = (ratio - BARO_RATIO_MIN) * (1.0f / BARO_RATIO_STEP);
+   int i = (int)x;
+   if (i >= BARO_TABLE_SIZE - 1) i = BARO_TABLE_SIZE - 2;
+   float f = x - i;
+   return table[i] + f * (table[i + 1] - table[i]);
+}
+
+void AltitudeEstimator::begin(float qnhHpa) {
+   if (!tableBuilt) {
+     for (int i = 0; i < BARO_TABLE_SIZE; i++) {
+       // double so the table itself adds no rounding to the interpolation error
+       double ratio = BARO_RATIO_MIN + (double)i * (BARO_RATIO_MAX - BARO_RATIO_MIN) / (BARO_TABLE_SIZE - 1);
+       table[i] = BARO_SCALE_M * (1.0 - pow(ratio, (double)BARO_EXPONENT));
+     }
+     tableBuilt = true;
+   }
+   this->qnhHpa = qnhHpa;
+   started = false;
+   updateCount = 0;
+}
+
+void AltitudeEstimator::setQnh(float qnhHpa) {
+   if (started) {
+     float shift = pressureAltitude(lastPressure, qnhHpa) - pressureAltitude(lastPressure, this->qnhHpa);
+     height += shift;
+     lastMeasured += shift;
+   }
+   this->qnhHpa = qnhHpa;
+}
+
+void AltitudeEstimator::update(float pressureHpa, uint32_t nowMs, float accel) {
+   if (isnan(pressureHpa) || pressureHpa <= 0) return;
+   float z = pressureAltitude(pressureHpa, qnhHpa);
+   lastPressure = pressureHpa;
+   lastMeasured = z;
+   updateCount++;
+
+   uint32_t gap = nowMs - lastMs;
+   lastMs = nowMs;
+   if (!started || gap > BARO_MAX_GAP_MS) {
+     // Start at the measurement, vertical speed unknown
+     started = true;
+     height = z;
+     speed = 0;
+     p00 = BARO_SIGMA_ALTITUDE * BARO_SIGMA_ALTITUDE;
+     p01 = 0;
+     p11 = 25.0f;                  // (5 m/s)^2
+     return;
+   }
+
+   // Predict: constant acceleration over dt, with the IMU's or an unknown one
+   float dt = gap * 0.001f;
+   bool fused = !isnan(accel);
+   float a = fused ? accel : 0;
+   float sigma = fused ? BARO_SIGMA_IMU : BARO_SIGMA_MANEUVER;
+   float q = sigma * sigma;
+   float dt2 = dt * dt;
+   height += speed * dt + 0.5f * a * dt2;
+   speed += a * dt;
+   p00 += dt * (2 * p01 + dt * p11) + q * dt2 * dt2 * 0.25f;
+   p01 += dt * p11 + q * dt2 * dt * 0.5f;
+   p11 += q * dt2;
+
+   // Correct with the measured altitude
+   float r = BARO_SIGMA_ALTITUDE * BARO_SIGMA_ALTITUDE;
+   float s = p00 + r;
+   float k0 = p00 / s;
+   float k1 = p01 / s;
+   float y = z - height;
+   height += k0 * y;
+   speed += k1 * y;
+   p11 -= k1 * p01;
+   p01 -= k0 * p01;
+   p00 -= k0 * p00;
+}
@@ -0,0 +1,74 @@
+#ifndef BARO_ALTITUDE_H
+#define BARO_ALTITUDE_H
+
+#include <stdint.h>
+
+// Barometric altitude and vertical speed
+//
+// Altitude from pressure is the ICAO standard atmosphere formula
+//   h = 44330.77 m * (1 - (p / QNH)^0.190263)
+// with QNH the sea-level pressure of the day (qnh_hpa parameter, 1013.25 by
+// default). powf() costs a log and an exp in software; the ratio p / QNH is
+// looked up in a table of BARO_TABLE_SIZE points built once by begin() and
+// interpolated linearly instead: within 2 cm of the formula below 3 km and
+// 13 cm at 10 km, the top of the table. Outside it falls back to powf().
+//
+// The altitude samples feed a two-state Kalman filter (altitude, vertical
+// speed) at the sensor rate: 8 Hz while a mode keeps the BME280 on, 1 Hz
+// gated. Between samples the state moves with the vertical acceleration
+// when an IMU supplies one, otherwise it is modelled as random
+// acceleration of BARO_SIGMA_MANEUVER; each sample then corrects it with a
+// measurement noise of BARO_SIGMA_ALTITUDE. A gap of more than
+// BARO_MAX_GAP_MS (sensor lost, first sample) restarts the filter at the
+// measured altitude. A new QNH shifts the state along with the
+// measurements, so it does not read as a climb.
+//
+// No Arduino dependencies: tools/altitude_bench.cpp checks the table against
+// the formula and the filter on simulated climbs, and measures update costs.
+
+#define BARO_TABLE_SIZE       256
+#define BARO_RATIO_MIN        0.25f     // ~10.3 km at QNH 1013.25
+#define BARO_RATIO_MAX        1.15f     // ~-1.1 km
+#define BARO_QNH_DEFAULT      1013.25f  // hPa, ICAO standard atmosphere
+#define BARO_SIGMA_ALTITUDE   0.5f      // m, BME280 pressure noise plus drift
+#define BARO_SIGMA_MANEUVER   1.0f      // m/s^2, vertical acceleration without an IMU
+#define BARO_SIGMA_IMU        0.3f      // m/s^2, accelerometer noise when fused
+#define BARO_MAX_GAP_MS       5000
+
+class AltitudeEstimator {
+public:
+   // Builds the lookup table (once) and resets the filter
+   void begin(float qnhHpa = BARO_QNH_DEFAULT);
+
+   void setQnh(float qnhHpa);
+   float qnh() const { return qnhHpa; }
+
+   // Pressure sample (hPa) at nowMs; accel is the vertical acceleration
+   // (m/s^2, up, gravity removed) or NaN without an IMU. NaN pressure is skipped.
+   void update(float pressureHpa, uint32_t nowMs, float accel);
+
+   bool valid() const { return started; }
+   float altitude() const { return height; }        // m, filtered
+   float verticalSpeed() const { return speed; }    // m/s, up
+   float measured() const { return lastMeasured; }  // m, last unfiltered sample
+   uint32_t updates() const { return updateCount; }
+
+   // The formula through the table, and as is
+   static float pressureAltitude(float pressureHpa, float qnhHpa);
+   static float exactAltitude(float pressureHpa, float qnhHpa);
+
+private:
+   float qnhHpa = BARO_QNH_DEFAULT;
+   bool started = false;
+   uint32_t lastMs = 0;
+   float lastPressure = 0;
+   float lastMeasured = 0;
+   float height = 0;
+   float speed = 0;
+   float p00 = 0, p01 = 0, p11 = 0;   // Covariance
+   uint32_t updateCount = 0;
+};
+
+extern AltitudeEstimator baroAltitude;
+
+#endif
@@ -0,0 +1,43 @@
+#include "boot_profile.h"
+
+BootTimeline bootTimeline;
+
+BootTimeline::BootTimeline()
+   : phaseCount(0),
+     fast(false),
+     reason("unknown"),
+     lock(portMUX_INITIALIZER_UNLOCKED) {
+}
+
+void BootTimeline::begin() {
+   switch (esp_reset_reason()) {
+     case ESP_RST_SW:        reason = "software"; fast = true; break;
+     case ESP_RST_PANIC:     reason = "panic";    fast = true; break;
+     case ESP_RST_INT_WDT:
+     case ESP_RST_TASK_WDT:
+     case ESP_RST_WDT:       reason = "watchdog"; fast = true; break;
+     case ESP_RST_DEEPSLEEP: reason = "deepsleep"; fast = true; break;
+     case ESP_RST_POWERON:   reason = "poweron";  break;
+     case ESP_RST_BROWNOUT:  reason = "brownout"; break;
+     case ESP_RST_EXT:       reason = "external"; break;
+     default:                break;
+   }
+}
+
+void BootTimeline::mark(const char* phase) {
+   uint32_t now = (uint32_t)esp_timer_get_time();
+   portENTER_CRITICAL(&lock);
+   if (phaseCount < BOOT_MAX_PHASES) {
+     phases[phaseCount].name = phase;
+     phases[phaseCount].micros = now;
+     phaseCount++;
+   }
+   portEXIT_CRITICAL(&lock);
+}
+
+uint32_t BootTimeline::at(const char* name) const {
+   for (int i = 0; i < phaseCount; i++) {
+     if (strcmp(phases[i].name, name) == 0) return phases[i].micros;
+   }
+   return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <Arduino.h>
+
+// Boot timeline
+//
+// Each init phase records the time it finished (µs since the app started),
+// from setup() or from the background init task. The first telemetry packet
+// publishes the whole timeline so slow phases show up on the ground.
+//
+// A warm reset (software restart, watchdog, panic, deep sleep) takes the
+// fast-boot path: no splash screens, the default mode starts sampling right
+// away and sensor/WiFi/MQTT init runs in a background task. A cold power-on
+// keeps the full boot sequence.
+
+#define BOOT_MAX_PHASES        16
+#define BOOT_FIRST_SAMPLE_GOAL 300000  // µs from reset to the first mode tick
+
+struct BootPhase {
+   const char* name;
+   uint32_t micros;
+};
+
+class BootTimeline {
+public:
+   BootTimeline();
+
+   // Pick the boot path from the reset reason
+   void begin();
+
+   // Record the end of a phase (safe from any task; extra phases are ignored)
+   void mark(const char* phase);
+
+   bool fastBoot() const { return fast; }
+   const char* resetReason() const { return reason; }
+   int count() const { return phaseCount; }
+   const BootPhase& phase(int i) const { return phases[i]; }
+
+   // Time of the named phase, or 0 if it has not happened yet
+   uint32_t at(const char* name) const;
+
+private:
+   BootPhase phases[BOOT_MAX_PHASES];
+   volatile int phaseCount;
+   bool fast;
+   const char* reason;
+   portMUX_TYPE lock;
+};
+
+extern BootTimeline bootTimeline;
+
+#endif
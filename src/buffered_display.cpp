@@ -0,0 +1,213 @@
+#include "buffered_display.h"
+
+BufferedDisplay::BufferedDisplay(uint8_t w, uint8_t h, TwoWire* twi, int8_t rstPin)
+   : Adafruit_SSD1306(w, h, twi, rstPin),
+     bus(twi),
+     busManager(nullptr),
+     busDevice(-1),
+     address(0),
+     frameBytes(w * ((h + 7) / 8)),
+     readyBuffer(nullptr),
+     frontBuffer(nullptr),
+     frameReady(false),
+     transferring(false),
+     pendingContrast(-1),
+     frameInterval(DISPLAY_FRAME_INTERVAL),
+     frameObserver(nullptr),
+     frameOverlay(nullptr),
+     drawCount(0),
+     sentCount(0),
+     droppedCount(0),
+     transferMicros(0),
+     lock(portMUX_INITIALIZER_UNLOCKED),
+     task(nullptr) {
+}
+
+bool BufferedDisplay::begin(uint8_t switchvcc, uint8_t i2caddr) {
+   if (!Adafruit_SSD1306::begin(switchvcc, i2caddr)) {
+     return false;
+   }
+   address = i2caddr;
+   canvas.attach(getBuffer(), WIDTH, HEIGHT);
+
+   readyBuffer = (uint8_t*)malloc(frameBytes);
+   frontBuffer = (uint8_t*)malloc(frameBytes);
+   if (!readyBuffer || !frontBuffer) {
+     // Without the extra buffers fall back to blocking transfers
+     free(readyBuffer);
+     free(frontBuffer);
+     readyBuffer = frontBuffer = nullptr;
+     return true;
+   }
+
+   // Run the bus transfers on core 0 so the render loop on core 1 never waits
+   if (xTaskCreatePinnedToCore(transferTask, "display", 2048, this, 1, &task, 0) != pdPASS) {
+     task = nullptr;
+   }
+   return true;
+}
+
+void BufferedDisplay::drawPixel(int16_t x, int16_t y, uint16_t color) {
+   drawCount++;
+   if (pageNative()) canvas.pixel(x, y, color);
+   else Adafruit_SSD1306::drawPixel(x, y, color);
+}
+
+void BufferedDisplay::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+   drawCount++;
+   if (pageNative()) canvas.hline(x, y, w, color);
+   else Adafruit_SSD1306::drawFastHLine(x, y, w, color);
+}
+
+void BufferedDisplay::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+   drawCount++;
+   if (pageNative()) canvas.vline(x, y, h, color);
+   else Adafruit_SSD1306::drawFastVLine(x, y, h, color);
+}
+
+void BufferedDisplay::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+   if (!pageNative()) {
+     Adafruit_SSD1306::fillRect(x, y, w, h, color);    // One draw call per column
+     return;
+   }
+   drawCount++;
+   canvas.fillRect(x, y, w, h, color);
+}
+
+void BufferedDisplay::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+   if (!pageNative()) {
+     Adafruit_SSD1306::drawLine(x0, y0, x1, y1, color);
+     return;
+   }
+   drawCount++;
+   canvas.line(x0, y0, x1, y1, color);
+}
+
+void BufferedDisplay::drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+   if (!pageNative()) {
+     Adafruit_SSD1306::drawCircle(x0, y0, r, color);
+     return;
+   }
+   drawCount++;
+   canvas.circle(x0, y0, r, color);
+}
+
+void BufferedDisplay::fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+   if (!pageNative()) {
+     Adafruit_SSD1306::fillCircle(x0, y0, r, color);
+     return;
+   }
+   drawCount++;
+   canvas.fillCircle(x0, y0, r, color);
+}
+
+void BufferedDisplay::display() {
+   if (frameObserver) {
+     frameObserver(getBuffer(), frameBytes);
+   }
+   if (frameOverlay) {
+     frameOverlay();
+   }
+
+   if (!task) {
+     uint32_t start = micros();
+     Adafruit_SSD1306::display();
+     transferMicros = micros() - start;
+     sentCount++;
+     return;
+   }
+
+   portENTER_CRITICAL(&lock);
+   if (frameReady) {
+     droppedCount++;
+   }
+   memcpy(readyBuffer, getBuffer(), frameBytes);
+   frameReady = true;
+   portEXIT_CRITICAL(&lock);
+
+   xTaskNotifyGive(task);
+}
+
+void BufferedDisplay::setContrast(uint8_t level) {
+   if (!task) {
+     ssd1306_command(SSD1306_SETCONTRAST);
+     ssd1306_command(level);
+     return;
+   }
+   portENTER_CRITICAL(&lock);
+   pendingContrast = level;
+   portEXIT_CRITICAL(&lock);
+}
+
+void BufferedDisplay::flush() {
+   while (task && (frameReady || transferring)) {
+     delay(1);
+   }
+}
+
+void BufferedDisplay::transferTask(void* arg) {
+   BufferedDisplay* self = (BufferedDisplay*)arg;
+   unsigned long lastStart = 0;
+
+   for (;;) {
+     ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+     // Frame pacing: frames arriving faster than the interval are coalesced
+     unsigned long sinceLast = millis() - lastStart;
+     if (sinceLast < self->frameInterval) {
+       vTaskDelay(pdMS_TO_TICKS(self->frameInterval - sinceLast));
+     }
+
+     portENTER_CRITICAL(&self->lock);
+     if (!self->frameReady) {
+       portEXIT_CRITICAL(&self->lock);
+       continue;
+     }
+     uint8_t* swap = self->frontBuffer;
+     self->frontBuffer = self->readyBuffer;
+     self->readyBuffer = swap;
+     self->frameReady = false;
+     self->transferring = true;
+     int16_t contrast = self->pendingContrast;
+     self->pendingContrast = -1;
+     portEXIT_CRITICAL(&self->lock);
+
+     lastStart = millis();
+     uint32_t start = micros();
+     self->transfer(self->frontBuffer, contrast);
+     self->transferMicros = micros() - start;
+     self->sentCount++;
+     self->transferring = false;
+   }
+}
+
+void BufferedDisplay::transfer(const uint8_t* frame, int16_t contrast) {
+   // Address the whole panel, same window as Adafruit_SSD1306::display()
+   static const uint8_t window[] = {
+     SSD1306_PAGEADDR, 0, 0xFF,
+     SSD1306_COLUMNADDR, 0
+   };
+   if (busManager) busManager->acquire(busDevice);
+   bus->beginTransmission(address);
+   bus->write((uint8_t)0x00); // Command stream
+   bus->write(window, sizeof(window));
+   bus->write((uint8_t)(WIDTH - 1));
+   if (contrast >= 0) {
+     bus->write((uint8_t)SSD1306_SETCONTRAST);
+     bus->write((uint8_t)contrast);
+   }
+   bus->endTransmission();
+   if (busManager) busManager->release(busDevice, sizeof(window) + 3 + (contrast >= 0 ? 2 : 0));
+
+   // Each chunk is its own transaction so higher-priority devices can use the bus in between
+   for (size_t offset = 0; offset < frameBytes; offset += DISPLAY_I2C_CHUNK) {
+     size_t count = frameBytes - offset;
+     if (count > DISPLAY_I2C_CHUNK) count = DISPLAY_I2C_CHUNK;
+     if (busManager) busManager->acquire(busDevice);
+     bus->beginTransmission(address);
+     bus->write((uint8_t)0x40); // Data stream
+     bus->write(frame + offset, count);
+     bus->endTransmission();
+     if (busManager) busManager->release(busDevice, count + 2);
+   }
+}
@@ -0,0 +1,100 @@
+#ifndef BUFFERED_DISPLAY_H
+#define BUFFERED_DISPLAY_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_SSD1306.h>
+#include "i2c_bus.h"
+#include "page_canvas.h"
+
+// SSD1306 driver with asynchronous frame transfer
+//
+// Modes keep drawing into the Adafruit GFX buffer (the back buffer). display()
+// copies the finished frame into a hand-off buffer and returns immediately; a
+// background FreeRTOS task swaps it with the front buffer and pushes that over
+// I2C. The ESP32-S3 I2C driver is interrupt driven, so the CPU is free to
+// render the next frame while the bus transfer is running.
+//
+// If a new frame is submitted before the task picked up the previous one, the
+// older frame is overwritten and counted as dropped; the panel always shows
+// the most recent complete frame.
+//
+// Pixels, spans, lines, rectangles and circles are drawn by PageCanvas
+// straight into the page-ordered buffer instead of pixel by pixel through
+// Adafruit_GFX; the frames are identical. Rotated displays keep the GFX path.
+
+#define DISPLAY_I2C_CHUNK       64     // Data bytes per I2C transaction
+#define DISPLAY_FRAME_INTERVAL  20     // Default minimum ms between transfers (50 fps)
+#define DISPLAY_CONTRAST_FULL   0xCF   // Adafruit_SSD1306::begin() value with the charge pump
+#define DISPLAY_CONTRAST_DIM    0x10
+
+class BufferedDisplay : public Adafruit_SSD1306 {
+public:
+   BufferedDisplay(uint8_t w, uint8_t h, TwoWire* twi, int8_t rstPin);
+
+   // Same arguments as Adafruit_SSD1306::begin(); also starts the transfer task
+   bool begin(uint8_t switchvcc, uint8_t i2caddr);
+
+   // Route frame transfers through the bus manager, one chunk per transaction
+   void attachBus(I2cBus* manager, int device) { busManager = manager; busDevice = device; }
+
+   // Queue the current frame for transfer (non-blocking)
+   void display();
+
+   // Block until every queued frame is on the panel (before reboot or long stalls)
+   void flush();
+
+   void setFrameInterval(unsigned long ms) { frameInterval = ms; }
+
+   // Panel contrast, sent ahead of the next frame so it never races a transfer
+   void setContrast(uint8_t level);
+
+   // Called with every submitted frame before it is queued (input trace checks)
+   void setFrameObserver(void (*observer)(const uint8_t* frame, size_t length)) { frameObserver = observer; }
+
+   // Drawn over every submitted frame after the observer saw it (alert banner)
+   void setOverlay(void (*overlay)()) { frameOverlay = overlay; }
+
+   // Primitives reaching the driver, one draw call each: shapes draw directly,
+   // glyphs and everything else in GFX end up as pixels and spans
+   void drawPixel(int16_t x, int16_t y, uint16_t color);
+   void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+   void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+   void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+   void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+   void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+   void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+   uint32_t drawCalls() const { return drawCount; }
+
+   uint32_t framesSent() const { return sentCount; }
+   uint32_t framesDropped() const { return droppedCount; }
+   uint32_t lastTransferMicros() const { return transferMicros; }
+
+private:
+   static void transferTask(void* arg);
+   void transfer(const uint8_t* frame, int16_t contrast);
+   bool pageNative() const { return canvas.attached() && getRotation() == 0; }
+
+   TwoWire* bus;
+   I2cBus* busManager;
+   int busDevice;
+   uint8_t address;
+   size_t frameBytes;
+   uint8_t* readyBuffer;    // Latest submitted frame, waiting for the task
+   uint8_t* frontBuffer;    // Frame currently on the bus
+   volatile bool frameReady;
+   volatile bool transferring;
+   int16_t pendingContrast;   // -1 when unchanged
+   unsigned long frameInterval;
+   void (*frameObserver)(const uint8_t* frame, size_t length);
+   void (*frameOverlay)();
+   PageCanvas canvas;
+   uint32_t drawCount;
+   volatile uint32_t sentCount;
+   volatile uint32_t droppedCount;
+   volatile uint32_t transferMicros;
+   portMUX_TYPE lock;
+   TaskHandle_t task;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "burst_capture.h"
+
+#include <string.h>
+
+BurstCapture burstCapture;
+
+static_assert(sizeof(BurstSample) == 16, "Capture layout assumes 16-byte samples");
+
+static const char* const triggerNames[BURST_TRIGGERS] = { "manual", "free_fall", "cat_alert" };
+
+// CRC-32 as in zlib, so the ground can check with a stock library
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+   crc = ~crc;
+   while (length--) {
+     crc ^= *data++;
+     for (int bit = 0; bit < 8; bit++) {
+       crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+     }
+   }
+   return ~crc;
+}
+
+static void put16(uint8_t* out, uint16_t value) {
+   out[0] = value;
+   out[1] = value >> 8;
+}
+
+static void put32(uint8_t* out, uint32_t value) {
+   put16(out, value);
+   put16(out + 2, value >> 16);
+}
+
+const char* BurstCapture::triggerName(BurstTrigger source) {
+   return source < BURST_TRIGGERS ? triggerNames[source] : "unknown";
+}
+
+void BurstCapture::add(const BurstSample& sample) {
+   if (state == BURST_DOWNLINK) return;
+   ring[head] = sample;
+   head = (head + 1) % ringSize;
+   if (count < ringSize) count++;
+
+   if (state == BURST_POST_TRIGGER && --postLeft == 0) {
+     freeze();
+   }
+}
+
+bool BurstCapture::trigger(BurstTrigger source, int64_t unixMicros) {
+   if (state != BURST_ARMED || count == 0) {
+     missedCount++;
+     return false;
+   }
+   this->source = source;
+   preCount = count < BURST_PRE_SAMPLES ? count : BURST_PRE_SAMPLES;
+   triggerMs = ring[(head + ringSize - 1) % ringSize].timeMs;
+   triggerUnix = unixMicros;
+   postLeft = BURST_POST_SAMPLES;
+   state = BURST_POST_TRIGGER;
+   return true;
+}
+
+void BurstCapture::freeze() {
+   total = preCount + BURST_POST_SAMPLES;
+   first = (head + ringSize - total) % ringSize;
+
+   uint32_t crc = 0;
+   for (int i = 0; i < total; i++) {
+     const BurstSample& sample = ring[(first + i) % ringSize];
+     crc = crc32Update(crc, (const uint8_t*)&sample, sizeof(sample)); // Xtensa is little endian
+   }
+
+   header[0] = source;
+   header[1] = BURST_VERSION;
+   put16(header + 2, BURST_SAMPLE_MS);
+   put16(header + 4, total);
+   put16(header + 6, preCount);
+   put32(header + 8, triggerMs);
+   put32(header + 12, (uint32_t)triggerUnix);
+   put32(header + 16, (uint32_t)((uint64_t)triggerUnix >> 32));
+   put32(header + 20, crc);
+
+   captureBytes = BURST_HEADER_BYTES + total * sizeof(BurstSample);
+   chunkCount = (captureBytes + BURST_CHUNK_BYTES - 1) / BURST_CHUNK_BYTES;
+   nextChunk = 0;
+   captureId++;
+   state = BURST_DOWNLINK;
+}
+
+uint8_t BurstCapture::captureByte(uint32_t offset) const {
+   if (offset < BURST_HEADER_BYTES) return header[offset];
+   offset -= BURST_HEADER_BYTES;
+   const BurstSample& sample = ring[(first + offset / sizeof(BurstSample)) % ringSize];
+   return ((const uint8_t*)&sample)[offset % sizeof(BurstSample)];
+}
+
+size_t BurstCapture::chunk(uint8_t* out, size_t size) const {
+   if (state != BURST_DOWNLINK || nextChunk >= chunkCount) return 0;
+   uint32_t start = (uint32_t)nextChunk * BURST_CHUNK_BYTES;
+   uint32_t length = captureBytes - start < BURST_CHUNK_BYTES ? captureBytes - start : BURST_CHUNK_BYTES;
+   if (size < BURST_CHUNK_HEADER + length) return 0;
+
+   out[0] = 'B';
+   out[1] = 'C';
+   out[2] = BURST_VERSION;
+   out[3] = source;
+   put16(out + 4, captureId);
+   put16(out + 6, nextChunk);
+   put16(out + 8, chunkCount);
+   put16(out + 10, length);
+   for (uint32_t i = 0; i < length; i++) {
+     out[BURST_CHUNK_HEADER + i] = captureByte(start + i);
+   }
+   return BURST_CHUNK_HEADER + length;
+}
+
+void BurstCapture::chunkSent() {
+   if (state != BURST_DOWNLINK) return;
+   if (++nextChunk < chunkCount) return;
+
+   // Re-arm with a fresh history: the samples skipped during the downlink leave a gap
+   head = 0;
+   count = 0;
+   state = BURST_ARMED;
+}
@@ -0,0 +1,110 @@
+#ifndef BURST_CAPTURE_H
+#define BURST_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Event-triggered burst capture
+//
+// A sampler in loop() feeds BURST_SAMPLE_MS samples into a ring holding
+// BURST_PRE_SAMPLES + BURST_POST_SAMPLES entries. A trigger (Mode 1 free fall,
+// Mode 2 cat safety alert, BURST TRIGGER telecommand) keeps recording for
+// BURST_POST_SAMPLES more, then freezes the ring: the capture is the history
+// before the trigger plus everything after it. The frozen capture is sent as
+// numbered chunks on the burst topic, paced so regular telemetry keeps its
+// slot; once the last chunk is out the ring is re-armed with a fresh history.
+// Triggers arriving meanwhile are counted as missed.
+//
+// Everything lives in the fixed-size object, nothing is allocated. Capture
+// layout (little endian), split over chunks of up to BURST_CHUNK_BYTES:
+//   u8 trigger, u8 version, u16 sample interval (ms), u16 samples,
+//   u16 samples up to and including the trigger, u32 trigger time (ms since boot),
+//   i64 trigger time (Unix µs, 0 before SNTP sync), u32 CRC-32 of the samples,
+//   then per sample: u32 time (ms since boot), u32 touch right, u32 touch left,
+//   f32 pressure (hPa, NaN without BME280)
+// Each MQTT message: "BC", u8 version, u8 trigger, u16 capture id, u16 chunk,
+// u16 chunk count, u16 payload length, payload. tools/burst_tool.py decodes it.
+
+#define BURST_VERSION         1
+#define BURST_SAMPLE_MS       20       // 50 Hz
+#define BURST_PRE_SAMPLES     250      // 5 s before the trigger
+#define BURST_POST_SAMPLES    250      // 5 s after it
+#define BURST_CHUNK_BYTES     512      // Capture bytes per MQTT message
+#define BURST_CHUNK_HEADER    12
+#define BURST_CHUNK_INTERVAL  100      // ms between chunks
+#define BURST_HEADER_BYTES    24
+
+enum BurstTrigger {
+   BURST_TRIGGER_MANUAL,      // BURST TRIGGER telecommand
+   BURST_TRIGGER_FREE_FALL,   // Mode 1
+   BURST_TRIGGER_CAT_ALERT,   // Mode 2
+   BURST_TRIGGERS
+};
+
+enum BurstState {
+   BURST_ARMED,               // Recording history, waiting for a trigger
+   BURST_POST_TRIGGER,        // Recording the samples after the trigger
+   BURST_DOWNLINK             // Frozen, chunks being sent
+};
+
+struct BurstSample {
+   uint32_t timeMs;
+   uint32_t touchRight;
+   uint32_t touchLeft;
+   float pressure;
+};
+
+class BurstCapture {
+public:
+   // Sampler input; ignored while a capture is being sent
+   void add(const BurstSample& sample);
+
+   // Start a capture at the latest sample; false (counted as missed) while one is running
+   bool trigger(BurstTrigger source, int64_t unixMicros);
+
+   // Sampling is only worth the bus time while a capture can start or is filling
+   bool sampling() const { return state != BURST_DOWNLINK; }
+
+   // Next chunk message of the frozen capture into out; 0 when there is none.
+   // The chunk is repeated until chunkSent() acknowledges it.
+   size_t chunk(uint8_t* out, size_t size) const;
+   void chunkSent();
+
+   BurstState status() const { return state; }
+   uint16_t captures() const { return captureId; }
+   uint32_t missed() const { return missedCount; }
+   uint16_t chunksLeft() const { return state == BURST_DOWNLINK ? chunkCount - nextChunk : 0; }
+
+   static const char* triggerName(BurstTrigger source);
+
+private:
+   static const int ringSize = BURST_PRE_SAMPLES + BURST_POST_SAMPLES;
+
+   void freeze();
+   uint8_t captureByte(uint32_t offset) const;
+
+   BurstSample ring[ringSize];
+   int head = 0;                 // Next slot to write
+   int count = 0;                // Valid samples in the ring
+   BurstState state = BURST_ARMED;
+
+   BurstTrigger source = BURST_TRIGGER_MANUAL;
+   int postLeft = 0;
+   int preCount = 0;
+   uint32_t triggerMs = 0;
+   int64_t triggerUnix = 0;
+
+   // Frozen capture
+   uint8_t header[BURST_HEADER_BYTES];
+   int first = 0;                // Ring index of the oldest captured sample
+   int total = 0;
+   uint32_t captureBytes = 0;
+   uint16_t chunkCount = 0;
+   uint16_t nextChunk = 0;
+   uint16_t captureId = 0;
+   uint32_t missedCount = 0;
+};
+
+extern BurstCapture burstCapture;
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef CADSE_H
+#define CADSE_H
+
+// CADSE v5 shared hardware configuration and global objects
+// Included by main.cpp and by every mode implementation (src/mode*_*.cpp)
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_SSD1306.h>
+#include <Adafruit_Sensor.h>
+#include <Adafruit_BME280.h>
+#include <Preferences.h>
+#include "orbit_propagator.h"
+#include "buffered_display.h"
+#include "i2c_bus.h"
+#include "input_trace.h"
+
+#define SCREEN_WIDTH 128
+#define SCREEN_HEIGHT 64
+#define OLED_RESET    -1
+#define SCREEN_ADDRESS 0x3C
+// End of display_config group
+
+#define BATTERY_PIN     7
+#define USB_VOLTAGE_PIN 3
+#define BUZZER_PIN      14
+#define LED_PIN         15
+
+#define TOUCH_UP        1
+#define TOUCH_LEFT      2
+#define TOUCH_X         4
+#define TOUCH_DOWN      5
+#define TOUCH_RIGHT     6
+
+// For backward compatibility with existing code
+#define TOUCH_PIN_PREV  TOUCH_LEFT
+#define TOUCH_PIN_NEXT  TOUCH_RIGHT
+// End of pin_definitions group
+
+#define BATTERY_VOLTAGE_MULTIPLIER  1.7
+#define USB_VOLTAGE_MULTIPLIER      1.9
+#define LOW_BATTERY_THRESHOLD       3.6
+// End of voltage_params group
+
+// Telemetry channel sampling for the windowed statistics (window_stats.h)
+#define STATS_TOUCH_MS  20    // Touch pads, 50 Hz
+#define STATS_ADC_MS    10    // Battery and USB voltage dividers, 100 Hz
+#define STATS_BME_MS    125   // BME280 at x16 oversampling converts every ~113 ms
+// End of sampling_config group
+
+const int touchThreshold = 60000;  // Default; runtime value is PARAM_TOUCH_THRESHOLD
+const int channelBuzzer = 0;
+// End of touch_config group
+
+// Global objects (defined in main.cpp)
+extern I2cBus i2cBus;
+extern BufferedDisplay display;
+extern Adafruit_BME280 bme;
+extern PubSubClient mqttClient;
+extern Preferences preferences;
+extern OrbitPropagator orbitPropagator;
+extern Ephemeris orbitEphemeris;
+// End of global_objects group
+
+// Global state (defined in main.cpp)
+extern int currentMode;
+extern volatile int nextMode;
+extern float batteryVoltage;
+extern float usbVoltage;
+extern bool lowBatteryAlert;
+extern bool orbitValid;
+extern volatile bool bmeAvailable;
+extern int i2cDisplay;
+extern int i2cBme280;
+// End of global_vars group
+
+#endif
@@ -0,0 +1,125 @@
+#include "display_mirror.h"
+
+#include <string.h>
+
+DisplayMirror displayMirror;
+
+static void put16(uint8_t* out, uint16_t value) {
+   out[0] = value;
+   out[1] = value >> 8;
+}
+
+static void put32(uint8_t* out, uint32_t value) {
+   put16(out, value);
+   put16(out + 2, value >> 16);
+}
+
+// CRC-32 as in zlib, so the ground can check with a stock library
+uint32_t DisplayMirror::crc32(const uint8_t* data, size_t length) {
+   uint32_t crc = 0xFFFFFFFF;
+   while (length--) {
+     crc ^= *data++;
+     for (int bit = 0; bit < 8; bit++) {
+       crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+     }
+   }
+   return ~crc;
+}
+
+size_t DisplayMirror::rle(const uint8_t* data, size_t length, uint8_t* out, size_t size) {
+   // out == nullptr only counts
+   size_t used = 0;
+   size_t literalStart = 0;
+   size_t i = 0;
+   while (i <= length) {
+     size_t run = 1;
+     if (i < length) {
+       while (i + run < length && data[i + run] == data[i] && run < MIRROR_MAX_RUN) run++;
+     }
+
+     // Flush pending literals before a run and at the end, in blocks of up to 128
+     if (i == length || run >= MIRROR_MIN_RUN) {
+       while (literalStart < i) {
+         size_t count = i - literalStart < MIRROR_MAX_LITERALS ? i - literalStart : MIRROR_MAX_LITERALS;
+         if (out) {
+           if (used + 1 + count > size) return 0;
+           out[used] = count - 1;
+           memcpy(out + used + 1, data + literalStart, count);
+         }
+         used += 1 + count;
+         literalStart += count;
+       }
+       if (i == length) break;
+       if (out) {
+         if (used + 2 > size) return 0;
+         out[used] = 0x80 + run - MIRROR_MIN_RUN;
+         out[used + 1] = data[i];
+       }
+       used += 2;
+       literalStart = i + run;
+     }
+     i += run;
+   }
+   return used;
+}
+
+void DisplayMirror::begin(uint16_t width, uint16_t height) {
+   this->width = width;
+   this->height = height;
+   frameBytes = (size_t)width * height / 8;
+   if (frameBytes > MIRROR_MAX_FRAME) frameBytes = 0;   // Mirror stays off
+   keyWanted = true;
+   pendingFrame = nullptr;
+}
+
+size_t DisplayMirror::encode(const uint8_t* frame, uint32_t nowMs, uint8_t* out, size_t size) {
+   pendingFrame = nullptr;
+   if (frameBytes == 0 || size < MIRROR_HEADER_BYTES) return 0;
+
+   bool changed = false;
+   for (size_t i = 0; i < frameBytes; i++) {
+     delta[i] = frame[i] ^ reference[i];
+     if (delta[i]) changed = true;
+   }
+   bool keyDue = keyWanted || nowMs - lastKeyMs >= MIRROR_KEY_INTERVAL;
+   if (!changed && !keyDue) {
+     unchangedCount++;
+     return 0;
+   }
+
+   // Size both codings first, then write the smaller one
+   bool key = keyDue || rle(frame, frameBytes, nullptr, 0) <= rle(delta, frameBytes, nullptr, 0);
+   size_t length = rle(key ? frame : delta, frameBytes, out + MIRROR_HEADER_BYTES, size - MIRROR_HEADER_BYTES);
+   if (length == 0) return 0;
+
+   out[0] = 'D';
+   out[1] = 'M';
+   out[2] = MIRROR_VERSION;
+   out[3] = key ? MIRROR_KEY : MIRROR_DELTA;
+   put16(out + 4, sequence);
+   put16(out + 6, width);
+   put16(out + 8, height);
+   put16(out + 10, length);
+   put32(out + 12, crc32(frame, frameBytes));
+
+   pendingFrame = frame;
+   pendingKey = key;
+   pendingLength = MIRROR_HEADER_BYTES + length;
+   pendingMs = nowMs;
+   return pendingLength;
+}
+
+void DisplayMirror::sent() {
+   if (!pendingFrame) return;
+   memcpy(reference, pendingFrame, frameBytes);
+   if (pendingKey) {
+     keyWanted = false;
+     lastKeyMs = pendingMs;
+     keyCount++;
+   }
+   sequence++;
+   frameCount++;
+   byteCount += pendingLength;
+   lastLength = pendingLength;
+   pendingFrame = nullptr;
+}
@@ -0,0 +1,91 @@
+#ifndef DISPLAY_MIRROR_H
+#define DISPLAY_MIRROR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Compressed framebuffer mirror for the ground
+//
+// Every mirror_period_ms the finished SSD1306 frame (1 KB in page layout) is
+// offered to encode(). Most frames differ from the last one sent in a few
+// bytes, so the frame is XOR'd with it and the difference run-length coded;
+// a keyframe codes the frame itself. Whichever is smaller is sent, and a
+// keyframe at least every MIRROR_KEY_INTERVAL so a decoder joining late or
+// after a lost message catches up. Unchanged frames are not sent at all: a
+// static screen costs one keyframe per interval.
+//
+// RLE (PackBits style): control byte c < 0x80 is followed by c + 1 literal
+// bytes; c >= 0x80 by one byte repeated c - 0x80 + MIRROR_MIN_RUN times.
+// Message (little endian): "DM", u8 version, u8 type (0 key, 1 delta),
+// u16 sequence, u16 width, u16 height, u16 payload length, u32 CRC-32 of the
+// decoded frame, payload. tools/mirror_decode.cpp turns a capture into PGM
+// or PNG frames and checks each CRC.
+//
+// The reference frame only moves on when the caller reports the message as
+// sent, so a failed publish is retried against the frame the ground has.
+// No Arduino dependencies.
+
+#define MIRROR_VERSION        1
+#define MIRROR_HEADER_BYTES   16
+#define MIRROR_MAX_FRAME      1024     // 128 x 64 / 8
+#define MIRROR_MIN_RUN        3        // Shorter repeats go out as literals
+#define MIRROR_MAX_RUN        (0x7F + MIRROR_MIN_RUN)
+#define MIRROR_MAX_LITERALS   0x80
+#define MIRROR_KEY_INTERVAL   10000    // ms between forced keyframes
+// Worst case: all literals, one control byte per MIRROR_MAX_LITERALS
+#define MIRROR_MESSAGE_BYTES  (MIRROR_HEADER_BYTES + MIRROR_MAX_FRAME + MIRROR_MAX_FRAME / MIRROR_MAX_LITERALS)
+
+enum MirrorFrameType {
+   MIRROR_KEY,
+   MIRROR_DELTA
+};
+
+class DisplayMirror {
+public:
+   // Frame geometry; width * height / 8 bytes, at most MIRROR_MAX_FRAME
+   void begin(uint16_t width, uint16_t height);
+
+   // Message for frame into out, 0 if it is unchanged and no keyframe is due.
+   // frame must stay untouched until sent().
+   size_t encode(const uint8_t* frame, uint32_t nowMs, uint8_t* out, size_t size);
+   void sent();
+
+   // Next message is a keyframe (mirror switched on, decoder asked for one)
+   void requestKey() { keyWanted = true; }
+
+   // Run-length code length bytes; returns the coded size, 0 if it does not fit
+   static size_t rle(const uint8_t* data, size_t length, uint8_t* out, size_t size);
+   static uint32_t crc32(const uint8_t* data, size_t length);
+
+   uint32_t frames() const { return frameCount; }
+   uint32_t keys() const { return keyCount; }
+   uint32_t unchanged() const { return unchangedCount; }
+   uint32_t bytes() const { return byteCount; }
+   uint16_t lastBytes() const { return lastLength; }
+
+private:
+   uint16_t width = 0;
+   uint16_t height = 0;
+   size_t frameBytes = 0;
+   uint8_t reference[MIRROR_MAX_FRAME];  // Frame the ground has
+   uint8_t delta[MIRROR_MAX_FRAME];
+   bool keyWanted = true;
+   uint32_t lastKeyMs = 0;
+   uint16_t sequence = 0;
+
+   // Message waiting for sent()
+   const uint8_t* pendingFrame = nullptr;
+   bool pendingKey = false;
+   uint16_t pendingLength = 0;
+   uint32_t pendingMs = 0;
+
+   uint32_t frameCount = 0;
+   uint32_t keyCount = 0;
+   uint32_t unchangedCount = 0;
+   uint32_t byteCount = 0;
+   uint16_t lastLength = 0;
+};
+
+extern DisplayMirror displayMirror;
+
+#endif
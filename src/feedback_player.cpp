@@ -0,0 +1,81 @@
+#include "feedback_player.h"
+
+FeedbackPlayer feedback;
+
+static int feedbackLedPin = -1;
+
+void FeedbackPlayer::begin(int buzzerPin, int ledPin) {
+   feedbackLedPin = ledPin;
+   ledcSetup(FEEDBACK_LEDC_CHANNEL, 2000, FEEDBACK_LEDC_BITS);
+   ledcAttachPin(buzzerPin, FEEDBACK_LEDC_CHANNEL);
+   sequencer.begin(toneOut, ledOut);
+
+   esp_timer_create_args_t args = {};
+   args.callback = timerCallback;
+   args.arg = this;
+   args.dispatch_method = ESP_TIMER_TASK;
+   args.name = "feedback";
+   if (esp_timer_create(&args, &timer) != ESP_OK) {
+     timer = nullptr;
+     return;
+   }
+   lock = xSemaphoreCreateMutex();
+}
+
+bool FeedbackPlayer::play(const Pattern& pattern, uint8_t repeats) {
+   if (!timer) return false;
+   xSemaphoreTake(lock, portMAX_DELAY);
+   bool started = sequencer.play(pattern, repeats, esp_timer_get_time());
+   if (started) arm();
+   xSemaphoreGive(lock);
+   return started;
+}
+
+void FeedbackPlayer::stop(const Pattern& pattern) {
+   if (!timer) return;
+   xSemaphoreTake(lock, portMAX_DELAY);
+   sequencer.stop(pattern, esp_timer_get_time());
+   arm();
+   xSemaphoreGive(lock);
+}
+
+bool FeedbackPlayer::playing(const Pattern& pattern) {
+   if (!timer) return false;
+   xSemaphoreTake(lock, portMAX_DELAY);
+   bool result = sequencer.playing(pattern);
+   xSemaphoreGive(lock);
+   return result;
+}
+
+int FeedbackPlayer::priority() {
+   if (!timer) return PATTERN_IDLE;
+   xSemaphoreTake(lock, portMAX_DELAY);
+   int result = sequencer.priority();
+   xSemaphoreGive(lock);
+   return result;
+}
+
+void FeedbackPlayer::timerCallback(void* arg) {
+   FeedbackPlayer* player = (FeedbackPlayer*)arg;
+   xSemaphoreTake(player->lock, portMAX_DELAY);
+   player->sequencer.advance(esp_timer_get_time());
+   player->arm();
+   xSemaphoreGive(player->lock);
+}
+
+void FeedbackPlayer::arm() {
+   // Called with the lock held, for the sequencer's next step boundary
+   esp_timer_stop(timer);
+   int64_t due = sequencer.due();
+   if (due == PATTERN_IDLE) return;
+   int64_t wait = due - esp_timer_get_time();
+   esp_timer_start_once(timer, wait > 0 ? wait : 0);
+}
+
+void FeedbackPlayer::toneOut(uint16_t hz) {
+   ledcWriteTone(FEEDBACK_LEDC_CHANNEL, hz);
+}
+
+void FeedbackPlayer::ledOut(bool on) {
+   if (feedbackLedPin >= 0) digitalWrite(feedbackLedPin, on ? HIGH : LOW);
+}
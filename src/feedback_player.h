@@ -0,0 +1,49 @@
+#ifndef FEEDBACK_PLAYER_H
+#define FEEDBACK_PLAYER_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "pattern_sequencer.h"
+
+// Buzzer and LED patterns on the ESP32-S3 peripherals
+//
+// The LEDC peripheral generates the buzzer's square wave, so the CPU only
+// acts at step boundaries: a one-shot esp_timer (backed by the S3's hardware
+// systimer) is armed for the next one and its callback advances the
+// sequencer. The callback runs in the esp_timer task rather than in an
+// interrupt, because the LEDC driver calls are not interrupt safe. play()
+// and stop() are called from the loop task and share the sequencer with the
+// callback under a mutex; neither waits for the pattern.
+//
+// Arduino's tone() is not used any more: it would claim an LEDC channel of
+// its own for the same pin.
+
+#define FEEDBACK_LEDC_CHANNEL   0
+#define FEEDBACK_LEDC_BITS      10
+
+class FeedbackPlayer {
+public:
+   void begin(int buzzerPin, int ledPin);
+
+   // repeats 0: until stop(). False when a pattern of higher priority plays.
+   bool play(const Pattern& pattern, uint8_t repeats = 1);
+   void stop(const Pattern& pattern);
+
+   bool playing(const Pattern& pattern);
+   int priority();
+   const PatternSequencer& stats() const { return sequencer; }
+
+private:
+   static void timerCallback(void* arg);
+   static void toneOut(uint16_t hz);
+   static void ledOut(bool on);
+   void arm();
+
+   PatternSequencer sequencer;
+   esp_timer_handle_t timer = nullptr;
+   SemaphoreHandle_t lock = nullptr;
+};
+
+extern FeedbackPlayer feedback;
+
+#endif
@@ -0,0 +1,46 @@
+#include "frame_pacing.h"
+
+FramePacer framePacer;
+
+void FramePacer::begin(uint32_t nowMs, uint32_t stepMs) {
+   step = stepMs;
+   lastAdvance = nowMs;
+   accumulator = 0;
+   frameCount = 0;
+   lateCount = 0;
+   droppedCount = 0;
+   stepCount = 0;
+   simDropped = 0;
+}
+
+uint32_t FramePacer::frame(uint32_t previousMs, uint32_t nowMs, uint32_t intervalMs) {
+   interval = intervalMs;
+   frameCount++;
+   uint32_t slot = previousMs + intervalMs;
+   int32_t behind = (int32_t)(nowMs - slot);
+   if (behind < 0) behind = 0;                // Interval shortened since the last frame
+
+   if (intervalMs > 0 && (uint32_t)behind >= intervalMs) {
+     droppedCount += behind / intervalMs;
+     lateCount++;
+     return nowMs;
+   }
+   if ((uint32_t)behind > intervalMs / FRAME_LATE_DIVISOR) lateCount++;
+   return slot;
+}
+
+uint32_t FramePacer::advance(uint32_t nowMs) {
+   uint32_t elapsed = nowMs - lastAdvance;
+   lastAdvance = nowMs;
+   if (step == 0) return 0;
+
+   if (elapsed > FRAME_MAX_CATCHUP_MS) {
+     simDropped += elapsed - FRAME_MAX_CATCHUP_MS;
+     elapsed = FRAME_MAX_CATCHUP_MS;
+   }
+   accumulator += elapsed;
+   uint32_t due = accumulator / step;
+   accumulator -= due * step;
+   stepCount += due;
+   return due;
+}
@@ -0,0 +1,67 @@
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include <stdint.h>
+
+// Frame pacing and fixed-timestep simulation for the current mode
+//
+// Frames: a mode renders once per update interval (its target frame rate,
+// tunable as the modeN_interval parameter). frame() schedules the next frame
+// one interval after the slot this one was due in, not after the time loop()
+// happened to get there, so the cadence does not drift by the loop latency
+// each frame. A frame starting more than a quarter interval after its slot
+// counts as late; whole slots that passed without a frame (the loop was
+// stalled by an MQTT reconnect, a blocking publish, ...) count as dropped,
+// and the schedule restarts from now instead of rendering a burst of frames.
+//
+// Simulation: modes with a step interval advance their physics in fixed
+// steps of simulated time. advance() adds the time since the last call to an
+// accumulator and returns the number of whole steps due; the remainder is
+// alpha(), the fraction of a step to interpolate the rendered state by. The
+// animation speed is then the same at any frame rate and any loop timing.
+// After a stall at most FRAME_MAX_CATCHUP_MS are simulated, the rest is
+// dropped and counted: the picture pauses rather than jumping ahead.
+//
+// Times are ms from inputTrace.now(), so replays and the render benchmark
+// step exactly like the recording did. No Arduino dependencies:
+// tools/pacing_sim.cpp runs this against a fake clock with injected stalls.
+
+#define FRAME_MAX_CATCHUP_MS  250     // Most simulated time one frame may catch up
+#define FRAME_LATE_DIVISOR    4       // Late: more than interval / 4 behind the slot
+
+class FramePacer {
+public:
+   // Mode entry: reset the counters; stepMs = 0 for modes without a simulation
+   void begin(uint32_t nowMs, uint32_t stepMs);
+
+   // A frame starting at nowMs; previousMs is when the last one was scheduled.
+   // Returns the time to schedule the next frame from.
+   uint32_t frame(uint32_t previousMs, uint32_t nowMs, uint32_t intervalMs);
+
+   // Whole simulation steps due at nowMs
+   uint32_t advance(uint32_t nowMs);
+   float alpha() const { return step ? (float)accumulator / step : 0.0f; }
+
+   uint32_t intervalMs() const { return interval; }
+   uint32_t stepMs() const { return step; }
+   uint32_t frames() const { return frameCount; }
+   uint32_t late() const { return lateCount; }
+   uint32_t dropped() const { return droppedCount; }
+   uint32_t steps() const { return stepCount; }
+   uint32_t simDroppedMs() const { return simDropped; }
+
+private:
+   uint32_t interval = 0;
+   uint32_t step = 0;
+   uint32_t lastAdvance = 0;
+   uint32_t accumulator = 0;
+   uint32_t frameCount = 0;
+   uint32_t lateCount = 0;
+   uint32_t droppedCount = 0;
+   uint32_t stepCount = 0;
+   uint32_t simDropped = 0;
+};
+
+extern FramePacer framePacer;
+
+#endif
@@ -0,0 +1,80 @@
+#include "heatshrink_decoder.h"
+
+#include <string.h>
+
+static const uint16_t WINDOW_MASK = (1 << HEATSHRINK_WINDOW_BITS) - 1;
+
+void HeatshrinkDecoder::begin(Sink outputSink, void* context) {
+   memset(window, 0, sizeof(window));
+   outputLength = 0;
+   head = 0;
+   bits = 0;
+   bitCount = 0;
+   step = STEP_TAG;
+   backrefIndex = 0;
+   sink = outputSink;
+   sinkContext = context;
+   inCount = 0;
+   outCount = 0;
+}
+
+bool HeatshrinkDecoder::emit(uint8_t value) {
+   window[head] = value;
+   head = (head + 1) & WINDOW_MASK;
+   output[outputLength++] = value;
+   outCount++;
+   if (outputLength == HEATSHRINK_OUTPUT_SIZE) {
+     outputLength = 0;
+     return sink(output, HEATSHRINK_OUTPUT_SIZE, sinkContext);
+   }
+   return true;
+}
+
+bool HeatshrinkDecoder::feed(const uint8_t* data, size_t length) {
+   for (size_t i = 0; i < length; i++) {
+     // Bits are consumed MSB first
+     bits = (bits << 8) | data[i];
+     bitCount += 8;
+     inCount++;
+
+     for (;;) {
+       uint8_t need;
+       switch (step) {
+         case STEP_TAG:     need = 1; break;
+         case STEP_LITERAL: need = 8; break;
+         case STEP_INDEX:   need = HEATSHRINK_WINDOW_BITS; break;
+         default:           need = HEATSHRINK_LOOKAHEAD_BITS; break;
+       }
+       if (bitCount < need) break;
+
+       bitCount -= need;
+       uint16_t value = (bits >> bitCount) & ((1 << need) - 1);
+
+       if (step == STEP_TAG) {
+         // 1 = literal byte, 0 = back-reference into the window
+         step = value ? STEP_LITERAL : STEP_INDEX;
+       } else if (step == STEP_LITERAL) {
+         if (!emit((uint8_t)value)) return false;
+         step = STEP_TAG;
+       } else if (step == STEP_INDEX) {
+         backrefIndex = value + 1;
+         step = STEP_COUNT;
+       } else {
+         uint16_t count = value + 1;
+         for (uint16_t n = 0; n < count; n++) {
+           if (!emit(window[(head - backrefIndex) & WINDOW_MASK])) return false;
+         }
+         step = STEP_TAG;
+       }
+     }
+   }
+   return true;
+}
+
+bool HeatshrinkDecoder::finish() {
+   // Leftover bits are zero padding of the final byte
+   if (outputLength == 0) return true;
+   size_t length = outputLength;
+   outputLength = 0;
+   return sink(output, length, sinkContext);
+}
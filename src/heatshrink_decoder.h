@@ -0,0 +1,52 @@
+#ifndef HEATSHRINK_DECODER_H
+#define HEATSHRINK_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Streaming decoder for the heatshrink LZSS format
+// (https://github.com/atomicobject/heatshrink, compatible with
+// `heatshrink -e -w 11 -l 4`). Input can be fed in arbitrary chunks; output
+// is handed to a sink in blocks of HEATSHRINK_OUTPUT_SIZE bytes, so only the
+// 2^W byte window and one output block are held in RAM.
+
+#define HEATSHRINK_WINDOW_BITS    11
+#define HEATSHRINK_LOOKAHEAD_BITS 4
+#define HEATSHRINK_OUTPUT_SIZE    256
+
+class HeatshrinkDecoder {
+public:
+   // Receives decompressed data; returns false to abort decoding
+   typedef bool (*Sink)(const uint8_t* data, size_t length, void* context);
+
+   void begin(Sink sink, void* context);
+
+   // Decode a chunk of compressed input; false if the sink aborted
+   bool feed(const uint8_t* data, size_t length);
+
+   // Flush the remaining output block; false if the sink aborted
+   bool finish();
+
+   uint32_t bytesIn() const { return inCount; }
+   uint32_t bytesOut() const { return outCount; }
+
+private:
+   enum Step { STEP_TAG, STEP_LITERAL, STEP_INDEX, STEP_COUNT };
+
+   uint8_t window[1 << HEATSHRINK_WINDOW_BITS];
+   uint8_t output[HEATSHRINK_OUTPUT_SIZE];
+   size_t outputLength;
+   uint16_t head;
+   uint32_t bits;
+   uint8_t bitCount;
+   Step step;
+   uint16_t backrefIndex;
+   Sink sink;
+   void* sinkContext;
+   uint32_t inCount;
+   uint32_t outCount;
+
+   bool emit(uint8_t value);
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "i2c_bus.h"
+
+I2cBus::I2cBus(TwoWire& wire)
+   : wire(wire),
+     devices(0),
+     busClock(100000),
+     busy(false),
+     lock(portMUX_INITIALIZER_UNLOCKED),
+     started(false) {
+   for (int p = 0; p < I2C_PRIORITY_COUNT; p++) {
+     waiting[p] = 0;
+     wake[p] = nullptr;
+   }
+}
+
+int I2cBus::addDevice(const char* name, uint8_t address, uint32_t maxClock, I2cPriority priority) {
+   if (devices >= I2C_MAX_DEVICES) {
+     return -1;
+   }
+   I2cDeviceStats& d = table[devices];
+   d.name = name;
+   d.address = address;
+   d.maxClock = maxClock;
+   d.priority = priority;
+   d.transactions = 0;
+   d.bytes = 0;
+   d.busyMicros = 0;
+   d.maxWaitMicros = 0;
+   acquiredAt[devices] = 0;
+   return devices++;
+}
+
+void I2cBus::begin() {
+   // Fastest clock every device on the bus tolerates
+   busClock = I2C_MAX_CLOCK;
+   for (int i = 0; i < devices; i++) {
+     if (table[i].maxClock < busClock) busClock = table[i].maxClock;
+   }
+   wire.setClock(busClock);
+
+   for (int p = 0; p < I2C_PRIORITY_COUNT; p++) {
+     wake[p] = xSemaphoreCreateCounting(8, 0);
+   }
+   started = true;
+
+   Serial.print("I2C bus clock: ");
+   Serial.print(busClock / 1000);
+   Serial.println(" kHz");
+}
+
+void I2cBus::acquire(int device) {
+   uint32_t requested = micros();
+   if (started) {
+     int p = table[device].priority;
+     portENTER_CRITICAL(&lock);
+     if (!busy) {
+       busy = true;
+       portEXIT_CRITICAL(&lock);
+     } else {
+       waiting[p]++;
+       portEXIT_CRITICAL(&lock);
+       // Ownership is handed over directly by release()
+       xSemaphoreTake(wake[p], portMAX_DELAY);
+     }
+   }
+
+   acquiredAt[device] = micros();
+   uint32_t waited = acquiredAt[device] - requested;
+   if (waited > table[device].maxWaitMicros) {
+     table[device].maxWaitMicros = waited;
+   }
+}
+
+void I2cBus::release(int device, size_t bytes) {
+   I2cDeviceStats& d = table[device];
+   d.transactions++;
+   d.bytes += bytes;
+   uint32_t held = micros() - acquiredAt[device];
+   d.busyMicros += held;
+
+   if (!started) {
+     return;
+   }
+
+   portENTER_CRITICAL(&lock);
+   for (int p = 0; p < I2C_PRIORITY_COUNT; p++) {
+     if (waiting[p] > 0) {
+       waiting[p]--;
+       portEXIT_CRITICAL(&lock);
+       xSemaphoreGive(wake[p]);
+       return;
+     }
+   }
+   busy = false;
+   portEXIT_CRITICAL(&lock);
+}
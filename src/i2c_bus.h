@@ -0,0 +1,100 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// I2C bus manager
+//
+// All consumers of the shared Wire bus (SSD1306, BME280, MPU6050) register
+// here with their address, maximum clock and priority. The bus runs at the
+// fastest clock every registered device allows.
+//
+// Before touching Wire a consumer acquires the bus for one transaction. When
+// the bus is busy, waiters are served strictly by priority on release, so a
+// display flush (split into short chunks) delays an IMU read by at most one
+// chunk. Per-device traffic, busy time and worst-case wait are recorded.
+
+#define I2C_MAX_DEVICES   4
+#define I2C_MAX_CLOCK     1000000  // ESP32-S3 supports fast mode plus
+
+// Datasheet clock limits
+#define SSD1306_MAX_CLOCK 400000   // tcycle >= 2.5 us
+#define BME280_MAX_CLOCK  3400000  // High-speed mode
+#define MPU6050_MAX_CLOCK 400000
+
+// Bus traffic of one Adafruit_BME280 read (address, register and data bytes);
+// pressure and humidity reads also read the temperature for t_fine
+#define BME280_TEMPERATURE_BYTES 6
+#define BME280_PRESSURE_BYTES    (BME280_TEMPERATURE_BYTES + 6)
+#define BME280_HUMIDITY_BYTES    (BME280_TEMPERATURE_BYTES + 5)
+#define BME280_SAMPLING_BYTES    12   // setSampling(): four register writes
+
+// Lower value = served first
+enum I2cPriority {
+   I2C_PRIORITY_IMU = 0,
+   I2C_PRIORITY_SENSOR = 1,
+   I2C_PRIORITY_DISPLAY = 2,
+   I2C_PRIORITY_COUNT = 3
+};
+
+struct I2cDeviceStats {
+   const char* name;
+   uint8_t address;
+   uint32_t maxClock;
+   I2cPriority priority;
+   uint32_t transactions;
+   uint32_t bytes;
+   uint64_t busyMicros;     // Total time holding the bus (32 bits wrap after 71.6 min)
+   uint32_t maxWaitMicros;  // Worst time spent waiting for the bus
+};
+
+class I2cBus {
+public:
+   I2cBus(TwoWire& wire);
+
+   // Register a device before begin(); returns its id, or -1 if the table is full
+   int addDevice(const char* name, uint8_t address, uint32_t maxClock, I2cPriority priority);
+
+   // Apply the clock and start arbitration (call after all devices are added)
+   void begin();
+
+   // Claim the bus for one transaction (blocks while a higher-priority user waits)
+   void acquire(int device);
+
+   // Hand the bus to the highest-priority waiter; bytes = traffic of the transaction
+   void release(int device, size_t bytes);
+
+   uint32_t clock() const { return busClock; }
+   int deviceCount() const { return devices; }
+   const I2cDeviceStats& stats(int device) const { return table[device]; }
+
+private:
+   TwoWire& wire;
+   I2cDeviceStats table[I2C_MAX_DEVICES];
+   uint32_t acquiredAt[I2C_MAX_DEVICES];
+   int devices;
+   uint32_t busClock;
+   bool busy;
+   int waiting[I2C_PRIORITY_COUNT];
+   SemaphoreHandle_t wake[I2C_PRIORITY_COUNT];
+   portMUX_TYPE lock;
+   bool started;
+};
+
+// Scoped bus ownership for one group of Wire calls
+class I2cTransaction {
+public:
+   I2cTransaction(I2cBus& bus, int device, size_t bytes = 0) : bus(bus), device(device), bytes(bytes) {
+     bus.acquire(device);
+   }
+   ~I2cTransaction() { bus.release(device, bytes); }
+   void addBytes(size_t count) { bytes += count; }
+
+private:
+   I2cBus& bus;
+   int device;
+   size_t bytes;
+};
+
+#endif
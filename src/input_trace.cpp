@@ -0,0 +1,405 @@
+#include "input_trace.h"
+#include "cadse.h"
+
+#include <LittleFS.h>
+#include <rom/crc.h>
+
+InputTrace inputTrace;
+
+static const uint8_t TRACE_MAGIC[4] = { 'C', 'T', 'R', 'C' };
+
+bool InputTrace::mount() {
+   static bool mounted = false;
+   if (!mounted) {
+     // Format on first use of the data partition
+     mounted = LittleFS.begin(true);
+   }
+   return mounted;
+}
+
+bool InputTrace::startRecording(int mode) {
+   stop();
+   if (!mount()) return false;
+   file = LittleFS.open(TRACE_PATH, "w");
+   if (!file) return false;
+
+   stats = TraceSummary();
+   bufferLength = 0;
+   wallStart = millis();
+   startTime = lastTime = tickTime = wallStart;
+
+   putBytes(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+   put(TRACE_VERSION);
+   put((uint8_t)mode);
+   put(0);
+   put(0);
+   putBytes(&startTime, sizeof(startTime));
+
+   traceState = TRACE_RECORDING;
+   return true;
+}
+
+bool InputTrace::startReplay(int& mode) {
+   stop();
+   if (!mount()) return false;
+   file = LittleFS.open(TRACE_PATH, "r");
+   if (!file) return false;
+
+   stats = TraceSummary();
+   bufferLength = 0;
+   bufferPos = 0;
+
+   uint8_t header[12];
+   if (!getBytes(header, sizeof(header)) || memcmp(header, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+       header[4] != TRACE_VERSION) {
+     file.close();
+     return false;
+   }
+   mode = header[5];
+   memcpy(&startTime, header + 8, sizeof(startTime));
+   lastTime = tickTime = startTime;
+   wallStart = millis();
+
+   traceState = TRACE_REPLAYING;
+   readNext();
+   return true;
+}
+
+bool InputTrace::startScript(const TraceScript* script) {
+   if (traceState != TRACE_OFF) return false;
+   activeScript = script;
+   tickTime = 0;
+   traceState = TRACE_SCRIPTED;
+   return true;
+}
+
+void InputTrace::stop() {
+   if (traceState == TRACE_RECORDING) {
+     flush();
+   }
+   if (traceState == TRACE_RECORDING || traceState == TRACE_REPLAYING) {
+     stats.wallMs = millis() - wallStart;
+     file.close();
+   }
+   traceState = TRACE_OFF;
+   pendingValid = false;
+}
+
+bool InputTrace::due(TraceSite site, unsigned long& last, unsigned long interval) {
+   if (replaying()) {
+     if (!take(REC_TICK, site)) return false;
+     last = tickTime = pending.time;
+     readNext();
+     return true;
+   }
+   if (scripted()) {
+     last = tickTime;
+     return true;
+   }
+
+   unsigned long time = millis();
+   if (time - last < interval) return false;
+   last = time;
+   if (recording() && begin(REC_TICK, site, time)) {
+     tickTime = time;
+   }
+   return true;
+}
+
+int InputTrace::touch(uint8_t pin) {
+   if (replaying()) {
+     if (!take(REC_TOUCH, pin)) {
+       stats.divergences++;
+       return touchRead(pin);
+     }
+     int value = pending.value;
+     readNext();
+     return value;
+   }
+   if (scripted()) return activeScript->read(pin, tickTime);
+
+   int value = touchRead(pin);
+   if (recording() && begin(REC_TOUCH, pin, millis())) {
+     putVarint(value);
+   }
+   return value;
+}
+
+int InputTrace::analog(uint8_t pin) {
+   if (replaying()) {
+     if (!take(REC_ANALOG, pin)) {
+       stats.divergences++;
+       return analogRead(pin);
+     }
+     int value = pending.value;
+     readNext();
+     return value;
+   }
+   if (scripted()) return activeScript->read(pin, tickTime);
+
+   int value = analogRead(pin);
+   if (recording() && begin(REC_ANALOG, pin, millis())) {
+     putVarint(value);
+   }
+   return value;
+}
+
+static float readSensor(TraceSensor channel) {
+   switch (channel) {
+     case TRACE_SENSOR_PRESSURE:    return bme.readPressure() / 100.0F;
+     case TRACE_SENSOR_TEMPERATURE: return bme.readTemperature();
+     default:                       return bme.readHumidity();
+   }
+}
+
+float InputTrace::sensor(TraceSensor channel) {
+   if (replaying()) {
+     if (!take(REC_SENSOR, channel)) {
+       stats.divergences++;
+       return readSensor(channel);
+     }
+     float value = pending.number;
+     readNext();
+     return value;
+   }
+   if (scripted()) return activeScript->sensor(channel, tickTime);
+
+   float value = readSensor(channel);
+   if (recording() && begin(REC_SENSOR, channel, millis())) {
+     putBytes(&value, sizeof(value));
+   }
+   return value;
+}
+
+int32_t InputTrace::status(TraceStatus channel, int32_t liveValue) {
+   if (replaying()) {
+     if (!take(REC_STATUS, channel)) {
+       stats.divergences++;
+       return liveValue;
+     }
+     int32_t value = pending.value;
+     readNext();
+     return value;
+   }
+   if (scripted()) return activeScript->status(channel, tickTime);
+
+   if (recording() && begin(REC_STATUS, channel, millis())) {
+     putVarint(((uint32_t)liveValue << 1) ^ (uint32_t)(liveValue >> 31)); // Zigzag
+   }
+   return liveValue;
+}
+
+void InputTrace::modeRequest(int current, volatile int& next) {
+   if (replaying()) {
+     // Touch interrupts and serial input are ignored; only recorded requests count
+     if (take(REC_MODE, 0)) {
+       next = pending.value;
+       readNext();
+     } else {
+       next = current;
+     }
+     return;
+   }
+   if (scripted()) {
+     next = current;
+     return;
+   }
+
+   int requested = next; // May be changed by a touch interrupt at any time
+   if (recording() && requested != current && begin(REC_MODE, 0, millis())) {
+     put((uint8_t)requested);
+   }
+}
+
+void InputTrace::command(const char* payload, size_t length) {
+   if (!recording()) return;
+   length = min(length, (size_t)TRACE_MAX_COMMAND - 1);
+   if (!begin(REC_COMMAND, 0, millis())) return;
+   putVarint(length);
+   putBytes(payload, length);
+}
+
+bool InputTrace::nextCommand(char* payload, size_t capacity) {
+   if (!replaying() || !take(REC_COMMAND, 0)) return false;
+   size_t length = min((size_t)pending.length, capacity - 1);
+   memcpy(payload, pending.payload, length);
+   payload[length] = '\0';
+   readNext();
+   return true;
+}
+
+void InputTrace::frame(const uint8_t* frameBuffer, size_t length) {
+   if (traceState == TRACE_OFF || scripted()) return;
+
+   uint32_t crc = crc32_le(0, frameBuffer, length);
+   stats.frames++;
+   if (recording()) {
+     if (begin(REC_FRAME, 0, millis())) putBytes(&crc, sizeof(crc));
+     return;
+   }
+
+   if (!take(REC_FRAME, 0)) {
+     stats.divergences++;
+     return;
+   }
+   if ((uint32_t)pending.value != crc) {
+     if (stats.frameMismatches == 0) {
+       stats.firstMismatchMs = pending.time - startTime;
+     }
+     stats.frameMismatches++;
+   }
+   readNext();
+}
+
+bool InputTrace::dump(Print& out) {
+   if (traceState != TRACE_OFF || !mount()) return false;
+   fs::File trace = LittleFS.open(TRACE_PATH, "r");
+   if (!trace) return false;
+
+   uint8_t chunk[32];
+   uint32_t offset = 0;
+   while (trace.available()) {
+     size_t length = trace.read(chunk, sizeof(chunk));
+     out.printf("TRACE %06lx ", (unsigned long)offset);
+     for (size_t i = 0; i < length; i++) {
+       out.printf("%02x", chunk[i]);
+     }
+     out.println();
+     offset += length;
+   }
+   trace.close();
+   return true;
+}
+
+// ---- Recording ----
+
+bool InputTrace::begin(uint8_t type, uint8_t channel, uint32_t time) {
+   if (stats.bytes + bufferLength >= TRACE_MAX_BYTES) {
+     // Full: keep what we have as a complete trace
+     stop();
+     return false;
+   }
+   put(type);
+   putVarint(time - lastTime);
+   lastTime = time;
+   if (hasChannel(type)) {
+     put(channel);
+   }
+   stats.records++;
+   stats.traceMs = time - startTime;
+   return true;
+}
+
+void InputTrace::put(uint8_t value) {
+   if (bufferLength == TRACE_BUFFER) flush();
+   buffer[bufferLength++] = value;
+}
+
+void InputTrace::putVarint(uint32_t value) {
+   while (value >= 0x80) {
+     put((uint8_t)(value | 0x80));
+     value >>= 7;
+   }
+   put((uint8_t)value);
+}
+
+void InputTrace::putBytes(const void* data, size_t length) {
+   const uint8_t* bytes = (const uint8_t*)data;
+   for (size_t i = 0; i < length; i++) {
+     put(bytes[i]);
+   }
+}
+
+void InputTrace::flush() {
+   if (bufferLength == 0) return;
+   file.write(buffer, bufferLength);
+   stats.bytes += bufferLength;
+   bufferLength = 0;
+}
+
+// ---- Replay ----
+
+bool InputTrace::take(uint8_t type, uint8_t channel) {
+   return pendingValid && pending.type == type && (!hasChannel(type) || pending.channel == channel);
+}
+
+void InputTrace::readNext() {
+   pendingValid = false;
+   uint8_t type;
+   uint32_t delta;
+   if (!get(type) || !getVarint(delta)) return;
+
+   pending.type = type;
+   pending.time = lastTime + delta;
+   pending.channel = 0;
+   if (hasChannel(type) && !get(pending.channel)) return;
+
+   uint32_t raw;
+   uint8_t mode;
+   switch (type) {
+     case REC_TICK:
+       break;
+     case REC_TOUCH:
+     case REC_ANALOG:
+       if (!getVarint(raw)) return;
+       pending.value = raw;
+       break;
+     case REC_STATUS:
+       if (!getVarint(raw)) return;
+       pending.value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+       break;
+     case REC_SENSOR:
+       if (!getBytes(&pending.number, sizeof(pending.number))) return;
+       break;
+     case REC_MODE:
+       if (!get(mode)) return;
+       pending.value = mode;
+       break;
+     case REC_COMMAND:
+       if (!getVarint(raw) || raw >= TRACE_MAX_COMMAND || !getBytes(pending.payload, raw)) return;
+       pending.length = raw;
+       break;
+     case REC_FRAME:
+       if (!getBytes(&raw, sizeof(raw))) return;
+       pending.value = raw;
+       break;
+     default:
+       return; // Unknown record: treat as end of trace
+   }
+
+   lastTime = pending.time;
+   pendingValid = true;
+   stats.records++;
+   stats.traceMs = pending.time - startTime;
+}
+
+bool InputTrace::get(uint8_t& value) {
+   if (bufferPos == bufferLength) {
+     int length = file.read(buffer, TRACE_BUFFER);
+     if (length <= 0) return false;
+     stats.bytes += length;
+     bufferLength = length;
+     bufferPos = 0;
+   }
+   value = buffer[bufferPos++];
+   return true;
+}
+
+bool InputTrace::getVarint(uint32_t& value) {
+   value = 0;
+   for (int shift = 0; shift < 35; shift += 7) {
+     uint8_t byte;
+     if (!get(byte)) return false;
+     value |= (uint32_t)(byte & 0x7F) << shift;
+     if (!(byte & 0x80)) return true;
+   }
+   return false;
+}
+
+bool InputTrace::getBytes(void* data, size_t length) {
+   uint8_t* bytes = (uint8_t*)data;
+   for (size_t i = 0; i < length; i++) {
+     if (!get(bytes[i])) return false;
+   }
+   return true;
+}
@@ -0,0 +1,192 @@
+#ifndef INPUT_TRACE_H
+#define INPUT_TRACE_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+// Deterministic record and replay of firmware inputs
+//
+// Everything the modes react to goes through inputTrace: touch and ADC reads,
+// BME280 samples, link status, the scheduling decisions of the periodic jobs
+// (mode ticks, touch scan, battery check), mode change requests and MQTT
+// telecommands. While recording, each input is appended to a compact binary
+// trace in flash together with a CRC of every frame sent to the display.
+// During replay the same call sites return the recorded values in order,
+// periodic jobs fire when the trace says they did rather than by the clock,
+// and each frame CRC is compared with the recorded one. Replay therefore
+// runs as fast as the loop can go and reports any frame that differs.
+//
+// Trace layout (little endian):
+//   header  "CTRC", version u8, mode u8, reserved u16, start millis u32
+//   record  type u8, varint ms since previous record, payload:
+//           TICK site u8 | TOUCH/ANALOG pin u8, varint value
+//           SENSOR channel u8, float32 | STATUS channel u8, zigzag varint
+//           MODE mode u8 | COMMAND varint length, bytes | FRAME crc32 u32
+//
+// Replays are only meaningful with the same parameters and orbit elements as
+// the recording. tools/trace_tool.py decodes dumps and diffs two traces.
+//
+// A third state serves scripted inputs: every read is answered by a
+// TraceScript as a function of a clock the caller sets (render benchmark).
+
+#define TRACE_PATH        "/trace.bin"
+#define TRACE_VERSION     1
+#define TRACE_MAX_BYTES   (512UL * 1024)  // Recording stops when the file reaches this size
+#define TRACE_BUFFER      512             // Bytes buffered in RAM between flash writes
+#define TRACE_MAX_COMMAND 256
+
+enum TraceState {
+   TRACE_OFF,
+   TRACE_RECORDING,
+   TRACE_REPLAYING,
+   TRACE_SCRIPTED
+};
+
+// Periodic jobs whose firing is part of the trace
+enum TraceSite {
+   TRACE_SITE_MODE_TICK,
+   TRACE_SITE_TOUCH_SCAN,
+   TRACE_SITE_BATTERY
+};
+
+enum TraceSensor {
+   TRACE_SENSOR_PRESSURE,     // hPa
+   TRACE_SENSOR_TEMPERATURE,  // °C
+   TRACE_SENSOR_HUMIDITY      // %
+};
+
+enum TraceStatus {
+   TRACE_STATUS_WIFI,
+   TRACE_STATUS_RSSI,
+   TRACE_STATUS_MQTT,
+   TRACE_STATUS_BME
+};
+
+struct TraceSummary {
+   uint32_t records;
+   uint32_t bytes;
+   uint32_t frames;
+   uint32_t frameMismatches;
+   uint32_t firstMismatchMs;   // Trace time of the first differing frame
+   uint32_t divergences;       // Inputs requested in a different order than recorded
+   unsigned long traceMs;      // Time span covered by the trace
+   unsigned long wallMs;       // Time the recording or replay took
+};
+
+// Synthetic inputs; each value must depend only on the arguments
+struct TraceScript {
+   int (*read)(uint8_t pin, unsigned long time);               // Touch and ADC pins
+   float (*sensor)(TraceSensor channel, unsigned long time);
+   int32_t (*status)(TraceStatus channel, unsigned long time);
+};
+
+class InputTrace {
+public:
+   // Start a new trace; the caller re-enters the current mode right after
+   bool startRecording(int mode);
+
+   // Open the stored trace; mode is the mode to enter before replaying
+   bool startReplay(int& mode);
+
+   // Serve inputs from script; time stands still until setScriptTime()
+   bool startScript(const TraceScript* script);
+   void setScriptTime(unsigned long time) { tickTime = time; }
+
+   // Close the trace (flushes a recording)
+   void stop();
+
+   TraceState state() const { return traceState; }
+   bool recording() const { return traceState == TRACE_RECORDING; }
+   bool replaying() const { return traceState == TRACE_REPLAYING; }
+   bool scripted() const { return traceState == TRACE_SCRIPTED; }
+   // Inputs come from the hardware (nothing or a recording running)
+   bool live() const { return traceState == TRACE_OFF || traceState == TRACE_RECORDING; }
+
+   // True once a replay has consumed every record
+   bool finished() const { return replaying() && !pendingValid; }
+
+   const TraceSummary& summary() const { return stats; }
+
+   // Periodic job gate: live it compares the clock, in replay it follows the trace
+   bool due(TraceSite site, unsigned long& last, unsigned long interval);
+
+   // Time of the current job; use instead of millis() in anything that renders
+   unsigned long now() const { return traceState == TRACE_OFF ? millis() : tickTime; }
+
+   int touch(uint8_t pin);
+   int analog(uint8_t pin);
+   float sensor(TraceSensor channel);   // Caller holds the BME280 bus transaction
+   int32_t status(TraceStatus channel, int32_t liveValue);
+
+   // Mode-change check point in loop(): records or applies pending requests
+   void modeRequest(int current, volatile int& next);
+
+   // Telecommand received (recording) / next telecommand due (replay)
+   void command(const char* payload, size_t length);
+   bool nextCommand(char* payload, size_t capacity);
+
+   // Output check: every frame pushed to the display
+   void frame(const uint8_t* buffer, size_t length);
+
+   // Print the stored trace as hex lines ("TRACE <offset> <hex>")
+   bool dump(Print& out);
+
+private:
+   enum RecordType {
+     REC_TICK = 1,
+     REC_TOUCH,
+     REC_ANALOG,
+     REC_SENSOR,
+     REC_STATUS,
+     REC_MODE,
+     REC_COMMAND,
+     REC_FRAME
+   };
+
+   struct Record {
+     uint8_t type;
+     uint8_t channel;
+     uint32_t time;
+     int32_t value;
+     float number;
+     uint16_t length;
+     char payload[TRACE_MAX_COMMAND];
+   };
+
+   bool mount();
+
+   // Every record but MODE, COMMAND and FRAME carries a channel byte
+   static bool hasChannel(uint8_t type) { return type <= REC_STATUS; }
+
+   // Recording
+   bool begin(uint8_t type, uint8_t channel, uint32_t time);
+   void put(uint8_t value);
+   void putVarint(uint32_t value);
+   void putBytes(const void* data, size_t length);
+   void flush();
+
+   // Replay
+   bool take(uint8_t type, uint8_t channel);
+   void readNext();
+   bool get(uint8_t& value);
+   bool getVarint(uint32_t& value);
+   bool getBytes(void* data, size_t length);
+
+   fs::File file;
+   TraceState traceState = TRACE_OFF;
+   TraceSummary stats = {};
+   uint8_t buffer[TRACE_BUFFER];
+   size_t bufferLength = 0;
+   size_t bufferPos = 0;
+   uint32_t startTime = 0;
+   uint32_t lastTime = 0;
+   unsigned long tickTime = 0;
+   unsigned long wallStart = 0;
+   const TraceScript* activeScript = nullptr;
+   Record pending;
+   bool pendingValid = false;
+};
+
+extern InputTrace inputTrace;
+
+#endif
@@ -0,0 +1,42 @@
+#include "link_control.h"
+
+void LinkController::begin(uint32_t minPeriodMs, uint32_t maxPeriodMs, bool adaptive) {
+   this->adaptive = adaptive;
+   if (minPeriodMs == 0) minPeriodMs = 1;
+   if (!adaptive || maxPeriodMs < minPeriodMs) maxPeriodMs = minPeriodMs;
+   maxRate = 1000000 / minPeriodMs;
+   minRate = 1000000 / maxPeriodMs;
+   if (minRate == 0) minRate = 1;
+   rateMilliHz = maxRate;
+   sinceFull = 0;
+}
+
+bool LinkController::degraded(int rssi) const {
+   return adaptive && (rateMilliHz * 2 < maxRate || rssi < LINK_RSSI_WEAK);
+}
+
+LinkPayload LinkController::nextPayload(int rssi) {
+   if (!degraded(rssi) || ++sinceFull >= LINK_FULL_EVERY) {
+     sinceFull = 0;
+     return LINK_FULL;
+   }
+   housekeepingCount++;
+   return LINK_HOUSEKEEPING;
+}
+
+void LinkController::record(bool published, uint32_t publishMicros, int rssi) {
+   if (!published) failureCount++;
+   if (!adaptive) return;
+
+   // At poor RSSI the send buffer fills long before a write blocks, so back off
+   // to half the maximum rate without waiting for a stall
+   bool poor = rssi <= LINK_RSSI_POOR;
+   if (!published || publishMicros > LINK_SLOW_PUBLISH_US || (poor && rateMilliHz * 2 > maxRate)) {
+     // Multiplicative decrease
+     rateMilliHz = rateMilliHz / 2 > minRate ? rateMilliHz / 2 : minRate;
+     decreaseCount++;
+   } else if (!poor) {
+     // Additive increase
+     rateMilliHz = rateMilliHz + LINK_RATE_STEP_MHZ < maxRate ? rateMilliHz + LINK_RATE_STEP_MHZ : maxRate;
+   }
+}
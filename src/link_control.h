@@ -0,0 +1,64 @@
+#ifndef LINK_CONTROL_H
+#define LINK_CONTROL_H
+
+#include <stdint.h>
+
+// Link-adaptive telemetry rate
+//
+// AIMD on the packet rate, kept between 1 / maxPeriod and 1 / minPeriod: each
+// clean publish adds LINK_RATE_STEP_MHZ, each loss signal halves the rate.
+// Loss signals are a failed publish (or no broker connection) and a slow
+// publish. With QoS 0 there is no broker ack, so the time the MQTT write
+// blocks is the round-trip signal: the TLS write stalls once the TCP send
+// buffer is full of unacknowledged data. That only happens after seconds of
+// queueing, so at or below LINK_RSSI_POOR the rate also backs off to half the
+// maximum and does not grow again until the signal improves.
+//
+// While the link is degraded (rate below half the maximum or RSSI below
+// LINK_RSSI_WEAK) packets shrink to the housekeeping subset, with a full one
+// every LINK_FULL_EVERY so the ground still sees the complete state.
+//
+// No Arduino dependencies: tools/link_sim.cpp runs this same controller
+// against a simulated lossy link.
+
+#define LINK_RATE_STEP_MHZ    100      // Additive increase per clean publish (packets/s * 1000)
+#define LINK_SLOW_PUBLISH_US  150000   // Publish call duration counted as congestion
+#define LINK_RSSI_POOR        -85      // dBm; at or below the rate is held at half the maximum or less
+#define LINK_RSSI_WEAK        -75      // dBm; below this only housekeeping is sent
+#define LINK_FULL_EVERY       10       // Full packets while degraded: one in this many
+
+enum LinkPayload {
+   LINK_FULL,
+   LINK_HOUSEKEEPING
+};
+
+class LinkController {
+public:
+   // Start at the fastest rate; adaptive = false keeps minPeriodMs and full packets
+   void begin(uint32_t minPeriodMs, uint32_t maxPeriodMs, bool adaptive);
+
+   // Content of the next packet; call once per telemetry attempt
+   LinkPayload nextPayload(int rssi);
+
+   // Outcome of that attempt
+   void record(bool published, uint32_t publishMicros, int rssi);
+
+   uint32_t periodMs() const { return 1000000 / rateMilliHz; }
+   bool degraded(int rssi) const;
+
+   uint32_t decreases() const { return decreaseCount; }
+   uint32_t failures() const { return failureCount; }
+   uint32_t housekeeping() const { return housekeepingCount; }
+
+private:
+   bool adaptive = false;
+   uint32_t rateMilliHz = 1000;
+   uint32_t minRate = 1000;         // mHz, from maxPeriodMs
+   uint32_t maxRate = 1000;         // mHz, from minPeriodMs
+   uint32_t sinceFull = 0;
+   uint32_t decreaseCount = 0;
+   uint32_t failureCount = 0;
+   uint32_t housekeepingCount = 0;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "log.h"
+
+#include <stdarg.h>
+
+Logger logger;
+
+static_assert((LOG_SLOTS & (LOG_SLOTS - 1)) == 0, "LOG_SLOTS must be a power of two");
+
+static const char LEVEL_TAGS[] = { '-', 'E', 'W', 'I', 'D' };
+
+Logger::Logger()
+   : head(0),
+     tail(0),
+     writtenCount(0),
+     droppedCount(0),
+     reportedDrops(0),
+     task(nullptr) {
+   for (uint32_t i = 0; i < LOG_SLOTS; i++) {
+     slots[i].sequence.store(i, std::memory_order_relaxed);
+   }
+}
+
+void Logger::begin() {
+   // Lowest priority above idle: printing only happens when nothing else wants the CPU
+   if (xTaskCreatePinnedToCore(drainTask, "log", 3072, this, 1, &task, 0) != pdPASS) {
+     task = nullptr;
+     Serial.println("Log drain task failed to start");
+   }
+}
+
+bool Logger::write(uint8_t level, const char* format, ...) {
+   uint32_t ticket = head.load(std::memory_order_relaxed);
+   Slot* slot;
+   for (;;) {
+     slot = &slots[ticket & (LOG_SLOTS - 1)];
+     int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - ticket);
+     if (diff == 0) {
+       if (head.compare_exchange_weak(ticket, ticket + 1, std::memory_order_relaxed)) break;
+     } else if (diff < 0) {
+       // Slot still holds a message from the previous lap: ring is full
+       droppedCount.fetch_add(1, std::memory_order_relaxed);
+       return false;
+     } else {
+       ticket = head.load(std::memory_order_relaxed);
+     }
+   }
+
+   slot->timestamp = millis();
+   slot->level = level;
+   va_list args;
+   va_start(args, format);
+   vsnprintf(slot->text, LOG_LINE_SIZE, format, args);
+   va_end(args);
+
+   slot->sequence.store(ticket + 1, std::memory_order_release);
+   writtenCount.fetch_add(1, std::memory_order_relaxed);
+   return true;
+}
+
+int Logger::drain() {
+   int printed = 0;
+   for (;;) {
+     Slot& slot = slots[tail & (LOG_SLOTS - 1)];
+     if (slot.sequence.load(std::memory_order_acquire) != tail + 1) break;
+
+     Serial.printf("[%lu] %c %s\n", (unsigned long)slot.timestamp,
+                   LEVEL_TAGS[slot.level < sizeof(LEVEL_TAGS) ? slot.level : 0], slot.text);
+     slot.sequence.store(tail + LOG_SLOTS, std::memory_order_release);
+     tail++;
+     printed++;
+   }
+
+   uint32_t drops = dropped();
+   if (drops != reportedDrops) {
+     Serial.printf("[%lu] W log: %lu messages dropped\n", millis(), (unsigned long)(drops - reportedDrops));
+     reportedDrops = drops;
+   }
+   return printed;
+}
+
+void Logger::drainTask(void* arg) {
+   Logger* self = (Logger*)arg;
+   for (;;) {
+     if (self->drain() == 0) {
+       vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_IDLE));
+     }
+   }
+}
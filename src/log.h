@@ -0,0 +1,96 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Asynchronous leveled logging
+//
+// LOGE/LOGW/LOGI/LOGD format into a fixed-size slot of a lock-free ring and
+// return; a low-priority task drains the ring to Serial. A log call costs a
+// vsnprintf and never waits for the UART, so it is safe on hot paths and from
+// any task. When the ring is full the message is dropped and counted; the
+// drain task reports the count once there is room again.
+//
+// Calls below LOG_LEVEL are compiled out entirely. Set it from build_flags,
+// e.g. -DLOG_LEVEL=LOG_LEVEL_DEBUG.
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_SLOTS      32   // Ring capacity in messages (power of two)
+#define LOG_LINE_SIZE  120  // Longest message, longer ones are truncated
+#define LOG_DRAIN_IDLE 10   // ms the drain task sleeps when the ring is empty
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOGE(...) logger.write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOGE(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOGW(...) logger.write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOGW(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOGI(...) logger.write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOGI(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOGD(...) logger.write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOGD(...) do {} while (0)
+#endif
+
+class Logger {
+public:
+   Logger();
+
+   // Start the drain task; messages logged earlier are kept in the ring
+   void begin();
+
+   // Format and enqueue one message; false if it was dropped
+   bool write(uint8_t level, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+   // Move queued messages to Serial; returns how many were printed.
+   // Single consumer: only the drain task may call this once begin() ran
+   int drain();
+
+   uint32_t written() const { return writtenCount.load(std::memory_order_relaxed); }
+   uint32_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+   // Bounded multi-producer queue: a slot is free for the producer holding
+   // ticket n when sequence == n and ready for the consumer when sequence == n + 1
+   struct Slot {
+     std::atomic<uint32_t> sequence;
+     uint32_t timestamp;
+     uint8_t level;
+     char text[LOG_LINE_SIZE];
+   };
+
+   static void drainTask(void* arg);
+
+   Slot slots[LOG_SLOTS];
+   std::atomic<uint32_t> head;      // Next ticket for producers
+   uint32_t tail;                   // Next slot for the (single) consumer
+   std::atomic<uint32_t> writtenCount;
+   std::atomic<uint32_t> droppedCount;
+   uint32_t reportedDrops;
+   TaskHandle_t task;
+};
+
+extern Logger logger;
+
+#endif
@@ -6,42 +6,28 @@
  #include <WiFi.h>
  #include <WiFiClientSecure.h>
  #include <PubSubClient.h>
- #include <Adafruit_GFX.h>
- #include <Adafruit_SSD1306.h>
- #include <Adafruit_Sensor.h>
- #include <Adafruit_BME280.h>
  #include <ArduinoOTA.h>
  #include <Preferences.h>  // Added for persistent storage
-  
-
- #define SCREEN_WIDTH 128      
- #define SCREEN_HEIGHT 64      
- #define OLED_RESET    -1      
- #define SCREEN_ADDRESS 0x3C   
- // End of display_config group
-  
-
- #define BATTERY_PIN     7      
- #define USB_VOLTAGE_PIN 3      
- #define BUZZER_PIN      14     
- #define LED_PIN         15     
- 
- #define TOUCH_UP        1      
- #define TOUCH_LEFT      2      
- #define TOUCH_X         4      
- #define TOUCH_DOWN      5      
- #define TOUCH_RIGHT     6      
- 
- // For backward compatibility with existing code
- #define TOUCH_PIN_PREV  TOUCH_LEFT   
- #define TOUCH_PIN_NEXT  TOUCH_RIGHT  
- // End of pin_definitions group
-  
-
- #define BATTERY_VOLTAGE_MULTIPLIER  1.7  
- #define USB_VOLTAGE_MULTIPLIER      1.9  
- #define LOW_BATTERY_THRESHOLD       3.6  
- // End of voltage_params group
+ #include "cadse.h"        // Pin map, display config and shared globals
+ #include "modes.h"        // Operational mode registry
+ #include "i2c_bus.h"      // Prioritised I2C arbitration
+ #include "params.h"       // Runtime-tunable parameters
+ #include "ota_update.h"   // Compressed pull OTA
+ #include "boot_profile.h" // Fast boot and boot timeline
+ #include "log.h"          // Asynchronous leveled logging
+ #include "render_bench.h" // Per-mode render benchmark
+#include "mem_health.h"   // Heap, stack and allocation monitoring
+#include "time_sync.h"    // SNTP wall clock and µs timestamps
+#include "link_control.h" // Link-adaptive telemetry rate
+#include "burst_capture.h" // Event-triggered burst capture
+#include "window_stats.h"  // Per-packet channel statistics
+#include "display_mirror.h" // Framebuffer mirror for the ground
+#include "power_gate.h"   // Per-mode peripheral gating
+#include "alert_rules.h"  // Alert rule engine
+#include "feedback_player.h" // Background buzzer and LED patterns
+#include "baro_altitude.h"  // Barometric altitude and vertical speed
+#include "telemetry_schema.h" // Telemetry fields, encoders and schema hash
+#include "telecommand.h"    // Command parser, parameter commands
   
 
  const char* WIFI_SSID = "We have internet!";        
@@ -50,28 +36,55 @@
  const int   MQTT_PORT = 8883;                       
  const char* MQTT_USER = "mse24";                    
  const char* MQTT_PASSWORD = "aura";                 
- const char* MQTT_CLIENT_ID = "floyd_esp32s3_satellite"; 
+ const char* MQTT_CLIENT_ID = "floyd_esp32s3_satellite"; // Board ID appended: one broker session per board
+ const uint16_t MQTT_BUFFER_SIZE = 2048;             // PubSubClient packet: header, topic and payload
+ const char* NTP_SERVER = "pool.ntp.org";            // Default; "NTP <host>" stores a local server
  const String mqttPrefix = "cadse";                  
  const int mqttYear = 2024;                          
- const byte mqttBoardId = 0;                         
+ String mqttBoardId = "";            // board_id parameter, or derived from the eFuse MAC
  // End of network_config group
  
-
- const int touchThreshold = 60000;  
- const int channelBuzzer = 0;       
- // End of touch_config group
+ // Default orbit for Mode 5 until a TLE is uplinked (ISS)
+ const char* DEFAULT_TLE_LINE1 = "1 25544U 98067A   08264.51782528 -.00002182  00000-0 -11606-4 0  2927";
+ const char* DEFAULT_TLE_LINE2 = "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563537";
+ // End of orbit_config group
  
 // Topic strings to be generated in setup()
 String mqttTelemetryTopic;   
+String mqttTelemetryBinTopic;
 String mqttCommandTopic;     
 String mqttResponseTopic;    
+String mqttAckTopic;         
+String mqttBurstTopic;       
+String mqttDisplayTopic;     
+String mqttAlertTopic;       
   
 
- Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET); 
+ I2cBus i2cBus(Wire);         
+ BufferedDisplay display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET); 
  Adafruit_BME280 bme;        
  WiFiClientSecure wifiClient; 
  PubSubClient mqttClient(wifiClient); 
  Preferences preferences;     
+ OrbitPropagator orbitPropagator; 
+ Ephemeris orbitEphemeris;    
+ LinkController linkControl;  
+ 
+ // Telemetry channels, each reduced to statistics between the packets reporting it
+ enum StatsChannel {
+   STATS_TEMPERATURE,
+   STATS_PRESSURE,
+   STATS_HUMIDITY,
+   STATS_BATTERY,
+   STATS_USB,
+   STATS_TOUCH_RIGHT,
+   STATS_TOUCH_LEFT,
+   STATS_TOUCH_UP,
+   STATS_TOUCH_DOWN,
+   STATS_TOUCH_X,
+   STATS_CHANNELS
+ };
+ WindowStats channelStats[STATS_CHANNELS];
  // End of global_objects group
   
 
@@ -85,10 +98,33 @@ String mqttResponseTopic;
  bool lowBatteryAlert = false;      
  String deviceID = "";              
  bool isOTAUpdating = false;        
+ unsigned long otaStartTime = 0;    
+ uint32_t otaBytesReceived = 0;     
+ bool orbitValid = false;           
+ volatile bool bmeAvailable = false; 
+ bool bmeNormal = true;             // BME280 sampling as last configured (normal or forced)
+ volatile bool bootInitDone = false; // Sensors and network up (set by the background init after a fast boot)
+ bool firstSampleDone = false;      
+ bool bootReported = false;         
+ String ackCommand = "";            // Mode change acknowledged after the new mode's first tick
+ int64_t ackReceivedMicros = 0;     
+ unsigned long lastBurstSampleTime = 0; 
+ unsigned long lastBurstChunkTime = 0; 
+ unsigned long lastMirrorTime = 0;  
+ unsigned long lastStatsTouchTime = 0; 
+ unsigned long lastStatsAuxTime = 0; 
+ unsigned long lastStatsAdcTime = 0; 
+ unsigned long lastStatsBmeTime = 0; 
+ int i2cDisplay = -1;               
+ int i2cBme280 = -1;                
  
  // Debug variables
  unsigned long lastTouchDebugTime = 0; 
  const int touchDebounceTime = 300;    
+ const unsigned long otaProgressInterval = 250; // ms between OTA progress redraws
+ const unsigned long modeBannerDuration = 1000; // ms the mode banner covers the new mode's frames
+ unsigned long modeBannerTime = 0;  
+ bool modeBannerShown = false;      
  // End of global_vars group
   
 // Function prototypes
@@ -102,15 +138,75 @@ void setupMQTT();
 void setupOTA();
 
 
+void showOtaProgress(uint32_t done, uint32_t total);
+
+
+void reportOtaThroughput(uint32_t receivedBytes, uint32_t imageBytes, unsigned long elapsedMs);
+
+
 void setupBME280();
 
 
+bool setupOrbit(const String& line1, const String& line2);
+
+
 void getChipInfo();
 
 
+String resolveBoardId();
+
+
 void handleMQTTCallback(char* topic, byte* payload, unsigned int length);
 
 
+bool executeCommand(const String& command, char* message, unsigned int length, int64_t received);
+
+
+void publishCommandAck(const String& command, int64_t received);
+
+
+void sampleBurst();
+
+
+void sendBurstChunk();
+
+
+void sendDisplayMirror();
+
+
+void sampleChannels();
+
+
+void serviceAlerts();
+
+
+void publishAlert(const AlertEvent& event);
+
+
+void drawAlertBanner();
+
+
+void drawModeBanner();
+
+
+void drawOverlays();
+
+
+String alertsJson();
+
+
+uint32_t alertMask();
+
+
+void applyPower(uint8_t changed);
+
+
+void configureBME280();
+
+
+String powerJson();
+
+
 void sendTelemetry();
 
 
@@ -138,195 +234,344 @@ void initializeTouchbuttons();
 void debugTouchSensors();
 
 
-String createJSONTelemetry();
+void fillTelemetry(TelemetryRecord& record, bool full);
+
+
+String bootJson();
+
+
+String mirrorJson();
+
+
+String i2cJson();
+
+
+size_t mqttPayloadLimit(const String& topic);
 
 
 void displayBootSequence();
-  
 
 
-void runBasicMonitoring();
+void applyParameter(int id);
+
+
+bool beginBME280();
+
+
+void configureMQTT();
+
 
+bool connectMQTT();
 
-void runMicroGravityDetection();
 
+void startBackgroundInit();
 
-void runPressureMonitoring();
 
+void backgroundInit();
 
-void runAttitudeIndicator();
 
+void backgroundInitTask(void*);
 
-void runRollingPlotter();
 
+void handleTraceCommand(const String& command);
+
+
+void finishReplay();
+
+
+String traceSummaryJson();
+
+
+void handleBenchCommand(const String& command);
+  
 
-void runCreativeMode();
- // End of mode_functions group
  
 
 void increaseModeNumber() {
    int maxTouch = touchRead(TOUCH_RIGHT);
-   if (currentMode < 5 && maxTouch > touchThreshold) {
-     nextMode = currentMode + 1;
-     Serial.println("Increasing mode to: " + String(nextMode));
+   if (currentMode < MODE_COUNT - 1 && maxTouch > params.getInt(PARAM_TOUCH_THRESHOLD)) {
+     nextMode = currentMode + 1; // Logged by switchMode(); no printing in interrupt context
    }
  }
  
 
 void decreaseModeNumber() {
    int maxTouch = touchRead(TOUCH_LEFT);
-   if (currentMode > 0 && maxTouch > touchThreshold) {
+   if (currentMode > 0 && maxTouch > params.getInt(PARAM_TOUCH_THRESHOLD)) {
      nextMode = currentMode - 1;
-     Serial.println("Decreasing mode to: " + String(nextMode));
    }
  }
  
 
 void initializeTouchbuttons() {
-   touchAttachInterrupt(TOUCH_RIGHT, increaseModeNumber, touchThreshold);
-   touchAttachInterrupt(TOUCH_LEFT, decreaseModeNumber, touchThreshold);
-   Serial.println("Touch buttons initialized with interrupts");
+   touchAttachInterrupt(TOUCH_RIGHT, increaseModeNumber, params.getInt(PARAM_TOUCH_THRESHOLD));
+   touchAttachInterrupt(TOUCH_LEFT, decreaseModeNumber, params.getInt(PARAM_TOUCH_THRESHOLD));
+   LOGI("Touch buttons initialized with interrupts");
  }
  
 
 void debugTouchSensors() {
-   if (millis() - lastTouchDebugTime > 500) {
-     int right = touchRead(TOUCH_RIGHT);
-     int left = touchRead(TOUCH_LEFT);
-     int up = touchRead(TOUCH_UP);
-     int down = touchRead(TOUCH_DOWN);
-     int x = touchRead(TOUCH_X);
+   if (inputTrace.due(TRACE_SITE_TOUCH_SCAN, lastTouchDebugTime, 500)) {
+     int right = inputTrace.touch(TOUCH_RIGHT);
+     int left = inputTrace.touch(TOUCH_LEFT);
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+     // Only logged: no reads when LOGD is compiled out (recorded traces
+     // replay against builds with the same LOG_LEVEL)
+     int up = inputTrace.touch(TOUCH_UP);
+     int down = inputTrace.touch(TOUCH_DOWN);
+     int x = inputTrace.touch(TOUCH_X);
      
-     Serial.print("Touch values - RIGHT(6): ");
-     Serial.print(right);
-     Serial.print(", LEFT(2): ");
-     Serial.print(left);
-     Serial.print(", UP(1): ");
-     Serial.print(up);
-     Serial.print(", DOWN(5): ");
-     Serial.print(down);
-     Serial.print(", X(4): ");
-     Serial.println(x);
+     LOGD("Touch values - RIGHT(6): %d, LEFT(2): %d, UP(1): %d, DOWN(5): %d, X(4): %d",
+          right, left, up, down, x);
+#endif
      
      // Force mode change if extreme touch values detected
      if (right > 65000 || right < 10) {
-       Serial.println("RIGHT touch detected, forcing mode change");
-       if (currentMode < 5) nextMode = currentMode + 1;
+       LOGI("RIGHT touch detected, forcing mode change");
+       if (currentMode < MODE_COUNT - 1) nextMode = currentMode + 1;
      }
      
      if (left > 65000 || left < 10) {
-       Serial.println("LEFT touch detected, forcing mode change");
+       LOGI("LEFT touch detected, forcing mode change");
        if (currentMode > 0) nextMode = currentMode - 1;
      }
-     
-     lastTouchDebugTime = millis();
    }
  }
   
 
 void setup() {
+   bootTimeline.begin();
+   
    // Initialize serial
    Serial.begin(115200);
-   delay(100);
+   if (!bootTimeline.fastBoot()) {
+     delay(100);
+   }
+   logger.begin();
    
    Serial.println("Starting CADSE v5 Space Electronics Project");
+   Serial.printf("Reset reason: %s (%s boot)\n", bootTimeline.resetReason(),
+                 bootTimeline.fastBoot() ? "fast" : "full");
    
    // Initialize GPIO
    pinMode(LED_PIN, OUTPUT);
    pinMode(BUZZER_PIN, OUTPUT);
+   feedback.begin(BUZZER_PIN, LED_PIN);
    
-   // Initialize I2C
+   // Initialize I2C and register every device sharing the bus
    Wire.begin();
+   i2cDisplay = i2cBus.addDevice("display", SCREEN_ADDRESS, SSD1306_MAX_CLOCK, I2C_PRIORITY_DISPLAY);
+   i2cBme280 = i2cBus.addDevice("bme280", 0x76, BME280_MAX_CLOCK, I2C_PRIORITY_SENSOR);
    
    // Initialize display
    if(!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) {
      Serial.println(F("SSD1306 allocation failed"));
      for(;;); // Don't proceed, loop forever
    }
+   
+   // Adafruit_SSD1306::begin() leaves the bus at 100 kHz; switch to the fastest common clock
+   i2cBus.begin();
+   display.attachBus(&i2cBus, i2cDisplay);
+   display.setFrameObserver([](const uint8_t* frame, size_t length) {
+     inputTrace.frame(frame, length);
+   });
+   display.setOverlay(drawOverlays);
+   displayMirror.begin(SCREEN_WIDTH, SCREEN_HEIGHT);
    display.clearDisplay();
    display.setTextSize(1);
    display.setTextColor(SSD1306_WHITE);
+   bootTimeline.mark("display");
    
    // Get chip information
    getChipInfo();
    
+   // Initialize preferences for persistent storage (R5.2)
+   preferences.begin("cadse", false);
+   params.begin(preferences);
+   powerGate.begin(millis());
+   alertEngine.begin(alertRules, alertStates, ALERT_RULE_COUNT);
+   
    // Generate board-specific MQTT topics using professor's pattern
-   String mqttTopicBase = mqttPrefix + "/" + String(mqttYear) + "/" + String(mqttBoardId) + "/";
+   mqttBoardId = resolveBoardId();
+   String mqttTopicBase = mqttPrefix + "/" + String(mqttYear) + "/" + mqttBoardId + "/";
    mqttTelemetryTopic = mqttTopicBase + "tm";     // Telemetry
+   mqttTelemetryBinTopic = mqttTopicBase + "tm/bin"; // Telemetry, packed (telemetry_format=1)
    mqttCommandTopic = mqttTopicBase + "tc";       // Telecommand
    mqttResponseTopic = mqttTopicBase + "response";
+   mqttAckTopic = mqttTopicBase + "ack";          // Telecommand timing
+   mqttBurstTopic = mqttTopicBase + "burst";      // Burst capture chunks (binary)
+   mqttDisplayTopic = mqttTopicBase + "display";  // Display mirror frames (binary)
+   mqttAlertTopic = mqttTopicBase + "alert";      // Alert raise / clear events
    
    Serial.println("MQTT Topics:");
    Serial.println("- Telemetry: " + mqttTelemetryTopic);
+   Serial.println("- Telemetry (packed): " + mqttTelemetryBinTopic);
    Serial.println("- Command: " + mqttCommandTopic);
    Serial.println("- Response: " + mqttResponseTopic);
+   Serial.println("- Ack: " + mqttAckTopic);
+   Serial.println("- Burst: " + mqttBurstTopic);
+   Serial.println("- Display: " + mqttDisplayTopic);
+   Serial.println("- Alert: " + mqttAlertTopic);
+   
+   defaultMode = params.getInt(PARAM_DEFAULT_MODE);
+   for (int mode = 0; mode < MODE_COUNT; mode++) {
+     applyParameter(PARAM_MODE_INTERVAL + mode);
+   }
+   applyParameter(PARAM_RATE_CONTROL);
+   applyParameter(PARAM_ALERT_THRESHOLD);
+   applyParameter(PARAM_MICROG_THRESHOLD);
+   baroAltitude.begin(params.getFloat(PARAM_QNH));
+   params.setChangeHandler(applyParameter);
+   bootTimeline.mark("params");
+   
+   // Load the last uplinked TLE for the orbit simulator, or fall back to the default
+   if (!setupOrbit(preferences.getString("tle1", DEFAULT_TLE_LINE1),
+                   preferences.getString("tle2", DEFAULT_TLE_LINE2))) {
+     setupOrbit(DEFAULT_TLE_LINE1, DEFAULT_TLE_LINE2);
+   }
+   bootTimeline.mark("orbit");
    
-   // Initialize preferences for persistent storage (R5.2)
-   preferences.begin("cadse", false);
-   defaultMode = preferences.getInt("defMode", 0);
-   
-   // Display boot sequence
-   displayBootSequence();
-   
-   // Read initial voltage values
+   // Read initial voltage values (shown by the boot sequence)
    batteryVoltage = analogRead(BATTERY_PIN) * BATTERY_VOLTAGE_MULTIPLIER * 3.3 / 4095.0;
    usbVoltage = analogRead(USB_VOLTAGE_PIN) * USB_VOLTAGE_MULTIPLIER * 3.3 / 4095.0;
    
    // Check battery status
    lowBatteryAlert = (batteryVoltage < LOW_BATTERY_THRESHOLD);
    
-   // Initialize BME280 sensor
-   setupBME280();
-   
-   // Connect to WiFi
-   setupWiFi();
-   
-   // Initialize touch buttons with interrupts
-   initializeTouchbuttons();
-   
-   // Setup MQTT with secure connection
-   setupMQTT();
-   
-   // Setup OTA updates
-   setupOTA();
+   if (bootTimeline.fastBoot()) {
+     // Warm reset: start sampling now, bring up sensors and network in the background
+     initializeTouchbuttons();
+     startBackgroundInit();
+   } else {
+     // Display boot sequence
+     displayBootSequence();
+     bootTimeline.mark("splash");
+     
+     // Initialize BME280 sensor
+     setupBME280();
+     bootTimeline.mark("bme280");
+     
+     // Connect to WiFi
+     setupWiFi();
+     bootTimeline.mark("wifi");
+     
+     // Initialize touch buttons with interrupts
+     initializeTouchbuttons();
+     
+     // Setup MQTT with secure connection
+     setupMQTT();
+     bootTimeline.mark("mqtt");
+     
+     // Setup OTA updates
+     setupOTA();
+     bootTimeline.mark("ota");
+     
+     // Indicate successful boot with LED and buzzer; the chime plays on while the first mode starts
+     feedback.play(patternBoot);
+     bootInitDone = true;
+   }
    
-   // Indicate successful boot with LED and buzzer
-   digitalWrite(LED_PIN, HIGH);
-   tone(BUZZER_PIN, 1000, 100);
-   delay(200);
-   tone(BUZZER_PIN, 1500, 100);
-   delay(200);
-   tone(BUZZER_PIN, 2000, 100);
-   digitalWrite(LED_PIN, LOW);
+#ifdef RENDER_BENCH_ON_BOOT
+   // Benchmark build (pio run -e esp32s3_bench): report before the first mode starts
+   if (renderBench.run(BENCH_FRAMES_DEFAULT, preferences)) {
+     renderBench.print(Serial);
+     memHealth.printCallSites(Serial);
+   }
+#endif
    
    // Initialize nextMode with currentMode or defaultMode
    currentMode = defaultMode;
    nextMode = currentMode;
+   OperationalModes::enter(currentMode);
+   applyPower(powerGate.enter(currentMode, OperationalModes::power(currentMode), millis()));
    
    Serial.println("Setup complete!");
  }
   
 
-void loop() {
-   // Handle OTA updates
-   ArduinoOTA.handle();
-   
-   // Skip regular processing during OTA
-   if (isOTAUpdating) {
-     return;
+void startBackgroundInit() {
+   // Core 0 alongside the WiFi stack; the mode loop keeps core 1 to itself
+   if (xTaskCreatePinnedToCore(backgroundInitTask, "bootInit", 8192, nullptr, 1, nullptr, 0) != pdPASS) {
+     LOGW("Background init task failed, initializing inline");
+     backgroundInit();
+   }
+ }
+  
+
+void backgroundInitTask(void*) {
+   backgroundInit();
+   vTaskDelete(nullptr);
+ }
+  
+
+void backgroundInit() {
+   // Nothing here may draw: the display belongs to the running mode
+   bmeAvailable = beginBME280();
+   if (bmeAvailable) {
+     LOGI("BME280 initialized!");
+   } else {
+     LOGW("Could not find a valid BME280 sensor!");
    }
+   bootTimeline.mark("bme280");
    
-   // Handle WiFi and MQTT reconnection
-   if (WiFi.status() != WL_CONNECTED) {
-     setupWiFi();
+   WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+   unsigned long wifiStart = millis();
+   while (WiFi.status() != WL_CONNECTED && millis() - wifiStart < 10000) {
+     delay(50);
    }
+   if (WiFi.status() == WL_CONNECTED) {
+     LOGI("Connected to WiFi, IP %s", WiFi.localIP().toString().c_str());
+     timeSync.begin(preferences, NTP_SERVER);
+   } else {
+     LOGW("Failed to connect to WiFi");
+   }
+   bootTimeline.mark("wifi");
    
-   if (!mqttClient.connected()) {
-     reconnectMQTT();
+   configureMQTT();
+   for (int attempts = 0; attempts < 3 && WiFi.status() == WL_CONNECTED; attempts++) {
+     if (connectMQTT()) break;
+     delay(2000);
    }
+   bootTimeline.mark("mqtt");
+   
+   setupOTA();
+   bootTimeline.mark("ota");
    
-   // Process MQTT messages
-   mqttClient.loop();
+   // Hand WiFi/MQTT housekeeping over to loop()
+   bootInitDone = true;
+ }
+  
+
+void loop() {
+   if (inputTrace.replaying()) {
+     // No live network input during a replay; recorded telecommands arrive here instead
+     char command[TRACE_MAX_COMMAND];
+     while (inputTrace.nextCommand(command, sizeof(command))) {
+       handleMQTTCallback((char*)mqttCommandTopic.c_str(), (byte*)command, strlen(command));
+     }
+   } else if (bootInitDone) {
+     // After a fast boot the background init owns WiFi and MQTT until it is done
+     // Handle OTA updates
+     ArduinoOTA.handle();
+     
+     // Skip regular processing during OTA
+     if (isOTAUpdating) {
+       return;
+     }
+     
+     // Handle WiFi and MQTT reconnection
+     if (WiFi.status() != WL_CONNECTED) {
+       setupWiFi();
+     }
+     
+     MemScope memScope(MEM_MQTT);
+     if (!mqttClient.connected()) {
+       reconnectMQTT();
+     }
+     
+     // Process MQTT messages
+     mqttClient.loop();
+   }
    
    // Debug touch sensors
    debugTouchSensors();
@@ -334,35 +579,62 @@ void loop() {
    // Check for serial commands to change modes
    if (Serial.available() > 0) {
      char cmd = Serial.read();
-     if (cmd >= '0' && cmd <= '5') {
+     if (cmd >= '0' && cmd < '0' + MODE_COUNT) {
        int newMode = cmd - '0';
-       Serial.print("Changing to mode ");
-       Serial.println(newMode);
+       LOGI("Changing to mode %d", newMode);
        nextMode = newMode;
      }
    }
    
-   // Check for mode changes from interrupts or serial
+   // Check for mode changes from interrupts or serial (a replay takes them from the trace)
+   inputTrace.modeRequest(currentMode, nextMode);
    if (currentMode != nextMode) {
      switchMode(nextMode);
    }
    
    // Send telemetry data periodically
-   if (millis() - lastTelemetryTime > 1000) {
+   if (bootInitDone && !inputTrace.replaying() && millis() - lastTelemetryTime > linkControl.periodMs()) {
      sendTelemetry();
      lastTelemetryTime = millis();
    }
    
    // Update battery status periodically
-   if (millis() - lastModeUpdateTime > 5000) {
-     batteryVoltage = analogRead(BATTERY_PIN) * BATTERY_VOLTAGE_MULTIPLIER * 3.3 / 4095.0;
-     usbVoltage = analogRead(USB_VOLTAGE_PIN) * USB_VOLTAGE_MULTIPLIER * 3.3 / 4095.0;
-     lowBatteryAlert = (batteryVoltage < LOW_BATTERY_THRESHOLD);
-     lastModeUpdateTime = millis();
+   if (inputTrace.due(TRACE_SITE_BATTERY, lastModeUpdateTime, 5000)) {
+     batteryVoltage = inputTrace.analog(BATTERY_PIN) * BATTERY_VOLTAGE_MULTIPLIER * 3.3 / 4095.0;
+     usbVoltage = inputTrace.analog(USB_VOLTAGE_PIN) * USB_VOLTAGE_MULTIPLIER * 3.3 / 4095.0;
+     lowBatteryAlert = alertEngine.active(ALERT_LOW_BATTERY);
    }
    
+   // High-rate history for burst captures, and the downlink of a finished one
+   if (inputTrace.live()) {
+     sampleBurst();
+     if (bootInitDone) sendBurstChunk();   // The MQTT client is backgroundInit()'s until then
+     sampleChannels();
+   }
+   
+   // Alert events from the samples, whatever mode is on screen
+   serviceAlerts();
+   
+   // Persist parameter changes once they have settled
+   params.service();
+   
    // Run the current operational mode
    runCurrentMode();
+   
+   // Mirror the frame the mode just drew
+   if (bootInitDone && !inputTrace.replaying()) {
+     sendDisplayMirror();
+   }
+   
+   // A mode change counts as executed once the new mode has drawn its first frame
+   if (ackCommand.length() > 0 && currentMode == nextMode) {
+     publishCommandAck(ackCommand, ackReceivedMicros);
+     ackCommand = "";
+   }
+   
+   if (inputTrace.finished()) {
+     finishReplay();
+   }
  }
   
 
@@ -395,6 +667,7 @@ void setupWiFi() {
      display.print("IP: ");
      display.println(WiFi.localIP());
      display.display();
+     timeSync.begin(preferences, NTP_SERVER);
      delay(1000);
    } else {
      Serial.println("\nFailed to connect to WiFi");
@@ -407,26 +680,36 @@ void setupWiFi() {
   
 
 void switchMode(int newMode) {
-   if (newMode < 0 || newMode > 5) {
+   if (!OperationalModes::isValid(newMode)) {
      return; // Invalid mode
    }
    
+   OperationalModes::exit(currentMode);
+   // The BME280 stays as configured until the new mode's needs are known, so a
+   // switch between two modes that gate it the same way writes nothing to it
+   applyPower(powerGate.exit(millis()) & ~POWER_BME280);
    currentMode = newMode;
-   Serial.print("Switching to mode ");
-   Serial.println(currentMode);
+   LOGI("Switching to mode %d", currentMode);
    
-   // Provide audio feedback
-   for (int i = 0; i < currentMode + 1; i++) {
-     tone(BUZZER_PIN, 2000, 100);
-     delay(200);
-   }
+   // Audio feedback, one beep per mode number, in the background
+   feedback.play(patternModeChange, currentMode + 1);
    
    // Update display
    displayModeInfo();
+   
+   // Start the new mode from a clean state, with only the peripherals it uses
+   OperationalModes::enter(currentMode);
+   applyPower(powerGate.enter(currentMode, OperationalModes::power(currentMode), millis()) | POWER_BME280);
  }
   
 
 void setupMQTT() {
+   configureMQTT();
+   reconnectMQTT();
+ }
+  
+
+void configureMQTT() {
    // Set the client to insecure mode - bypass certificate verification
    wifiClient.setInsecure();
    
@@ -434,7 +717,9 @@ void setupMQTT() {
    mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
    mqttClient.setCallback(handleMQTTCallback);
    
-   reconnectMQTT();
+   // Telemetry and PARAMS responses exceed PubSubClient's default 256 byte packet;
+   // the first packet with the boot timeline and channel statistics is ~1.6 kB
+   mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
  }
   
 
@@ -444,8 +729,8 @@ void setupBME280() {
    display.println("Initializing BME280...");
    display.display();
    
-   unsigned status = bme.begin(0x76);
-   if (!status) {
+   bmeAvailable = beginBME280();
+   if (!bmeAvailable) {
      Serial.println("Could not find a valid BME280 sensor!");
      display.println("BME280 not found!");
      display.println("Check wiring/address");
@@ -460,12 +745,92 @@ void setupBME280() {
  }
   
 
+bool beginBME280() {
+   // Probing and calibration readout go through the bus manager: after a fast
+   // boot this runs while the display task is already pushing frames
+   I2cTransaction transaction(i2cBus, i2cBme280);
+   if (!bme.begin(0x76)) return false;
+   configureBME280();
+   return true;
+ }
+  
+
+void configureBME280() {
+   // Caller holds the BME280 on the bus. Gated: sleep between forced x1
+   // conversions, each one started by writing the mode (no wait here)
+   bmeNormal = powerGate.on(POWER_BME280);
+   if (bmeNormal) {
+     bme.setSampling();      // Normal mode, x16, as begin() leaves it
+   } else {
+     bme.setSampling(Adafruit_BME280::MODE_FORCED, Adafruit_BME280::SAMPLING_X1, Adafruit_BME280::SAMPLING_X1,
+                     Adafruit_BME280::SAMPLING_X1, Adafruit_BME280::FILTER_OFF);
+   }
+ }
+  
+
+void applyPower(uint8_t changed) {
+   // Touch pads need no switching: sampleChannels() reads the gate. The
+   // BME280 is only written when its configuration differs from the gate
+   if ((changed & POWER_BME280) && bmeAvailable && bmeNormal != powerGate.on(POWER_BME280)) {
+     I2cTransaction transaction(i2cBus, i2cBme280, BME280_SAMPLING_BYTES);
+     configureBME280();
+   }
+   if (changed & POWER_DISPLAY) {
+     display.setContrast(powerGate.on(POWER_DISPLAY) ? DISPLAY_CONTRAST_FULL : DISPLAY_CONTRAST_DIM);
+   }
+ }
+  
+
+String powerJson() {
+   // Per mode: time current, CPU share and how long each peripheral was on
+   static_assert(MODE_COUNT <= POWER_MAX_MODES, "PowerGate accounts for every registered mode");
+   String json = "{";
+   json += "\"on\":" + String(powerGate.state()) + ",";
+   json += "\"transitions\":" + String(powerGate.transitions()) + ",";
+   json += "\"modes\":[";
+   for (int mode = 0; mode < MODE_COUNT; mode++) {
+     ModePower stats = powerGate.stats(mode, millis());
+     if (mode > 0) json += ",";
+     json += "{\"needs\":" + String(OperationalModes::power(mode)) + ",";
+     json += "\"entries\":" + String(stats.entries) + ",";
+     json += "\"resident_ms\":" + String(stats.residentMs) + ",";
+     json += "\"busy_pct\":" + String(stats.residentMs ? stats.busyUs / (stats.residentMs * 10.0) : 0.0, 2) + ",";
+     json += "\"bme_ms\":" + String(stats.onMs[0]) + ",";
+     json += "\"touch_aux_ms\":" + String(stats.onMs[1]) + ",";
+     json += "\"display_full_ms\":" + String(stats.onMs[2]) + "}";
+   }
+   json += "]}";
+   return json;
+ }
+  
+
+bool setupOrbit(const String& line1, const String& line2) {
+   // Reject malformed elements without disturbing the current orbit
+   TleElements elements;
+   if (!parseTle(line1.c_str(), line2.c_str(), elements)) {
+     LOGW("Orbit elements rejected");
+     return false;
+   }
+   orbitValid = orbitPropagator.init(elements);
+   
+   // Build the first ephemeris table at epoch; Mode 5 rebuilds it once per orbit
+   if (orbitValid) {
+     orbitValid = (orbitEphemeris.build(orbitPropagator, 0.0) == ORBIT_OK);
+   }
+   
+   LOGI("Orbit elements %s", orbitValid ? "loaded" : "rejected");
+   return orbitValid;
+ }
+  
+
 void setupOTA() {
    ArduinoOTA.setHostname("floyd-satellite");
    ArduinoOTA.setPassword("admin");
    
    ArduinoOTA.onStart([]() {
      isOTAUpdating = true;
+     otaStartTime = millis();
+     otaBytesReceived = 0;
      String type = (ArduinoOTA.getCommand() == U_FLASH) ? "sketch" : "filesystem";
      Serial.println("Start updating " + type);
      
@@ -477,30 +842,21 @@ void setupOTA() {
    });
    
    ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-     Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
-     
-     display.clearDisplay();
-     display.setCursor(0, 0);
-     display.println("OTA Update");
-     display.print("Progress: ");
-     display.print(progress / (total / 100));
-     display.println("%");
-     
-     // Draw progress bar
-     display.drawRect(0, 30, 128, 10, SSD1306_WHITE);
-     display.fillRect(0, 30, (progress / (total / 128)), 10, SSD1306_WHITE);
-     display.display();
+     otaBytesReceived = progress;
+     showOtaProgress(progress, total);
    });
    
    ArduinoOTA.onEnd([]() {
      Serial.println("\nOTA Update finished");
      isOTAUpdating = false;
+     reportOtaThroughput(otaBytesReceived, otaBytesReceived, millis() - otaStartTime);
      
      display.clearDisplay();
      display.setCursor(0, 0);
      display.println("OTA Update Complete!");
      display.println("Rebooting...");
      display.display();
+     display.flush();
    });
    
    ArduinoOTA.onError([](ota_error_t error) {
@@ -535,6 +891,54 @@ void setupOTA() {
  }
   
 
+void showOtaProgress(uint32_t done, uint32_t total) {
+   // Every redraw is a full frame transfer, so cap the rate and keep the
+   // radio and flash busy with the image instead
+   static unsigned long lastDraw = 0;
+   bool finished = total > 0 && done >= total;
+   if (!finished && millis() - lastDraw < otaProgressInterval) {
+     return;
+   }
+   lastDraw = millis();
+   
+   display.clearDisplay();
+   display.setCursor(0, 0);
+   display.println("OTA Update");
+   
+   if (total > 0) {
+     unsigned int percent = (uint64_t)done * 100 / total;
+     Serial.printf("Progress: %u%%\r", percent);
+     display.print("Progress: ");
+     display.print(percent);
+     display.println("%");
+     
+     // Draw progress bar
+     display.drawRect(0, 30, 128, 10, SSD1306_WHITE);
+     display.fillRect(0, 30, (uint64_t)done * 128 / total, 10, SSD1306_WHITE);
+   } else {
+     // Size unknown (chunked download)
+     Serial.printf("Received: %u bytes\r", done);
+     display.print("Received: ");
+     display.print(done / 1024);
+     display.println(" KB");
+   }
+   display.display();
+ }
+  
+
+void reportOtaThroughput(uint32_t receivedBytes, uint32_t imageBytes, unsigned long elapsedMs) {
+   float seconds = max(elapsedMs, 1UL) / 1000.0;
+   String report = "OTA: " + String(receivedBytes) + " B received, " + String(imageBytes) +
+                   " B written in " + String(seconds, 1) + " s (" +
+                   String(receivedBytes / 1024.0 / seconds, 1) + " KB/s link, " +
+                   String(imageBytes / 1024.0 / seconds, 1) + " KB/s image)";
+   Serial.println(report);
+   if (mqttClient.connected()) {
+     mqttClient.publish(mqttResponseTopic.c_str(), report.c_str());
+   }
+ }
+  
+
 void getChipInfo() {
    esp_chip_info_t chipInfo;
    esp_chip_info(&chipInfo);
@@ -552,6 +956,47 @@ void getChipInfo() {
  }
   
 
+String resolveBoardId() {
+   // A pinned board_id keeps legacy topics (e.g. 0); otherwise use the
+   // device-specific half of the eFuse MAC so every board gets its own topics
+   int32_t pinned = params.getInt(PARAM_BOARD_ID);
+   if (pinned >= 0) {
+     return String(pinned);
+   }
+   uint64_t mac = ESP.getEfuseMac(); // Byte 0 of the MAC in the low bits
+   char id[7];
+   snprintf(id, sizeof(id), "%02x%02x%02x", (uint8_t)(mac >> 24), (uint8_t)(mac >> 32), (uint8_t)(mac >> 40));
+   return String(id);
+ }
+  
+
+void applyParameter(int id) {
+   if (id == PARAM_DEFAULT_MODE) {
+     defaultMode = params.getInt(PARAM_DEFAULT_MODE);
+     LOGI("Default mode set to: %d", defaultMode);
+   } else if (id == PARAM_TOUCH_THRESHOLD) {
+     initializeTouchbuttons();
+   } else if (id >= PARAM_MODE_INTERVAL && id < PARAM_MODE_INTERVAL + MODE_COUNT) {
+     OperationalModes::setUpdateInterval(id - PARAM_MODE_INTERVAL, params.modeInterval(id - PARAM_MODE_INTERVAL));
+   } else if (id == PARAM_BOARD_ID) {
+     LOGI("Board ID %s becomes %s after a restart", mqttBoardId.c_str(), resolveBoardId().c_str());
+   } else if (id == PARAM_TELEMETRY_PERIOD || id == PARAM_TELEMETRY_MAX_PERIOD || id == PARAM_RATE_CONTROL) {
+     // Restarts at the fastest rate; a poor link backs off again within a few packets
+     linkControl.begin(params.getInt(PARAM_TELEMETRY_PERIOD), params.getInt(PARAM_TELEMETRY_MAX_PERIOD),
+                       params.getInt(PARAM_RATE_CONTROL) != 0);
+   } else if (id == PARAM_MIRROR_PERIOD) {
+     // Whoever switched it on wants to see the screen now
+     displayMirror.requestKey();
+   } else if (id == PARAM_ALERT_THRESHOLD) {
+     alertEngine.setThreshold(ALERT_CAT_SAFETY, params.getFloat(PARAM_ALERT_THRESHOLD));
+   } else if (id == PARAM_MICROG_THRESHOLD) {
+     alertEngine.setThreshold(ALERT_FREE_FALL, params.getInt(PARAM_MICROG_THRESHOLD));
+   } else if (id == PARAM_QNH) {
+     baroAltitude.setQnh(params.getFloat(PARAM_QNH));
+   }
+ }
+  
+
 void displayBootSequence() {
    display.clearDisplay();
    
@@ -614,717 +1059,775 @@ void handleMQTTCallback(char* topic, byte* payload, unsigned int length) {
      message[i] = (char)payload[i];
    }
    message[length] = '\0';
+   MemScope memScope(MEM_COMMANDS);
    
-   Serial.print("Message received: [");
-   Serial.print(topic);
-   Serial.print("] ");
-   Serial.println(message);
+   LOGD("Message received: [%s] %s", topic, message);
    
    // Process commands
    if (String(topic) == mqttCommandTopic) {
+     int64_t received = TimeSync::monotonicMicros();
      String command = String(message);
-     
-     if (command.startsWith("M") && command.length() == 2) {
-       int newMode = command.substring(1).toInt();
-       if (newMode >= 0 && newMode <= 5) {
-         nextMode = newMode;
-         mqttClient.publish(mqttResponseTopic.c_str(), ("Mode changed to " + String(newMode)).c_str());
-       } else {
-         mqttClient.publish(mqttResponseTopic.c_str(), "Invalid mode number");
-       }
-     } 
-     else if (command.startsWith("SET_DEFAULT_M") && command.length() == 13) {
-       int newDefaultMode = command.substring(12).toInt();
-       if (newDefaultMode >= 0 && newDefaultMode <= 5) {
-         defaultMode = newDefaultMode;
-         // Store default mode in non-volatile memory
-         preferences.putInt("defMode", defaultMode);
-         Serial.print("Default mode set to: ");
-         Serial.println(defaultMode);
-         mqttClient.publish(mqttResponseTopic.c_str(), ("Default mode set to " + String(defaultMode)).c_str());
-       } else {
-         mqttClient.publish(mqttResponseTopic.c_str(), "Invalid default mode number");
-       }
+     if (executeCommand(command, message, length, received) && !inputTrace.replaying()) {
+       publishCommandAck(command, received);
+     }
+   }
+ }
+  
+
+bool executeCommand(const String& command, char* message, unsigned int length, int64_t received) {
+   // False when the command takes effect later (mode changes) and acknowledges itself
+   Telecommand telecommand = parseTelecommand(command.c_str());
+   if (telecommand.id == TC_TRACE) {
+     handleTraceCommand(command);
+     return true;
+   }
+   if (telecommand.id == TC_BENCH) {
+     handleBenchCommand(command);
+     return true;
+   }
+   if (telecommand.id == TC_MEM) {
+     // Call sites of the last benchmark go to the console, they need the ELF to decode
+     memHealth.printCallSites(Serial);
+     mqttClient.publish(mqttResponseTopic.c_str(), memHealth.json().c_str());
+     return true;
+   }
+   if (inputTrace.replaying() && (telecommand.id == TC_OTA_URL || telecommand.id == TC_OTA_RESTART)) {
+     return true; // Never flash or restart from a replayed trace
+   }
+   inputTrace.command(message, length);
+   
+   // Mode, parameter and unknown commands are answered by telecommand.cpp
+   String response;
+   TelecommandResult result = runTelecommand(telecommand, params, response);
+   if (result == TC_MODE_CHANGE) {
+     nextMode = telecommand.number;
+     mqttClient.publish(mqttResponseTopic.c_str(), response.c_str());
+     if (nextMode != currentMode && !inputTrace.replaying()) {
+       ackCommand = command;
+       ackReceivedMicros = received;
+       return false;
+     }
+   }
+   else if (result == TC_DONE) {
+     mqttClient.publish(mqttResponseTopic.c_str(), response.c_str());
+   }
+   else if (telecommand.id == TC_TLE) {
+     // Two-line element set, lines separated by newline or '|'
+     int split = command.indexOf('\n');
+     if (split < 0) split = command.indexOf('|');
+     String line1 = command.substring(4, split);
+     String line2 = command.substring(split + 1);
+     line1.trim();
+     line2.trim();
+     if (split > 0 && setupOrbit(line1, line2)) {
+       preferences.putString("tle1", line1);
+       preferences.putString("tle2", line2);
+       mqttClient.publish(mqttResponseTopic.c_str(), ("TLE accepted, period " + String(orbitPropagator.periodMinutes(), 1) + " min").c_str());
+     } else {
+       mqttClient.publish(mqttResponseTopic.c_str(), "Invalid TLE");
      }
-     else if (command == "OTA_RESTART") {
-       mqttClient.publish(mqttResponseTopic.c_str(), "Restarting for OTA update...");
+   }
+   else if (telecommand.id == TC_OTA_URL) {
+     // Pull an image (heatshrink-compressed if the URL ends in .hs)
+     String url = command.substring(8);
+     url.trim();
+     mqttClient.publish(mqttResponseTopic.c_str(), ("Fetching " + url).c_str());
+     params.commit();
+     isOTAUpdating = true;
+     
+     OtaReport report;
+     bool ok = runUrlOta(url, showOtaProgress, report);
+     isOTAUpdating = false;
+     reportOtaThroughput(report.downloadedBytes, report.imageBytes, report.elapsedMs);
+     
+     display.clearDisplay();
+     display.setCursor(0, 0);
+     if (ok) {
+       mqttClient.publish(mqttResponseTopic.c_str(), "OTA update staged, rebooting...");
+       display.println("OTA Update Complete!");
+       display.println("Rebooting...");
+       display.display();
+       display.flush();
        delay(500);
        ESP.restart();
+     } else {
+       LOGE("OTA failed: %s", report.error);
+       mqttClient.publish(mqttResponseTopic.c_str(), (String("OTA failed: ") + report.error).c_str());
+       display.println("OTA Error!");
+       display.println(report.error);
+       display.display();
      }
-     else {
-       mqttClient.publish(mqttResponseTopic.c_str(), "Unknown command");
+   }
+   else if (telecommand.id == TC_OTA_RESTART) {
+     params.commit();
+     mqttClient.publish(mqttResponseTopic.c_str(), "Restarting for OTA update...");
+     delay(500);
+     ESP.restart();
+   }
+   else if (telecommand.id == TC_BURST) {
+     String json = "{";
+     json += "\"state\":\"" + String(burstCapture.status() == BURST_ARMED ? "armed" :
+                                      burstCapture.status() == BURST_POST_TRIGGER ? "recording" : "sending") + "\",";
+     json += "\"captures\":" + String(burstCapture.captures()) + ",";
+     json += "\"missed\":" + String(burstCapture.missed()) + ",";
+     json += "\"chunks_left\":" + String(burstCapture.chunksLeft());
+     json += "}";
+     mqttClient.publish(mqttResponseTopic.c_str(), json.c_str());
+   }
+   else if (telecommand.id == TC_BURST_TRIGGER) {
+     bool started = inputTrace.live() && burstCapture.trigger(BURST_TRIGGER_MANUAL, timeSync.unixMicros());
+     mqttClient.publish(mqttResponseTopic.c_str(), started ? "Burst capture triggered" : "Burst capture busy");
+   }
+   else if (telecommand.id == TC_MIRROR) {
+     String json = "{";
+     json += "\"period_ms\":" + String(params.getInt(PARAM_MIRROR_PERIOD)) + ",";
+     json += "\"frames\":" + String(displayMirror.frames()) + ",";
+     json += "\"keys\":" + String(displayMirror.keys()) + ",";
+     json += "\"unchanged\":" + String(displayMirror.unchanged()) + ",";
+     json += "\"bytes\":" + String(displayMirror.bytes()) + ",";
+     json += "\"last_bytes\":" + String(displayMirror.lastBytes());
+     json += "}";
+     mqttClient.publish(mqttResponseTopic.c_str(), json.c_str());
+   }
+   else if (telecommand.id == TC_MIRROR_KEY) {
+     displayMirror.requestKey();
+     mqttClient.publish(mqttResponseTopic.c_str(), "Display mirror keyframe requested");
+   }
+   else if (telecommand.id == TC_POWER) {
+     mqttClient.publish(mqttResponseTopic.c_str(), powerJson().c_str());
+   }
+   else if (telecommand.id == TC_ALERTS) {
+     mqttClient.publish(mqttResponseTopic.c_str(), alertsJson().c_str());
+   }
+   else if (telecommand.id == TC_NTP) {
+     mqttClient.publish(mqttResponseTopic.c_str(), timeSync.json().c_str());
+   }
+   else if (telecommand.id == TC_NTP_SERVER) {
+     // NTP <host>: SNTP server, e.g. one on the ground station LAN
+     String host = command.substring(4);
+     host.trim();
+     if (timeSync.setServer(host, preferences)) {
+       mqttClient.publish(mqttResponseTopic.c_str(), ("NTP server set to " + host).c_str());
+     } else {
+       mqttClient.publish(mqttResponseTopic.c_str(), "Invalid NTP server");
      }
    }
+   return true;
  }
   
 
-void sendTelemetry() {
-   if (mqttClient.connected()) {
-     String telemetryJson = createJSONTelemetry();
-     bool success = mqttClient.publish(mqttTelemetryTopic.c_str(), telemetryJson.c_str());
-     
-     if (success) {
-       Serial.println("Telemetry sent: " + telemetryJson);
-     } else {
-       Serial.println("Failed to send telemetry, error code: " + String(mqttClient.state()));
+void publishCommandAck(const String& command, int64_t received) {
+   // Wall clock receipt and completion (0 before the first SNTP sync); exec_us
+   // comes from the monotonic clock and is exact either way
+   int64_t done = TimeSync::monotonicMicros();
+   String json = telecommandAck(command.c_str(), timeSync.unixAt(received), timeSync.unixAt(done), done - received);
+   mqttClient.publish(mqttAckTopic.c_str(), json.c_str());
+ }
+  
+
+void sampleBurst() {
+   // Nothing is recorded while a finished capture is being sent
+   if (!burstCapture.sampling() || millis() - lastBurstSampleTime < BURST_SAMPLE_MS) return;
+   lastBurstSampleTime = millis();
+   
+   BurstSample sample;
+   sample.timeMs = lastBurstSampleTime;
+   sample.touchRight = touchRead(TOUCH_RIGHT);
+   sample.touchLeft = touchRead(TOUCH_LEFT);
+   sample.pressure = NAN;
+   if (bmeAvailable) {
+     I2cTransaction transaction(i2cBus, i2cBme280, BME280_PRESSURE_BYTES);
+     sample.pressure = bme.readPressure() / 100.0F;
+   }
+   burstCapture.add(sample);
+ }
+  
+
+void sendBurstChunk() {
+   // One chunk per BURST_CHUNK_INTERVAL so telemetry and commands are not held up
+   if (burstCapture.chunksLeft() == 0 || !mqttClient.connected() ||
+       millis() - lastBurstChunkTime < BURST_CHUNK_INTERVAL) return;
+   lastBurstChunkTime = millis();
+   
+   uint8_t message[BURST_CHUNK_HEADER + BURST_CHUNK_BYTES];
+   size_t length = burstCapture.chunk(message, sizeof(message));
+   if (length > 0 && mqttClient.publish(mqttBurstTopic.c_str(), message, length)) {
+     burstCapture.chunkSent();
+     if (burstCapture.chunksLeft() == 0) {
+       LOGI("Burst capture %u sent", burstCapture.captures());
      }
-   } else {
-     Serial.println("Cannot send telemetry: MQTT not connected");
    }
  }
   
 
-String createJSONTelemetry() {
-   // Manually create JSON
-   String json = "{";
+
+void sendDisplayMirror() {
+   // mirror_period_ms = 0 switches the mirror off
+   unsigned long period = params.getInt(PARAM_MIRROR_PERIOD);
+   if (period == 0 || !mqttClient.connected() || millis() - lastMirrorTime < period) return;
+   lastMirrorTime = millis();
    
-   // System information
-   json += "\"device_id\":\"" + deviceID + "\",";
-   json += "\"uptime\":" + String(millis() / 1000) + ",";
-   json += "\"free_heap\":" + String(ESP.getFreeHeap()) + ",";
-   json += "\"mode\":" + String(currentMode) + ",";
-   json += "\"default_mode\":" + String(defaultMode) + ",";
-   
-   // Voltage readings
-   json += "\"battery_voltage\":" + String(batteryVoltage, 2) + ",";
-   json += "\"usb_voltage\":" + String(usbVoltage, 2) + ",";
-   json += "\"low_battery\":" + String(lowBatteryAlert ? "true" : "false") + ",";
-   
-   // Touch sensor values
-   json += "\"touch_right\":" + String(touchRead(TOUCH_RIGHT)) + ",";
-   json += "\"touch_left\":" + String(touchRead(TOUCH_LEFT)) + ",";
-   json += "\"touch_up\":" + String(touchRead(TOUCH_UP)) + ",";
-   json += "\"touch_down\":" + String(touchRead(TOUCH_DOWN)) + ",";
-   json += "\"touch_x\":" + String(touchRead(TOUCH_X)) + ",";
-   
-   // Add simulated acceleration data (3 axes)
-   json += "\"acceleration\":{";
-   json += "\"x\":" + String(random(98, 102) / 10.0, 1) + ","; // Around 1g with variation
-   json += "\"y\":" + String(random(-5, 5) / 10.0, 1) + ",";   // Near 0g with small variation
-   json += "\"z\":" + String(random(-5, 5) / 10.0, 1);          // Near 0g with small variation
-   json += "},";
-   
-   // Add simulated angular rate data (3 axes)
-   json += "\"gyro\":{";
-   json += "\"x\":" + String(random(-20, 20) / 10.0, 1) + ","; // Random rotation
-   json += "\"y\":" + String(random(-20, 20) / 10.0, 1) + ","; // Random rotation
-   json += "\"z\":" + String(random(-20, 20) / 10.0, 1);        // Random rotation
-   json += "},";
-   
-   // Environmental data
-   if (bme.begin(0x76)) {
-     json += "\"temperature\":" + String(bme.readTemperature(), 1) + ",";
-     json += "\"pressure\":" + String(bme.readPressure() / 100.0F, 1) + ",";
-     json += "\"humidity\":" + String(bme.readHumidity(), 1) + ",";
-     json += "\"altitude\":" + String(bme.readAltitude(1013.25), 1) + ",";
-   } else {
-     json += "\"temperature\":null,";
-     json += "\"pressure\":null,";
-     json += "\"humidity\":null,";
-     json += "\"altitude\":null,";
+   // Unchanged frames cost nothing; the reference only moves on once the ground has the message
+   uint8_t message[MIRROR_MESSAGE_BYTES];
+   size_t length = displayMirror.encode(display.getBuffer(), millis(), message, sizeof(message));
+   if (length > 0 && mqttClient.publish(mqttDisplayTopic.c_str(), message, length)) {
+     displayMirror.sent();
    }
-   
-   // Network information
-   json += "\"wifi_strength\":" + String(WiFi.RSSI(), 1) + ",";
-   json += "\"ip_address\":\"" + WiFi.localIP().toString() + "\"";
-   
-   json += "}";
-   return json;
  }
   
 
-void reconnectMQTT() {
-   if (WiFi.status() != WL_CONNECTED) return;
+void sampleChannels() {
+   // Every channel at its sensor's own rate, or duty-cycled when the mode does not use it
+   uint32_t start = micros();
+   if (millis() - lastStatsTouchTime >= STATS_TOUCH_MS) {
+     lastStatsTouchTime = millis();
+     int right = touchRead(TOUCH_RIGHT);
+     int left = touchRead(TOUCH_LEFT);
+     channelStats[STATS_TOUCH_RIGHT].add(right);
+     channelStats[STATS_TOUCH_LEFT].add(left);
+     alertEngine.sample(ALERT_TOUCH_DELTA, abs(right - left), millis());
+   }
    
-   display.clearDisplay();
-   display.setCursor(0, 0);
-   display.println("Connecting to MQTT...");
-   display.display();
+   if (millis() - lastStatsAuxTime >= (powerGate.on(POWER_TOUCH_AUX) ? STATS_TOUCH_MS : POWER_TOUCH_IDLE_MS)) {
+     lastStatsAuxTime = millis();
+     channelStats[STATS_TOUCH_UP].add(touchRead(TOUCH_UP));
+     channelStats[STATS_TOUCH_DOWN].add(touchRead(TOUCH_DOWN));
+     channelStats[STATS_TOUCH_X].add(touchRead(TOUCH_X));
+   }
    
-   Serial.print("Attempting MQTT connection to ");
-   Serial.println(MQTT_SERVER);
+   if (millis() - lastStatsAdcTime >= STATS_ADC_MS) {
+     lastStatsAdcTime = millis();
+     float battery = analogRead(BATTERY_PIN) * BATTERY_VOLTAGE_MULTIPLIER * 3.3 / 4095.0;
+     float usb = analogRead(USB_VOLTAGE_PIN) * USB_VOLTAGE_MULTIPLIER * 3.3 / 4095.0;
+     channelStats[STATS_BATTERY].add(battery);
+     channelStats[STATS_USB].add(usb);
+     alertEngine.sample(ALERT_BATTERY, battery, millis());
+     alertEngine.sample(ALERT_USB, usb, millis());
+   }
    
-   // Try to connect with a maximum of 3 attempts
-   int attempts = 0;
-   while (!mqttClient.connected() && attempts < 3) {
-     Serial.print("Attempt #");
-     Serial.print(attempts + 1);
-     Serial.print("... ");
-     
-     // Connect with client ID and username/password from arduino_secrets.h
-     if (mqttClient.connect(MQTT_CLIENT_ID, MQTT_USER, MQTT_PASSWORD)) {
-       Serial.println("connected!");
-       display.println("Connected!");
-       display.display();
-       
-       // Subscribe to command topic
-       mqttClient.subscribe(mqttCommandTopic.c_str());
-       Serial.print("Subscribed to: ");
-       Serial.println(mqttCommandTopic);
-       
-       // Send online status
-       mqttClient.publish(mqttResponseTopic.c_str(), "{\"status\":\"online\"}");
-     } else {
-       int errorCode = mqttClient.state();
-       Serial.print("failed, rc=");
-       Serial.print(errorCode);
-       Serial.print(" (");
-       
-       // Print more detailed error information
-       switch(errorCode) {
-         case -1: Serial.print("Connection timeout"); break;
-         case -2: Serial.print("Connection lost"); break;
-         case -3: Serial.print("Connection failed"); break;
-         case -4: Serial.print("Server disconnected"); break;
-         case -5: Serial.print("Bad protocol"); break;
-         case -6: Serial.print("Bad client ID"); break;
-         case -7: Serial.print("Connection unavailable"); break;
-         case -8: Serial.print("Bad credentials"); break;
-         case -9: Serial.print("Unauthorized"); break;
-         default: Serial.print("Unknown error"); break;
+   // Gated: read the conversion started a period ago, then start the next one.
+   // Also catches a gate change that raced the BME280 coming up at boot.
+   bool bmeGated = !powerGate.on(POWER_BME280);
+   if (bmeAvailable && millis() - lastStatsBmeTime >= (bmeGated ? POWER_BME_IDLE_MS : STATS_BME_MS)) {
+     lastStatsBmeTime = millis();
+     bool configure = bmeGated || !bmeNormal;
+     I2cTransaction transaction(i2cBus, i2cBme280,
+       BME280_TEMPERATURE_BYTES + BME280_PRESSURE_BYTES + BME280_HUMIDITY_BYTES + (configure ? BME280_SAMPLING_BYTES : 0));
+     float temperature = bme.readTemperature();
+     float pressure = bme.readPressure() / 100.0F;
+     float humidity = bme.readHumidity();
+     channelStats[STATS_TEMPERATURE].add(temperature);
+     channelStats[STATS_PRESSURE].add(pressure);
+     channelStats[STATS_HUMIDITY].add(humidity);
+     alertEngine.sample(ALERT_TEMPERATURE, temperature, millis());
+     alertEngine.sample(ALERT_PRESSURE, pressure, millis());
+     alertEngine.sample(ALERT_HUMIDITY, humidity, millis());
+     baroAltitude.update(pressure, millis(), NAN);      // No IMU on this board
+     if (configure) configureBME280();
+   }
+   powerGate.busy(micros() - start);
+ }
+  
+
+void serviceAlerts() {
+   // Raise and clear events: log, burst capture around the onset, buzzer and LED, ground
+   AlertEvent event;
+   while (alertEngine.poll(event)) {
+     const AlertRule& rule = alertEngine.rule(event.rule);
+     bool critical = rule.severity == ALERT_CRITICAL;
+     if (event.raised) {
+       LOGW("Alert %s raised (%.2f)", rule.name, event.value);
+       if (rule.pattern) feedback.play(*rule.pattern, critical ? 0 : 1);
+       if (event.rule == ALERT_CAT_SAFETY) {
+         burstCapture.trigger(BURST_TRIGGER_CAT_ALERT, timeSync.unixMicros());
+       } else if (event.rule == ALERT_FREE_FALL) {
+         burstCapture.trigger(BURST_TRIGGER_FREE_FALL, timeSync.unixMicros());
        }
-       
-       Serial.println(") trying again in 2 seconds");
-       delay(2000);
-       attempts++;
+     } else {
+       LOGI("Alert %s cleared (%.2f)", rule.name, event.value);
+       if (rule.pattern && critical) feedback.stop(*rule.pattern);
      }
+     publishAlert(event);
    }
    
-   if (!mqttClient.connected()) {
-     display.println("Failed to connect!");
-     display.println("Check MQTT settings");
-     display.display();
-     delay(2000);
+   // A critical alarm replaced by another one resumes when that one clears
+   int top = alertEngine.top();
+   if (top != ALERT_NONE && alertEngine.rule(top).severity == ALERT_CRITICAL && alertEngine.rule(top).pattern &&
+       feedback.priority() < alertEngine.rule(top).pattern->priority) {
+     feedback.play(*alertEngine.rule(top).pattern, 0);
    }
  }
   
 
-void displayModeInfo() {
+void publishAlert(const AlertEvent& event) {
+   // Lost while offline or still booting (backgroundInit() owns the client until then);
+   // the ALERTS command and the telemetry mask give the current state
+   if (!bootInitDone || !mqttClient.connected()) return;
+   const AlertRule& rule = alertEngine.rule(event.rule);
+   int64_t at = TimeSync::monotonicMicros() - (int64_t)(millis() - event.timeMs) * 1000;
+   String json = "{";
+   json += "\"rule\":\"" + String(rule.name) + "\",";
+   json += "\"state\":\"" + String(event.raised ? "raised" : "cleared") + "\",";
+   json += "\"severity\":" + String(rule.severity) + ",";
+   json += "\"value\":" + String(event.value, 2) + ",";
+   json += "\"threshold\":" + String(alertEngine.threshold(event.rule), 2) + ",";
+   json += "\"ts_us\":" + TimeSync::format(timeSync.unixAt(at)) + ",";
+   json += "\"mono_us\":" + TimeSync::format(at);
+   json += "}";
+   mqttClient.publish(mqttAlertTopic.c_str(), json.c_str());
+ }
+  
+
+void drawOverlays() {
+   drawModeBanner();
+   drawAlertBanner();
+ }
+  
+
+void drawModeBanner() {
+   // The first frame drawn after the duration clears it; traces and benchmarks
+   // see the mode's own frames
+   if (!modeBannerShown) return;
+   if (millis() - modeBannerTime >= modeBannerDuration || !inputTrace.live()) {
+     modeBannerShown = false;
+     return;
+   }
+   
+   int16_t x = display.getCursorX();
+   int16_t y = display.getCursorY();
    display.clearDisplay();
    display.setCursor(0, 0);
    display.println("CADSE Space Electronics");
    display.setTextSize(2);
    display.println("Mode " + String(currentMode));
    display.setTextSize(1);
-   
-   switch (currentMode) {
-     case 0:
-       display.println("Basic Monitoring");
-       break;
-     case 1:
-       display.println("Micro-G Detection");
-       break;
-     case 2:
-       display.println("Pressure Monitor");
-       break;
-     case 3:
-       display.println("Attitude Indicator");
-       break;
-     case 4:
-       display.println("Rolling Plotter");
-       break;
-     case 5:
-       display.println("Creative: Orbit Sim");
-       break;
-     default:
-       display.println("Unknown Mode");
-       break;
-   }
-   
-   display.display();
-   delay(1000);
+   display.println(OperationalModes::name(currentMode));
+   display.setCursor(x, y);
  }
   
 
-void runCurrentMode() {
-   switch (currentMode) {
-     case 0:
-       runBasicMonitoring();
-       break;
-     case 1:
-       runMicroGravityDetection();
-       break;
-     case 2:
-       runPressureMonitoring();
-       break;
-     case 3:
-       runAttitudeIndicator();
-       break;
-     case 4:
-       runRollingPlotter();
-       break;
-     case 5:
-       runCreativeMode();
-       break;
-     default:
-       runBasicMonitoring();
-       break;
-   }
+void drawAlertBanner() {
+   // Most severe active warning across the bottom line of whatever mode is drawing.
+   // Hardware inputs only: traces and benchmarks see the mode's own frames.
+   int top = alertEngine.top();
+   if (top == ALERT_NONE || alertEngine.rule(top).severity < ALERT_WARNING || !inputTrace.live()) return;
+   
+   // Boot screens keep printing after display(), so the cursor goes back where it was
+   int16_t x = display.getCursorX();
+   int16_t y = display.getCursorY();
+   display.fillRect(0, SCREEN_HEIGHT - 9, SCREEN_WIDTH, 9, SSD1306_WHITE);
+   display.setTextColor(SSD1306_BLACK);
+   display.setCursor(2, SCREEN_HEIGHT - 8);
+   display.print("! ");
+   display.print(alertEngine.rule(top).name);
+   display.setTextColor(SSD1306_WHITE);
+   display.setCursor(x, y);
  }
   
 
-void runBasicMonitoring() {
-   static unsigned long lastUpdateTime = 0;
-   const unsigned long updateInterval = 1000; // Update every second
-   
-   if (millis() - lastUpdateTime < updateInterval) {
-     return;
-   }
-   
-   lastUpdateTime = millis();
-   
-   display.clearDisplay();
-   display.setCursor(0, 0);
-   display.println("Mode 0: Basic Status");
-   display.drawLine(0, 10, 128, 10, SSD1306_WHITE);
-   
-   // Battery status
-   display.setCursor(0, 12);
-   display.print("Batt: ");
-   display.print(batteryVoltage, 1);
-   display.println("V");
-   
-   // USB status
-   display.print("USB: ");
-   display.print(usbVoltage, 1);
-   display.println("V");
-   
-   // WiFi status
-   display.print("WiFi: ");
-   if (WiFi.status() == WL_CONNECTED) {
-     display.print("Connected (");
-     display.print(WiFi.RSSI());
-     display.println("dBm)");
-   } else {
-     display.println("Disconnected");
+String alertsJson() {
+   // Every rule with its current state, for the ALERTS command
+   String json = "{";
+   json += "\"evaluations\":" + String(alertEngine.evaluations()) + ",";
+   json += "\"dropped\":" + String(alertEngine.eventsDropped()) + ",";
+   json += "\"rules\":[";
+   for (int i = 0; i < alertEngine.count(); i++) {
+     const AlertState& state = alertEngine.state(i);
+     if (i > 0) json += ",";
+     json += "{\"name\":\"" + String(alertEngine.rule(i).name) + "\",";
+     json += "\"severity\":" + String(alertEngine.rule(i).severity) + ",";
+     json += "\"active\":" + String(state.active ? "true" : "false") + ",";
+     json += "\"raised\":" + String(state.raised) + ",";
+     json += "\"value\":" + String(state.value, 2) + ",";
+     json += "\"threshold\":" + String(state.threshold, 2) + "}";
    }
-   
-   // MQTT status
-   display.print("MQTT: ");
-   display.println(mqttClient.connected() ? "Connected" : "Disconnected");
-   
-   // Runtime
-   display.print("Uptime: ");
-   unsigned long uptime = millis() / 1000;
-   display.print(uptime / 60);
-   display.print("m ");
-   display.print(uptime % 60);
-   display.println("s");
-   
-   display.display();
+   json += "]}";
+   return json;
  }
   
 
-void runMicroGravityDetection() {
-   static unsigned long lastUpdateTime = 0;
-   const unsigned long updateInterval = 200; // Update every 200ms
-   static int fallingCounter = 0;
-   static bool inFreeFall = false;
-   
-   // Using touch reading changes to simulate acceleration
-   // In a real implementation, this would use MPU6050 data
-   int touch1 = touchRead(TOUCH_RIGHT);
-   int touch2 = touchRead(TOUCH_LEFT);
-   int touchDiff = abs(touch1 - touch2);
-   
-   // Simulate free-fall detection using touch sensor changes
-   // FIXED: Changed threshold from 100 to 15000 to prevent false detections
-   bool freeFallDetected = (touchDiff > 15000);
-   
-   // Debug output when close to threshold
-   if (touchDiff > 2500) {
-     Serial.print("Touch diff: ");
-     Serial.println(touchDiff);
+uint32_t alertMask() {
+   // Bit n set while rule n of the table is active
+   static_assert(ALERT_RULE_COUNT <= 32, "Alert mask holds every rule");
+   uint32_t mask = 0;
+   for (int i = 0; i < ALERT_RULE_COUNT; i++) {
+     if (alertEngine.active(i)) mask |= 1UL << i;
    }
-   
-   if (freeFallDetected && !inFreeFall) {
-     inFreeFall = true;
-     fallingCounter = 10; // Fall duration counter
-     
-     // Alert with buzzer
-     tone(BUZZER_PIN, 3000, 200);
-     
-     Serial.println("MICROGRAVITY DETECTED!");
+   return mask;
+ }
+  
+
+void handleTraceCommand(const String& command) {
+   if (command == "TRACE RECORD") {
+     if (inputTrace.startRecording(currentMode)) {
+       // Start from a clean mode state with every traced job due immediately
+       lastTouchDebugTime = millis() - 500;
+       lastModeUpdateTime = millis() - 5000;
+       switchMode(currentMode);
+       mqttClient.publish(mqttResponseTopic.c_str(), "Trace recording started");
+     } else {
+       mqttClient.publish(mqttResponseTopic.c_str(), "Trace recording failed");
+     }
    }
-   
-   if (millis() - lastUpdateTime < updateInterval) {
-     return;
+   else if (command == "TRACE REPLAY") {
+     int mode;
+     if (inputTrace.startReplay(mode) && OperationalModes::isValid(mode)) {
+       LOGI("Replaying trace from mode %d", mode);
+       mqttClient.publish(mqttResponseTopic.c_str(), "Trace replay started");
+       nextMode = mode;
+       switchMode(mode);
+     } else {
+       inputTrace.stop();
+       mqttClient.publish(mqttResponseTopic.c_str(), "No valid trace stored");
+     }
    }
-   
-   lastUpdateTime = millis();
-   
-   display.clearDisplay();
-   display.setCursor(0, 0);
-   display.println("Mode 1: Micro-G Detector");
-   display.drawLine(0, 10, 128, 10, SSD1306_WHITE);
-   
-   // Status display
-   display.setCursor(0, 15);
-   display.print("Touch Delta: ");
-   display.println(touchDiff);
-   
-   display.setCursor(0, 30);
-   if (inFreeFall) {
-     display.setTextSize(2);
-     display.println("FALLING!");
-     display.setTextSize(1);
-     
-     fallingCounter--;
-     if (fallingCounter <= 0) {
-       inFreeFall = false;
+   else if (command == "TRACE STOP") {
+     bool wasReplaying = inputTrace.replaying();
+     inputTrace.stop();
+     if (wasReplaying) {
+       finishReplay();
+     } else {
+       mqttClient.publish(mqttResponseTopic.c_str(), traceSummaryJson().c_str());
      }
-   } else {
-     display.println("Status: Normal");
-     display.println("Touch sensors to simulate");
-     display.println("micro-gravity detection");
-     display.println("(Free fall < 1G)");
    }
-   
-   display.display();
+   else if (command == "TRACE DUMP") {
+     bool ok = inputTrace.dump(Serial);
+     mqttClient.publish(mqttResponseTopic.c_str(), ok ? "Trace dumped to serial" : "No trace to dump");
+   }
+   else {
+     mqttClient.publish(mqttResponseTopic.c_str(), "Unknown trace command");
+   }
  }
   
 
-void runPressureMonitoring() {
-   static unsigned long lastUpdateTime = 0;
-   const unsigned long updateInterval = 500; // Update every 500ms
-   static float basePressure = 0;
-   static bool baselineSet = false;
-   static bool alertActive = false;
-   const float alertThreshold = 10.0; // hPa drop to trigger cat safety alert
-   
-   // Set baseline pressure
-   if (!baselineSet && bme.begin(0x76)) {
-     basePressure = bme.readPressure() / 100.0F;
-     baselineSet = true;
-     Serial.print("Baseline pressure set to: ");
-     Serial.println(basePressure);
+void finishReplay() {
+   inputTrace.stop();
+   const TraceSummary& trace = inputTrace.summary();
+   LOGI("Replay finished: %lu frames, %lu differ, %lu divergences",
+        (unsigned long)trace.frames, (unsigned long)trace.frameMismatches, (unsigned long)trace.divergences);
+   String summary = traceSummaryJson();
+   mqttClient.publish(mqttResponseTopic.c_str(), summary.c_str());
+ }
+  
+
+void handleBenchCommand(const String& command) {
+   // "BENCH [frames]" measures every mode; "BENCH GOLDEN" keeps the last run as reference
+   if (command == "BENCH GOLDEN") {
+     bool saved = renderBench.saveGolden(preferences);
+     mqttClient.publish(mqttResponseTopic.c_str(), saved ? "Benchmark CRCs stored as golden" : "Run BENCH first");
+     return;
    }
    
-   if (millis() - lastUpdateTime < updateInterval) {
-     return;
+   uint32_t frames = BENCH_FRAMES_DEFAULT;
+   if (command.length() > 6) {
+     frames = command.substring(6).toInt();
    }
    
-   lastUpdateTime = millis();
+   OperationalModes::exit(currentMode);
+   bool ok = renderBench.run(frames, preferences);
+   OperationalModes::enter(currentMode);
    
-   display.clearDisplay();
-   display.setCursor(0, 0);
-   display.println("Mode 2: Pressure Monitor");
-   display.drawLine(0, 10, 128, 10, SSD1306_WHITE);
-   
-   // Read current pressure
-   float currentPressure = 0;
-   if (bme.begin(0x76)) {
-     currentPressure = bme.readPressure() / 100.0F;
-     
-     // Check specifically for pressure drops (cat safety)
-     float pressureDelta = currentPressure - basePressure;
-     alertActive = (pressureDelta < -alertThreshold); // Alert only on pressure DROP exceeding threshold
-     
-     // Display pressure information
-     display.setCursor(0, 15);
-     display.print("Current: ");
-     display.print(currentPressure, 1);
-     display.println(" hPa");
+   if (!ok) {
+     mqttClient.publish(mqttResponseTopic.c_str(), "Benchmark not run (bad frame count or trace active)");
+     return;
+   }
+   renderBench.print(Serial);
+   memHealth.printCallSites(Serial);
+   mqttClient.publish(mqttResponseTopic.c_str(), renderBench.json().c_str());
+ }
+  
+
+String traceSummaryJson() {
+   const TraceSummary& trace = inputTrace.summary();
+   String json = "{";
+   json += "\"records\":" + String(trace.records) + ",";
+   json += "\"bytes\":" + String(trace.bytes) + ",";
+   json += "\"trace_ms\":" + String(trace.traceMs) + ",";
+   json += "\"wall_ms\":" + String(trace.wallMs) + ",";
+   json += "\"frames\":" + String(trace.frames) + ",";
+   json += "\"frame_mismatches\":" + String(trace.frameMismatches) + ",";
+   json += "\"first_mismatch_ms\":" + String(trace.firstMismatchMs) + ",";
+   json += "\"divergences\":" + String(trace.divergences);
+   json += "}";
+   return json;
+ }
+  
+
+void sendTelemetry() {
+   MemScope memScope(MEM_TELEMETRY);
+   int rssi = WiFi.RSSI();
+   if (mqttClient.connected()) {
+     bool full = linkControl.nextPayload(rssi) == LINK_FULL;
+     uint8_t packet = full ? TM_FULL : TM_HK;
+     TelemetryRecord record = {};
+     fillTelemetry(record, full);
      
-     display.print("Baseline: ");
-     display.print(basePressure, 1);
-     display.println(" hPa");
+     // Sections of variable shape go in as JSON text; the Strings keep it until encoded
+     String ip, mem, boot, mirror, i2c;
+     if (full) {
+       ip = WiFi.localIP().toString();
+       mem = memHealth.json();
+       i2c = i2cJson();
+       record.ipAddress = ip.c_str();
+       record.mem = mem.c_str();
+       record.i2c = i2c.c_str();
+       if (!bootReported) {
+         boot = bootJson();
+         record.boot = boot.c_str();
+       }
+       if (params.getInt(PARAM_MIRROR_PERIOD) > 0) {
+         mirror = mirrorJson();
+         record.mirror = mirror.c_str();
+       }
+     }
      
-     display.print("Delta: ");
-     display.print(pressureDelta, 2);
-     display.println(" hPa");
+     // Encoded straight into one buffer instead of growing a String field by field
+     // and limited to what PubSubClient will send on the topic (JSON adds its NUL)
+     static char buffer[TELEMETRY_JSON_MAX];
+     bool packed = params.getInt(PARAM_TELEMETRY_FORMAT) == 1;
+     const String& topic = packed ? mqttTelemetryBinTopic : mqttTelemetryTopic;
+     size_t limit = min(sizeof(buffer), mqttPayloadLimit(topic) + (packed ? 0 : 1));
+     size_t length = packed ? telemetryPack(record, packet, (uint8_t*)buffer, limit)
+                            : telemetryJson(record, packet, buffer, limit);
+     if (length == 0 && full) {
+       // Channel statistics come first; the sections of variable size wait for a
+       // later packet (the boot timeline stays pending until one carries it)
+       LOGW("Telemetry over %u bytes, sending it without boot, mem, i2c and mirror", (unsigned)limit);
+       record.boot = record.mem = record.i2c = record.mirror = nullptr;
+       length = packed ? telemetryPack(record, packet, (uint8_t*)buffer, limit)
+                       : telemetryJson(record, packet, buffer, limit);
+     }
+     if (length == 0) {
+       LOGE("Telemetry packet does not fit the MQTT buffer");
+       return;
+     }
+     int64_t publishStart = TimeSync::monotonicMicros();
+     bool success = packed ? mqttClient.publish(topic.c_str(), (const uint8_t*)buffer, length)
+                           : mqttClient.publish(topic.c_str(), buffer);
+     linkControl.record(success, (uint32_t)(TimeSync::monotonicMicros() - publishStart), rssi);
      
-     // Alert display
-     if (alertActive) {
-       display.setCursor(0, 45);
-       display.setTextSize(1);
-       display.println("! CAT SAFETY ALERT !");
-       display.println("PRESSURE DROP DETECTED!");
-       
-       // Visual alert - Rapid LED blinking for visibility
-       digitalWrite(LED_PIN, (millis() / 200) % 2); // Faster blink rate
-       
-       // Audible alert - Alternating alarm tones
-       unsigned long alarmPattern = (millis() / 300) % 4;
-       switch(alarmPattern) {
-         case 0: tone(BUZZER_PIN, 2500, 150); break;
-         case 1: tone(BUZZER_PIN, 2000, 150); break;
-         case 2: tone(BUZZER_PIN, 2500, 150); break;
-         case 3: tone(BUZZER_PIN, 1800, 150); break;
-       }
+     if (success) {
+       if (record.boot) bootReported = true;
+       // Echoing the whole packet cost ~50 ms of UART time per second; log the size only
+       LOGD("Telemetry sent (%u bytes)", (unsigned)length);
      } else {
-       digitalWrite(LED_PIN, LOW);
-       display.setCursor(0, 45);
-       display.println("Pressure stable");
+       LOGW("Failed to send telemetry, error code: %d", mqttClient.state());
      }
    } else {
-     display.setCursor(0, 20);
-     display.println("BME280 sensor not found");
-     display.println("Please check connections");
+     linkControl.record(false, 0, rssi);
+     LOGW("Cannot send telemetry: MQTT not connected");
    }
-   
-   display.display();
  }
   
 
-void runAttitudeIndicator() {
-   static unsigned long lastUpdateTime = 0;
-   const unsigned long updateInterval = 50; // Update frequently for smooth animation
-   static float roll = 0.0;
-   static float pitch = 0.0;
-   
-   // Using touch to control roll
-   int touch1 = touchRead(TOUCH_RIGHT);
-   int touch2 = touchRead(TOUCH_LEFT);
-   
-   // Map touch values to roll changes
-   if (touch1 < 40) {
-     roll += 1.0;
-     if (roll > 180) roll -= 360;
-   }
-   
-   if (touch2 < 40) {
-     roll -= 1.0;
-     if (roll < -180) roll += 360;
-   }
-   
-   if (millis() - lastUpdateTime < updateInterval) {
-     return;
+void fillTelemetry(TelemetryRecord& record, bool full) {
+   // Fields and order are declared in telemetry_schema.h; a housekeeping packet
+   // (LinkController) only takes the windows of the channels it reports
+   record.deviceId = deviceID.c_str();
+   record.boardId = mqttBoardId.c_str();
+   record.hk = !full;
+   record.uptime = millis() / 1000;
+   record.tsUs = timeSync.unixMicros();                // Sample time, 0 until SNTP sync
+   record.monoUs = TimeSync::monotonicMicros();
+   record.freeHeap = ESP.getFreeHeap();
+   record.mode = currentMode;
+   record.periodMs = linkControl.periodMs();
+   record.linkFailures = linkControl.failures();
+   record.batteryVoltage = channelStats[STATS_BATTERY].take();
+   record.lowBattery = lowBatteryAlert;
+   record.alerts = alertMask();
+   record.wifiStrength = WiFi.RSSI();
+   if (!full) return;
+   
+   record.defaultMode = defaultMode;
+   record.paramWrites = params.flashWrites();
+   record.logDropped = logger.dropped();
+   record.usbVoltage = channelStats[STATS_USB].take();
+   
+   // Display pipeline and frame pacing of the current mode (counters since it was entered)
+   record.displayFrames = display.framesSent();
+   record.displayDropped = display.framesDropped();
+   record.displayTransferUs = display.lastTransferMicros();
+   record.pacingTargetMs = framePacer.intervalMs();
+   record.pacingFrames = framePacer.frames();
+   record.pacingLate = framePacer.late();
+   record.pacingDropped = framePacer.dropped();
+   record.pacingStepMs = framePacer.stepMs();
+   record.pacingSteps = framePacer.steps();
+   record.pacingSimDroppedMs = framePacer.simDroppedMs();
+   
+   // Peripherals powered for the current mode and its CPU share so far
+   ModePower power = powerGate.stats(currentMode, millis());
+   record.powerOn = powerGate.state();
+   record.powerBusyPct = power.residentMs ? (float)(power.busyUs / (power.residentMs * 10.0)) : 0.0f;
+   
+   record.touchRight = channelStats[STATS_TOUCH_RIGHT].take();
+   record.touchLeft = channelStats[STATS_TOUCH_LEFT].take();
+   record.touchUp = channelStats[STATS_TOUCH_UP].take();
+   record.touchDown = channelStats[STATS_TOUCH_DOWN].take();
+   record.touchX = channelStats[STATS_TOUCH_X].take();
+   
+   // Simulated acceleration (around 1 g on x) and angular rate
+   record.accelX = random(98, 102) / 10.0f;
+   record.accelY = random(-5, 5) / 10.0f;
+   record.accelZ = random(-5, 5) / 10.0f;
+   record.gyroX = random(-20, 20) / 10.0f;
+   record.gyroY = random(-20, 20) / 10.0f;
+   record.gyroZ = random(-20, 20) / 10.0f;
+   
+   // Environmental data (null without a BME280); altitude and vertical speed from the filter, at the qnh_hpa setting
+   record.temperature = channelStats[STATS_TEMPERATURE].take();
+   record.pressure = channelStats[STATS_PRESSURE].take();
+   record.humidity = channelStats[STATS_HUMIDITY].take();
+   bool altitude = record.pressure.count > 0 && baroAltitude.valid();
+   record.altitude = altitude ? baroAltitude.altitude() : NAN;
+   record.verticalSpeed = altitude ? baroAltitude.verticalSpeed() : NAN;
+   record.qnh = baroAltitude.qnh();
+ }
+  
+
+String bootJson() {
+   // Boot timeline, only until the first full packet got through
+   String json = "{";
+   json += "\"fast\":" + String(bootTimeline.fastBoot() ? "true" : "false") + ",";
+   json += "\"reset\":\"" + String(bootTimeline.resetReason()) + "\",";
+   json += "\"phases_us\":{";
+   for (int i = 0; i < bootTimeline.count(); i++) {
+     const BootPhase& phase = bootTimeline.phase(i);
+     if (i > 0) json += ",";
+     json += "\"" + String(phase.name) + "\":" + String(phase.micros);
    }
-   
-   lastUpdateTime = millis();
-   
-   display.clearDisplay();
-   
-   // Draw attitude indicator
-   int centerX = SCREEN_WIDTH / 2;
-   int centerY = SCREEN_HEIGHT / 2;
-   int radius = 24;
-   
-   // Draw artificial horizon
-   // Calculate line position based on roll and pitch
-   float sinRoll = sin(roll * PI / 180.0);
-   float cosRoll = cos(roll * PI / 180.0);
-   
-   // Draw horizon line
-   display.drawLine(
-     centerX - radius * cosRoll,
-     centerY + radius * sinRoll + pitch,
-     centerX + radius * cosRoll,
-     centerY - radius * sinRoll + pitch,
-     SSD1306_WHITE
-   );
-   
-   // Draw aircraft symbol
-   display.drawLine(centerX - 10, centerY, centerX + 10, centerY, SSD1306_WHITE);
-   display.drawLine(centerX, centerY - 5, centerX, centerY + 5, SSD1306_WHITE);
-   
-   // Draw outer circle
-   display.drawCircle(centerX, centerY, radius, SSD1306_WHITE);
-   
-   // Draw roll indicator
-   display.drawLine(
-     centerX,
-     centerY - radius,
-     centerX + int(8 * sinRoll),
-     centerY - radius + int(8 * cosRoll),
-     SSD1306_WHITE
-   );
-   
-   // Display roll and pitch values
-   display.setTextSize(1);
-   display.setCursor(0, 0);
-   display.print("Roll: ");
-   display.print(int(roll));
-   display.println("°");
-   
-   display.setCursor(64, 0);
-   display.print("Pitch: ");
-   display.print(int(pitch));
-   display.println("°");
-   
-   display.setCursor(0, 55);
-   display.println("Touch to adjust roll");
-   
-   display.display();
+   json += "}}";
+   return json;
  }
   
 
-void runRollingPlotter() {
-   static unsigned long lastUpdateTime = 0;
-   const unsigned long updateInterval = 100; // Update every 100ms
-   static int dataPoints[SCREEN_WIDTH];
-   static int dataIndex = 0;
-   static int maxVal = 0;
-   
-   if (millis() - lastUpdateTime < updateInterval) {
-     return;
+String mirrorJson() {
+   // Mirror bandwidth: bytes per sent frame, unchanged frames cost none
+   String json = "{";
+   json += "\"frames\":" + String(displayMirror.frames()) + ",";
+   json += "\"unchanged\":" + String(displayMirror.unchanged()) + ",";
+   json += "\"bytes\":" + String(displayMirror.bytes()) + ",";
+   json += "\"last_bytes\":" + String(displayMirror.lastBytes());
+   json += "}";
+   return json;
+ }
+  
+
+String i2cJson() {
+   // I2C bus usage per device
+   String json = "{";
+   for (int i = 0; i < i2cBus.deviceCount(); i++) {
+     const I2cDeviceStats& bus = i2cBus.stats(i);
+     if (i > 0) json += ",";
+     json += "\"" + String(bus.name) + "\":{";
+     json += "\"bytes\":" + String(bus.bytes) + ",";
+     json += "\"busy_us\":" + String(bus.busyMicros) + ",";
+     json += "\"max_wait_us\":" + String(bus.maxWaitMicros);
+     json += "}";
    }
+   json += "}";
+   return json;
+ }
+  
+
+size_t mqttPayloadLimit(const String& topic) {
+   // The packet buffer also holds the fixed header (up to MQTT_MAX_HEADER_SIZE
+   // bytes) and the topic with its 2-byte length; publish() refuses anything longer
+   size_t overhead = MQTT_MAX_HEADER_SIZE + 2 + topic.length();
+   size_t buffer = mqttClient.getBufferSize();
+   return buffer > overhead ? buffer - overhead : 0;
+ }
+  
+
+void reconnectMQTT() {
+   if (WiFi.status() != WL_CONNECTED) return;
    
-   lastUpdateTime = millis();
+   display.clearDisplay();
+   display.setCursor(0, 0);
+   display.println("Connecting to MQTT...");
+   display.display();
    
-   // Read sensor data
-   float temperature = 0;
-   float pressure = 0;
-   float humidity = 0;
+   LOGI("Attempting MQTT connection to %s", MQTT_SERVER);
    
-   if (bme.begin(0x76)) {
-     temperature = bme.readTemperature();
-     pressure = bme.readPressure() / 100.0F;
-     humidity = bme.readHumidity();
+   // Try to connect with a maximum of 3 attempts
+   int attempts = 0;
+   while (!mqttClient.connected() && attempts < 3) {
+     if (connectMQTT()) {
+       display.println("Connected!");
+       display.display();
+     } else {
+       int errorCode = mqttClient.state();
+       const char* reason;
+       
+       // Print more detailed error information
+       switch(errorCode) {
+         case -1: reason = "Connection timeout"; break;
+         case -2: reason = "Connection lost"; break;
+         case -3: reason = "Connection failed"; break;
+         case -4: reason = "Server disconnected"; break;
+         case -5: reason = "Bad protocol"; break;
+         case -6: reason = "Bad client ID"; break;
+         case -7: reason = "Connection unavailable"; break;
+         case -8: reason = "Bad credentials"; break;
+         case -9: reason = "Unauthorized"; break;
+         default: reason = "Unknown error"; break;
+       }
+       
+       LOGW("MQTT attempt #%d failed, rc=%d (%s) trying again in 2 seconds", attempts + 1, errorCode, reason);
+       delay(2000);
+       attempts++;
+     }
    }
    
-   // Select value to plot based on touch
-   int plotValue;
-   int touch1 = touchRead(TOUCH_RIGHT);
-   int touch2 = touchRead(TOUCH_LEFT);
-   
-   if (touch1 < 40) {
-     // Plot temperature
-     plotValue = int(temperature * 5); // Scale for better visualization
-   } else if (touch2 < 40) {
-     // Plot humidity
-     plotValue = int(humidity);
-   } else {
-     // Plot pressure variation
-     plotValue = int((pressure - 1000) * 5); // Normalize around 1000 hPa
+   if (!mqttClient.connected()) {
+     display.println("Failed to connect!");
+     display.println("Check MQTT settings");
+     display.display();
+     delay(2000);
    }
-   
-   // Ensure plotValue is in displayable range
-   plotValue = constrain(plotValue, 0, 50);
-   
-   // Store the new data point
-   dataPoints[dataIndex] = plotValue;
-   dataIndex = (dataIndex + 1) % SCREEN_WIDTH;
-   
-   // Find max value for scaling
-   maxVal = 0;
-   for (int i = 0; i < SCREEN_WIDTH; i++) {
-     if (dataPoints[i] > maxVal) maxVal = dataPoints[i];
+ }
+  
+
+bool connectMQTT() {
+   // Connect with client ID and username/password from arduino_secrets.h
+   String clientId = String(MQTT_CLIENT_ID) + "_" + mqttBoardId;
+   if (!mqttClient.connect(clientId.c_str(), MQTT_USER, MQTT_PASSWORD)) {
+     return false;
    }
-   maxVal = max(maxVal, 10); // Ensure non-zero scaling
+   LOGI("MQTT connected");
    
-   display.clearDisplay();
-   
-   // Draw title
-   display.setTextSize(1);
-   display.setCursor(0, 0);
-   display.println("Mode 4: Rolling Plotter");
-   
-   // Display values
-   display.setCursor(0, 10);
-   display.print("T:");
-   display.print(temperature, 1);
-   display.print("C ");
-   
-   display.print("H:");
-   display.print(humidity, 0);
-   display.print("% ");
-   
-   display.print("P:");
-   display.print(pressure, 0);
-   display.println("hPa");
-   
-   // Draw axes
-   display.drawLine(0, 63, 127, 63, SSD1306_WHITE); // X-axis
-   display.drawLine(0, 25, 0, 63, SSD1306_WHITE);   // Y-axis
-   
-   // Draw graph
-   for (int i = 0; i < SCREEN_WIDTH - 1; i++) {
-     int x1 = i;
-     int y1 = 63 - map(dataPoints[(dataIndex + i) % SCREEN_WIDTH], 0, maxVal, 0, 35);
-     int x2 = i + 1;
-     int y2 = 63 - map(dataPoints[(dataIndex + i + 1) % SCREEN_WIDTH], 0, maxVal, 0, 35);
-     
-     display.drawLine(x1, y1, x2, y2, SSD1306_WHITE);
-   }
+   // Subscribe to command topic
+   mqttClient.subscribe(mqttCommandTopic.c_str());
+   LOGI("Subscribed to: %s", mqttCommandTopic.c_str());
    
-   display.display();
+   // Send online status
+   mqttClient.publish(mqttResponseTopic.c_str(), "{\"status\":\"online\"}");
+   return true;
  }
   
 
-void runCreativeMode() {
-   static unsigned long lastUpdateTime = 0;
-   const unsigned long updateInterval = 50; // Update frequently for smooth animation
-   static float orbitAngle = 0.0;
-   static float satelliteAngle = 0.0;
-   static float orbitSpeed = 0.5;
-   static int earthRadius = 15;
-   static int orbitRadius = 25;
-   
-   // Control orbit speed with touch
-   int touch1 = touchRead(TOUCH_RIGHT);
-   int touch2 = touchRead(TOUCH_LEFT);
-   
-   if (touch1 < 40) {
-     orbitSpeed += 0.1;
-     if (orbitSpeed > 5.0) orbitSpeed = 5.0;
-   }
-   
-   if (touch2 < 40) {
-     orbitSpeed -= 0.1;
-     if (orbitSpeed < 0.1) orbitSpeed = 0.1;
+void displayModeInfo() {
+   // Drawn over the new mode's frames by drawModeBanner() until modeBannerDuration
+   // has passed, so the mode starts sampling and drawing at once
+   modeBannerTime = millis();
+   modeBannerShown = true;
+ }
+  
+
+void runCurrentMode() {
+   {
+     MemScope memScope(MEM_MODES);
+     uint32_t start = micros();
+     OperationalModes::tick(currentMode);
+     powerGate.busy(micros() - start);
    }
    
-   if (millis() - lastUpdateTime < updateInterval) {
-     return;
+   if (!firstSampleDone) {
+     firstSampleDone = true;
+     bootTimeline.mark("first_sample");
+     uint32_t firstSample = bootTimeline.at("first_sample");
+     LOGI("First sample %u ms after app start (goal %u ms)",
+          (unsigned)(firstSample / 1000), (unsigned)(BOOT_FIRST_SAMPLE_GOAL / 1000));
    }
-   
-   lastUpdateTime = millis();
-   
-   // Update angles
-   orbitAngle += orbitSpeed;
-   if (orbitAngle > 360) orbitAngle -= 360;
-   
-   satelliteAngle += orbitSpeed * 3; // Satellite rotation
-   if (satelliteAngle > 360) satelliteAngle -= 360;
-   
-   display.clearDisplay();
-   
-   // Draw title
-   display.setTextSize(1);
-   display.setCursor(0, 0);
-   display.println("Mode 5: Orbit Simulator");
-   
-   // Display orbit info
-   display.setCursor(0, 56);
-   display.print("Speed: ");
-   display.print(orbitSpeed, 1);
-   display.print(" (Touch to adjust)");
-   
-   // Draw Earth
-   int centerX = SCREEN_WIDTH / 2;
-   int centerY = 32;
-   display.fillCircle(centerX, centerY, earthRadius, SSD1306_WHITE);
-   display.fillCircle(centerX + 2, centerY - 2, earthRadius - 4, SSD1306_BLACK);
-   
-   // Draw orbit path
-   display.drawCircle(centerX, centerY, orbitRadius, SSD1306_WHITE);
-   
-   // Calculate satellite position
-   int satX = centerX + int(orbitRadius * cos(orbitAngle * PI / 180.0));
-   int satY = centerY + int(orbitRadius * sin(orbitAngle * PI / 180.0));
-   
-   // Draw satellite
-   display.fillRect(satX - 2, satY - 2, 4, 4, SSD1306_WHITE);
-   
-   // Draw satellite solar panels
-   float sinRot = sin(satelliteAngle * PI / 180.0);
-   float cosRot = cos(satelliteAngle * PI / 180.0);
-   
-   display.drawLine(
-     satX, satY,
-     satX + int(8 * cosRot),
-     satY + int(8 * sinRot),
-     SSD1306_WHITE
-   );
-   
-   display.drawLine(
-     satX, satY,
-     satX - int(8 * cosRot),
-     satY - int(8 * sinRot),
-     SSD1306_WHITE
-   );
-   
-   display.display();
  }
\ No newline at end of file
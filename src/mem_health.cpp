@@ -0,0 +1,156 @@
+#include "mem_health.h"
+
+#include <esp_debug_helpers.h>
+
+MemHealth memHealth;
+
+static const char* const subsystemNames[MEM_SUBSYSTEMS] = { "other", "telemetry", "commands", "mqtt", "modes" };
+
+bool MemHealth::tracking() {
+#ifdef MEM_TRACK_ALLOCATIONS
+   return true;
+#else
+   return false;
+#endif
+}
+
+String MemHealth::json() const {
+   uint32_t freeHeap = ESP.getFreeHeap();
+   uint32_t largest = ESP.getMaxAllocHeap();
+   String json = "{";
+   json += "\"free\":" + String(freeHeap) + ",";
+   json += "\"min_free\":" + String(ESP.getMinFreeHeap()) + ",";
+   json += "\"largest\":" + String(largest) + ",";
+   json += "\"frag_pct\":" + String(freeHeap ? 100 - (uint32_t)((uint64_t)largest * 100 / freeHeap) : 0) + ",";
+
+   // uxTaskGetStackHighWaterMark() counts bytes on the ESP32
+   json += "\"stack_free\":{";
+   static const char* const tasks[] = MEM_WATCHED_TASKS;
+   bool first = true;
+   for (const char* name : tasks) {
+     TaskHandle_t task = xTaskGetHandle(name);
+     if (!task) continue; // Not running (bootInit after a fast boot)
+     if (!first) json += ",";
+     json += "\"" + String(name) + "\":" + String(uxTaskGetStackHighWaterMark(task));
+     first = false;
+   }
+   json += "}";
+
+   if (tracking()) {
+     json += ",\"allocs\":{";
+     for (int i = 0; i < MEM_SUBSYSTEMS; i++) {
+       if (i > 0) json += ",";
+       json += "\"" + String(subsystemNames[i]) + "\":" + String(allocCount[i]);
+     }
+     json += "},\"alloc_bytes\":{";
+     for (int i = 0; i < MEM_SUBSYSTEMS; i++) {
+       if (i > 0) json += ",";
+       json += "\"" + String(subsystemNames[i]) + "\":" + String(allocBytes[i]);
+     }
+     json += "},\"frees\":" + String(freeCount);
+   }
+   json += "}";
+   return json;
+}
+
+void MemHealth::recordAllocation(size_t size) {
+   void* task = xTaskGetCurrentTaskHandle();
+   uint8_t tag = (task == scopeTask) ? (int)scopeTag : (int)MEM_OTHER;
+   __atomic_add_fetch(&allocCount[tag], 1, __ATOMIC_RELAXED);
+   __atomic_add_fetch(&allocBytes[tag], size, __ATOMIC_RELAXED);
+   if (capturing && task == captureTask) {
+     captureSite(size);
+   }
+}
+
+void MemHealth::startCapture() {
+   siteCount = 0;
+   siteOverflow = 0;
+   captureTask = xTaskGetCurrentTaskHandle();
+   capturing = true;
+}
+
+// Must not allocate: runs inside malloc
+void __attribute__((noinline)) MemHealth::captureSite(size_t size) {
+   uint32_t pcs[MEM_CALLSITE_DEPTH] = {};
+   esp_backtrace_frame_t frame;
+   esp_backtrace_get_start(&frame.pc, &frame.sp, &frame.next_pc);
+   for (int depth = 0; depth < MEM_CALLSITE_DEPTH && esp_backtrace_get_next_frame(&frame); depth++) {
+     // Strip the window bits and point at the call instruction
+     pcs[depth] = ((frame.pc & 0x3FFFFFFF) | 0x40000000) - 3;
+   }
+
+   for (uint8_t i = 0; i < siteCount; i++) {
+     if (memcmp(sites[i].pc, pcs, sizeof(pcs)) == 0) {
+       sites[i].count++;
+       sites[i].bytes += size;
+       return;
+     }
+   }
+   if (siteCount == MEM_CALLSITES) {
+     siteOverflow++;
+     return;
+   }
+   MemCallSite& site = sites[siteCount++];
+   memcpy(site.pc, pcs, sizeof(pcs));
+   site.count = 1;
+   site.bytes = size;
+}
+
+void MemHealth::printCallSites(Print& out) const {
+   if (!tracking()) {
+     out.println("Allocation tracking not built in (use the esp32s3_memtrack environment)");
+     return;
+   }
+   out.printf("Allocation call sites (%u, %lu more not kept):\n", siteCount, (unsigned long)siteOverflow);
+   for (uint8_t i = 0; i < siteCount; i++) {
+     const MemCallSite& site = sites[i];
+     out.printf("%6lu x %7lu B ", (unsigned long)site.count, (unsigned long)site.bytes);
+     for (int depth = 0; depth < MEM_CALLSITE_DEPTH && site.pc[depth]; depth++) {
+       out.printf(" 0x%08lx", (unsigned long)site.pc[depth]);
+     }
+     out.println();
+   }
+}
+
+MemScope::MemScope(MemSubsystem subsystem)
+   : previousTask(memHealth.scopeTask),
+     previousTag(memHealth.scopeTag) {
+   memHealth.scopeTag = subsystem;
+   memHealth.scopeTask = xTaskGetCurrentTaskHandle();
+}
+
+MemScope::~MemScope() {
+   memHealth.scopeTask = previousTask;
+   memHealth.scopeTag = previousTag;
+}
+
+#ifdef MEM_TRACK_ALLOCATIONS
+// Linked in place of the C library entry points by -Wl,--wrap=<name>
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+void __real_free(void* pointer);
+
+void* __wrap_malloc(size_t size) {
+   memHealth.recordAllocation(size);
+   return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+   memHealth.recordAllocation(count * size);
+   return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size) {
+   memHealth.recordAllocation(size);
+   return __real_realloc(pointer, size);
+}
+
+void __wrap_free(void* pointer) {
+   if (pointer) memHealth.recordFree();
+   __real_free(pointer);
+}
+}
+#endif
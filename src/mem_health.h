@@ -0,0 +1,90 @@
+#ifndef MEM_HEALTH_H
+#define MEM_HEALTH_H
+
+#include <Arduino.h>
+
+// Memory health
+//
+// Heap: free, minimum ever free, largest free block and fragmentation (the
+// share of free memory that the largest single allocation cannot use).
+// Stacks: high-water marks, i.e. bytes never touched, of the tasks in
+// MEM_WATCHED_TASKS.
+//
+// Allocations: built with MEM_TRACK_ALLOCATIONS and the linker wrapping
+// malloc, calloc, realloc and free (see platformio.ini), every heap call is
+// counted against the subsystem whose MemScope is open on the calling task.
+// Scopes are meant for the loop task; calls from any other task count as
+// "other". While a capture is running (render benchmark) allocations from the
+// capturing task are also grouped by call site as short backtraces, to be
+// resolved with xtensa-esp32s3-elf-addr2line -e .pio/build/<env>/firmware.elf.
+
+#define MEM_WATCHED_TASKS   { "loopTask", "display", "log", "bootInit", "tiT", "wifi" }
+#define MEM_CALLSITES       24     // Distinct call sites kept while capturing
+#define MEM_CALLSITE_DEPTH  5      // Return addresses per call site, innermost first
+
+enum MemSubsystem {
+   MEM_OTHER,
+   MEM_TELEMETRY,   // Telemetry packets and publishing them
+   MEM_COMMANDS,    // handleMQTTCallback()
+   MEM_MQTT,        // Client loop and reconnects
+   MEM_MODES,       // Mode ticks
+   MEM_SUBSYSTEMS
+};
+
+struct MemCallSite {
+   uint32_t pc[MEM_CALLSITE_DEPTH];
+   uint32_t count;
+   uint32_t bytes;
+};
+
+class MemHealth {
+public:
+   // Heap, stack and allocation figures as a JSON object
+   String json() const;
+
+   // False when the allocation wrappers are not linked in
+   static bool tracking();
+
+   uint32_t allocations(MemSubsystem subsystem) const { return allocCount[subsystem]; }
+
+   // Group allocations of the calling task by call site until stopCapture()
+   void startCapture();
+   void stopCapture() { capturing = false; }
+   void printCallSites(Print& out) const;
+
+   // Heap wrappers
+   void recordAllocation(size_t size);
+   void recordFree() { __atomic_add_fetch(&freeCount, 1, __ATOMIC_RELAXED); }
+
+private:
+   friend class MemScope;
+
+   void captureSite(size_t size);
+
+   // Zero-initialized so the wrappers work before static constructors run
+   volatile uint32_t allocCount[MEM_SUBSYSTEMS];
+   volatile uint32_t allocBytes[MEM_SUBSYSTEMS];
+   volatile uint32_t freeCount;
+   void* volatile scopeTask;
+   volatile uint8_t scopeTag;
+   volatile bool capturing;
+   void* captureTask;
+   MemCallSite sites[MEM_CALLSITES];
+   uint8_t siteCount;
+   uint32_t siteOverflow;
+};
+
+extern MemHealth memHealth;
+
+// Attribute the calling task's heap calls to a subsystem until end of scope
+class MemScope {
+public:
+   explicit MemScope(MemSubsystem subsystem);
+   ~MemScope();
+
+private:
+   void* previousTask;
+   uint8_t previousTag;
+};
+
+#endif
@@ -1,22 +1,9 @@
-#include <Arduino.h>
-#include <Adafruit_GFX.h>
-#include <Adafruit_SSD1306.h>
-#include <WiFi.h>
-#include <PubSubClient.h>
+#include "modes.h"
 
 // Mode 0: Basic Monitoring Window
 // Displays system status information
 
-void runBasicMonitoring() {
-   static unsigned long lastUpdateTime = 0;
-   const unsigned long updateInterval = 1000; // Update every second
-   
-   if (millis() - lastUpdateTime < updateInterval) {
-     return;
-   }
-   
-   lastUpdateTime = millis();
-   
+void BasicMonitoringMode::tick(State&) {
    display.clearDisplay();
    display.setCursor(0, 0);
    display.println("Mode 0: Basic Status");
@@ -35,9 +22,9 @@ void runBasicMonitoring() {
    
    // WiFi status
    display.print("WiFi: ");
-   if (WiFi.status() == WL_CONNECTED) {
+   if (inputTrace.status(TRACE_STATUS_WIFI, WiFi.status() == WL_CONNECTED)) {
      display.print("Connected (");
-     display.print(WiFi.RSSI());
+     display.print(inputTrace.status(TRACE_STATUS_RSSI, WiFi.RSSI()));
      display.println("dBm)");
    } else {
      display.println("Disconnected");
@@ -45,11 +32,11 @@ void runBasicMonitoring() {
    
    // MQTT status
    display.print("MQTT: ");
-   display.println(mqttClient.connected() ? "Connected" : "Disconnected");
+   display.println(inputTrace.status(TRACE_STATUS_MQTT, mqttClient.connected()) ? "Connected" : "Disconnected");
    
    // Runtime
    display.print("Uptime: ");
-   unsigned long uptime = millis() / 1000;
+   unsigned long uptime = inputTrace.now() / 1000;
    display.print(uptime / 60);
    display.print("m ");
    display.print(uptime % 60);
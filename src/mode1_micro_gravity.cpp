@@ -1,48 +1,34 @@
-#include <Arduino.h>
-#include <Adafruit_GFX.h>
-#include <Adafruit_SSD1306.h>
+#include "modes.h"
+#include "params.h"
+#include "log.h"
 
 // Mode 1: Micro-Gravity Detection Window
-// Detects microgravity conditions using touch sensor differences
+// Detects microgravity conditions using touch sensor differences. The alert
+// (buzzer, burst capture, ground) is the free_fall rule in alert_rules.cpp,
+// which watches the same difference in every mode.
 
-void runMicroGravityDetection() {
-   static unsigned long lastUpdateTime = 0;
-   const unsigned long updateInterval = 200; // Update every 200ms
-   static int fallingCounter = 0;
-   static bool inFreeFall = false;
-   
+void MicroGravityMode::tick(State& state) {
    // Using touch reading changes to simulate acceleration
    // In a real implementation, this would use MPU6050 data
-   int touch1 = touchRead(TOUCH_RIGHT);
-   int touch2 = touchRead(TOUCH_LEFT);
+   int touch1 = inputTrace.touch(TOUCH_RIGHT);
+   int touch2 = inputTrace.touch(TOUCH_LEFT);
    int touchDiff = abs(touch1 - touch2);
    
    // Simulate free-fall detection using touch sensor changes
    // FIXED: Changed threshold from 100 to 15000 to prevent false detections
-   bool freeFallDetected = (touchDiff > 15000);
+   bool freeFallDetected = (touchDiff > params.getInt(PARAM_MICROG_THRESHOLD));
    
    // Debug output when close to threshold
    if (touchDiff > 2500) {
-     Serial.print("Touch diff: ");
-     Serial.println(touchDiff);
-   }
-   
-   if (freeFallDetected && !inFreeFall) {
-     inFreeFall = true;
-     fallingCounter = 10; // Fall duration counter
-     
-     // Alert with buzzer
-     tone(BUZZER_PIN, 3000, 200);
-     
-     Serial.println("MICROGRAVITY DETECTED!");
+     LOGD("Touch diff: %d", touchDiff);
    }
    
-   if (millis() - lastUpdateTime < updateInterval) {
-     return;
+   if (freeFallDetected && !state.inFreeFall) {
+     state.inFreeFall = true;
+     state.fallingCounter = 10; // Fall duration counter
+     LOGI("MICROGRAVITY DETECTED!");
    }
    
-   lastUpdateTime = millis();
-   
    display.clearDisplay();
    display.setCursor(0, 0);
    display.println("Mode 1: Micro-G Detector");
@@ -54,14 +40,14 @@ void runMicroGravityDetection() {
    display.println(touchDiff);
    
    display.setCursor(0, 30);
-   if (inFreeFall) {
+   if (state.inFreeFall) {
      display.setTextSize(2);
      display.println("FALLING!");
      display.setTextSize(1);
      
-     fallingCounter--;
-     if (fallingCounter <= 0) {
-       inFreeFall = false;
+     state.fallingCounter--;
+     if (state.fallingCounter <= 0) {
+       state.inFreeFall = false;
      }
    } else {
      display.println("Status: Normal");
@@ -1,36 +1,30 @@
-#include <Arduino.h>
-#include <Adafruit_GFX.h>
-#include <Adafruit_SSD1306.h>
+#include "modes.h"
 
 // Mode 3: Attitude Indicator Window
 // Provides a visual artificial horizon display for landing maneuvers
 
-void runAttitudeIndicator() {
-   static unsigned long lastUpdateTime = 0;
-   const unsigned long updateInterval = 50; // Update frequently for smooth animation
-   static float roll = 0.0;
-   static float pitch = 0.0;
-   
-   // Using touch to control roll
-   int touch1 = touchRead(TOUCH_RIGHT);
-   int touch2 = touchRead(TOUCH_LEFT);
-   
-   // Map touch values to roll changes
-   if (touch1 < 40) {
-     roll += 1.0;
-     if (roll > 180) roll -= 360;
-   }
-   
-   if (touch2 < 40) {
-     roll -= 1.0;
-     if (roll < -180) roll += 360;
-   }
-   
-   if (millis() - lastUpdateTime < updateInterval) {
-     return;
-   }
+const float rollRate = 20.0;    // Degrees per second while a pad is held
+
+static float wrapDegrees(float angle) {
+   if (angle > 180) angle -= 360;
+   if (angle < -180) angle += 360;
+   return angle;
+}
+
+void AttitudeIndicatorMode::step(State& state) {
+   state.previousRoll = state.roll;
+   state.roll = wrapDegrees(state.roll + state.rollInput * rollRate * stepInterval / 1000.0);
+}
+
+void AttitudeIndicatorMode::tick(State& state) {
+   // Using touch to control roll; step() turns it at a fixed rate
+   int touch1 = inputTrace.touch(TOUCH_RIGHT);
+   int touch2 = inputTrace.touch(TOUCH_LEFT);
+   state.rollInput = (touch1 < 40 ? 1 : 0) - (touch2 < 40 ? 1 : 0);
    
-   lastUpdateTime = millis();
+   // Between the last two steps, the short way round at +-180
+   float roll = wrapDegrees(state.previousRoll +
+                            wrapDegrees(state.roll - state.previousRoll) * framePacer.alpha());
    
    display.clearDisplay();
    
@@ -47,9 +41,9 @@ void runAttitudeIndicator() {
    // Draw horizon line
    display.drawLine(
      centerX - radius * cosRoll,
-     centerY + radius * sinRoll + pitch,
+     centerY + radius * sinRoll + state.pitch,
      centerX + radius * cosRoll,
-     centerY - radius * sinRoll + pitch,
+     centerY - radius * sinRoll + state.pitch,
      SSD1306_WHITE
    );
    
@@ -78,7 +72,7 @@ void runAttitudeIndicator() {
    
    display.setCursor(64, 0);
    display.print("Pitch: ");
-   display.print(int(pitch));
+   display.print(int(state.pitch));
    display.println("°");
    
    display.setCursor(0, 55);
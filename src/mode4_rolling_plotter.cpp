@@ -1,40 +1,26 @@
-#include <Arduino.h>
-#include <Adafruit_GFX.h>
-#include <Adafruit_SSD1306.h>
-#include <Adafruit_Sensor.h>
-#include <Adafruit_BME280.h>
+#include "modes.h"
 
 // Mode 4: Rolling Plotter Window
 // Displays real-time graph of sensor values
 
-void runRollingPlotter() {
-   static unsigned long lastUpdateTime = 0;
-   const unsigned long updateInterval = 100; // Update every 100ms
-   static int dataPoints[SCREEN_WIDTH];
-   static int dataIndex = 0;
-   static int maxVal = 0;
-   
-   if (millis() - lastUpdateTime < updateInterval) {
-     return;
-   }
-   
-   lastUpdateTime = millis();
-   
+void RollingPlotterMode::tick(State& state) {
    // Read sensor data
    float temperature = 0;
    float pressure = 0;
    float humidity = 0;
    
-   if (bme.begin(0x76)) {
-     temperature = bme.readTemperature();
-     pressure = bme.readPressure() / 100.0F;
-     humidity = bme.readHumidity();
+   if (inputTrace.status(TRACE_STATUS_BME, bmeAvailable)) {
+     I2cTransaction transaction(i2cBus, i2cBme280,
+       BME280_TEMPERATURE_BYTES + BME280_PRESSURE_BYTES + BME280_HUMIDITY_BYTES);
+     temperature = inputTrace.sensor(TRACE_SENSOR_TEMPERATURE);
+     pressure = inputTrace.sensor(TRACE_SENSOR_PRESSURE);
+     humidity = inputTrace.sensor(TRACE_SENSOR_HUMIDITY);
    }
    
    // Select value to plot based on touch
    int plotValue;
-   int touch1 = touchRead(TOUCH_RIGHT);
-   int touch2 = touchRead(TOUCH_LEFT);
+   int touch1 = inputTrace.touch(TOUCH_RIGHT);
+   int touch2 = inputTrace.touch(TOUCH_LEFT);
    
    if (touch1 < 40) {
      // Plot temperature
@@ -51,15 +37,15 @@ void runRollingPlotter() {
    plotValue = constrain(plotValue, 0, 50);
    
    // Store the new data point
-   dataPoints[dataIndex] = plotValue;
-   dataIndex = (dataIndex + 1) % SCREEN_WIDTH;
+   state.dataPoints[state.dataIndex] = plotValue;
+   state.dataIndex = (state.dataIndex + 1) % SCREEN_WIDTH;
    
    // Find max value for scaling
-   maxVal = 0;
+   state.maxVal = 0;
    for (int i = 0; i < SCREEN_WIDTH; i++) {
-     if (dataPoints[i] > maxVal) maxVal = dataPoints[i];
+     if (state.dataPoints[i] > state.maxVal) state.maxVal = state.dataPoints[i];
    }
-   maxVal = max(maxVal, 10); // Ensure non-zero scaling
+   state.maxVal = max(state.maxVal, 10); // Ensure non-zero scaling
    
    display.clearDisplay();
    
@@ -89,9 +75,9 @@ void runRollingPlotter() {
    // Draw graph
    for (int i = 0; i < SCREEN_WIDTH - 1; i++) {
      int x1 = i;
-     int y1 = 63 - map(dataPoints[(dataIndex + i) % SCREEN_WIDTH], 0, maxVal, 0, 35);
+     int y1 = 63 - map(state.dataPoints[(state.dataIndex + i) % SCREEN_WIDTH], 0, state.maxVal, 0, 35);
      int x2 = i + 1;
-     int y2 = 63 - map(dataPoints[(dataIndex + i + 1) % SCREEN_WIDTH], 0, maxVal, 0, 35);
+     int y2 = 63 - map(state.dataPoints[(state.dataIndex + i + 1) % SCREEN_WIDTH], 0, state.maxVal, 0, 35);
      
      display.drawLine(x1, y1, x2, y2, SSD1306_WHITE);
    }
@@ -1,92 +1,118 @@
-#include <Arduino.h>
-#include <Adafruit_GFX.h>
-#include <Adafruit_SSD1306.h>
+#include "modes.h"
 
 // Mode 5: Creative Mode - Orbit Simulator Window
-// Provides a visual simulation of satellite orbit around Earth
+// Propagates the uplinked TLE with SGP4 and renders orbit, altitude,
+// ground track position and eclipse state from a precomputed ephemeris table
 
-void runCreativeMode() {
-   static unsigned long lastUpdateTime = 0;
-   const unsigned long updateInterval = 50; // Update frequently for smooth animation
-   static float orbitAngle = 0.0;
-   static float satelliteAngle = 0.0;
-   static float orbitSpeed = 0.5;
-   static int earthRadius = 15;
-   static int orbitRadius = 25;
-   
-   // Control orbit speed with touch
-   int touch1 = touchRead(TOUCH_RIGHT);
-   int touch2 = touchRead(TOUCH_LEFT);
-   
-   if (touch1 < 40) {
-     orbitSpeed += 0.1;
-     if (orbitSpeed > 5.0) orbitSpeed = 5.0;
-   }
-   
-   if (touch2 < 40) {
-     orbitSpeed -= 0.1;
-     if (orbitSpeed < 0.1) orbitSpeed = 0.1;
-   }
-   
-   if (millis() - lastUpdateTime < updateInterval) {
-     return;
-   }
-   
-   lastUpdateTime = millis();
+const float speedRate = 2.0;    // Orbit speed change per second while a pad is held
+
+void OrbitSimulatorMode::step(State& state) {
+   state.orbitSpeed += state.speedInput * speedRate * stepInterval / 1000.0;
+   if (state.orbitSpeed > 5.0) state.orbitSpeed = 5.0;
+   if (state.orbitSpeed < 0.1) state.orbitSpeed = 0.1;
+   
+   // Advance simulation time: speed 1.0 = 300x real time (one LEO orbit in ~18 s)
+   state.previousMinutes = state.simMinutes;
+   state.simMinutes += stepInterval / 60000.0 * state.orbitSpeed * 300.0;
+}
+
+void OrbitSimulatorMode::tick(State& state) {
+   const int earthRadius = 15;
+   const int orbitRadius = 25;
    
-   // Update angles
-   orbitAngle += orbitSpeed;
-   if (orbitAngle > 360) orbitAngle -= 360;
+   // Control orbit speed with touch; step() applies it at a fixed rate
+   int touch1 = inputTrace.touch(TOUCH_RIGHT);
+   int touch2 = inputTrace.touch(TOUCH_LEFT);
+   state.speedInput = (touch1 < 40 ? 1 : 0) - (touch2 < 40 ? 1 : 0);
    
-   satelliteAngle += orbitSpeed * 3; // Satellite rotation
-   if (satelliteAngle > 360) satelliteAngle -= 360;
+   // Render between the last two steps
+   double simMinutes = state.previousMinutes + (state.simMinutes - state.previousMinutes) * framePacer.alpha();
    
    display.clearDisplay();
    
    // Draw title
    display.setTextSize(1);
    display.setCursor(0, 0);
-   display.println("Mode 5: Orbit Simulator");
+   display.println("Mode 5: Orbit Sim");
    
-   // Display orbit info
-   display.setCursor(0, 56);
-   display.print("Speed: ");
-   display.print(orbitSpeed, 1);
-   display.print(" (Touch to adjust)");
+   if (!orbitValid) {
+     display.setCursor(0, 20);
+     display.println("No valid TLE loaded");
+     display.println("Send: TLE <l1>|<l2>");
+     display.display();
+     return;
+   }
+   
+   // Full SGP4 only runs when the table window is left, i.e. once per orbit
+   if (!orbitEphemeris.contains(simMinutes)) {
+     if (orbitEphemeris.build(orbitPropagator, simMinutes) != ORBIT_OK) {
+       // Propagated past decay: the elements are still good, start over from their epoch
+       state.simMinutes = state.previousMinutes = simMinutes = 0.0;
+       if (orbitEphemeris.build(orbitPropagator, 0.0) != ORBIT_OK) {
+         display.setCursor(0, 20);
+         display.println("Orbit decayed");
+         display.display();
+         return;
+       }
+     }
+   }
+   
+   EphemerisPoint sat;
+   orbitEphemeris.sample(simMinutes, sat);
    
    // Draw Earth
-   int centerX = SCREEN_WIDTH / 2;
-   int centerY = 32;
+   int centerX = 32;
+   int centerY = 36;
    display.fillCircle(centerX, centerY, earthRadius, SSD1306_WHITE);
    display.fillCircle(centerX + 2, centerY - 2, earthRadius - 4, SSD1306_BLACK);
    
-   // Draw orbit path
-   display.drawCircle(centerX, centerY, orbitRadius, SSD1306_WHITE);
+   // Altitude is drawn exaggerated: perigee..apogee maps onto the orbit ring
+   float altSpan = orbitEphemeris.apogeeAltitude() - orbitEphemeris.perigeeAltitude();
+   float pxPerKm = (altSpan > 1.0) ? 6.0 / altSpan : 0.0;
+   float perigeeAlt = orbitEphemeris.perigeeAltitude();
+   
+   // Draw orbit path from the ephemeris table
+   int prevX = 0, prevY = 0;
+   for (int i = 0; i <= EPHEMERIS_SIZE; i++) {
+     const EphemerisPoint& p = orbitEphemeris.point(i);
+     float angle = atan2(p.planeY, p.planeX);
+     float radius = orbitRadius - 3 + (p.altitude - perigeeAlt) * pxPerKm;
+     int x = centerX + int(radius * cos(angle));
+     int y = centerY - int(radius * sin(angle));
+     if (i > 0) display.drawLine(prevX, prevY, x, y, SSD1306_WHITE);
+     prevX = x;
+     prevY = y;
+   }
    
    // Calculate satellite position
-   int satX = centerX + int(orbitRadius * cos(orbitAngle * PI / 180.0));
-   int satY = centerY + int(orbitRadius * sin(orbitAngle * PI / 180.0));
-   
-   // Draw satellite
-   display.fillRect(satX - 2, satY - 2, 4, 4, SSD1306_WHITE);
-   
-   // Draw satellite solar panels
-   float sinRot = sin(satelliteAngle * PI / 180.0);
-   float cosRot = cos(satelliteAngle * PI / 180.0);
-   
-   display.drawLine(
-     satX, satY,
-     satX + int(8 * cosRot),
-     satY + int(8 * sinRot),
-     SSD1306_WHITE
-   );
+   float satAngle = atan2(sat.planeY, sat.planeX);
+   float satRadius = orbitRadius - 3 + (sat.altitude - perigeeAlt) * pxPerKm;
+   int satX = centerX + int(satRadius * cos(satAngle));
+   int satY = centerY - int(satRadius * sin(satAngle));
+   
+   // Draw satellite: filled in sunlight, outline in eclipse
+   if (sat.eclipse) {
+     display.drawRect(satX - 2, satY - 2, 5, 5, SSD1306_WHITE);
+   } else {
+     display.fillRect(satX - 2, satY - 2, 5, 5, SSD1306_WHITE);
+   }
    
-   display.drawLine(
-     satX, satY,
-     satX - int(8 * cosRot),
-     satY - int(8 * sinRot),
-     SSD1306_WHITE
-   );
+   // Display orbit info
+   display.setCursor(66, 12);
+   display.print("Alt ");
+   display.print(int(sat.altitude));
+   display.println("km");
+   display.setCursor(66, 22);
+   display.print("Lat ");
+   display.println(sat.latitude, 1);
+   display.setCursor(66, 32);
+   display.print("Lon ");
+   display.println(sat.longitude, 1);
+   display.setCursor(66, 42);
+   display.println(sat.eclipse ? "ECLIPSE" : "SUNLIT");
+   display.setCursor(66, 56);
+   display.print("x");
+   display.print(int(state.orbitSpeed * 300));
    
    display.display();
 }
@@ -0,0 +1,130 @@
+#ifndef MODE_REGISTRY_H
+#define MODE_REGISTRY_H
+
+#include <Arduino.h>
+#include "input_trace.h"
+#include "frame_pacing.h"
+
+// Compile-time registry of operational modes
+//
+// A mode is a type providing:
+//   static constexpr const char* name;         // Shown by displayModeInfo()
+//   static const unsigned long updateInterval; // Default ms between frames (target frame rate)
+//   static const unsigned long stepInterval;   // Fixed simulation step in ms, 0 without one
+//   static const uint8_t power;                // Peripherals it needs (POWER_* in power_gate.h)
+//   struct State;                              // Per-mode state, reset on every entry
+//   static void enter(State&);
+//   static void exit(State&);
+//   static void step(State&);                  // Advance the simulation by one step
+//   static void tick(State&);                  // Read inputs and render a frame
+//
+// Before each frame the mode's simulation runs as many fixed steps as are
+// due (frame_pacing.h); tick() renders, interpolating by framePacer.alpha().
+//
+// ModeRegistry<Mode0, Mode1, ...> builds a constexpr table of plain function
+// pointers, one row per mode, so dispatch needs no virtual calls and the
+// mode number is simply the position in the template argument list.
+// Update intervals can be retuned at runtime through setUpdateInterval().
+
+// Storage for one mode's state plus the rate limiter
+template <typename M>
+struct ModeSlot {
+   static typename M::State state;
+   static unsigned long lastUpdateTime;
+   static unsigned long updateInterval;
+};
+
+template <typename M>
+typename M::State ModeSlot<M>::state;
+
+template <typename M>
+unsigned long ModeSlot<M>::lastUpdateTime = 0;
+
+template <typename M>
+unsigned long ModeSlot<M>::updateInterval = M::updateInterval;
+
+template <typename M>
+void modeEnter() {
+   ModeSlot<M>::state = typename M::State();
+   ModeSlot<M>::lastUpdateTime = millis() - ModeSlot<M>::updateInterval; // First tick runs immediately
+   framePacer.begin(inputTrace.now(), M::stepInterval);
+   M::enter(ModeSlot<M>::state);
+}
+
+template <typename M>
+void modeExit() {
+   M::exit(ModeSlot<M>::state);
+}
+
+template <typename M>
+void modeAdvance() {
+   for (uint32_t steps = framePacer.advance(inputTrace.now()); steps > 0; steps--) {
+     M::step(ModeSlot<M>::state);
+   }
+}
+
+template <typename M>
+void modeTick() {
+   // Rate limit through the input trace so replays tick exactly when the recording did
+   unsigned long scheduled = ModeSlot<M>::lastUpdateTime;
+   if (!inputTrace.due(TRACE_SITE_MODE_TICK, ModeSlot<M>::lastUpdateTime, ModeSlot<M>::updateInterval)) {
+     return;
+   }
+   ModeSlot<M>::lastUpdateTime = framePacer.frame(scheduled, ModeSlot<M>::lastUpdateTime, ModeSlot<M>::updateInterval);
+   modeAdvance<M>();
+   M::tick(ModeSlot<M>::state);
+}
+
+// Tick without the rate limiter or frame pacing (render benchmark)
+template <typename M>
+void modeRender() {
+   modeAdvance<M>();
+   M::tick(ModeSlot<M>::state);
+}
+
+template <typename M>
+void modeSetInterval(unsigned long ms) {
+   ModeSlot<M>::updateInterval = ms;
+}
+
+struct ModeEntry {
+   const char* name;
+   uint8_t power;
+   void (*enter)();
+   void (*exit)();
+   void (*tick)();
+   void (*render)();
+   void (*setInterval)(unsigned long);
+};
+
+template <typename... Modes>
+class ModeRegistry {
+public:
+   static const int count = sizeof...(Modes);
+
+   static bool isValid(int mode) { return mode >= 0 && mode < count; }
+   static const char* name(int mode) { return table[mode].name; }
+   static unsigned long defaultUpdateInterval(int mode) { return defaultIntervals[mode]; }
+   static uint8_t power(int mode) { return table[mode].power; }
+   static void setUpdateInterval(int mode, unsigned long ms) { table[mode].setInterval(ms); }
+   static void enter(int mode) { table[mode].enter(); }
+   static void exit(int mode) { table[mode].exit(); }
+   static void tick(int mode) { table[mode].tick(); }
+   static void render(int mode) { table[mode].render(); }
+
+private:
+   // Apart from the table so reading a default does not link the modes in (params.cpp)
+   static constexpr unsigned long defaultIntervals[sizeof...(Modes)] = { Modes::updateInterval... };
+   static constexpr ModeEntry table[sizeof...(Modes)] = {
+     { Modes::name, Modes::power, &modeEnter<Modes>, &modeExit<Modes>, &modeTick<Modes>,
+       &modeRender<Modes>, &modeSetInterval<Modes> }...
+   };
+};
+
+template <typename... Modes>
+constexpr unsigned long ModeRegistry<Modes...>::defaultIntervals[sizeof...(Modes)];
+
+template <typename... Modes>
+constexpr ModeEntry ModeRegistry<Modes...>::table[sizeof...(Modes)];
+
+#endif
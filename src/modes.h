@@ -0,0 +1,122 @@
+#ifndef MODES_H
+#define MODES_H
+
+#include "cadse.h"
+#include "mode_registry.h"
+#include "power_gate.h"
+
+// Operational modes. Each type is implemented in its own src/modeN_*.cpp
+// and registered once in the OperationalModes list at the bottom.
+
+// Mode 0: Basic Monitoring - system status overview
+struct BasicMonitoringMode {
+   static constexpr const char* name = "Basic Monitoring";
+   static const unsigned long updateInterval = 1000;
+   static const unsigned long stepInterval = 0;
+   static const uint8_t power = POWER_NONE;   // Status text only: dimmed, BME280 asleep
+   struct State {};
+   static void enter(State&) {}
+   static void exit(State&) {}
+   static void step(State&) {}
+   static void tick(State& state);
+};
+
+// Mode 1: Micro-G Detection - free-fall simulation from touch differential
+struct MicroGravityMode {
+   static constexpr const char* name = "Micro-G Detection";
+   static const unsigned long updateInterval = 200;
+   static const unsigned long stepInterval = 0;
+   static const uint8_t power = POWER_DISPLAY;
+   struct State {
+     int fallingCounter;
+     bool inFreeFall;
+   };
+   static void enter(State&) {}
+   static void exit(State&) {}
+   static void step(State&) {}
+   static void tick(State& state);
+};
+
+// Mode 2: Pressure Monitor - cat safety alert on pressure drops
+struct PressureMonitoringMode {
+   static constexpr const char* name = "Pressure Monitor";
+   static const unsigned long updateInterval = 500;
+   static const unsigned long stepInterval = 0;
+   static const uint8_t power = POWER_DISPLAY | POWER_BME280;
+   struct State {
+     float basePressure;
+     bool baselineSet;
+     bool alertActive;
+   };
+   static void enter(State&) {}
+   static void exit(State&) {}
+   static void step(State&) {}
+   static void tick(State& state);
+};
+
+// Mode 3: Attitude Indicator - artificial horizon
+struct AttitudeIndicatorMode {
+   static constexpr const char* name = "Attitude Indicator";
+   static const unsigned long updateInterval = 50;
+   static const unsigned long stepInterval = 20;
+   static const uint8_t power = POWER_DISPLAY;
+   struct State {
+     float roll;
+     float previousRoll;          // Roll one step earlier, for interpolation
+     float pitch;
+     int rollInput;               // -1, 0, +1 from the touch pads, applied by step()
+   };
+   static void enter(State&) {}
+   static void exit(State&) {}
+   static void step(State& state);
+   static void tick(State& state);
+};
+
+// Mode 4: Rolling Plotter - scrolling sensor graph
+struct RollingPlotterMode {
+   static constexpr const char* name = "Rolling Plotter";
+   static const unsigned long updateInterval = 100;
+   static const unsigned long stepInterval = 0;
+   static const uint8_t power = POWER_DISPLAY | POWER_BME280;
+   struct State {
+     int dataPoints[SCREEN_WIDTH];
+     int dataIndex;
+     int maxVal;
+   };
+   static void enter(State&) {}
+   static void exit(State&) {}
+   static void step(State&) {}
+   static void tick(State& state);
+};
+
+// Mode 5: Creative Mode - SGP4 orbit simulator
+struct OrbitSimulatorMode {
+   static constexpr const char* name = "Creative: Orbit Sim";
+   static const unsigned long updateInterval = 50;
+   static const unsigned long stepInterval = 20;
+   static const uint8_t power = POWER_DISPLAY;
+   struct State {
+     double simMinutes = 0.0;     // Simulation time since TLE epoch
+     double previousMinutes = 0.0; // One step earlier, for interpolation
+     float orbitSpeed = 0.5;
+     int speedInput = 0;          // -1, 0, +1 from the touch pads, applied by step()
+   };
+   static void enter(State&) {}
+   static void exit(State&) {}
+   static void step(State& state);
+   static void tick(State& state);
+};
+
+// Mode number = position in this list
+typedef ModeRegistry<
+   BasicMonitoringMode,
+   MicroGravityMode,
+   PressureMonitoringMode,
+   AttitudeIndicatorMode,
+   RollingPlotterMode,
+   OrbitSimulatorMode
+> OperationalModes;
+
+#define MODE_COUNT OperationalModes::count
+
+#endif
@@ -0,0 +1,471 @@
+#include "orbit_propagator.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// WGS-72 constants used by SGP4
+static const double RADIUS_EARTH_KM = 6378.135;
+static const double MU_KM3_S2 = 398600.8;
+static const double XKE = 0.0743669161331734132; // sqrt(mu) in earth radii^1.5 / min
+static const double J2 = 0.001082616;
+static const double J3 = -0.00000253881;
+static const double J4 = -0.00000165597;
+static const double J3OJ2 = J3 / J2;
+static const double X2O3 = 2.0 / 3.0;
+static const double TWO_PI = 6.283185307179586;
+static const double DEG_TO_RAD = 0.017453292519943295;
+static const double VKM_PER_SEC = RADIUS_EARTH_KM * XKE / 60.0;
+
+// ---------------------------------------------------------------------------
+// TLE parsing
+
+// Copy columns [first, last] (1-based, inclusive) of a TLE line into buf
+static void tleField(const char* line, int first, int last, char* buf) {
+   int n = last - first + 1;
+   memcpy(buf, line + first - 1, n);
+   buf[n] = '\0';
+}
+
+static bool tleChecksumOk(const char* line) {
+   int sum = 0;
+   for (int i = 0; i < 68; i++) {
+     char c = line[i];
+     if (c >= '0' && c <= '9') sum += c - '0';
+     else if (c == '-') sum += 1;
+   }
+   return (sum % 10) == (line[68] - '0');
+}
+
+// Decode the "assumed decimal point" exponent notation, e.g. " 28098-4" -> 0.28098e-4
+static double tleExponentField(const char* line, int first) {
+   char mantissa[8];
+   char exponent[3];
+   tleField(line, first + 1, first + 5, mantissa);
+   tleField(line, first + 6, first + 7, exponent);
+   double value = atof(mantissa) * 1.0e-5 * pow(10.0, atoi(exponent));
+   return (line[first - 1] == '-') ? -value : value;
+}
+
+bool parseTle(const char* line1, const char* line2, TleElements& out) {
+   if (strlen(line1) < 69 || strlen(line2) < 69) return false;
+   if (line1[0] != '1' || line2[0] != '2') return false;
+   if (!tleChecksumOk(line1) || !tleChecksumOk(line2)) return false;
+
+   char buf[16];
+   tleField(line1, 3, 7, buf);
+   out.satnum = strtoul(buf, nullptr, 10);
+
+   // Epoch: two-digit year (57-99 => 19xx) and fractional day of year
+   tleField(line1, 19, 20, buf);
+   int year = atoi(buf);
+   year += (year < 57) ? 2000 : 1900;
+   tleField(line1, 21, 32, buf);
+   double dayOfYear = atof(buf);
+   double jdJan1 = 367.0 * year - floor(7.0 * (year + floor(10.0 / 12.0)) * 0.25)
+                   + floor(275.0 / 9.0) + 1.0 + 1721013.5;
+   out.epochJd = jdJan1 + dayOfYear - 1.0;
+
+   out.bstar = tleExponentField(line1, 54);
+
+   tleField(line2, 9, 16, buf);
+   out.inclo = atof(buf) * DEG_TO_RAD;
+   tleField(line2, 18, 25, buf);
+   out.nodeo = atof(buf) * DEG_TO_RAD;
+   tleField(line2, 27, 33, buf);
+   out.ecco = atof(buf) * 1.0e-7;
+   tleField(line2, 35, 42, buf);
+   out.argpo = atof(buf) * DEG_TO_RAD;
+   tleField(line2, 44, 51, buf);
+   out.mo = atof(buf) * DEG_TO_RAD;
+   tleField(line2, 53, 63, buf);
+   out.noKozai = atof(buf) * TWO_PI / 1440.0;
+
+   return out.noKozai > 0 && out.ecco < 1.0;
+}
+
+// ---------------------------------------------------------------------------
+// SGP4 initialisation
+
+bool OrbitPropagator::init(const TleElements& el) {
+   elements = el;
+
+   const double ss = 78.0 / RADIUS_EARTH_KM + 1.0;
+   const double qzms2t = pow((120.0 - 78.0) / RADIUS_EARTH_KM, 4);
+
+   double eccsq = el.ecco * el.ecco;
+   double omeosq = 1.0 - eccsq;
+   double rteosq = sqrt(omeosq);
+   double cosio = cos(el.inclo);
+   double cosio2 = cosio * cosio;
+   double sinio = sin(el.inclo);
+
+   // Un-Kozai the mean motion
+   double ak = pow(XKE / el.noKozai, X2O3);
+   double d1 = 0.75 * J2 * (3.0 * cosio2 - 1.0) / (rteosq * omeosq);
+   double del = d1 / (ak * ak);
+   double adel = ak * (1.0 - del * del - del * (1.0 / 3.0 + 134.0 * del * del / 81.0));
+   del = d1 / (adel * adel);
+   no = el.noKozai / (1.0 + del);
+   if (no <= 0 || el.ecco >= 1.0) return false;
+
+   ao = pow(XKE / no, X2O3);
+   double po = ao * omeosq;
+   double con42 = 1.0 - 5.0 * cosio2;
+   con41 = -con42 - cosio2 - cosio2;
+   double posq = po * po;
+   double rp = ao * (1.0 - el.ecco);
+
+   // SDP4 deep-space terms are not implemented; long-period orbits use two-body Kepler
+   deepSpace = (TWO_PI / no >= 225.0);
+   if (deepSpace) return true;
+
+   isimp = (rp < 220.0 / RADIUS_EARTH_KM + 1.0);
+
+   // Atmospheric density parameters for low perigees
+   double sfour = ss;
+   double qzms24 = qzms2t;
+   double perige = (rp - 1.0) * RADIUS_EARTH_KM;
+   if (perige < 156.0) {
+     sfour = perige - 78.0;
+     if (perige < 98.0) sfour = 20.0;
+     qzms24 = pow((120.0 - sfour) / RADIUS_EARTH_KM, 4);
+     sfour = sfour / RADIUS_EARTH_KM + 1.0;
+   }
+
+   double pinvsq = 1.0 / posq;
+   double tsi = 1.0 / (ao - sfour);
+   eta = ao * el.ecco * tsi;
+   double etasq = eta * eta;
+   double eeta = el.ecco * eta;
+   double psisq = fabs(1.0 - etasq);
+   double coef = qzms24 * pow(tsi, 4);
+   double coef1 = coef / pow(psisq, 3.5);
+   double cc2 = coef1 * no * (ao * (1.0 + 1.5 * etasq + eeta * (4.0 + etasq)) +
+                0.375 * J2 * tsi / psisq * con41 * (8.0 + 3.0 * etasq * (8.0 + etasq)));
+   cc1 = el.bstar * cc2;
+   double cc3 = 0.0;
+   if (el.ecco > 1.0e-4) cc3 = -2.0 * coef * tsi * J3OJ2 * no * sinio / el.ecco;
+   x1mth2 = 1.0 - cosio2;
+   cc4 = 2.0 * no * coef1 * ao * omeosq *
+         (eta * (2.0 + 0.5 * etasq) + el.ecco * (0.5 + 2.0 * etasq) -
+          J2 * tsi / (ao * psisq) *
+          (-3.0 * con41 * (1.0 - 2.0 * eeta + etasq * (1.5 - 0.5 * eeta)) +
+           0.75 * x1mth2 * (2.0 * etasq - eeta * (1.0 + etasq)) * cos(2.0 * el.argpo)));
+   cc5 = 2.0 * coef1 * ao * omeosq * (1.0 + 2.75 * (etasq + eeta) + eeta * etasq);
+
+   // Secular rates from J2/J4
+   double cosio4 = cosio2 * cosio2;
+   double temp1 = 1.5 * J2 * pinvsq * no;
+   double temp2 = 0.5 * temp1 * J2 * pinvsq;
+   double temp3 = -0.46875 * J4 * pinvsq * pinvsq * no;
+   mdot = no + 0.5 * temp1 * rteosq * con41 +
+          0.0625 * temp2 * rteosq * (13.0 - 78.0 * cosio2 + 137.0 * cosio4);
+   argpdot = -0.5 * temp1 * con42 + 0.0625 * temp2 * (7.0 - 114.0 * cosio2 + 395.0 * cosio4) +
+             temp3 * (3.0 - 36.0 * cosio2 + 49.0 * cosio4);
+   double xhdot1 = -temp1 * cosio;
+   nodedot = xhdot1 + (0.5 * temp2 * (4.0 - 19.0 * cosio2) + 2.0 * temp3 * (3.0 - 7.0 * cosio2)) * cosio;
+
+   omgcof = el.bstar * cc3 * cos(el.argpo);
+   xmcof = 0.0;
+   if (el.ecco > 1.0e-4) xmcof = -X2O3 * coef * el.bstar / eeta;
+   nodecf = 3.5 * omeosq * xhdot1 * cc1;
+   t2cof = 1.5 * cc1;
+   if (fabs(cosio + 1.0) > 1.5e-12) {
+     xlcof = -0.25 * J3OJ2 * sinio * (3.0 + 5.0 * cosio) / (1.0 + cosio);
+   } else {
+     xlcof = -0.25 * J3OJ2 * sinio * (3.0 + 5.0 * cosio) / 1.5e-12;
+   }
+   aycof = -0.5 * J3OJ2 * sinio;
+   delmo = pow(1.0 + eta * cos(el.mo), 3);
+   sinmao = sin(el.mo);
+   x7thm1 = 7.0 * cosio2 - 1.0;
+
+   d2 = d3 = d4 = t3cof = t4cof = t5cof = 0.0;
+   if (!isimp) {
+     double cc1sq = cc1 * cc1;
+     d2 = 4.0 * ao * tsi * cc1sq;
+     double temp = d2 * tsi * cc1 / 3.0;
+     d3 = (17.0 * ao + sfour) * temp;
+     d4 = 0.5 * temp * ao * tsi * (221.0 * ao + 31.0 * sfour) * cc1;
+     t3cof = d2 + 2.0 * cc1sq;
+     t4cof = 0.25 * (3.0 * d3 + cc1 * (12.0 * d2 + 10.0 * cc1sq));
+     t5cof = 0.2 * (3.0 * d4 + 12.0 * cc1 * d3 + 6.0 * d2 * d2 + 15.0 * cc1sq * (2.0 * d2 + cc1sq));
+   }
+   return true;
+}
+
+double OrbitPropagator::periodMinutes() const {
+   return TWO_PI / no;
+}
+
+// ---------------------------------------------------------------------------
+// SGP4 propagation
+
+int OrbitPropagator::propagate(double t, double r[3], double v[3]) const {
+   if (deepSpace) return propagateKepler(t, r, v);
+
+   // Secular gravity and atmospheric drag
+   double xmdf = elements.mo + mdot * t;
+   double argpdf = elements.argpo + argpdot * t;
+   double nodedf = elements.nodeo + nodedot * t;
+   double argpm = argpdf;
+   double mm = xmdf;
+   double t2 = t * t;
+   double nodem = nodedf + nodecf * t2;
+   double tempa = 1.0 - cc1 * t;
+   double tempe = elements.bstar * cc4 * t;
+   double templ = t2cof * t2;
+
+   if (!isimp) {
+     double delomg = omgcof * t;
+     double delm = xmcof * (pow(1.0 + eta * cos(xmdf), 3) - delmo);
+     double temp = delomg + delm;
+     mm = xmdf + temp;
+     argpm = argpdf - temp;
+     double t3 = t2 * t;
+     double t4 = t3 * t;
+     tempa = tempa - d2 * t2 - d3 * t3 - d4 * t4;
+     tempe = tempe + elements.bstar * cc5 * (sin(mm) - sinmao);
+     templ = templ + t3cof * t3 + t4 * (t4cof + t * t5cof);
+   }
+
+   if (no <= 0.0) return ORBIT_ERR_MEAN_MOTION;
+   double am = pow(XKE / no, X2O3) * tempa * tempa;
+   double nm = XKE / pow(am, 1.5);
+   double em = elements.ecco - tempe;
+   if (em >= 1.0 || em < -0.001) return ORBIT_ERR_ECCENTRICITY;
+   if (em < 1.0e-6) em = 1.0e-6;
+   mm = mm + no * templ;
+   double xlm = mm + argpm + nodem;
+   nodem = fmod(nodem, TWO_PI);
+   argpm = fmod(argpm, TWO_PI);
+   xlm = fmod(xlm, TWO_PI);
+   mm = fmod(xlm - argpm - nodem, TWO_PI);
+
+   double sinip = sin(elements.inclo);
+   double cosip = cos(elements.inclo);
+
+   // Long-period periodics
+   double axnl = em * cos(argpm);
+   double temp = 1.0 / (am * (1.0 - em * em));
+   double aynl = em * sin(argpm) + temp * aycof;
+   double xl = mm + argpm + nodem + temp * xlcof * axnl;
+
+   // Solve Kepler's equation
+   double u = fmod(xl - nodem, TWO_PI);
+   double eo1 = u;
+   double tem5 = 9999.9;
+   double sineo1 = 0.0, coseo1 = 0.0;
+   for (int ktr = 1; fabs(tem5) >= 1.0e-12 && ktr <= 10; ktr++) {
+     sineo1 = sin(eo1);
+     coseo1 = cos(eo1);
+     tem5 = 1.0 - coseo1 * axnl - sineo1 * aynl;
+     tem5 = (u - aynl * coseo1 + axnl * sineo1 - eo1) / tem5;
+     if (fabs(tem5) >= 0.95) tem5 = tem5 > 0.0 ? 0.95 : -0.95;
+     eo1 = eo1 + tem5;
+   }
+
+   // Short-period preliminary quantities
+   double ecose = axnl * coseo1 + aynl * sineo1;
+   double esine = axnl * sineo1 - aynl * coseo1;
+   double el2 = axnl * axnl + aynl * aynl;
+   double pl = am * (1.0 - el2);
+   if (pl < 0.0) return ORBIT_ERR_SEMILATUS;
+
+   double rl = am * (1.0 - ecose);
+   double rdotl = sqrt(am) * esine / rl;
+   double rvdotl = sqrt(pl) / rl;
+   double betal = sqrt(1.0 - el2);
+   temp = esine / (1.0 + betal);
+   double sinu = am / rl * (sineo1 - aynl - axnl * temp);
+   double cosu = am / rl * (coseo1 - axnl + aynl * temp);
+   double su = atan2(sinu, cosu);
+   double sin2u = (cosu + cosu) * sinu;
+   double cos2u = 1.0 - 2.0 * sinu * sinu;
+   temp = 1.0 / pl;
+   double temp1 = 0.5 * J2 * temp;
+   double temp2 = temp1 * temp;
+
+   // Short-period periodics
+   double mrt = rl * (1.0 - 1.5 * temp2 * betal * con41) + 0.5 * temp1 * x1mth2 * cos2u;
+   su = su - 0.25 * temp2 * x7thm1 * sin2u;
+   double xnode = nodem + 1.5 * temp2 * cosip * sin2u;
+   double xinc = elements.inclo + 1.5 * temp2 * cosip * sinip * cos2u;
+   double mvt = rdotl - nm * temp1 * x1mth2 * sin2u / XKE;
+   double rvdot = rvdotl + nm * temp1 * (x1mth2 * cos2u + 1.5 * con41) / XKE;
+
+   // Orientation vectors
+   double sinsu = sin(su), cossu = cos(su);
+   double snod = sin(xnode), cnod = cos(xnode);
+   double sini = sin(xinc), cosi = cos(xinc);
+   double xmx = -snod * cosi;
+   double xmy = cnod * cosi;
+   double ux = xmx * sinsu + cnod * cossu;
+   double uy = xmy * sinsu + snod * cossu;
+   double uz = sini * sinsu;
+   double vx = xmx * cossu - cnod * sinsu;
+   double vy = xmy * cossu - snod * sinsu;
+   double vz = sini * cossu;
+
+   r[0] = mrt * ux * RADIUS_EARTH_KM;
+   r[1] = mrt * uy * RADIUS_EARTH_KM;
+   r[2] = mrt * uz * RADIUS_EARTH_KM;
+   v[0] = (mvt * ux + rvdot * vx) * VKM_PER_SEC;
+   v[1] = (mvt * uy + rvdot * vy) * VKM_PER_SEC;
+   v[2] = (mvt * uz + rvdot * vz) * VKM_PER_SEC;
+
+   return (mrt < 1.0) ? ORBIT_ERR_DECAYED : ORBIT_OK;
+}
+
+// Two-body propagation of the mean elements (used for deep-space TLEs)
+int OrbitPropagator::propagateKepler(double t, double r[3], double v[3]) const {
+   double e = elements.ecco;
+   double a = ao * RADIUS_EARTH_KM;
+   double m = fmod(elements.mo + no * t, TWO_PI);
+
+   double ea = (e < 0.8) ? m : M_PI;
+   for (int i = 0; i < 10; i++) {
+     double delta = (ea - e * sin(ea) - m) / (1.0 - e * cos(ea));
+     ea -= delta;
+     if (fabs(delta) < 1.0e-12) break;
+   }
+
+   double cosE = cos(ea), sinE = sin(ea);
+   double b = a * sqrt(1.0 - e * e);
+   double px = a * (cosE - e);
+   double py = b * sinE;
+   double rmag = a * (1.0 - e * cosE);
+   double n = sqrt(MU_KM3_S2 / (a * a * a));
+   double vpx = -a * n * sinE * a / rmag;
+   double vpy = b * n * cosE * a / rmag;
+
+   // Perifocal -> inertial
+   double cO = cos(elements.nodeo), sO = sin(elements.nodeo);
+   double cw = cos(elements.argpo), sw = sin(elements.argpo);
+   double ci = cos(elements.inclo), si = sin(elements.inclo);
+   double p[3] = {cO * cw - sO * sw * ci, sO * cw + cO * sw * ci, sw * si};
+   double q[3] = {-cO * sw - sO * cw * ci, -sO * sw + cO * cw * ci, cw * si};
+   for (int i = 0; i < 3; i++) {
+     r[i] = px * p[i] + py * q[i];
+     v[i] = vpx * p[i] + vpy * q[i];
+   }
+   return ORBIT_OK;
+}
+
+// ---------------------------------------------------------------------------
+// Earth orientation and sun geometry
+
+double gmst(double jd) {
+   double tut1 = (jd - 2451545.0) / 36525.0;
+   double seconds = -6.2e-6 * tut1 * tut1 * tut1 + 0.093104 * tut1 * tut1 +
+                    (876600.0 * 3600.0 + 8640184.812866) * tut1 + 67310.54841;
+   double angle = fmod(seconds * DEG_TO_RAD / 240.0, TWO_PI);
+   return (angle < 0.0) ? angle + TWO_PI : angle;
+}
+
+void sunDirection(double jd, double s[3]) {
+   double n = jd - 2451545.0;
+   double meanLon = (280.460 + 0.9856474 * n) * DEG_TO_RAD;
+   double g = (357.528 + 0.9856003 * n) * DEG_TO_RAD;
+   double lambda = meanLon + (1.915 * sin(g) + 0.020 * sin(2.0 * g)) * DEG_TO_RAD;
+   double eps = (23.439 - 0.0000004 * n) * DEG_TO_RAD;
+   s[0] = cos(lambda);
+   s[1] = cos(eps) * sin(lambda);
+   s[2] = sin(eps) * sin(lambda);
+}
+
+bool inEarthShadow(const double r[3], const double sun[3]) {
+   double along = r[0] * sun[0] + r[1] * sun[1] + r[2] * sun[2];
+   if (along >= 0.0) return false;
+   double px = r[0] - along * sun[0];
+   double py = r[1] - along * sun[1];
+   double pz = r[2] - along * sun[2];
+   return (px * px + py * py + pz * pz) < RADIUS_EARTH_KM * RADIUS_EARTH_KM;
+}
+
+// ---------------------------------------------------------------------------
+// Ephemeris table
+
+int Ephemeris::build(const OrbitPropagator& propagator, double start) {
+   valid = false;
+   startMinutes = start;
+   spanMinutes = propagator.periodMinutes();
+   minAltitude = 1.0e9f;
+   maxAltitude = -1.0e9f;
+
+   double step = spanMinutes / EPHEMERIS_SIZE;
+   double planeP[3] = {0, 0, 0};
+   double planeQ[3] = {0, 0, 0};
+   double sun[3];
+   sunDirection(propagator.epochJd() + start / 1440.0, sun);
+
+   for (int i = 0; i <= EPHEMERIS_SIZE; i++) {
+     double t = start + i * step;
+     double r[3], v[3];
+     int status = propagator.propagate(t, r, v);
+     if (status != ORBIT_OK) return status;
+
+     double rmag = sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+
+     // Fix the display plane from the first sample: x along the eccentricity vector
+     if (i == 0) {
+       double h[3] = {r[1] * v[2] - r[2] * v[1], r[2] * v[0] - r[0] * v[2], r[0] * v[1] - r[1] * v[0]};
+       double hmag = sqrt(h[0] * h[0] + h[1] * h[1] + h[2] * h[2]);
+       double vxh[3] = {v[1] * h[2] - v[2] * h[1], v[2] * h[0] - v[0] * h[2], v[0] * h[1] - v[1] * h[0]};
+       double e[3];
+       for (int k = 0; k < 3; k++) e[k] = vxh[k] / MU_KM3_S2 - r[k] / rmag;
+       double emag = sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+       for (int k = 0; k < 3; k++) {
+         planeP[k] = (emag > 1.0e-4) ? e[k] / emag : r[k] / rmag;
+         h[k] /= hmag;
+       }
+       planeQ[0] = h[1] * planeP[2] - h[2] * planeP[1];
+       planeQ[1] = h[2] * planeP[0] - h[0] * planeP[2];
+       planeQ[2] = h[0] * planeP[1] - h[1] * planeP[0];
+     }
+
+     EphemerisPoint& p = points[i];
+     p.planeX = r[0] * planeP[0] + r[1] * planeP[1] + r[2] * planeP[2];
+     p.planeY = r[0] * planeQ[0] + r[1] * planeQ[1] + r[2] * planeQ[2];
+     p.altitude = rmag - RADIUS_EARTH_KM;
+     p.latitude = asin(r[2] / rmag) / DEG_TO_RAD;
+     double lon = atan2(r[1], r[0]) - gmst(propagator.epochJd() + t / 1440.0);
+     lon = fmod(lon + 3.0 * M_PI, TWO_PI) - M_PI;
+     p.longitude = lon / DEG_TO_RAD;
+     p.eclipse = inEarthShadow(r, sun);
+     if (p.altitude < minAltitude) minAltitude = p.altitude;
+     if (p.altitude > maxAltitude) maxAltitude = p.altitude;
+   }
+
+   valid = true;
+   return ORBIT_OK;
+}
+
+bool Ephemeris::sample(double tsince, EphemerisPoint& out) const {
+   if (!contains(tsince)) return false;
+
+   double pos = (tsince - startMinutes) / spanMinutes * EPHEMERIS_SIZE;
+   int i = (int)pos;
+   if (i >= EPHEMERIS_SIZE) i = EPHEMERIS_SIZE - 1;
+   float f = pos - i;
+   const EphemerisPoint& a = points[i];
+   const EphemerisPoint& b = points[i + 1];
+
+   out.planeX = a.planeX + (b.planeX - a.planeX) * f;
+   out.planeY = a.planeY + (b.planeY - a.planeY) * f;
+   out.altitude = a.altitude + (b.altitude - a.altitude) * f;
+   out.latitude = a.latitude + (b.latitude - a.latitude) * f;
+
+   // Interpolate longitude across the dateline
+   float dLon = b.longitude - a.longitude;
+   if (dLon > 180.0f) dLon -= 360.0f;
+   if (dLon < -180.0f) dLon += 360.0f;
+   float lon = a.longitude + dLon * f;
+   if (lon > 180.0f) lon -= 360.0f;
+   if (lon < -180.0f) lon += 360.0f;
+   out.longitude = lon;
+
+   out.eclipse = (f < 0.5f) ? a.eclipse : b.eclipse;
+   return true;
+}
@@ -0,0 +1,107 @@
+#ifndef ORBIT_PROPAGATOR_H
+#define ORBIT_PROPAGATOR_H
+
+#include <stdint.h>
+
+// Orbit propagation for Mode 5 (Orbit Simulator)
+// Near-earth SGP4 (WGS-72, Vallado 2006 formulation) driven by a two-line
+// element set, with a two-body Kepler fallback for deep-space elements.
+// Pure C++ so the same code runs on the ESP32-S3 and on a host PC.
+
+// Mean orbital elements decoded from a TLE
+struct TleElements {
+   uint32_t satnum;
+   double epochJd;       // Julian date of element epoch (UTC)
+   double bstar;         // Drag term (1/earth radii)
+   double inclo;         // Inclination (rad)
+   double nodeo;         // Right ascension of ascending node (rad)
+   double ecco;          // Eccentricity
+   double argpo;         // Argument of perigee (rad)
+   double mo;            // Mean anomaly (rad)
+   double noKozai;       // Mean motion (rad/min)
+};
+
+// Result codes of propagation (0 = OK, same numbering as Vallado's sgp4)
+#define ORBIT_OK               0
+#define ORBIT_ERR_ECCENTRICITY 1
+#define ORBIT_ERR_MEAN_MOTION  2
+#define ORBIT_ERR_SEMILATUS    4
+#define ORBIT_ERR_DECAYED      6
+
+// Parse a two-line element set. Returns false on malformed lines or checksum mismatch.
+bool parseTle(const char* line1, const char* line2, TleElements& out);
+
+class OrbitPropagator {
+public:
+   // Initialise from elements. Returns false if the elements are unusable.
+   bool init(const TleElements& elements);
+
+   // Position (km) and velocity (km/s) in the TEME frame, tsince minutes after epoch
+   int propagate(double tsince, double r[3], double v[3]) const;
+
+   double epochJd() const { return elements.epochJd; }
+   double periodMinutes() const;
+   bool isDeepSpace() const { return deepSpace; }
+
+private:
+   TleElements elements;
+   bool deepSpace;
+   bool isimp;
+
+   // Secular and drag coefficients from sgp4init
+   double no, ao, con41, x1mth2, x7thm1, cc1, cc4, cc5;
+   double d2, d3, d4, delmo, eta, sinmao, omgcof, xmcof, nodecf;
+   double t2cof, t3cof, t4cof, t5cof, mdot, argpdot, nodedot;
+   double xlcof, aycof;
+
+   int propagateKepler(double tsince, double r[3], double v[3]) const;
+};
+
+// Greenwich mean sidereal time (rad) for a UT1 Julian date
+double gmst(double jd);
+
+// Unit vector towards the sun in the mean-equator frame (low-precision almanac)
+void sunDirection(double jd, double s[3]);
+
+// Cylindrical earth shadow test for a TEME position (km)
+bool inEarthShadow(const double r[3], const double sun[3]);
+
+// One precomputed ephemeris sample
+struct EphemerisPoint {
+   float planeX, planeY; // Position in the orbital plane (km), x towards perigee
+   float altitude;       // Height above the spherical earth (km)
+   float latitude;       // Geocentric latitude (deg)
+   float longitude;      // East longitude (deg, -180..180)
+   bool eclipse;         // Satellite inside the earth's shadow
+};
+
+#define EPHEMERIS_SIZE 64
+
+// Ephemeris table covering one orbital period. Built with full SGP4
+// propagations, then sampled per frame by table lookup and linear interpolation.
+class Ephemeris {
+public:
+   // Precompute EPHEMERIS_SIZE + 1 samples starting tsince minutes after epoch
+   int build(const OrbitPropagator& propagator, double startMinutes);
+
+   // Interpolated state at tsince; false if outside the table window
+   bool sample(double tsince, EphemerisPoint& out) const;
+
+   bool contains(double tsince) const {
+      return valid && tsince >= startMinutes && tsince <= startMinutes + spanMinutes;
+   }
+
+   const EphemerisPoint& point(int i) const { return points[i]; }
+   float perigeeAltitude() const { return minAltitude; }
+   float apogeeAltitude() const { return maxAltitude; }
+
+private:
+   EphemerisPoint points[EPHEMERIS_SIZE + 1];
+   double startMinutes = 0;
+   double spanMinutes = 0;
+   float minAltitude = 0;
+   float maxAltitude = 0;
+   bool valid = false;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "ota_update.h"
+#include "heatshrink_decoder.h"
+
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <Update.h>
+#include <new>
+
+static bool writeImage(const uint8_t* data, size_t length, void* context) {
+   OtaReport* report = (OtaReport*)context;
+   if (Update.write((uint8_t*)data, length) != length) {
+     report->error = "Flash write failed";
+     return false;
+   }
+   report->imageBytes += length;
+   return true;
+}
+
+static bool fail(OtaReport& report, const char* error) {
+   if (error) report.error = error;
+   Update.abort();
+   return false;
+}
+
+bool runUrlOta(const String& url, OtaProgressHandler progress, OtaReport& report) {
+   unsigned long start = millis();
+   report.success = false;
+   report.compressed = url.endsWith(OTA_COMPRESSED_SUFFIX);
+   report.error = nullptr;
+   report.downloadedBytes = 0;
+   report.imageBytes = 0;
+   report.elapsedMs = 0;
+
+   WiFiClient plainClient;
+   WiFiClientSecure secureClient;
+   secureClient.setInsecure();
+   WiFiClient& client = url.startsWith("https://") ? (WiFiClient&)secureClient : plainClient;
+
+   HTTPClient http;
+   if (!http.begin(client, url)) {
+     report.error = "Bad URL";
+     return false;
+   }
+   int code = http.GET();
+   if (code != HTTP_CODE_OK) {
+     report.error = "HTTP request failed";
+     http.end();
+     return false;
+   }
+
+   int contentLength = http.getSize();
+   uint32_t total = contentLength > 0 ? contentLength : 0;
+
+   // A plain image of known size lets Update reject it before any flash erase
+   size_t imageSize = (!report.compressed && total > 0) ? total : UPDATE_SIZE_UNKNOWN;
+   if (!Update.begin(imageSize)) {
+     report.error = "Not enough space for image";
+     http.end();
+     return false;
+   }
+
+   // Heap-allocated: the decoder window is too large for the loop task stack
+   HeatshrinkDecoder* decoder = nullptr;
+   if (report.compressed) {
+     decoder = new (std::nothrow) HeatshrinkDecoder;
+     if (!decoder) {
+       fail(report, "Out of memory");
+       http.end();
+       return false;
+     }
+     decoder->begin(writeImage, &report);
+   }
+
+   uint8_t buffer[OTA_FETCH_BUFFER];
+   WiFiClient* stream = http.getStreamPtr();
+   unsigned long lastData = millis();
+   bool ok = true;
+
+   while (total == 0 || report.downloadedBytes < total) {
+     size_t available = stream->available();
+     if (available == 0) {
+       if (!http.connected() && total == 0) break; // Chunked/unknown length: EOF
+       if (millis() - lastData > OTA_READ_TIMEOUT) {
+         ok = fail(report, "Download timed out");
+         break;
+       }
+       delay(1);
+       continue;
+     }
+
+     size_t length = stream->readBytes(buffer, min(available, sizeof(buffer)));
+     lastData = millis();
+     report.downloadedBytes += length;
+
+     bool written = decoder ? decoder->feed(buffer, length) : writeImage(buffer, length, &report);
+     if (!written) {
+       ok = fail(report, nullptr);
+       break;
+     }
+     if (progress) progress(report.downloadedBytes, total);
+   }
+
+   if (ok && decoder && !decoder->finish()) {
+     ok = fail(report, nullptr);
+   }
+   delete decoder;
+   http.end();
+
+   if (ok && report.imageBytes == 0) {
+     ok = fail(report, "Empty image");
+   }
+   if (ok && !Update.end(true)) {
+     ok = false;
+     report.error = "Image verification failed";
+   }
+
+   report.elapsedMs = millis() - start;
+   report.success = ok;
+   return ok;
+}
@@ -0,0 +1,33 @@
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <Arduino.h>
+
+// Pull-based OTA with streaming decompression
+//
+// The image is fetched over HTTP(S) and written to the update partition as it
+// arrives. URLs ending in OTA_COMPRESSED_SUFFIX are heatshrink-compressed
+// (`heatshrink -e -w 11 -l 4 firmware.bin firmware.bin.hs`) and are decoded
+// on the fly, so neither the compressed nor the plain image is ever buffered
+// in full. Anything else is written as-is.
+
+#define OTA_COMPRESSED_SUFFIX ".hs"
+#define OTA_FETCH_BUFFER      1024   // Bytes read from the socket per chunk
+#define OTA_READ_TIMEOUT      10000  // ms without data before giving up
+
+struct OtaReport {
+   bool success;
+   bool compressed;
+   const char* error;
+   uint32_t downloadedBytes;   // Bytes received over the network
+   uint32_t imageBytes;        // Bytes written to flash
+   unsigned long elapsedMs;
+};
+
+// Called as data arrives; total is the download size or 0 if unknown
+typedef void (*OtaProgressHandler)(uint32_t done, uint32_t total);
+
+// Download, decompress and stage an image; the caller decides when to restart
+bool runUrlOta(const String& url, OtaProgressHandler progress, OtaReport& report);
+
+#endif
@@ -0,0 +1,294 @@
+#include "page_canvas.h"
+
+#include <stdlib.h>
+
+void PageCanvas::attach(uint8_t* buffer, int16_t width, int16_t height) {
+   frame = buffer;
+   this->width = width;
+   this->height = height;
+   for (int i = 0; i < PAGE_CIRCLE_CACHE; i++) {
+     cache[i].radius = -1;
+   }
+   nextCache = 0;
+}
+
+inline void PageCanvas::put(int offset, uint8_t mask, uint8_t color) {
+   switch (color) {
+     case PAGE_WHITE:   frame[offset] |= mask; break;
+     case PAGE_BLACK:   frame[offset] &= ~mask; break;
+     case PAGE_INVERSE: frame[offset] ^= mask; break;
+   }
+}
+
+void PageCanvas::pixel(int16_t x, int16_t y, uint8_t color) {
+   if (inside(x, y)) put((y >> 3) * width + x, 1 << (y & 7), color);
+}
+
+void PageCanvas::hline(int16_t x, int16_t y, int16_t w, uint8_t color) {
+   if (y < 0 || y >= height) return;
+   int left = x < 0 ? 0 : x;
+   int right = (int)x + w > width ? width : (int)x + w;
+   if (left >= right) return;
+
+   // One page, one mask for the whole span
+   uint8_t mask = 1 << (y & 7);
+   uint8_t* p = frame + (y >> 3) * width + left;
+   uint8_t* end = p + (right - left);
+   switch (color) {
+     case PAGE_WHITE:   while (p < end) *p++ |= mask; break;
+     case PAGE_BLACK:   mask = ~mask; while (p < end) *p++ &= mask; break;
+     case PAGE_INVERSE: while (p < end) *p++ ^= mask; break;
+   }
+}
+
+void PageCanvas::vline(int16_t x, int16_t y, int16_t h, uint8_t color) {
+   if (x < 0 || x >= width) return;
+   int top = y < 0 ? 0 : y;
+   int bottom = (int)y + h > height ? height : (int)y + h;
+   if (top >= bottom) return;
+
+   // Partial masks in the first and last page, whole bytes in between
+   int offset = (top >> 3) * width + x;
+   int last = ((bottom - 1) >> 3) * width + x;
+   uint8_t head = 0xFF << (top & 7);
+   uint8_t tail = 0xFF >> (7 - ((bottom - 1) & 7));
+   if (offset == last) {
+     put(offset, head & tail, color);
+     return;
+   }
+   put(offset, head, color);
+   for (offset += width; offset < last; offset += width) {
+     switch (color) {
+       case PAGE_WHITE:   frame[offset] = 0xFF; break;
+       case PAGE_BLACK:   frame[offset] = 0x00; break;
+       case PAGE_INVERSE: frame[offset] ^= 0xFF; break;
+     }
+   }
+   put(last, tail, color);
+}
+
+void PageCanvas::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t color) {
+   // Clip once, in int so x + w cannot wrap
+   int left = x < 0 ? 0 : x;
+   int right = (int)x + w > width ? width : (int)x + w;
+   int top = y < 0 ? 0 : y;
+   int bottom = (int)y + h > height ? height : (int)y + h;
+   if (left >= right || top >= bottom) return;
+
+   int lastPage = (bottom - 1) >> 3;
+   for (int page = top >> 3; page <= lastPage; page++) {
+     uint8_t mask = 0xFF;
+     if (page == top >> 3) mask &= 0xFF << (top & 7);
+     if (page == lastPage) mask &= 0xFF >> (7 - ((bottom - 1) & 7));
+     uint8_t* p = frame + page * width + left;
+     uint8_t* end = frame + page * width + right;
+     switch (color) {
+       case PAGE_WHITE:   while (p < end) *p++ |= mask; break;
+       case PAGE_BLACK:   mask = ~mask; while (p < end) *p++ &= mask; break;
+       case PAGE_INVERSE: while (p < end) *p++ ^= mask; break;
+     }
+   }
+}
+
+void PageCanvas::line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t color) {
+   // Straight lines as in Adafruit_GFX::drawLine, the rest as writeLine
+   if (x0 == x1) {
+     if (y0 > y1) { int16_t t = y0; y0 = y1; y1 = t; }
+     vline(x0, y0, y1 - y0 + 1, color);
+     return;
+   }
+   if (y0 == y1) {
+     if (x0 > x1) { int16_t t = x0; x0 = x1; x1 = t; }
+     hline(x0, y0, x1 - x0 + 1, color);
+     return;
+   }
+
+   bool steep = abs(y1 - y0) > abs(x1 - x0);
+   if (steep) {
+     int16_t t = x0; x0 = y0; y0 = t;
+     t = x1; x1 = y1; y1 = t;
+   }
+   if (x0 > x1) {
+     int16_t t = x0; x0 = x1; x1 = t;
+     t = y0; y0 = y1; y1 = t;
+   }
+   int16_t dx = x1 - x0;
+   int16_t dy = abs(y1 - y0);
+   int16_t err = dx / 2;
+   int16_t ystep = y0 < y1 ? 1 : -1;
+
+   // An end off screen: same walk, clipped per pixel
+   bool clipped = steep ? !inside(y0, x0) || !inside(y1, x1) : !inside(x0, y0) || !inside(x1, y1);
+   if (clipped) {
+     for (; x0 <= x1; x0++) {
+       if (steep) pixel(y0, x0, color); else pixel(x0, y0, color);
+       err -= dy;
+       if (err < 0) {
+         y0 += ystep;
+         err += dx;
+       }
+     }
+     return;
+   }
+
+   if (steep) {
+     // Walking down a column: gather the bits of one byte, write it when the
+     // walk leaves it (next column, next page or the end)
+     int offset = (x0 >> 3) * width + y0;
+     uint8_t mask = 1 << (x0 & 7);
+     uint8_t bits = 0;
+     for (; x0 <= x1; x0++) {
+       bits |= mask;
+       err -= dy;
+       bool sideStep = err < 0;
+       if (sideStep) err += dx;
+       mask <<= 1;
+       if (sideStep || mask == 0 || x0 == x1) {
+         put(offset, bits, color);
+         bits = 0;
+         if (sideStep) offset += ystep;
+         if (mask == 0) {
+           mask = 1;
+           offset += width;
+         }
+       }
+     }
+   } else {
+     // Walking along a row: one byte per pixel, the mask moves on a y step
+     int offset = (y0 >> 3) * width + x0;
+     uint8_t mask = 1 << (y0 & 7);
+     for (; x0 <= x1; x0++) {
+       put(offset++, mask, color);
+       err -= dy;
+       if (err < 0) {
+         err += dx;
+         if (ystep > 0) {
+           mask <<= 1;
+           if (mask == 0) {
+             mask = 1;
+             offset += width;
+           }
+         } else {
+           mask >>= 1;
+           if (mask == 0) {
+             mask = 0x80;
+             offset -= width;
+           }
+         }
+       }
+     }
+   }
+}
+
+void PageCanvas::circle(int16_t x0, int16_t y0, int16_t r, uint8_t color) {
+   // Midpoint walk of Adafruit_GFX::drawCircle, one octant mirrored eight ways
+   int16_t f = 1 - r;
+   int16_t ddFx = 1;
+   int16_t ddFy = -2 * r;
+   int16_t x = 0;
+   int16_t y = r;
+
+   pixel(x0, y0 + r, color);
+   pixel(x0, y0 - r, color);
+   pixel(x0 + r, y0, color);
+   pixel(x0 - r, y0, color);
+   while (x < y) {
+     if (f >= 0) {
+       y--;
+       ddFy += 2;
+       f += ddFy;
+     }
+     x++;
+     ddFx += 2;
+     f += ddFx;
+     pixel(x0 + x, y0 + y, color);
+     pixel(x0 - x, y0 + y, color);
+     pixel(x0 + x, y0 - y, color);
+     pixel(x0 - x, y0 - y, color);
+     pixel(x0 + y, y0 + x, color);
+     pixel(x0 - y, y0 + x, color);
+     pixel(x0 + y, y0 - x, color);
+     pixel(x0 - y, y0 - x, color);
+   }
+}
+
+const PageCanvas::CircleSpans& PageCanvas::spans(int16_t r) {
+   for (int i = 0; i < PAGE_CIRCLE_CACHE; i++) {
+     if (cache[i].radius == r) return cache[i];
+   }
+
+   // The columns Adafruit_GFX::fillCircleHelper draws, each as its longest vline
+   CircleSpans& s = cache[nextCache];
+   nextCache = (nextCache + 1) % PAGE_CIRCLE_CACHE;
+   s.radius = r;
+   for (int i = 0; i <= r; i++) s.half[i] = 0xFF;      // Column not drawn
+   s.half[0] = r;
+   int16_t f = 1 - r;
+   int16_t ddFx = 1;
+   int16_t ddFy = -2 * r;
+   int16_t x = 0;
+   int16_t y = r;
+   int16_t px = x;
+   int16_t py = y;
+   while (x < y) {
+     if (f >= 0) {
+       y--;
+       ddFy += 2;
+       f += ddFy;
+     }
+     x++;
+     ddFx += 2;
+     f += ddFx;
+     if (x < y + 1 && (s.half[x] == 0xFF || s.half[x] < y)) s.half[x] = y;
+     if (y != py) {
+       if (s.half[py] == 0xFF || s.half[py] < px) s.half[py] = px;
+       py = y;
+     }
+     px = x;
+   }
+   return s;
+}
+
+void PageCanvas::fillCircle(int16_t x0, int16_t y0, int16_t r, uint8_t color) {
+   if (r < 0) return;
+   vline(x0, y0 - r, 2 * r + 1, color);
+   if (r > PAGE_CIRCLE_MAX_RADIUS) {
+     // Larger than the panel, not worth a cache entry: fillCircleHelper as is
+     int16_t f = 1 - r;
+     int16_t ddFx = 1;
+     int16_t ddFy = -2 * r;
+     int16_t x = 0;
+     int16_t y = r;
+     int16_t px = x;
+     int16_t py = y;
+     while (x < y) {
+       if (f >= 0) {
+         y--;
+         ddFy += 2;
+         f += ddFy;
+       }
+       x++;
+       ddFx += 2;
+       f += ddFx;
+       if (x < y + 1) {
+         vline(x0 + x, y0 - y, 2 * y + 1, color);
+         vline(x0 - x, y0 - y, 2 * y + 1, color);
+       }
+       if (y != py) {
+         vline(x0 + py, y0 - px, 2 * px + 1, color);
+         vline(x0 - py, y0 - px, 2 * px + 1, color);
+         py = y;
+       }
+       px = x;
+     }
+     return;
+   }
+
+   const CircleSpans& s = spans(r);
+   for (int16_t dx = 1; dx <= r; dx++) {
+     uint8_t half = s.half[dx];
+     if (half == 0xFF) continue;
+     vline(x0 + dx, y0 - half, 2 * half + 1, color);
+     vline(x0 - dx, y0 - half, 2 * half + 1, color);
+   }
+}
@@ -0,0 +1,67 @@
+#ifndef PAGE_CANVAS_H
+#define PAGE_CANVAS_H
+
+#include <stdint.h>
+
+// Drawing primitives on the SSD1306 page layout
+//
+// The SSD1306 frame is WIDTH bytes per page, each byte a column of 8 pixels
+// with the LSB on top. Adafruit_GFX reaches it one drawPixel() at a time for
+// every sloped line and circle: a virtual call, a rotation switch, bounds
+// checks and a read-modify-write per pixel. These primitives clip once per
+// shape and then write bytes directly:
+//   hline/fillRect  one mask per page, OR'd across the span
+//   vline           partial masks at both ends, whole 0xFF/0x00 bytes between
+//   line            Bresenham stepping a byte index and bit mask; steep lines
+//                   collect the bits of each byte and write it once
+//   circle          midpoint octant mirrored into direct byte writes
+//   fillCircle      per-column half heights, cached per radius, drawn as vlines
+// Shapes produce exactly the pixels of the Adafruit_GFX 1.12 algorithms
+// (writeLine, drawCircle, fillCircle), so frame CRCs do not change.
+//
+// Colours are PAGE_BLACK, PAGE_WHITE and PAGE_INVERSE (SSD1306_* values).
+// PAGE_INVERSE gives the GFX result too: spans, lines and filled circles
+// touch each pixel once, and circle outlines repeat GFX's double writes on
+// the axes and diagonals.
+//
+// No Arduino dependencies: tools/draw_bench.cpp checks these against the GFX
+// algorithms pixel for pixel and compares their throughput.
+
+#define PAGE_BLACK               0
+#define PAGE_WHITE               1
+#define PAGE_INVERSE             2
+#define PAGE_CIRCLE_MAX_RADIUS   63     // Larger filled circles are walked without the cache
+#define PAGE_CIRCLE_CACHE        4      // Radii with cached spans (Mode 5 uses two)
+
+class PageCanvas {
+public:
+   // buffer holds width * height / 8 bytes, height a multiple of 8
+   void attach(uint8_t* buffer, int16_t width, int16_t height);
+   bool attached() const { return frame != nullptr; }
+
+   void pixel(int16_t x, int16_t y, uint8_t color);
+   void hline(int16_t x, int16_t y, int16_t w, uint8_t color);
+   void vline(int16_t x, int16_t y, int16_t h, uint8_t color);
+   void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t color);
+   void line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t color);
+   void circle(int16_t x0, int16_t y0, int16_t r, uint8_t color);
+   void fillCircle(int16_t x0, int16_t y0, int16_t r, uint8_t color);
+
+private:
+   struct CircleSpans {
+     int16_t radius;
+     uint8_t half[PAGE_CIRCLE_MAX_RADIUS + 1];   // Half height of the column dx from the centre
+   };
+
+   bool inside(int16_t x, int16_t y) const { return x >= 0 && y >= 0 && x < width && y < height; }
+   void put(int offset, uint8_t mask, uint8_t color);
+   const CircleSpans& spans(int16_t r);
+
+   uint8_t* frame = nullptr;
+   int16_t width = 0;
+   int16_t height = 0;
+   CircleSpans cache[PAGE_CIRCLE_CACHE];
+   uint8_t nextCache = 0;
+};
+
+#endif
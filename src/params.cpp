@@ -0,0 +1,185 @@
+#include "params.h"
+#include "modes.h"
+#include "baro_altitude.h"
+
+ParameterRegistry params;
+
+static_assert(MODE_COUNT <= PARAMS_MAX_MODES, "Raise PARAMS_MAX_MODES for more modes");
+
+// Order must match ParamId
+static const ParamDef definitions[PARAM_COUNT] = {
+   { "telemetry_period_ms", PARAM_INT,   100,  60000, 1000 },
+   { "alert_threshold_hpa", PARAM_FLOAT, 0.5,  100,   10.0 },
+   { "touch_threshold",     PARAM_INT,   1000, 200000, touchThreshold },
+   { "microg_threshold",    PARAM_INT,   100,  100000, 15000 },
+   { "default_mode",        PARAM_INT,   0,    MODE_COUNT - 1, 0 },
+   { "board_id",            PARAM_INT,   -1,   9999,  -1 },
+   { "telemetry_max_period_ms", PARAM_INT, 100, 600000, 10000 },
+   { "rate_control",        PARAM_INT,   0,    1,     1 },
+   { "mirror_period_ms",    PARAM_INT,   0,    60000, 0 },
+   { "qnh_hpa",             PARAM_FLOAT, 850,  1100,  BARO_QNH_DEFAULT },
+   { "telemetry_format",    PARAM_INT,   0,    1,     0 },
+};
+
+// modeN_interval_ms, named and defaulted from the mode registry
+static char intervalNames[PARAMS_MAX_MODES][20];
+static ParamDef intervalDefinitions[PARAMS_MAX_MODES];
+
+static bool defineIntervals() {
+   for (int mode = 0; mode < MODE_COUNT; mode++) {
+     snprintf(intervalNames[mode], sizeof(intervalNames[mode]), "mode%d_interval_ms", mode);
+     intervalDefinitions[mode] = { intervalNames[mode], PARAM_INT, 10, 10000,
+                                   (float)OperationalModes::defaultUpdateInterval(mode) };
+   }
+   return true;
+}
+
+static const bool intervalsDefined = defineIntervals();
+
+// Version 1 layout: the six mode intervals sat between default_mode and board_id
+static const int version1Ids[] = {
+   PARAM_TELEMETRY_PERIOD, PARAM_ALERT_THRESHOLD, PARAM_TOUCH_THRESHOLD, PARAM_MICROG_THRESHOLD,
+   PARAM_DEFAULT_MODE, PARAM_MODE_INTERVAL + 0, PARAM_MODE_INTERVAL + 1, PARAM_MODE_INTERVAL + 2,
+   PARAM_MODE_INTERVAL + 3, PARAM_MODE_INTERVAL + 4, PARAM_MODE_INTERVAL + 5, PARAM_BOARD_ID,
+   PARAM_TELEMETRY_MAX_PERIOD, PARAM_RATE_CONTROL, PARAM_MIRROR_PERIOD, PARAM_QNH, PARAM_TELEMETRY_FORMAT,
+};
+static const int version1Count = sizeof(version1Ids) / sizeof(version1Ids[0]);
+static_assert(version1Count <= PARAM_COUNT + PARAMS_MAX_MODES, "Blob too small to read a version 1 blob");
+
+// Read a {version, count, values[count]} blob; -1 if missing or malformed
+template <typename Blob>
+static int readBlob(Preferences& prefs, const char* key, Blob& blob) {
+   size_t header = offsetof(Blob, values);
+   size_t length = prefs.getBytesLength(key);
+   bool valid = length >= header && length <= sizeof(blob) &&
+                prefs.getBytes(key, &blob, length) == length &&
+                length == header + blob.count * sizeof(ParamValue);
+   return valid ? blob.count : -1;
+}
+
+int ParameterRegistry::count() {
+   return PARAM_COUNT + MODE_COUNT;
+}
+
+void ParameterRegistry::begin(Preferences& prefs) {
+   store = &prefs;
+   for (int id = 0; id < count(); id++) {
+     storeValue(id, definition(id).defaultValue);
+   }
+
+   // A blob from older firmware holds a prefix of the list; the rest keep defaults
+   Blob blob;
+   int stored = readBlob(prefs, PARAMS_KEY, blob);
+   bool loaded = stored >= 0 && blob.version == PARAMS_VERSION && stored <= PARAM_COUNT;
+   bool migrated = stored >= 0 && blob.version == 1 && stored <= version1Count;
+
+   if (loaded) {
+     for (int id = 0; id < stored; id++) {
+       loadValue(id, blob.values[id]);
+     }
+   } else if (migrated) {
+     // Rewritten in the current layout at the next service()
+     for (int n = 0; n < stored; n++) {
+       if (version1Ids[n] < count()) loadValue(version1Ids[n], blob.values[n]);
+     }
+     dirty = intervalsDirty = true;
+     lastChange = millis();
+   } else {
+     // Migrate the default mode stored by older firmware
+     storeValue(PARAM_DEFAULT_MODE, prefs.getInt("defMode", 0));
+   }
+
+   // Intervals by mode number; modes registered since the blob was written keep defaults
+   stored = readBlob(prefs, PARAMS_INTERVALS_KEY, blob);
+   if (!migrated && stored >= 0 && blob.version == PARAMS_INTERVALS_VERSION && stored <= PARAMS_MAX_MODES) {
+     for (int mode = 0; mode < stored && mode < MODE_COUNT; mode++) {
+       loadValue(PARAM_MODE_INTERVAL + mode, blob.values[mode]);
+     }
+   }
+
+   Serial.println(loaded ? "Parameters loaded from flash" :
+                  migrated ? "Parameters migrated from version 1" : "Parameters set to defaults");
+}
+
+int ParameterRegistry::find(const char* name) const {
+   for (int id = 0; id < count(); id++) {
+     if (strcmp(definition(id).name, name) == 0) return id;
+   }
+   return -1;
+}
+
+const ParamDef& ParameterRegistry::definition(int id) const {
+   return id < PARAM_COUNT ? definitions[id] : intervalDefinitions[id - PARAM_MODE_INTERVAL];
+}
+
+String ParameterRegistry::format(int id) const {
+   if (definition(id).type == PARAM_INT) {
+     return String(values[id].i);
+   }
+   return String(values[id].f, 2);
+}
+
+bool ParameterRegistry::set(int id, float value) {
+   if (id < 0 || id >= count()) return false;
+   const ParamDef& def = definition(id);
+   if (!(value >= def.minValue && value <= def.maxValue)) return false;   // NaN fails too
+
+   storeValue(id, value);
+   if (id < PARAM_COUNT) dirty = true;
+   else intervalsDirty = true;
+   lastChange = millis();
+
+   if (onChange) onChange(id);
+   return true;
+}
+
+bool ParameterRegistry::parse(int id, const char* text, float& value) const {
+   if (id < 0 || id >= count()) return false;
+   char* end;
+   value = strtof(text, &end);
+   if (end == text) return false;
+   while (isspace((unsigned char)*end)) end++;
+   if (*end != '\0' || !isfinite(value)) return false;
+   return definition(id).type == PARAM_FLOAT || value == floorf(value);
+}
+
+void ParameterRegistry::service() {
+   if (pending() && millis() - lastChange >= PARAMS_COMMIT_DELAY) {
+     commit();
+   }
+}
+
+void ParameterRegistry::commit() {
+   if (!pending() || !store) return;
+
+   if (dirty) writeBlob(PARAMS_KEY, PARAMS_VERSION, values, PARAM_COUNT);
+   if (intervalsDirty) writeBlob(PARAMS_INTERVALS_KEY, PARAMS_INTERVALS_VERSION, values + PARAM_MODE_INTERVAL, MODE_COUNT);
+
+   dirty = intervalsDirty = false;
+   writeCount++;
+}
+
+void ParameterRegistry::writeBlob(const char* key, uint16_t version, const ParamValue* from, int count) {
+   Blob blob;
+   blob.version = version;
+   blob.count = count;
+   memcpy(blob.values, from, count * sizeof(ParamValue));
+   store->putBytes(key, &blob, offsetof(Blob, values) + count * sizeof(ParamValue));
+}
+
+void ParameterRegistry::storeValue(int id, float value) {
+   if (definition(id).type == PARAM_INT) {
+     values[id].i = (int32_t)lroundf(value);
+   } else {
+     values[id].f = value;
+   }
+}
+
+// Keep a stored value only if it is inside the current range
+void ParameterRegistry::loadValue(int id, ParamValue value) {
+   const ParamDef& def = definition(id);
+   float number = (def.type == PARAM_INT) ? (float)value.i : value.f;
+   if (number >= def.minValue && number <= def.maxValue) {
+     values[id] = value;
+   }
+}
@@ -0,0 +1,121 @@
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Runtime parameter registry
+//
+// Tuning constants live in a RAM cache so hot paths read them with a single
+// array access. Telecommands change them through set(); changes are validated
+// against the declared range and persisted as versioned blobs in
+// Preferences. Writes are debounced: a burst of SET commands costs a single
+// NVS write once the values have been stable for PARAMS_COMMIT_DELAY.
+//
+// The per-mode update intervals (modeN_interval_ms) are not in ParamId's
+// list: they are indexed by mode number from PARAM_MODE_INTERVAL and kept in
+// a blob of their own, so registering a mode appends an interval instead of
+// shifting the parameters stored after it.
+
+#define PARAMS_VERSION       2     // 1 had the mode intervals inside the list
+#define PARAMS_KEY           "params"
+#define PARAMS_INTERVALS_VERSION 1
+#define PARAMS_INTERVALS_KEY "intervals"
+#define PARAMS_MAX_MODES     8     // Interval slots, at least MODE_COUNT
+#define PARAMS_COMMIT_DELAY  5000  // ms without changes before writing flash
+
+enum ParamId {
+   PARAM_TELEMETRY_PERIOD,   // ms between telemetry packets
+   PARAM_ALERT_THRESHOLD,    // hPa pressure drop for the cat safety alert
+   PARAM_TOUCH_THRESHOLD,    // Touch interrupt threshold
+   PARAM_MICROG_THRESHOLD,   // Touch differential that counts as free fall
+   PARAM_DEFAULT_MODE,       // Mode entered after boot
+   PARAM_BOARD_ID,           // MQTT topic board ID; -1 = derived from the eFuse MAC
+   PARAM_TELEMETRY_MAX_PERIOD, // Slowest telemetry period the rate control backs off to (ms)
+   PARAM_RATE_CONTROL,       // 1 = adapt telemetry rate and content to the link
+   PARAM_MIRROR_PERIOD,      // ms between display mirror frames; 0 = off
+   PARAM_QNH,                // hPa sea-level pressure the altitude is referenced to
+   PARAM_TELEMETRY_FORMAT,   // 0 = JSON on tm, 1 = packed binary on tm/bin (telemetry_schema.h)
+   // New parameters go at the end so blobs from older firmware still load
+   PARAM_COUNT,
+   PARAM_MODE_INTERVAL = PARAM_COUNT  // + mode number: update interval (ms)
+};
+
+enum ParamType {
+   PARAM_INT,
+   PARAM_FLOAT
+};
+
+struct ParamDef {
+   const char* name;
+   ParamType type;
+   float minValue;
+   float maxValue;
+   float defaultValue;
+};
+
+union ParamValue {
+   int32_t i;
+   float f;
+};
+
+class ParameterRegistry {
+public:
+   // Load the stored blob (falls back to defaults on version or range mismatch)
+   void begin(Preferences& prefs);
+
+   int32_t getInt(ParamId id) const { return values[id].i; }
+   float getFloat(ParamId id) const { return values[id].f; }
+   int32_t modeInterval(int mode) const { return values[PARAM_MODE_INTERVAL + mode].i; }
+
+   // Number of ids: the ParamId list plus one interval per registered mode
+   static int count();
+
+   // Look up a parameter by name; returns -1 if unknown
+   int find(const char* name) const;
+   const ParamDef& definition(int id) const;
+   String format(int id) const;
+
+   // Validate and apply a new value; false if out of range
+   bool set(int id, float value);
+
+   // Read a telecommand value for id: false unless the whole text is a finite
+   // number, and a whole number for integer parameters (range is set()'s job)
+   bool parse(int id, const char* text, float& value) const;
+
+   // Called after a value changed (to reattach interrupts, retune modes, ...)
+   void setChangeHandler(void (*handler)(int id)) { onChange = handler; }
+
+   // Call from loop(); writes the blob once changes have settled
+   void service();
+
+   // Write pending changes now (before a restart)
+   void commit();
+
+   uint32_t flashWrites() const { return writeCount; }
+   bool pending() const { return dirty || intervalsDirty; }
+
+private:
+   // Stored as the header plus count values; sized for the largest layout
+   struct Blob {
+     uint16_t version;
+     uint16_t count;
+     ParamValue values[PARAM_COUNT + PARAMS_MAX_MODES];
+   };
+
+   Preferences* store = nullptr;
+   ParamValue values[PARAM_COUNT + PARAMS_MAX_MODES];
+   bool dirty = false;            // ParamId list changed
+   bool intervalsDirty = false;   // Mode intervals changed
+   unsigned long lastChange = 0;
+   uint32_t writeCount = 0;
+   void (*onChange)(int id) = nullptr;
+
+   void storeValue(int id, float value);
+   void loadValue(int id, ParamValue value);
+   void writeBlob(const char* key, uint16_t version, const ParamValue* from, int count);
+};
+
+extern ParameterRegistry params;
+
+#endif
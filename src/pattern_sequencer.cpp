@@ -0,0 +1,101 @@
+#include "pattern_sequencer.h"
+
+// Boot chime: rising three notes with the LED on, as before
+static const PatternStep bootSteps[] = {
+   { 1000, true, 100 }, { 0, true, 100 },
+   { 1500, true, 100 }, { 0, true, 100 },
+   { 2000, true, 100 }
+};
+const Pattern patternBoot = { "boot", PATTERN_PRIORITY_UI, 5, bootSteps };
+
+static const PatternStep modeChangeSteps[] = {
+   { 2000, false, 100 }, { 0, false, 100 }
+};
+const Pattern patternModeChange = { "mode_change", PATTERN_PRIORITY_UI, 2, modeChangeSteps };
+
+static const PatternStep warningSteps[] = {
+   { 1800, true, 150 }, { 0, false, 150 },
+   { 1800, true, 150 }, { 0, false, 150 }
+};
+const Pattern patternWarning = { "warning", PATTERN_PRIORITY_ALERT, 4, warningSteps };
+
+static const PatternStep freeFallSteps[] = {
+   { 3000, true, 200 }, { 0, false, 100 }
+};
+const Pattern patternFreeFall = { "free_fall", PATTERN_PRIORITY_ALERT, 2, freeFallSteps };
+
+// Alternating alarm tones of the former mode 2 alert, LED flashing with them
+static const PatternStep catAlarmSteps[] = {
+   { 2500, true, 150 }, { 0, false, 150 },
+   { 2000, true, 150 }, { 0, false, 150 },
+   { 2500, true, 150 }, { 0, false, 150 },
+   { 1800, true, 150 }, { 0, false, 150 }
+};
+const Pattern patternCatAlarm = { "cat_alarm", PATTERN_PRIORITY_ALARM, 8, catAlarmSteps };
+
+static const PatternStep powerAlarmSteps[] = {
+   { 2500, true, 300 }, { 0, false, 700 }
+};
+const Pattern patternPowerAlarm = { "power_alarm", PATTERN_PRIORITY_ALARM, 2, powerAlarmSteps };
+
+void PatternSequencer::begin(void (*tone)(uint16_t hz), void (*led)(bool on)) {
+   toneOut = tone;
+   ledOut = led;
+   current = nullptr;
+   toneNow = 0;
+   ledNow = false;
+   if (toneOut) toneOut(0);
+   if (ledOut) ledOut(false);
+}
+
+bool PatternSequencer::play(const Pattern& pattern, uint8_t repeats, int64_t nowUs) {
+   // A pattern without any duration would never let advance() return
+   uint32_t total = 0;
+   for (int i = 0; i < pattern.count; i++) total += pattern.steps[i].ms;
+   if (total == 0 || (current && pattern.priority < current->priority)) {
+     refusedCount++;
+     return false;
+   }
+   if (current && pattern.priority > current->priority) preemptedCount++;
+
+   current = &pattern;
+   step = 0;
+   endless = repeats == 0;
+   repeatsLeft = repeats;
+   stepEnd = nowUs + (int64_t)pattern.steps[0].ms * 1000;
+   playedCount++;
+   output(pattern.steps[0].toneHz, pattern.steps[0].led);
+   return true;
+}
+
+void PatternSequencer::stop(const Pattern& pattern, int64_t) {
+   if (current == &pattern) finish();
+}
+
+void PatternSequencer::advance(int64_t nowUs) {
+   if (!current) return;
+   // Catching up after a late callback only sets the outputs of the step reached
+   while (nowUs >= stepEnd) {
+     if (++step == current->count) {
+       step = 0;
+       if (!endless && --repeatsLeft == 0) {
+         finish();
+         return;
+       }
+     }
+     stepEnd += (int64_t)current->steps[step].ms * 1000;
+   }
+   output(current->steps[step].toneHz, current->steps[step].led);
+}
+
+void PatternSequencer::finish() {
+   current = nullptr;
+   output(0, false);
+}
+
+void PatternSequencer::output(uint16_t toneHz, bool led) {
+   if (toneHz != toneNow && toneOut) toneOut(toneHz);
+   if (led != ledNow && ledOut) ledOut(led);
+   toneNow = toneHz;
+   ledNow = led;
+}
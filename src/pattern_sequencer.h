@@ -0,0 +1,99 @@
+#ifndef PATTERN_SEQUENCER_H
+#define PATTERN_SEQUENCER_H
+
+#include <stdint.h>
+
+// Buzzer and LED patterns played in the background
+//
+// A pattern is a table of steps (tone frequency or silence, LED on or off,
+// duration); play() starts it and returns at once, the steps are advanced by
+// a timer. Nothing that wants a beep waits for it any more.
+//
+// One pattern plays at a time. A pattern of higher priority preempts the one
+// playing, which is dropped (an alarm cuts the mode-change beeps short);
+// one of the same priority replaces it; one of lower priority is refused
+// while the other plays. A pattern repeats the requested number of times, 0
+// until stop().
+//
+// Timing: due() is the time of the next step boundary and the caller arms
+// its timer for it. advance() moves through every boundary up to now; each
+// boundary is scheduled from the previous boundary, not from when the timer
+// fired, so a late callback does not stretch the pattern. Outputs are set
+// through the callbacks given to begin(), only when they change.
+//
+// No Arduino dependencies: src/feedback_player.cpp drives it from an
+// esp_timer and the LEDC peripheral, tools/pattern_sim.cpp checks the timing
+// against a fake timer with callback jitter.
+
+#define PATTERN_IDLE          -1
+
+enum PatternPriority {
+   PATTERN_PRIORITY_UI,       // Boot chime, mode changes
+   PATTERN_PRIORITY_ALERT,    // Warnings
+   PATTERN_PRIORITY_ALARM     // Critical alerts
+};
+
+struct PatternStep {
+   uint16_t toneHz;           // 0 silence
+   bool led;
+   uint16_t ms;
+};
+
+struct Pattern {
+   const char* name;
+   uint8_t priority;
+   uint8_t count;
+   const PatternStep* steps;
+};
+
+class PatternSequencer {
+public:
+   void begin(void (*tone)(uint16_t hz), void (*led)(bool on));
+
+   // Start a pattern at nowUs, repeats times (0 until stopped). False when a
+   // pattern of higher priority is playing.
+   bool play(const Pattern& pattern, uint8_t repeats, int64_t nowUs);
+
+   // Stop the pattern if it is the one playing
+   void stop(const Pattern& pattern, int64_t nowUs);
+
+   // Move through every step boundary up to nowUs
+   void advance(int64_t nowUs);
+
+   // Next step boundary, PATTERN_IDLE when nothing plays
+   int64_t due() const { return current ? stepEnd : PATTERN_IDLE; }
+
+   bool playing(const Pattern& pattern) const { return current == &pattern; }
+   int priority() const { return current ? current->priority : PATTERN_IDLE; }
+
+   uint32_t played() const { return playedCount; }
+   uint32_t preempted() const { return preemptedCount; }
+   uint32_t refused() const { return refusedCount; }
+
+private:
+   void output(uint16_t toneHz, bool led);
+   void finish();
+
+   void (*toneOut)(uint16_t hz) = nullptr;
+   void (*ledOut)(bool on) = nullptr;
+   const Pattern* current = nullptr;
+   uint8_t step = 0;
+   uint8_t repeatsLeft = 0;    // 0 with endless
+   bool endless = false;
+   int64_t stepEnd = 0;
+   uint16_t toneNow = 0;
+   bool ledNow = false;
+   uint32_t playedCount = 0;
+   uint32_t preemptedCount = 0;
+   uint32_t refusedCount = 0;
+};
+
+// The board's patterns
+extern const Pattern patternBoot;
+extern const Pattern patternModeChange;     // One beep, repeated mode + 1 times
+extern const Pattern patternWarning;
+extern const Pattern patternFreeFall;
+extern const Pattern patternCatAlarm;
+extern const Pattern patternPowerAlarm;
+
+#endif
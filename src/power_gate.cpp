@@ -0,0 +1,59 @@
+#include "power_gate.h"
+
+PowerGate powerGate;
+
+void PowerGate::begin(uint32_t nowMs) {
+   powered = POWER_ALL;
+   current = -1;
+   lastAccount = nowMs;
+   transitionCount = 0;
+   for (int i = 0; i < POWER_MAX_MODES; i++) {
+     modes[i] = ModePower();
+   }
+}
+
+void PowerGate::account(uint32_t nowMs) {
+   uint32_t elapsed = nowMs - lastAccount;
+   lastAccount = nowMs;
+   if (current < 0) return;
+
+   ModePower& m = modes[current];
+   m.residentMs += elapsed;
+   for (int bit = 0; bit < POWER_PERIPHERALS; bit++) {
+     if (powered & (1 << bit)) m.onMs[bit] += elapsed;
+   }
+}
+
+uint8_t PowerGate::set(uint8_t target, uint32_t nowMs) {
+   account(nowMs);
+   uint8_t changed = (powered ^ target) & POWER_ALL;
+   powered = target & POWER_ALL;
+   for (int bit = 0; bit < POWER_PERIPHERALS; bit++) {
+     if (changed & (1 << bit)) transitionCount++;
+   }
+   return changed;
+}
+
+uint8_t PowerGate::enter(int mode, uint8_t needs, uint32_t nowMs) {
+   if (mode < 0 || mode >= POWER_MAX_MODES) return set(POWER_ALL, nowMs);
+   account(nowMs);
+   current = mode;
+   modes[mode].entries++;
+   return set(needs, nowMs);
+}
+
+uint8_t PowerGate::exit(uint32_t nowMs) {
+   // Time until the next entry (mode-change screen, beeps) belongs to no mode
+   account(nowMs);
+   current = -1;
+   return set(POWER_ALL, nowMs);
+}
+
+void PowerGate::busy(uint32_t micros) {
+   if (current >= 0) modes[current].busyUs += micros;
+}
+
+ModePower PowerGate::stats(int mode, uint32_t nowMs) {
+   account(nowMs);
+   return (mode >= 0 && mode < POWER_MAX_MODES) ? modes[mode] : ModePower();
+}
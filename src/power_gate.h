@@ -0,0 +1,81 @@
+#ifndef POWER_GATE_H
+#define POWER_GATE_H
+
+#include <stdint.h>
+
+// Per-mode peripheral power gating
+//
+// Each mode declares the peripherals it needs (the power trait in modes.h).
+// On entry everything it does not need is powered down or duty-cycled; on
+// exit the baseline (everything on) is restored, so the mode-change screen
+// and a mode without a declaration behave as before. enter() and exit()
+// return the peripherals whose state changed and the caller switches only
+// those:
+//   POWER_BME280     normal mode at x16 oversampling (8 conversions/s);
+//                    otherwise sleep with one forced x1 conversion every
+//                    POWER_BME_IDLE_MS for telemetry
+//   POWER_TOUCH_AUX  up, down and X pads sampled every STATS_TOUCH_MS;
+//                    otherwise every POWER_TOUCH_IDLE_MS. Right and left
+//                    switch modes and are always read.
+//   POWER_DISPLAY    full contrast; otherwise dimmed. Refresh follows the
+//                    mode's update interval already.
+//
+// The gate also measures, per mode, how long it was current, how much of that
+// the CPU spent on it (tick and sampling, reported by the caller through
+// busy()) and how long each peripheral was on. No Arduino dependencies:
+// tools/power_sim.cpp drives the state machine through mode sequences on the
+// host and checks the transitions and the accounting.
+
+#define POWER_BME280          0x01
+#define POWER_TOUCH_AUX       0x02
+#define POWER_DISPLAY         0x04
+#define POWER_NONE            0x00
+#define POWER_ALL             (POWER_BME280 | POWER_TOUCH_AUX | POWER_DISPLAY)
+#define POWER_PERIPHERALS     3
+
+#define POWER_MAX_MODES       8
+#define POWER_BME_IDLE_MS     1000     // Forced conversion period while gated
+#define POWER_TOUCH_IDLE_MS   1000     // Auxiliary pad period while gated
+
+struct ModePower {
+   uint32_t entries;
+   uint32_t residentMs;         // Time the mode was current
+   uint64_t busyUs;             // CPU time spent on it (32 bits wrap after 71.6 min)
+   uint32_t onMs[POWER_PERIPHERALS];   // Per peripheral bit, time it was on
+};
+
+class PowerGate {
+public:
+   // Boot: everything on, no mode current
+   void begin(uint32_t nowMs);
+
+   // Mode entry with its declared needs / exit back to the baseline.
+   // Both return the peripherals that changed state.
+   uint8_t enter(int mode, uint8_t needs, uint32_t nowMs);
+   uint8_t exit(uint32_t nowMs);
+
+   bool on(uint8_t peripheral) const { return (powered & peripheral) != 0; }
+   uint8_t state() const { return powered; }
+   int mode() const { return current; }
+   uint32_t transitions() const { return transitionCount; }
+
+   // CPU time spent on the current mode
+   void busy(uint32_t micros);
+
+   // Accounting of a mode up to nowMs (includes the current stay)
+   ModePower stats(int mode, uint32_t nowMs);
+
+private:
+   uint8_t set(uint8_t target, uint32_t nowMs);
+   void account(uint32_t nowMs);
+
+   uint8_t powered = POWER_ALL;
+   int current = -1;
+   uint32_t lastAccount = 0;
+   uint32_t transitionCount = 0;
+   ModePower modes[POWER_MAX_MODES] = {};
+};
+
+extern PowerGate powerGate;
+
+#endif
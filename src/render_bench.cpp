@@ -0,0 +1,163 @@
+#include "render_bench.h"
+#include "modes.h"
+#include "mem_health.h"
+
+#include <math.h>
+#include <rom/crc.h>
+
+RenderBench renderBench;
+
+static_assert(MODE_COUNT <= BENCH_MAX_MODES, "Raise BENCH_MAX_MODES");
+
+// Scripted input values
+#define BENCH_TOUCH_RELEASED 50
+#define BENCH_TOUCH_PRESSED  30     // Below the modes' press threshold, small touch differential
+#define BENCH_BATTERY        3.9
+#define BENCH_USB            5.0
+
+// Alternating one second presses: nothing, RIGHT, nothing, LEFT
+static int scriptRead(uint8_t pin, unsigned long time) {
+   unsigned long phase = (time / 1000) % 4;
+   if ((pin == TOUCH_RIGHT && phase == 1) || (pin == TOUCH_LEFT && phase == 3)) {
+     return BENCH_TOUCH_PRESSED;
+   }
+   return BENCH_TOUCH_RELEASED;
+}
+
+// Slow weather: 20 s pressure and 60 s temperature cycles, well clear of alert thresholds
+static float scriptSensor(TraceSensor channel, unsigned long time) {
+   switch (channel) {
+     case TRACE_SENSOR_PRESSURE:    return 1003.0f + 3.0f * sinf(time * (2.0f * PI / 20000.0f));
+     case TRACE_SENSOR_TEMPERATURE: return 22.5f + 1.5f * sinf(time * (2.0f * PI / 60000.0f));
+     default:                       return 45.0f;
+   }
+}
+
+static int32_t scriptStatus(TraceStatus channel, unsigned long) {
+   return channel == TRACE_STATUS_RSSI ? -58 : 1;
+}
+
+static const TraceScript benchScript = { scriptRead, scriptSensor, scriptStatus };
+
+bool RenderBench::run(uint32_t frames, Preferences& store) {
+   if (frames == 0 || frames > BENCH_FRAMES_MAX) return false;
+   if (!inputTrace.startScript(&benchScript)) return false;
+
+   // Mode 0 shows the voltages; the ephemeris window affects Mode 5's interpolation
+   float savedBattery = batteryVoltage;
+   float savedUsb = usbVoltage;
+   batteryVoltage = BENCH_BATTERY;
+   usbVoltage = BENCH_USB;
+   if (orbitValid) {
+     orbitValid = (orbitEphemeris.build(orbitPropagator, 0.0) == ORBIT_OK);
+   }
+
+   const size_t frameBytes = SCREEN_WIDTH * ((SCREEN_HEIGHT + 7) / 8);
+   uint32_t goldenFrames = store.getUInt("bench_n", 0);
+   unsigned long start = millis();
+   frameCount = frames;
+   resultCount = MODE_COUNT;
+   memHealth.startCapture();
+
+   for (int mode = 0; mode < MODE_COUNT; mode++) {
+     BenchResult& result = results[mode];
+     // Default interval, not the tuned one, so the CRCs do not depend on parameters
+     unsigned long interval = OperationalModes::defaultUpdateInterval(mode);
+     uint64_t totalMicros = 0;
+     uint32_t crc = 0;
+     result.maxMicros = 0;
+
+     MemScope memScope(MEM_MODES);
+     uint32_t allocStart = memHealth.allocations(MEM_MODES);
+     inputTrace.setScriptTime(0);
+     OperationalModes::enter(mode);
+     uint32_t drawStart = display.drawCalls();
+
+     for (uint32_t frame = 0; frame < frames; frame++) {
+       inputTrace.setScriptTime(frame * interval);
+       uint32_t tickStart = micros();
+       OperationalModes::render(mode);
+       uint32_t elapsed = micros() - tickStart;
+
+       totalMicros += elapsed;
+       if (elapsed > result.maxMicros) result.maxMicros = elapsed;
+       crc = crc32_le(crc, display.getBuffer(), frameBytes);
+       if (frame % BENCH_YIELD_EVERY == BENCH_YIELD_EVERY - 1) {
+         delay(1);
+       }
+     }
+
+     result.drawsPerFrame = (display.drawCalls() - drawStart) / frames;
+     OperationalModes::exit(mode);
+     result.allocs = memHealth.allocations(MEM_MODES) - allocStart;
+
+     result.nsPerFrame = (uint32_t)(totalMicros * 1000 / frames);
+     result.crc = crc;
+     char key[12];
+     snprintf(key, sizeof(key), "bench_crc%d", mode);
+     if (goldenFrames != frames || !store.isKey(key)) {
+       result.golden = BENCH_GOLDEN_NONE;
+     } else {
+       result.golden = store.getUInt(key) == crc ? BENCH_GOLDEN_MATCH : BENCH_GOLDEN_DIFFERS;
+     }
+   }
+
+   elapsedMs = millis() - start;
+   memHealth.stopCapture();
+   inputTrace.stop();
+   batteryVoltage = savedBattery;
+   usbVoltage = savedUsb;
+   return true;
+}
+
+bool RenderBench::saveGolden(Preferences& store) {
+   if (resultCount == 0) return false;
+   for (int mode = 0; mode < resultCount; mode++) {
+     char key[12];
+     snprintf(key, sizeof(key), "bench_crc%d", mode);
+     store.putUInt(key, results[mode].crc);
+     results[mode].golden = BENCH_GOLDEN_MATCH;
+   }
+   store.putUInt("bench_n", frameCount);
+   return true;
+}
+
+static const char* goldenName(BenchGolden golden) {
+   switch (golden) {
+     case BENCH_GOLDEN_MATCH:   return "match";
+     case BENCH_GOLDEN_DIFFERS: return "DIFFERS";
+     default:                   return "none";
+   }
+}
+
+void RenderBench::print(Print& out) const {
+   out.printf("Render benchmark: %lu frames per mode, %lu ms\n",
+              (unsigned long)frameCount, (unsigned long)elapsedMs);
+   out.println("mode  ns/frame  max us  draws/frame  allocs  crc       golden");
+   for (int mode = 0; mode < resultCount; mode++) {
+     const BenchResult& result = results[mode];
+     out.printf("%4d  %8lu  %6lu  %11lu  %6lu  %08lx  %s\n", mode,
+                (unsigned long)result.nsPerFrame, (unsigned long)result.maxMicros,
+                (unsigned long)result.drawsPerFrame, (unsigned long)result.allocs,
+                (unsigned long)result.crc,
+                goldenName(result.golden));
+   }
+}
+
+String RenderBench::json() const {
+   String json = "{\"frames\":" + String(frameCount) + ",\"ms\":" + String(elapsedMs) + ",\"modes\":[";
+   for (int mode = 0; mode < resultCount; mode++) {
+     const BenchResult& result = results[mode];
+     char crc[9];
+     snprintf(crc, sizeof(crc), "%08lx", (unsigned long)result.crc);
+     if (mode > 0) json += ",";
+     json += "{\"ns\":" + String(result.nsPerFrame);
+     json += ",\"max_us\":" + String(result.maxMicros);
+     json += ",\"draws\":" + String(result.drawsPerFrame);
+     json += ",\"allocs\":" + String(result.allocs);
+     json += ",\"crc\":\"" + String(crc) + "\"";
+     json += ",\"golden\":\"" + String(goldenName(result.golden)) + "\"}";
+   }
+   json += "]}";
+   return json;
+}
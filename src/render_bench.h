@@ -0,0 +1,63 @@
+#ifndef RENDER_BENCH_H
+#define RENDER_BENCH_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Per-mode rendering benchmark
+//
+// Runs every registered mode for a fixed number of frames back to back, with
+// the rate limiter bypassed and all inputs (touch, BME280, link status, clock)
+// scripted through inputTrace, so each frame is a pure function of the frame
+// number. Per mode it reports the average tick cost, the slowest frame, the
+// driver draw calls per frame, the heap allocations made by the mode (when
+// built with MEM_TRACK_ALLOCATIONS) and a CRC over every framebuffer produced.
+// Allocation call sites are captured across the whole run, see mem_health.h.
+//
+// The CRCs can be stored as golden values; later runs with the same frame
+// count flag any mode whose output changed. Mode 5 output also depends on the
+// stored TLE, so re-record the golden values after uplinking new elements.
+
+#define BENCH_FRAMES_DEFAULT 1000
+#define BENCH_FRAMES_MAX     20000
+#define BENCH_YIELD_EVERY    64      // Frames between yields so core 1 idle tasks can run
+#define BENCH_MAX_MODES      8
+
+enum BenchGolden {
+   BENCH_GOLDEN_NONE,     // Nothing stored for this frame count
+   BENCH_GOLDEN_MATCH,
+   BENCH_GOLDEN_DIFFERS
+};
+
+struct BenchResult {
+   uint32_t nsPerFrame;
+   uint32_t maxMicros;
+   uint32_t drawsPerFrame;
+   uint32_t allocs;        // Over all frames, enter and exit
+   uint32_t crc;
+   BenchGolden golden;
+};
+
+class RenderBench {
+public:
+   // Render every mode for frames ticks and compare with the stored golden
+   // CRCs. The caller exits the running mode first and re-enters it after.
+   // Fails while an input trace is recording or replaying.
+   bool run(uint32_t frames, Preferences& store);
+
+   // Keep the results of the last run as the golden values
+   bool saveGolden(Preferences& store);
+
+   void print(Print& out) const;
+   String json() const;
+
+private:
+   uint32_t frameCount = 0;
+   unsigned long elapsedMs = 0;
+   BenchResult results[BENCH_MAX_MODES];
+   int resultCount = 0;
+};
+
+extern RenderBench renderBench;
+
+#endif
@@ -0,0 +1,145 @@
+#include "telecommand.h"
+#include "modes.h"
+
+#include <stdio.h>
+#include <string.h>
+
+struct TelecommandName {
+   const char* text;
+   TelecommandId id;
+   bool prefix;          // Matches the start of the command, the rest is the argument
+};
+
+// Longest match first where one name starts another
+static const TelecommandName names[] = {
+   { "SET_DEFAULT_M", TC_DEFAULT_MODE,  true },
+   { "GET ",          TC_GET,           true },
+   { "SET ",          TC_SET,           true },
+   { "PARAMS",        TC_PARAMS,        false },
+   { "TLE ",          TC_TLE,           true },
+   { "OTA_URL ",      TC_OTA_URL,       true },
+   { "OTA_RESTART",   TC_OTA_RESTART,   false },
+   { "BURST TRIGGER", TC_BURST_TRIGGER, false },
+   { "BURST",         TC_BURST,         false },
+   { "MIRROR KEY",    TC_MIRROR_KEY,    false },
+   { "MIRROR",        TC_MIRROR,        false },
+   { "POWER",         TC_POWER,         false },
+   { "ALERTS",        TC_ALERTS,        false },
+   { "NTP ",          TC_NTP_SERVER,    true },
+   { "NTP",           TC_NTP,           false },
+   { "TRACE",         TC_TRACE,         true },
+   { "BENCH",         TC_BENCH,         true },
+   { "MEM",           TC_MEM,           false },
+};
+
+static int digit(const char* text) {
+   return (text[0] >= '0' && text[0] <= '9' && text[1] == '\0') ? text[0] - '0' : -1;
+}
+
+Telecommand parseTelecommand(const char* text) {
+   Telecommand command = { TC_UNKNOWN, -1, "" };
+   if (text[0] == 'M' && strlen(text) == 2) {
+     command.id = TC_MODE;
+     command.number = digit(text + 1);
+     return command;
+   }
+   for (const TelecommandName& name : names) {
+     size_t length = strlen(name.text);
+     if (name.prefix ? strncmp(text, name.text, length) != 0 : strcmp(text, name.text) != 0) continue;
+     command.id = name.id;
+     command.argument = text + length;
+     if (name.id == TC_TRACE || name.id == TC_BENCH) {
+       command.argument = text;
+     } else if (name.id == TC_DEFAULT_MODE) {
+       // SET_DEFAULT_M<n> exactly; anything longer is not a command
+       if (strlen(command.argument) != 1) command.id = TC_UNKNOWN;
+       command.number = digit(command.argument);
+     }
+     return command;
+   }
+   return command;
+}
+
+static String parameterText(const ParameterRegistry& registry, int id) {
+   return String(registry.definition(id).name) + "=" + registry.format(id);
+}
+
+TelecommandResult runTelecommand(const Telecommand& command, ParameterRegistry& registry, String& response) {
+   switch (command.id) {
+   case TC_MODE:
+     if (!OperationalModes::isValid(command.number)) {
+       response = "Invalid mode number";
+       return TC_DONE;
+     }
+     response = String("Mode changed to ") + String(command.number);
+     return TC_MODE_CHANGE;
+
+   case TC_DEFAULT_MODE:
+     if (command.number >= 0 && registry.set(PARAM_DEFAULT_MODE, command.number)) {
+       response = String("Default mode set to ") + String((long)registry.getInt(PARAM_DEFAULT_MODE));
+     } else {
+       response = "Invalid default mode number";
+     }
+     return TC_DONE;
+
+   case TC_GET: {
+     int id = registry.find(command.argument);
+     response = id >= 0 ? parameterText(registry, id) : String("Unknown parameter");
+     return TC_DONE;
+   }
+
+   case TC_SET: {
+     // SET <name> <value>
+     const char* split = strchr(command.argument, ' ');
+     char name[32];
+     int id = -1;
+     if (split && (size_t)(split - command.argument) < sizeof(name)) {
+       memcpy(name, command.argument, split - command.argument);
+       name[split - command.argument] = '\0';
+       id = registry.find(name);
+     }
+     float value;
+     if (id < 0) {
+       response = "Unknown parameter";
+     } else if (!registry.parse(id, split + 1, value)) {
+       // toFloat() read "abc" as 0, which several parameters accept
+       response = "Invalid parameter value";
+     } else if (registry.set(id, value)) {
+       response = parameterText(registry, id);
+     } else {
+       response = "Parameter value out of range";
+     }
+     return TC_DONE;
+   }
+
+   case TC_PARAMS:
+     response = "{";
+     for (int id = 0; id < registry.count(); id++) {
+       if (id > 0) response += ",";
+       response += String("\"") + registry.definition(id).name + "\":" + registry.format(id);
+     }
+     response += "}";
+     return TC_DONE;
+
+   case TC_UNKNOWN:
+     response = "Unknown command";
+     return TC_DONE;
+
+   default:
+     return TC_FIRMWARE;
+   }
+}
+
+String telecommandAck(const char* command, int64_t rxUs, int64_t doneUs, int64_t execUs) {
+   char name[33];
+   size_t length = 0;
+   for (; length < sizeof(name) - 1 && command[length]; length++) {
+     char c = command[length];
+     name[length] = (c < ' ' || c == '"' || c == '\\') ? '?' : c;
+   }
+   name[length] = '\0';
+   char json[160];
+   snprintf(json, sizeof(json), "{\"cmd\":\"%s\",\"rx_us\":%lld,\"done_us\":%lld,\"exec_us\":%lld}", name,
+            (long long)rxUs, (long long)doneUs, (long long)execUs);
+   return String(json);
+}
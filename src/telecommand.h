@@ -0,0 +1,64 @@
+#ifndef TELECOMMAND_H
+#define TELECOMMAND_H
+
+#include <Arduino.h>
+#include "params.h"
+
+// Telecommand parser and the commands that only touch the parameters
+//
+// parseTelecommand() turns the text received on the command topic into a
+// TelecommandId plus its argument. runTelecommand() then executes what needs
+// nothing but the ParameterRegistry and the mode number (M<n>,
+// SET_DEFAULT_M<n>, GET, SET, PARAMS, unknown commands) and returns the
+// response text; executeCommand() in main.cpp handles the rest itself.
+// telecommandAck() builds the timing record publishCommandAck() sends.
+//
+// Host-buildable with tools/host: tools/fleet_sim.cpp runs every virtual
+// board's commands and acks through this same code and a ParameterRegistry
+// each.
+
+enum TelecommandId {
+   TC_UNKNOWN,
+   TC_MODE,              // M<n>
+   TC_DEFAULT_MODE,      // SET_DEFAULT_M<n>
+   TC_GET,               // GET <name>
+   TC_SET,               // SET <name> <value>
+   TC_PARAMS,
+   TC_TLE,               // TLE <line 1>\n<line 2> (or '|')
+   TC_OTA_URL,           // OTA_URL <url>
+   TC_OTA_RESTART,
+   TC_BURST,
+   TC_BURST_TRIGGER,
+   TC_MIRROR,
+   TC_MIRROR_KEY,
+   TC_POWER,
+   TC_ALERTS,
+   TC_NTP,
+   TC_NTP_SERVER,        // NTP <host>
+   TC_TRACE,             // TRACE ..., argument is the whole command
+   TC_BENCH,             // BENCH ..., argument is the whole command
+   TC_MEM
+};
+
+struct Telecommand {
+   TelecommandId id;
+   int number;           // Mode of TC_MODE and TC_DEFAULT_MODE, -1 if not a digit
+   const char* argument; // Points into the parsed text; "" without one
+};
+
+enum TelecommandResult {
+   TC_DONE,              // Executed, response set
+   TC_MODE_CHANGE,       // Valid M<n>, response set; the caller switches modes
+   TC_FIRMWARE           // Not executed here
+};
+
+Telecommand parseTelecommand(const char* text);
+
+TelecommandResult runTelecommand(const Telecommand& command, ParameterRegistry& registry, String& response);
+
+// Timing record for the ack topic: the command's first 32 characters (quotes,
+// backslashes and control characters as '?'), wall clock receipt and
+// completion (0 before the first sync) and the execution time, all in us
+String telecommandAck(const char* command, int64_t rxUs, int64_t doneUs, int64_t execUs);
+
+#endif
@@ -0,0 +1,400 @@
+#include "telemetry_schema.h"
+
+#include <math.h>
+#include <string.h>
+
+#define TM_MAX_DECIMALS   6      // Statistics print sd with one more
+
+static const float powers10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f };
+
+#define TM_CHECK_F(member, key, type, unit, decimals, packets) \
+   static_assert(decimals <= TM_MAX_DECIMALS, key ": too many decimals for an i32");
+TELEMETRY_SCHEMA(TM_CHECK_F, TM_SKIP_G, TM_SKIP_E)
+#undef TM_CHECK_F
+
+const TelemetryEntry telemetryEntries[TELEMETRY_ENTRY_COUNT] = {
+#define TM_ENTRY_F(member, key, type, unit, decimals, packets) { #member, key, type, unit, decimals, packets },
+#define TM_ENTRY_G(member, key, packets) { #member, key, TM_OBJECT, "", 0, packets },
+#define TM_ENTRY_E(member, packets) { #member, "", TM_END, "", 0, packets },
+   TELEMETRY_SCHEMA(TM_ENTRY_F, TM_ENTRY_G, TM_ENTRY_E)
+#undef TM_ENTRY_F
+#undef TM_ENTRY_G
+#undef TM_ENTRY_E
+};
+
+// round(value * 10^decimals), the digits both encodings carry
+static int32_t fixedPoint(float value, uint8_t decimals) {
+   if (isnan(value)) return TELEMETRY_FIXED_NULL;
+   float scaled = value * powers10[decimals];
+   if (scaled >= 2147483520.0f) return INT32_MAX;
+   if (scaled <= -2147483520.0f) return INT32_MIN + 1;
+   return (int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+static float fromFixed(int32_t value, uint8_t decimals) {
+   return value == TELEMETRY_FIXED_NULL ? NAN : value / powers10[decimals];
+}
+
+// Digits of value ending at end; returns the first
+static char* formatDigits(char* end, uint32_t value) {
+   do {
+     *--end = '0' + value % 10;
+     value /= 10;
+   } while (value);
+   return end;
+}
+
+struct JsonWriter {
+   char* out;
+   size_t size;
+   size_t pos;
+   bool first;
+   bool overflow;
+
+   void raw(const char* text, size_t length) {
+     if (pos + length >= size) {
+       overflow = true;
+       return;
+     }
+     memcpy(out + pos, text, length);
+     pos += length;
+   }
+   void put(char c) { raw(&c, 1); }
+   // Key is the quoted name with its colon, as one literal
+   void key(const char* quoted, size_t length) {
+     if (!first) put(',');
+     first = false;
+     raw(quoted, length);
+   }
+   void open(const char* quoted, size_t length) {
+     key(quoted, length);
+     put('{');
+     first = true;
+   }
+   void close() {
+     put('}');
+     first = false;
+   }
+   void u32(uint32_t value) {
+     char digits[10];
+     char* start = formatDigits(digits + sizeof(digits), value);
+     raw(start, digits + sizeof(digits) - start);
+   }
+   void i32(int32_t value) {
+     if (value < 0) put('-');
+     u32(value < 0 ? 0u - (uint32_t)value : (uint32_t)value);
+   }
+   void i64(int64_t value) {
+     char digits[21];
+     char* end = digits + sizeof(digits);
+     char* start = end;
+     uint64_t magnitude = value < 0 ? 0ull - (uint64_t)value : (uint64_t)value;
+     // 32-bit divisions where possible: 64-bit ones are library calls on the ESP32
+     while (magnitude > 0xFFFFFFFFull) {
+       uint32_t low = magnitude % 1000000000ull;
+       magnitude /= 1000000000ull;
+       for (int i = 0; i < 9; i++, low /= 10) *--start = '0' + low % 10;
+     }
+     start = formatDigits(start, (uint32_t)magnitude);
+     if (value < 0) *--start = '-';
+     raw(start, end - start);
+   }
+   void fixed(float value, uint8_t decimals) {
+     int32_t scaled = fixedPoint(value, decimals);
+     if (scaled == TELEMETRY_FIXED_NULL) {
+       raw("null", 4);
+       return;
+     }
+     char digits[16];
+     char* end = digits + sizeof(digits);
+     uint32_t magnitude = scaled < 0 ? 0u - (uint32_t)scaled : (uint32_t)scaled;
+     char* start = formatDigits(end, magnitude);
+     // At least one digit before the point
+     while (end - start <= decimals) *--start = '0';
+     if (decimals > 0) {
+       memmove(start - 1, start, end - start - decimals);
+       start--;
+       end[-decimals - 1] = '.';
+     }
+     if (scaled < 0) *--start = '-';
+     raw(start, end - start);
+   }
+   void string(const char* text) {
+     put('"');
+     if (text) raw(text, strlen(text));
+     put('"');
+   }
+};
+
+static void json_TM_BOOL(JsonWriter& w, const char* key, size_t keyLength, bool value, uint8_t) {
+   w.key(key, keyLength);
+   if (value) w.raw("true", 4);
+   else w.raw("false", 5);
+}
+
+static void json_TM_U32(JsonWriter& w, const char* key, size_t keyLength, uint32_t value, uint8_t) {
+   w.key(key, keyLength);
+   w.u32(value);
+}
+
+static void json_TM_I32(JsonWriter& w, const char* key, size_t keyLength, int32_t value, uint8_t) {
+   w.key(key, keyLength);
+   w.i32(value);
+}
+
+static void json_TM_I64(JsonWriter& w, const char* key, size_t keyLength, int64_t value, uint8_t) {
+   w.key(key, keyLength);
+   w.i64(value);
+}
+
+static void json_TM_FIXED(JsonWriter& w, const char* key, size_t keyLength, float value, uint8_t decimals) {
+   w.key(key, keyLength);
+   w.fixed(value, decimals);
+}
+
+static void json_TM_STATS(JsonWriter& w, const char* key, size_t keyLength, const StatsSummary& stats,
+                          uint8_t decimals) {
+   // The deviation gets one more digit than the value, it is usually the small one
+   w.key(key, keyLength);
+   if (stats.count == 0) {
+     w.raw("null", 4);
+     return;
+   }
+   w.raw("{\"n\":", 5);
+   w.u32(stats.count);
+   w.raw(",\"min\":", 7);
+   w.fixed(stats.min, decimals);
+   w.raw(",\"max\":", 7);
+   w.fixed(stats.max, decimals);
+   w.raw(",\"mean\":", 8);
+   w.fixed(stats.mean, decimals);
+   w.raw(",\"sd\":", 6);
+   w.fixed(stats.stddev, decimals + 1);
+   w.put('}');
+}
+
+static void json_TM_STRING(JsonWriter& w, const char* key, size_t keyLength, const char* value, uint8_t) {
+   w.key(key, keyLength);
+   w.string(value);
+}
+
+static void json_TM_JSON(JsonWriter& w, const char* key, size_t keyLength, const char* value, uint8_t) {
+   if (!value) return;
+   w.key(key, keyLength);
+   w.raw(value, strlen(value));
+}
+
+size_t telemetryJson(const TelemetryRecord& record, uint8_t packet, char* out, size_t size) {
+   JsonWriter w = { out, size, 0, true, false };
+   static const char hex[] = "0123456789abcdef";
+   char schema[] = "{\"schema\":\"00000000\"";
+   for (int i = 0; i < 8; i++) schema[11 + i] = hex[(TELEMETRY_SCHEMA_HASH >> (28 - 4 * i)) & 0xF];
+   w.raw(schema, sizeof(schema) - 1);
+   w.first = false;
+
+#define TM_JSON_F(member, key, type, unit, decimals, packets) \
+   if (packet & (packets)) json_##type(w, "\"" key "\":", sizeof("\"" key "\":") - 1, record.member, decimals);
+#define TM_JSON_G(member, key, packets) \
+   if (packet & (packets)) w.open("\"" key "\":", sizeof("\"" key "\":") - 1);
+#define TM_JSON_E(member, packets) \
+   if (packet & (packets)) w.close();
+   TELEMETRY_SCHEMA(TM_JSON_F, TM_JSON_G, TM_JSON_E)
+#undef TM_JSON_F
+#undef TM_JSON_G
+#undef TM_JSON_E
+
+   w.put('}');
+   if (w.overflow) return 0;
+   out[w.pos] = '\0';
+   return w.pos;
+}
+
+struct BinaryWriter {
+   uint8_t* out;
+   size_t size;
+   size_t pos;
+   bool overflow;
+
+   uint8_t* reserve(size_t length) {
+     if (overflow || pos + length > size) {
+       overflow = true;
+       return nullptr;
+     }
+     uint8_t* at = out + pos;
+     pos += length;
+     return at;
+   }
+   void u8(uint8_t value) {
+     uint8_t* at = reserve(1);
+     if (at) at[0] = value;
+   }
+   void u16(uint16_t value) {
+     uint8_t* at = reserve(2);
+     if (!at) return;
+     at[0] = value;
+     at[1] = value >> 8;
+   }
+   void u32(uint32_t value) {
+     uint8_t* at = reserve(4);
+     if (!at) return;
+     at[0] = value;
+     at[1] = value >> 8;
+     at[2] = value >> 16;
+     at[3] = value >> 24;
+   }
+   void u64(uint64_t value) {
+     u32((uint32_t)value);
+     u32((uint32_t)(value >> 32));
+   }
+   void bytes(const char* data, size_t length) {
+     uint8_t* at = reserve(length);
+     if (at) memcpy(at, data, length);
+   }
+};
+
+static void pack_TM_BOOL(BinaryWriter& w, bool value, uint8_t) { w.u8(value); }
+static void pack_TM_U32(BinaryWriter& w, uint32_t value, uint8_t) { w.u32(value); }
+static void pack_TM_I32(BinaryWriter& w, int32_t value, uint8_t) { w.u32((uint32_t)value); }
+static void pack_TM_I64(BinaryWriter& w, int64_t value, uint8_t) { w.u64((uint64_t)value); }
+
+static void pack_TM_FIXED(BinaryWriter& w, float value, uint8_t decimals) {
+   w.u32((uint32_t)fixedPoint(value, decimals));
+}
+
+static void pack_TM_STATS(BinaryWriter& w, const StatsSummary& stats, uint8_t decimals) {
+   w.u32(stats.count);
+   if (stats.count == 0) return;
+   w.u32((uint32_t)fixedPoint(stats.min, decimals));
+   w.u32((uint32_t)fixedPoint(stats.max, decimals));
+   w.u32((uint32_t)fixedPoint(stats.mean, decimals));
+   w.u32((uint32_t)fixedPoint(stats.stddev, decimals + 1));
+}
+
+static void pack_TM_STRING(BinaryWriter& w, const char* value, uint8_t) {
+   size_t length = value ? strlen(value) : 0;
+   if (length > 0xFF) length = 0xFF;
+   w.u8(length);
+   w.bytes(value, length);
+}
+
+static void pack_TM_JSON(BinaryWriter& w, const char* value, uint8_t) {
+   size_t length = value ? strlen(value) : 0;
+   if (length > 0xFFFF) {
+     w.overflow = true;
+     return;
+   }
+   w.u16(length);
+   w.bytes(value, length);
+}
+
+size_t telemetryPack(const TelemetryRecord& record, uint8_t packet, uint8_t* out, size_t size) {
+   BinaryWriter w = { out, size, 0, false };
+   w.u8(TELEMETRY_BINARY_VERSION);
+   w.u8(packet);
+   w.u32(TELEMETRY_SCHEMA_HASH);
+
+#define TM_PACK_F(member, key, type, unit, decimals, packets) \
+   if (packet & (packets)) pack_##type(w, record.member, decimals);
+   TELEMETRY_SCHEMA(TM_PACK_F, TM_SKIP_G, TM_SKIP_E)
+#undef TM_PACK_F
+
+   return w.overflow ? 0 : w.pos;
+}
+
+struct BinaryReader {
+   const uint8_t* in;
+   size_t length;
+   size_t pos;
+   char* text;                   // Strings go here, NUL terminated
+   size_t textSize;
+   size_t textPos;
+   bool truncated;
+
+   const uint8_t* take(size_t count) {
+     if (truncated || pos + count > length) {
+       truncated = true;
+       return nullptr;
+     }
+     const uint8_t* at = in + pos;
+     pos += count;
+     return at;
+   }
+   uint8_t u8() {
+     const uint8_t* at = take(1);
+     return at ? at[0] : 0;
+   }
+   uint16_t u16() {
+     const uint8_t* at = take(2);
+     return at ? at[0] | at[1] << 8 : 0;
+   }
+   uint32_t u32() {
+     const uint8_t* at = take(4);
+     return at ? at[0] | at[1] << 8 | at[2] << 16 | (uint32_t)at[3] << 24 : 0;
+   }
+   uint64_t u64() {
+     uint64_t low = u32();
+     return low | (uint64_t)u32() << 32;
+   }
+   const char* string(size_t count) {
+     const uint8_t* at = take(count);
+     if (!at || textPos + count + 1 > textSize) {
+       truncated = true;
+       return "";
+     }
+     char* copy = text + textPos;
+     memcpy(copy, at, count);
+     copy[count] = '\0';
+     textPos += count + 1;
+     return copy;
+   }
+};
+
+static void unpack_TM_BOOL(BinaryReader& r, bool& value, uint8_t) { value = r.u8() != 0; }
+static void unpack_TM_U32(BinaryReader& r, uint32_t& value, uint8_t) { value = r.u32(); }
+static void unpack_TM_I32(BinaryReader& r, int32_t& value, uint8_t) { value = (int32_t)r.u32(); }
+static void unpack_TM_I64(BinaryReader& r, int64_t& value, uint8_t) { value = (int64_t)r.u64(); }
+
+static void unpack_TM_FIXED(BinaryReader& r, float& value, uint8_t decimals) {
+   value = fromFixed((int32_t)r.u32(), decimals);
+}
+
+static void unpack_TM_STATS(BinaryReader& r, StatsSummary& stats, uint8_t decimals) {
+   stats = StatsSummary();
+   stats.count = r.u32();
+   if (stats.count == 0) return;
+   stats.min = fromFixed((int32_t)r.u32(), decimals);
+   stats.max = fromFixed((int32_t)r.u32(), decimals);
+   stats.mean = fromFixed((int32_t)r.u32(), decimals);
+   stats.stddev = fromFixed((int32_t)r.u32(), decimals + 1);
+}
+
+static void unpack_TM_STRING(BinaryReader& r, const char*& value, uint8_t) { value = r.string(r.u8()); }
+
+static void unpack_TM_JSON(BinaryReader& r, const char*& value, uint8_t) {
+   uint16_t length = r.u16();
+   value = length ? r.string(length) : nullptr;
+}
+
+uint32_t telemetryPacketHash(const uint8_t* message, size_t length) {
+   if (length < TELEMETRY_BINARY_HEADER) return 0;
+   return message[2] | message[3] << 8 | message[4] << 16 | (uint32_t)message[5] << 24;
+}
+
+TelemetryDecodeResult telemetryUnpack(const uint8_t* message, size_t length, TelemetryRecord& record,
+                                      uint8_t& packet, char* text, size_t textSize) {
+   BinaryReader r = { message, length, 0, text, textSize, 0, false };
+   record = TelemetryRecord();
+   uint8_t version = r.u8();
+   packet = r.u8();
+   uint32_t hash = r.u32();
+   if (r.truncated) return TELEMETRY_TRUNCATED;
+   if (version != TELEMETRY_BINARY_VERSION || (packet != TM_FULL && packet != TM_HK)) return TELEMETRY_BAD_VERSION;
+   if (hash != TELEMETRY_SCHEMA_HASH) return TELEMETRY_SCHEMA_MISMATCH;
+
+#define TM_UNPACK_F(member, key, type, unit, decimals, packets) \
+   if (packet & (packets)) unpack_##type(r, record.member, decimals);
+   TELEMETRY_SCHEMA(TM_UNPACK_F, TM_SKIP_G, TM_SKIP_E)
+#undef TM_UNPACK_F
+
+   return r.truncated || r.pos != length ? TELEMETRY_TRUNCATED : TELEMETRY_DECODED;
+}
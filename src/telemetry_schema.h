@@ -0,0 +1,213 @@
+#ifndef TELEMETRY_SCHEMA_H
+#define TELEMETRY_SCHEMA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "window_stats.h"
+
+// Telemetry schema, declared once
+//
+// TELEMETRY_SCHEMA lists every telemetry field in packet order: member name,
+// JSON key, type, unit, decimals and the packets it goes out in (full,
+// housekeeping or both). Expanding it generates
+//   TelemetryRecord     a struct with one typed member per field, which the
+//                       firmware fills before each packet
+//   telemetryJson()     the JSON packet, straight-line code per field
+//   telemetryPack()     the packed binary packet
+//   telemetryUnpack()   the ground decoder, binary back into a record
+//   telemetryEntries[]  the field table for tools (types and units)
+//   TELEMETRY_SCHEMA_HASH  over every entry, in order
+// Adding, moving or retyping a field changes the hash. JSON packets carry it
+// as "schema" (hex), binary ones in their header; a receiver built from a
+// different schema sees the mismatch instead of misreading fields.
+//
+// Fixed point fields are floats sent with their decimals: JSON prints them
+// to that many places, binary sends round(value * 10^decimals) as i32, so
+// both carry the same digits and a binary packet decodes to the same JSON
+// text. Statistics ({"n","min","max","mean","sd"}) do the same with one
+// more decimal for sd. NaN fixed point values and empty statistics are null.
+// String fields are sent as is; json fields are sections of variable shape
+// (boot timeline, memory, I2C devices) passed through as JSON text, and
+// left out of the packet when nullptr.
+//
+// Binary (little endian): u8 TELEMETRY_BINARY_VERSION, u8 packet (TM_FULL or
+// TM_HK), u32 schema hash, then the packet's fields in schema order: bool u8;
+// u32, i32 4 bytes; i64 8 bytes; fixed i32 (INT32_MIN = null); stats u32 n,
+// then if n > 0 i32 min, max, mean, sd; string u8 length and bytes; json u16
+// length and bytes (0 = absent). Objects only group keys in JSON.
+//
+// No Arduino dependencies: tools/telemetry_codec.cpp decodes binary captures
+// with this header, prints the schema for analysis scripts, and benchmarks
+// the generated encoders against hand-written string building.
+
+#define TELEMETRY_BINARY_VERSION  1
+#define TELEMETRY_BINARY_HEADER   6
+#define TELEMETRY_JSON_MAX        2048   // Encode buffer; MQTT sends a little less (mqttPayloadLimit())
+#define TELEMETRY_BINARY_MAX      TELEMETRY_JSON_MAX   // Never longer than the JSON
+#define TELEMETRY_FIXED_NULL      INT32_MIN
+
+// Packets a field goes out in
+#define TM_FULL   1
+#define TM_HK     2
+#define TM_BOTH   (TM_FULL | TM_HK)
+
+enum TelemetryType {
+   TM_BOOL,
+   TM_U32,
+   TM_I32,
+   TM_I64,
+   TM_FIXED,     // float, decimals places; NaN = null
+   TM_STATS,     // StatsSummary; count 0 = null
+   TM_STRING,
+   TM_JSON,      // JSON text; nullptr leaves the key out
+   TM_OBJECT,    // Opens an object: the fields up to its TM_END
+   TM_END
+};
+
+// F(member, key, type, unit, decimals, packets)  field
+// G(member, key, packets)                         object opens
+// E(member, packets)                              object closes
+#define TELEMETRY_SCHEMA(F, G, E) \
+   F(deviceId,          "device_id",           TM_STRING, "",     0, TM_BOTH) \
+   F(boardId,           "board_id",            TM_STRING, "",     0, TM_BOTH) \
+   F(hk,                "hk",                  TM_BOOL,   "",     0, TM_HK)   \
+   F(uptime,            "uptime",              TM_U32,    "s",    0, TM_BOTH) \
+   F(tsUs,              "ts_us",               TM_I64,    "us",   0, TM_BOTH) \
+   F(monoUs,            "mono_us",             TM_I64,    "us",   0, TM_BOTH) \
+   F(freeHeap,          "free_heap",           TM_U32,    "B",    0, TM_BOTH) \
+   F(mode,              "mode",                TM_U32,    "",     0, TM_BOTH) \
+   F(defaultMode,       "default_mode",        TM_U32,    "",     0, TM_FULL) \
+   F(paramWrites,       "param_writes",        TM_U32,    "",     0, TM_FULL) \
+   F(logDropped,        "log_dropped",         TM_U32,    "",     0, TM_FULL) \
+   F(periodMs,          "period_ms",           TM_U32,    "ms",   0, TM_BOTH) \
+   F(linkFailures,      "link_failures",       TM_U32,    "",     0, TM_BOTH) \
+   F(mem,               "mem",                 TM_JSON,   "",     0, TM_FULL) \
+   F(boot,              "boot",                TM_JSON,   "",     0, TM_FULL) \
+   F(batteryVoltage,    "battery_voltage",     TM_STATS,  "V",    2, TM_BOTH) \
+   F(usbVoltage,        "usb_voltage",         TM_STATS,  "V",    2, TM_FULL) \
+   F(lowBattery,        "low_battery",         TM_BOOL,   "",     0, TM_BOTH) \
+   F(alerts,            "alerts",              TM_U32,    "",     0, TM_BOTH) \
+   F(displayFrames,     "display_frames",      TM_U32,    "",     0, TM_FULL) \
+   F(displayDropped,    "display_dropped",     TM_U32,    "",     0, TM_FULL) \
+   F(displayTransferUs, "display_transfer_us", TM_U32,    "us",   0, TM_FULL) \
+   F(mirror,            "mirror",              TM_JSON,   "",     0, TM_FULL) \
+   G(pacing,            "pacing",                                    TM_FULL) \
+   F(pacingTargetMs,    "target_ms",           TM_U32,    "ms",   0, TM_FULL) \
+   F(pacingFrames,      "frames",              TM_U32,    "",     0, TM_FULL) \
+   F(pacingLate,        "late",                TM_U32,    "",     0, TM_FULL) \
+   F(pacingDropped,     "dropped",             TM_U32,    "",     0, TM_FULL) \
+   F(pacingStepMs,      "step_ms",             TM_U32,    "ms",   0, TM_FULL) \
+   F(pacingSteps,       "steps",               TM_U32,    "",     0, TM_FULL) \
+   F(pacingSimDroppedMs,"sim_dropped_ms",      TM_U32,    "ms",   0, TM_FULL) \
+   E(pacing,                                                         TM_FULL) \
+   G(power,             "power",                                     TM_FULL) \
+   F(powerOn,           "on",                  TM_U32,    "",     0, TM_FULL) \
+   F(powerBusyPct,      "busy_pct",            TM_FIXED,  "%",    2, TM_FULL) \
+   E(power,                                                          TM_FULL) \
+   F(touchRight,        "touch_right",         TM_STATS,  "",     0, TM_FULL) \
+   F(touchLeft,         "touch_left",          TM_STATS,  "",     0, TM_FULL) \
+   F(touchUp,           "touch_up",            TM_STATS,  "",     0, TM_FULL) \
+   F(touchDown,         "touch_down",          TM_STATS,  "",     0, TM_FULL) \
+   F(touchX,            "touch_x",             TM_STATS,  "",     0, TM_FULL) \
+   G(acceleration,      "acceleration",                              TM_FULL) \
+   F(accelX,            "x",                   TM_FIXED,  "m/s2", 1, TM_FULL) \
+   F(accelY,            "y",                   TM_FIXED,  "m/s2", 1, TM_FULL) \
+   F(accelZ,            "z",                   TM_FIXED,  "m/s2", 1, TM_FULL) \
+   E(acceleration,                                                   TM_FULL) \
+   G(gyro,              "gyro",                                      TM_FULL) \
+   F(gyroX,             "x",                   TM_FIXED,  "deg/s",1, TM_FULL) \
+   F(gyroY,             "y",                   TM_FIXED,  "deg/s",1, TM_FULL) \
+   F(gyroZ,             "z",                   TM_FIXED,  "deg/s",1, TM_FULL) \
+   E(gyro,                                                           TM_FULL) \
+   F(temperature,       "temperature",         TM_STATS,  "degC", 2, TM_FULL) \
+   F(pressure,          "pressure",            TM_STATS,  "hPa",  2, TM_FULL) \
+   F(humidity,          "humidity",            TM_STATS,  "%",    1, TM_FULL) \
+   F(altitude,          "altitude",            TM_FIXED,  "m",    1, TM_FULL) \
+   F(verticalSpeed,     "vertical_speed",      TM_FIXED,  "m/s",  2, TM_FULL) \
+   F(qnh,               "qnh",                 TM_FIXED,  "hPa",  2, TM_FULL) \
+   F(i2c,               "i2c",                 TM_JSON,   "",     0, TM_FULL) \
+   F(wifiStrength,      "wifi_strength",       TM_I32,    "dBm",  0, TM_BOTH) \
+   F(ipAddress,         "ip_address",          TM_STRING, "",     0, TM_FULL)
+
+#define TM_CTYPE_TM_BOOL    bool
+#define TM_CTYPE_TM_U32     uint32_t
+#define TM_CTYPE_TM_I32     int32_t
+#define TM_CTYPE_TM_I64     int64_t
+#define TM_CTYPE_TM_FIXED   float
+#define TM_CTYPE_TM_STATS   StatsSummary
+#define TM_CTYPE_TM_STRING  const char*
+#define TM_CTYPE_TM_JSON    const char*
+
+#define TM_SKIP_G(member, key, packets)
+#define TM_SKIP_E(member, packets)
+
+// Zero-initialise ({}), then fill the members of the packet being sent
+struct TelemetryRecord {
+#define TM_MEMBER(member, key, type, unit, decimals, packets) TM_CTYPE_##type member;
+   TELEMETRY_SCHEMA(TM_MEMBER, TM_SKIP_G, TM_SKIP_E)
+#undef TM_MEMBER
+};
+
+// Position of every entry; the hash weighs each entry by it
+enum TelemetryEntryIndex {
+#define TM_INDEX_F(member, key, type, unit, decimals, packets) TM_ENTRY_##member,
+#define TM_INDEX_G(member, key, packets) TM_ENTRY_##member,
+#define TM_INDEX_E(member, packets) TM_ENTRY_END_##member,
+   TELEMETRY_SCHEMA(TM_INDEX_F, TM_INDEX_G, TM_INDEX_E)
+#undef TM_INDEX_F
+#undef TM_INDEX_G
+#undef TM_INDEX_E
+   TELEMETRY_ENTRY_COUNT
+};
+
+// FNV-1a; recursive so it is a constant expression in C++11
+constexpr uint32_t telemetryFnv(const char* text, uint32_t hash = 2166136261u) {
+   return *text ? telemetryFnv(text + 1, (hash ^ (uint8_t)*text) * 16777619u) : hash;
+}
+
+#define TM_HASH_F(member, key, type, unit, decimals, packets) \
+   + telemetryFnv(key "|" #type "|" unit "|" #decimals "|" #packets) * (2u * TM_ENTRY_##member + 1u)
+#define TM_HASH_G(member, key, packets) \
+   + telemetryFnv("{" key "|" #packets) * (2u * TM_ENTRY_##member + 1u)
+#define TM_HASH_E(member, packets) \
+   + telemetryFnv("}" #packets) * (2u * TM_ENTRY_END_##member + 1u)
+constexpr uint32_t TELEMETRY_SCHEMA_HASH = TELEMETRY_BINARY_VERSION * 0x9E3779B9u
+   TELEMETRY_SCHEMA(TM_HASH_F, TM_HASH_G, TM_HASH_E);
+#undef TM_HASH_F
+#undef TM_HASH_G
+#undef TM_HASH_E
+
+struct TelemetryEntry {
+   const char* member;
+   const char* key;              // Within its object
+   TelemetryType type;
+   const char* unit;
+   uint8_t decimals;
+   uint8_t packets;              // TM_FULL, TM_HK or both
+};
+
+extern const TelemetryEntry telemetryEntries[TELEMETRY_ENTRY_COUNT];
+
+enum TelemetryDecodeResult {
+   TELEMETRY_DECODED,
+   TELEMETRY_TRUNCATED,
+   TELEMETRY_BAD_VERSION,
+   TELEMETRY_SCHEMA_MISMATCH     // Sent by firmware with another schema
+};
+
+// JSON packet (TM_FULL or TM_HK) into out, NUL terminated; returns its
+// length, 0 if it does not fit
+size_t telemetryJson(const TelemetryRecord& record, uint8_t packet, char* out, size_t size);
+
+// Binary packet into out; returns its length, 0 if it does not fit
+size_t telemetryPack(const TelemetryRecord& record, uint8_t packet, uint8_t* out, size_t size);
+
+// Binary packet back into record and packet. Strings and JSON sections are
+// copied NUL terminated into text, which must hold length bytes.
+TelemetryDecodeResult telemetryUnpack(const uint8_t* message, size_t length, TelemetryRecord& record,
+                                      uint8_t& packet, char* text, size_t textSize);
+
+// Schema hash in a binary packet's header, 0 if it is too short
+uint32_t telemetryPacketHash(const uint8_t* message, size_t length);
+
+#endif
@@ -0,0 +1,61 @@
+#include "time_sync.h"
+
+#include <esp_sntp.h>
+#include <sys/time.h>
+
+TimeSync timeSync;
+
+void TimeSync::begin(Preferences& prefs, const char* defaultServer) {
+   if (started) return;
+   String stored = prefs.getString(TIME_SERVER_KEY, "");
+   const char* host = (stored.length() > 0 && stored.length() <= TIME_SERVER_MAX) ? stored.c_str() : defaultServer;
+   strlcpy(serverName, host, sizeof(serverName));
+
+   sntp_set_time_sync_notification_cb(onSync);
+   sntp_set_sync_interval(TIME_SYNC_INTERVAL);
+   // lwIP keeps the pointer, so it must be the member buffer
+   configTime(0, 0, serverName);
+   started = true;
+}
+
+bool TimeSync::setServer(const String& host, Preferences& prefs) {
+   if (host.length() == 0 || host.length() > TIME_SERVER_MAX || host.indexOf(' ') >= 0) return false;
+   prefs.putString(TIME_SERVER_KEY, host);
+   if (!started) return true; // Picked up by begin()
+
+   // Stop first: the SNTP client reads serverName while running
+   sntp_stop();
+   strlcpy(serverName, host.c_str(), sizeof(serverName));
+   configTime(0, 0, serverName);
+   return true;
+}
+
+int64_t TimeSync::unixAt(int64_t monotonic) const {
+   if (!synced()) return 0;
+   struct timeval now;
+   gettimeofday(&now, nullptr);
+   int64_t unixNow = (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+   return unixNow - (monotonicMicros() - monotonic);
+}
+
+void TimeSync::onSync(struct timeval*) {
+   // Runs in the lwIP task
+   timeSync.lastSyncMicros = monotonicMicros();
+   timeSync.syncCount = timeSync.syncCount + 1;
+}
+
+String TimeSync::format(int64_t value) {
+   char text[24];
+   snprintf(text, sizeof(text), "%lld", (long long)value);
+   return String(text);
+}
+
+String TimeSync::json() const {
+   String json = "{";
+   json += "\"synced\":" + String(synced() ? "true" : "false") + ",";
+   json += "\"server\":\"" + String(started ? serverName : "") + "\",";
+   json += "\"syncs\":" + String(syncCount) + ",";
+   json += "\"age_s\":" + String(synced() ? (uint32_t)((monotonicMicros() - lastSyncMicros) / 1000000) : 0);
+   json += "}";
+   return json;
+}
@@ -0,0 +1,56 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+
+// Wall clock and monotonic microsecond clock
+//
+// monotonicMicros() is esp_timer_get_time(): µs since boot, 64 bit, never
+// steps. Use it for durations. The wall clock is kept by SNTP against one
+// server. By default that is the built-in one; an NTP <host> telecommand
+// stores another (e.g. a server on the ground station LAN) in Preferences.
+// Until the first sync unixMicros() returns 0, so the ground can tell
+// unsynchronised samples apart instead of trusting a 1970 timestamp.
+
+#define TIME_SERVER_KEY      "ntp_server"
+#define TIME_SERVER_MAX      63         // Host name length
+#define TIME_SYNC_INTERVAL   900000     // ms between SNTP polls once synced
+
+class TimeSync {
+public:
+   // Start SNTP with the stored server (or defaultServer); call once the
+   // TCP/IP stack is up. Later calls are ignored.
+   void begin(Preferences& prefs, const char* defaultServer);
+
+   // Switch to another server and store it; false if the name is unusable
+   bool setServer(const String& host, Preferences& prefs);
+   const char* server() const { return serverName; }
+
+   bool synced() const { return syncCount > 0; }
+
+   static int64_t monotonicMicros() { return esp_timer_get_time(); }
+
+   // Unix time in µs now, or at an earlier monotonicMicros() reading; 0 before the first sync
+   int64_t unixMicros() const { return unixAt(monotonicMicros()); }
+   int64_t unixAt(int64_t monotonic) const;
+
+   // Signed 64-bit value as decimal (Arduino String has no 64-bit constructor on every core)
+   static String format(int64_t value);
+
+   // {"synced":..,"server":..,"syncs":..,"age_s":..} for telemetry and the NTP telecommand
+   String json() const;
+
+private:
+   static void onSync(struct timeval* tv);
+
+   char serverName[TIME_SERVER_MAX + 1];
+   bool started = false;
+   volatile uint32_t syncCount = 0;
+   volatile int64_t lastSyncMicros = 0;    // Monotonic time of the last sync
+};
+
+extern TimeSync timeSync;
+
+#endif
@@ -0,0 +1,40 @@
+#include "window_stats.h"
+
+#include <math.h>
+
+void WindowStats::add(float value) {
+   if (value != value) return;
+   n++;
+   if (n == 1) {
+     origin = minimum = maximum = value;
+     mean = m2 = 0;
+     return;
+   }
+   if (value < minimum) minimum = value;
+   if (value > maximum) maximum = value;
+   float x = value - origin;
+   float delta = x - mean;
+   mean += delta / n;
+   m2 += delta * (x - mean);
+}
+
+StatsSummary WindowStats::summary() const {
+   StatsSummary result = { n, 0, 0, 0, 0 };
+   if (n == 0) return result;
+   result.min = minimum;
+   result.max = maximum;
+   result.mean = origin + mean;
+   result.stddev = n > 1 ? sqrtf(m2 / (n - 1)) : 0;
+   return result;
+}
+
+StatsSummary WindowStats::take() {
+   StatsSummary result = summary();
+   reset();
+   return result;
+}
+
+void WindowStats::reset() {
+   n = 0;
+   origin = minimum = maximum = mean = m2 = 0;
+}
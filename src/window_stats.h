@@ -0,0 +1,54 @@
+#ifndef WINDOW_STATS_H
+#define WINDOW_STATS_H
+
+#include <stdint.h>
+
+// Windowed statistics for the telemetry channels
+//
+// Each channel is sampled at its sensor's own rate and reduced to count, min,
+// max, mean and standard deviation until a telemetry packet reports it and
+// starts the next window, so noise and short excursions between packets stay
+// visible. Mean and variance use Welford's streaming update
+//   mean += (x - mean) / n,  m2 += (x - mean_old) * (x - mean_new)
+// which only ever works on deviations from the running mean. The textbook
+// sum / sum-of-squares form subtracts two nearly equal numbers instead: for a
+// pressure of 1013 hPa with 0.01 hPa of noise they agree in their first ten
+// digits, more than a float holds. The update also runs on the offset from
+// the window's first sample, so the running mean is a small number and does
+// not lose its low bits to the 1013 in front. Floats because the ESP32-S3 FPU
+// is single precision; double arithmetic is done in software.
+//
+// No Arduino dependencies: tools/stats_bench.cpp measures the update cost and
+// checks the results against a two-pass reference in double precision.
+
+struct StatsSummary {
+   uint32_t count;             // Samples in the window; the rest is 0 without any
+   float min;
+   float max;
+   float mean;
+   float stddev;               // Sample standard deviation (n - 1), 0 below two samples
+};
+
+class WindowStats {
+public:
+   // NaN (sensor missing or read failed) is skipped
+   void add(float value);
+
+   StatsSummary summary() const;
+
+   // Summary of the window, then start a new one
+   StatsSummary take();
+   void reset();
+
+   uint32_t count() const { return n; }
+
+private:
+   uint32_t n = 0;
+   float minimum = 0;
+   float maximum = 0;
+   float origin = 0;           // First sample of the window
+   float mean = 0;             // Relative to origin
+   float m2 = 0;               // Sum of squared deviations from the mean
+};
+
+#endif
@@ -0,0 +1,279 @@
+// Semantics check and throughput benchmark for the alert rule engine
+//
+// Runs the firmware's AlertEngine and rule table (src/alert_rules.cpp,
+// compiled in as is) on the host:
+//
+//   g++ -O2 -std=c++17 -Isrc -o alert_bench tools/alert_bench.cpp src/alert_rules.cpp src/pattern_sequencer.cpp
+//   alert_bench [--seed n] [--rules n] [--seconds n]
+//
+// First the board's rules go through scripted scenarios: hold time before a
+// raise, hysteresis on the way back, the combined power rule following its
+// operands, the cat safety drop against a slow weather drift, NaN samples,
+// runtime thresholds, a full event queue and tables the engine must reject.
+// Threshold rules are then checked against a straightforward reference on
+// random walks.
+//
+// Then a generated table of --rules rules spread over the channels (all
+// kinds, a tenth combined) is fed --seconds of simulated samples at the
+// firmware's rates (touch 50 Hz, battery and USB 100 Hz, BME280 8 Hz) and
+// the rule evaluations per second are reported. Host timing only ranks the
+// engine; the per-evaluation work is a handful of float compares on the
+// ESP32-S3 as well.
+
+#include "alert_rules.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+   if (condition) return;
+   printf("FAIL: %s\n", what);
+   failures++;
+}
+
+// Feeds one channel at a fixed period and collects the events
+struct Board {
+   AlertEngine engine;
+   AlertState states[ALERT_RULE_COUNT];
+   uint32_t now = 0;
+   int raised[ALERT_RULE_COUNT] = {};
+   int cleared[ALERT_RULE_COUNT] = {};
+
+   Board() { check(engine.begin(alertRules, states, ALERT_RULE_COUNT), "firmware table accepted"); }
+
+   void drain() {
+     AlertEvent event;
+     while (engine.poll(event)) {
+       (event.raised ? raised : cleared)[event.rule]++;
+     }
+   }
+   // value(t) for ms milliseconds, one sample every period
+   template <typename F> void feed(int channel, uint32_t ms, uint32_t period, F value) {
+     for (uint32_t t = 0; t < ms; t += period) {
+       engine.sample(channel, value(t), now);
+       now += period;
+       drain();
+     }
+   }
+   void hold(int channel, uint32_t ms, uint32_t period, float value) {
+     feed(channel, ms, period, [=](uint32_t) { return value; });
+   }
+};
+
+static void scenarios() {
+   {
+     Board b;
+     b.hold(ALERT_BATTERY, 1900, 10, 3.5f);
+     check(!b.engine.active(ALERT_LOW_BATTERY), "low battery waits for its hold time");
+     b.hold(ALERT_BATTERY, 200, 10, 3.5f);
+     check(b.engine.active(ALERT_LOW_BATTERY) && b.raised[ALERT_LOW_BATTERY] == 1, "low battery raised after 2 s");
+     b.hold(ALERT_BATTERY, 1000, 10, 3.65f);
+     check(b.engine.active(ALERT_LOW_BATTERY), "low battery holds inside the hysteresis");
+     b.hold(ALERT_BATTERY, 10, 10, 3.75f);
+     check(!b.engine.active(ALERT_LOW_BATTERY) && b.cleared[ALERT_LOW_BATTERY] == 1, "low battery clears past it");
+     b.hold(ALERT_BATTERY, 1500, 10, 3.5f);
+     b.hold(ALERT_BATTERY, 10, 10, 3.7f);
+     b.hold(ALERT_BATTERY, 1500, 10, 3.5f);
+     check(!b.engine.active(ALERT_LOW_BATTERY), "an interruption restarts the hold time");
+   }
+   {
+     Board b;
+     b.hold(ALERT_BATTERY, 3000, 10, 3.4f);
+     b.hold(ALERT_USB, 500, 10, 5.0f);
+     check(!b.engine.active(ALERT_POWER_CRITICAL), "low battery on USB is not critical");
+     b.hold(ALERT_USB, 1100, 10, 0.1f);
+     check(b.engine.active(ALERT_NO_USB) && b.engine.active(ALERT_POWER_CRITICAL), "unplugged: power critical");
+     check(b.engine.top() == ALERT_POWER_CRITICAL, "critical rule on top");
+     b.hold(ALERT_USB, 10, 10, 5.0f);
+     check(!b.engine.active(ALERT_POWER_CRITICAL) && b.cleared[ALERT_POWER_CRITICAL] == 1,
+           "power critical clears with its operand");
+     check(b.engine.top() == ALERT_LOW_BATTERY, "warning on top after that");
+   }
+   {
+     // Weather: 3 hPa/h for 10 h at the gated 1 Hz, then a fast drop at 8 Hz
+     Board b;
+     b.feed(ALERT_PRESSURE, 36000000, 1000, [](uint32_t t) { return 1013.0f - 3.0f * t / 3600000; });
+     check(!b.engine.active(ALERT_CAT_SAFETY) && b.raised[ALERT_CAT_SAFETY] == 0, "weather drift is no alert");
+     float start = 1013.0f - 30.0f;
+     b.feed(ALERT_PRESSURE, 120000, 125, [=](uint32_t t) { return start - 12.0f * t / 120000; });
+     check(b.engine.active(ALERT_CAT_SAFETY), "12 hPa in 2 min raises cat safety");
+     check(b.engine.state(ALERT_CAT_SAFETY).value > 10.0f, "reported as the drop");
+     b.hold(ALERT_PRESSURE, 60000, 125, start - 12.0f);
+     check(b.engine.active(ALERT_CAT_SAFETY), "stays while the drop is inside the window");
+     b.hold(ALERT_PRESSURE, 700000, 125, start - 12.0f);
+     check(!b.engine.active(ALERT_CAT_SAFETY), "clears once the window moved past the drop");
+     b.hold(ALERT_PRESSURE, 1000, 125, NAN);
+     check(b.engine.state(ALERT_CAT_SAFETY).value < 1.0f, "NaN samples are skipped");
+   }
+   {
+     Board b;
+     b.engine.setThreshold(ALERT_FREE_FALL, 5000);
+     b.hold(ALERT_TOUCH_DELTA, 20, 20, 6000);
+     check(b.engine.active(ALERT_FREE_FALL), "runtime threshold used, no hold time");
+     b.hold(ALERT_TOUCH_DELTA, 20, 20, 2500);
+     check(b.engine.active(ALERT_FREE_FALL), "free fall holds inside the hysteresis");
+     b.hold(ALERT_TOUCH_DELTA, 20, 20, 1900);
+     check(!b.engine.active(ALERT_FREE_FALL), "free fall clears past it");
+   }
+   {
+     // 20 raise/clear transitions without draining: the first 16 are kept
+     Board b;
+     for (int i = 0; i < 10; i++) {
+       b.engine.sample(ALERT_TOUCH_DELTA, 20000, b.now);
+       b.engine.sample(ALERT_TOUCH_DELTA, 0, b.now);
+     }
+     check(b.engine.eventsDropped() == 20 - ALERT_EVENT_QUEUE, "full queue counts the dropped events");
+     AlertEvent event;
+     int n = 0;
+     while (b.engine.poll(event)) check(event.raised == (n++ % 2 == 0), "queue keeps the order");
+     check(n == ALERT_EVENT_QUEUE, "queue drained");
+   }
+   {
+     AlertEngine engine;
+     AlertState states[2];
+     AlertRule forward[2] = {
+       { "a", ALERT_ANY_OF, ALERT_WARNING, 1, 1, 0, 0, 0, 0, nullptr },
+       { "b", ALERT_ABOVE, ALERT_WARNING, ALERT_USB, 0, 1, 0, 0, 0, nullptr },
+     };
+     check(!engine.begin(forward, states, 2), "combined rule on a later rule rejected");
+     AlertRule channel[1] = { { "c", ALERT_ABOVE, ALERT_WARNING, ALERT_CHANNELS, 0, 1, 0, 0, 0, nullptr } };
+     check(!engine.begin(channel, states, 1), "unknown channel rejected");
+     engine.sample(ALERT_USB, 10, 0);
+     check(engine.count() == 0 && engine.evaluations() == 0, "rejected table evaluates nothing");
+   }
+}
+
+// Reference for threshold rules: same hold and hysteresis, written plainly
+static void reference(unsigned seed) {
+   std::mt19937 random(seed);
+   const int count = 64;
+   std::vector<AlertRule> rules(count);
+   for (int i = 0; i < count; i++) {
+     rules[i] = { "r", (uint8_t)(random() % 2 ? ALERT_ABOVE : ALERT_BELOW), ALERT_WARNING,
+                  (uint16_t)(random() % ALERT_CHANNELS), 0, (float)(random() % 100), (float)(random() % 10),
+                  (uint32_t)(random() % 5) * 100, 0, nullptr };
+   }
+   std::vector<AlertState> states(count);
+   AlertEngine engine;
+   check(engine.begin(rules.data(), states.data(), count), "reference table accepted");
+
+   std::vector<bool> active(count, false), pending(count, false);
+   std::vector<uint32_t> since(count, 0);
+   float value[ALERT_CHANNELS];
+   for (int c = 0; c < ALERT_CHANNELS; c++) value[c] = 50;
+   int mismatches = 0;
+   for (uint32_t now = 0; now < 600000; now += 10) {
+     int c = random() % ALERT_CHANNELS;
+     value[c] += (random() % 2001 - 1000) / 200.0f;
+     value[c] = std::fmin(120.0f, std::fmax(-20.0f, value[c]));
+     engine.sample(c, value[c], now);
+     AlertEvent event;
+     while (engine.poll(event)) {}
+     for (int i = 0; i < count; i++) {
+       if (rules[i].channel != c) continue;
+       float t = rules[i].threshold, h = active[i] ? rules[i].hysteresis : 0;
+       bool condition = rules[i].kind == ALERT_ABOVE ? value[c] > t - h : value[c] < t + h;
+       if (!condition) {
+         active[i] = pending[i] = false;
+       } else if (!active[i]) {
+         if (!pending[i]) { pending[i] = true; since[i] = now; }
+         if (now - since[i] >= rules[i].holdMs) { active[i] = true; pending[i] = false; }
+       }
+       if (active[i] != engine.active(i)) mismatches++;
+     }
+   }
+   check(mismatches == 0, "threshold rules match the reference");
+   printf("reference: %d rules, 60000 samples, %d mismatches\n", count, mismatches);
+}
+
+int main(int argc, char** argv) {
+   unsigned seed = 1;
+   int ruleCount = 4096;
+   int seconds = 60;
+   for (int i = 1; i < argc; i++) {
+     if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--rules") && i + 1 < argc) ruleCount = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atoi(argv[++i]);
+     else {
+       fprintf(stderr, "usage: alert_bench [--seed n] [--rules n] [--seconds n]\n");
+       return 2;
+     }
+   }
+
+   scenarios();
+   reference(seed);
+
+   // Generated table: plausible thresholds around each channel's level
+   static const float level[ALERT_CHANNELS] = { 1013, 25, 45, 3.9f, 5.0f, 3000 };
+   static const float spread[ALERT_CHANNELS] = { 0.5f, 0.2f, 1.0f, 0.01f, 0.02f, 400 };
+   std::mt19937 random(seed);
+   std::vector<AlertRule> rules(ruleCount);
+   for (int i = 0; i < ruleCount; i++) {
+     int kind = (i > 1 && random() % 10 == 0) ? ALERT_ALL_OF + random() % 2 : random() % 4;
+     AlertRule& r = rules[i];
+     r = { "generated", (uint8_t)kind, (uint8_t)(random() % 3), 0, 0, 0, 0, 0, 0, nullptr };
+     if (kind >= ALERT_ALL_OF) {
+       r.channel = random() % i;
+       r.operand = random() % i;
+       continue;
+     }
+     r.channel = random() % ALERT_CHANNELS;
+     float s = spread[r.channel];
+     r.threshold = kind <= ALERT_BELOW ? level[r.channel] + (kind == ALERT_ABOVE ? 1 : -1) * s * (1 + random() % 4)
+                                       : s * (1 + random() % 8);
+     r.hysteresis = s * (random() % 3) / 2;
+     r.holdMs = (random() % 4) * 500;
+     r.windowMs = 1000 * (1 + random() % 600);
+   }
+   std::vector<AlertState> states(ruleCount);
+   AlertEngine engine;
+   if (!engine.begin(rules.data(), states.data(), ruleCount)) {
+     printf("generated table rejected\n");
+     return 1;
+   }
+
+   // Sample schedule per millisecond, values as noisy random walks
+   static const uint32_t period[ALERT_CHANNELS] = { 125, 125, 125, 10, 10, 20 };
+   float value[ALERT_CHANNELS];
+   for (int c = 0; c < ALERT_CHANNELS; c++) value[c] = level[c];
+   std::normal_distribution<float> noise(0, 1);
+   std::vector<float> walk(ALERT_CHANNELS * 1000);
+   for (float& w : walk) w = noise(random);
+
+   uint64_t samples = 0, events = 0;
+   auto start = std::chrono::steady_clock::now();
+   for (uint32_t now = 0; now < (uint32_t)seconds * 1000; now++) {
+     for (int c = 0; c < ALERT_CHANNELS; c++) {
+       if (now % period[c]) continue;
+       value[c] += spread[c] * 0.3f * walk[(c * 1000 + now / period[c]) % walk.size()];
+       value[c] += (level[c] - value[c]) * 0.01f;
+       engine.sample(c, value[c], now);
+       samples++;
+     }
+     AlertEvent event;
+     while (engine.poll(event)) events++;
+   }
+   double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   printf("\n%d rules, %d s simulated: %llu samples, %u evaluations, %llu events (%u dropped)\n", ruleCount,
+          seconds, (unsigned long long)samples, engine.evaluations(), (unsigned long long)events,
+          engine.eventsDropped());
+   printf("host: %.2f s, %.1f M rule evaluations/s, %.0f ns/evaluation, %.1f us/sample\n", elapsed,
+          engine.evaluations() / elapsed / 1e6, elapsed * 1e9 / engine.evaluations(), elapsed * 1e6 / samples);
+   printf("realtime load of the table at firmware rates: %.3f%% of one host core\n",
+          elapsed / seconds * 100);
+
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
@@ -0,0 +1,251 @@
+// Accuracy test and cost benchmark for the barometric altitude estimator
+//
+// Runs the firmware's AltitudeEstimator (src/baro_altitude.cpp, compiled in
+// as is) on the host:
+//
+//   g++ -O2 -std=c++17 -Isrc -o altitude_bench tools/altitude_bench.cpp src/baro_altitude.cpp
+//   altitude_bench [--seed n]
+//
+// 1. The table against the formula in double precision over its whole range
+//    for three QNH values, and the powf() fallback outside it.
+// 2. The filter on simulated flights with BME280-like pressure noise (about
+//    1.2 Pa RMS at x16 oversampling and 8 Hz, 3.3 Pa at x1 and 1 Hz gated),
+//    against the true altitude and vertical speed: standing still, an
+//    elevator ride with and without a fused accelerometer, a QNH change in
+//    flight and a gap in the samples. The raw samples and a finite
+//    difference of them are reported next to it.
+// 3. Cost per call of the table, of powf() and of a whole update.
+//
+// Host timing only ranks the methods: the ESP32-S3 runs powf() in software
+// (a log and an exp), the table is a multiply, a load pair and a lerp.
+
+#include "baro_altitude.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+   if (condition) return;
+   printf("FAIL: %s\n", what);
+   failures++;
+}
+
+static double formula(double pressure, double qnh) {
+   return 44330.77 * (1.0 - pow(pressure / qnh, 0.190263));
+}
+
+static double pressureAt(double altitude, double qnh) {
+   return qnh * pow(1.0 - altitude / 44330.77, 1.0 / 0.190263);
+}
+
+static void tableAccuracy() {
+   printf("table vs formula (double), %d points\n", BARO_TABLE_SIZE);
+   AltitudeEstimator estimator;
+   estimator.begin();
+   const double qnhs[] = { 980.0, 1013.25, 1040.0 };
+   double worstAll = 0;
+   for (double qnh : qnhs) {
+     double worst = 0, worstAt = 0, worstLow = 0, worstPowf = 0;
+     for (double ratio = BARO_RATIO_MIN; ratio < BARO_RATIO_MAX; ratio += 1e-5) {
+       double p = ratio * qnh;
+       double exact = formula(p, qnh);
+       double error = fabs(AltitudeEstimator::pressureAltitude(p, qnh) - exact);
+       worstPowf = fmax(worstPowf, fabs(AltitudeEstimator::exactAltitude(p, qnh) - exact));
+       if (error > worst) { worst = error; worstAt = exact; }
+       if (exact < 3000) worstLow = fmax(worstLow, error);
+     }
+     printf("  QNH %7.2f: max error %.3f m (at %.0f m), %.3f m below 3 km; powf %.3f m\n", qnh, worst, worstAt,
+            worstLow, worstPowf);
+     worstAll = fmax(worstAll, worst);
+     check(worstLow < 0.05, "table within 5 cm below 3 km");
+   }
+   check(worstAll < 0.2, "table within 20 cm over its range");
+   float outside = AltitudeEstimator::pressureAltitude(200.0f, 1013.25f);
+   check(outside == AltitudeEstimator::exactAltitude(200.0f, 1013.25f), "powf() outside the table");
+   check(fabs(AltitudeEstimator::pressureAltitude(1013.25f, 1013.25f)) < 0.025, "QNH itself is 0 m");
+}
+
+struct Flight {
+   const char* name;
+   uint32_t periodMs;
+   double noisePa;
+   double seconds;
+   std::function<double(double)> altitude;     // True altitude over time
+   double accelNoise;                          // < 0: no IMU
+};
+
+struct FlightResult {
+   double rawRms, altRms, diffSpeedRms, speedRms, speedMax, finalError;
+};
+
+// Trajectory with rest, constant acceleration, cruise, deceleration, rest
+static double elevator(double t) {
+   const double start = 20, ramp = 2, cruise = 30, a = 1.0;
+   double v = a * ramp;
+   if (t < start) return 100;
+   t -= start;
+   if (t < ramp) return 100 + 0.5 * a * t * t;
+   double h = 100 + 0.5 * a * ramp * ramp;
+   t -= ramp;
+   if (t < cruise) return h + v * t;
+   h += v * cruise;
+   t -= cruise;
+   if (t < ramp) return h + v * t - 0.5 * a * t * t;
+   return h + v * ramp - 0.5 * a * ramp * ramp;
+}
+
+static FlightResult fly(const Flight& flight, unsigned seed, double qnhChangeAt = -1) {
+   std::mt19937 random(seed);
+   std::normal_distribution<double> noise(0, 1);
+   AltitudeEstimator estimator;
+   estimator.begin(1013.25f);
+   double qnh = 1013.25;
+   double sumRaw = 0, sumAlt = 0, sumDiff = 0, sumSpeed = 0, speedMax = 0;
+   int n = 0;
+   double lastRaw = NAN;
+   const double settle = 5;              // Filter start-up not scored
+   for (uint32_t ms = 0; ms <= flight.seconds * 1000; ms += flight.periodMs) {
+     double t = ms / 1000.0;
+     if (qnhChangeAt >= 0 && t >= qnhChangeAt && qnh == 1013.25) {
+       qnh = 1020.0;
+       estimator.setQnh(1020.0f);
+     }
+     // The weather does not change with the QNH setting; the reading does
+     double truth = flight.altitude(t);
+     double pressure = pressureAt(truth, 1013.25) + flight.noisePa * noise(random) / 100.0;
+     double accel = NAN;
+     if (flight.accelNoise >= 0) {
+       const double h = 0.001;
+       accel = (flight.altitude(t + h) - 2 * truth + flight.altitude(t - h)) / (h * h) + flight.accelNoise * noise(random);
+     }
+     estimator.update(pressure, 1000 + ms, accel);
+     double expected = truth + formula(pressureAt(truth, 1013.25), qnh) - formula(pressureAt(truth, 1013.25), 1013.25);
+     double speed = (flight.altitude(t + 0.01) - flight.altitude(t - 0.01)) / 0.02;
+     double raw = estimator.measured();
+     if (t >= settle) {
+       sumRaw += (raw - expected) * (raw - expected);
+       sumAlt += (estimator.altitude() - expected) * (estimator.altitude() - expected);
+       double diff = std::isnan(lastRaw) ? 0 : (raw - lastRaw) * 1000.0 / flight.periodMs;
+       sumDiff += (diff - speed) * (diff - speed);
+       double speedError = estimator.verticalSpeed() - speed;
+       sumSpeed += speedError * speedError;
+       speedMax = fmax(speedMax, fabs(speedError));
+       n++;
+     }
+     lastRaw = raw;
+   }
+   FlightResult result;
+   result.rawRms = sqrt(sumRaw / n);
+   result.altRms = sqrt(sumAlt / n);
+   result.diffSpeedRms = sqrt(sumDiff / n);
+   result.speedRms = sqrt(sumSpeed / n);
+   result.speedMax = speedMax;
+   double endTruth = flight.altitude(flight.seconds);
+   result.finalError = estimator.altitude() -
+                       (endTruth + formula(pressureAt(endTruth, 1013.25), qnh) - formula(pressureAt(endTruth, 1013.25), 1013.25));
+   printf("  %-28s alt rms %5.2f m (raw %5.2f)  speed rms %5.2f m/s (max %5.2f, raw diff %5.2f)  end %+5.2f m\n",
+          flight.name, result.altRms, result.rawRms, result.speedRms, result.speedMax, result.diffSpeedRms,
+          result.finalError);
+   return result;
+}
+
+static void flights(unsigned seed) {
+   printf("\nfilter on simulated flights\n");
+   Flight still = { "standing, 8 Hz", 125, 1.2, 600, [](double) { return 250.0; }, -1 };
+   FlightResult r = fly(still, seed);
+   check(r.altRms < r.rawRms * 0.5, "standing: filter halves the altitude noise");
+   check(r.speedRms < 0.1, "standing: vertical speed within 0.1 m/s rms");
+
+   Flight gated = { "standing, gated 1 Hz", 1000, 3.3, 600, [](double) { return 250.0; }, -1 };
+   r = fly(gated, seed);
+   check(r.altRms < r.rawRms, "gated: filter below the raw noise");
+   check(r.speedRms < r.diffSpeedRms * 0.75, "gated: vertical speed better than differencing");
+
+   Flight ride = { "elevator, 8 Hz", 125, 1.2, 80, elevator, -1 };
+   FlightResult plain = fly(ride, seed);
+   check(plain.speedRms < plain.diffSpeedRms * 0.5, "elevator: speed far better than differencing");
+   check(plain.speedRms < 0.3, "elevator: speed within 0.3 m/s rms");
+   check(fabs(plain.finalError) < 0.5, "elevator: settles on the final altitude");
+
+   Flight imu = { "elevator, 8 Hz + IMU", 125, 1.2, 80, elevator, 0.05 };
+   FlightResult fused = fly(imu, seed);
+   check(fused.speedRms < plain.speedRms, "elevator: IMU improves vertical speed");
+   check(fused.speedMax < plain.speedMax, "elevator: IMU removes the lag at the ramps");
+
+   Flight qnh = { "elevator, QNH 1020 at 40 s", 125, 1.2, 80, elevator, -1 };
+   FlightResult changed = fly(qnh, seed, 40.0);
+   check(fabs(changed.speedRms - plain.speedRms) < 0.02, "QNH change does not read as a climb");
+   check(fabs(changed.finalError) < 0.5, "QNH change: altitude follows the new reference");
+
+   // Gap: the filter restarts at the measurement instead of extrapolating
+   AltitudeEstimator estimator;
+   estimator.begin();
+   for (uint32_t ms = 0; ms < 10000; ms += 125) {
+     estimator.update(pressureAt(100 + ms / 1000.0, 1013.25), ms, NAN);    // 1 m/s
+   }
+   estimator.update(pressureAt(500, 1013.25), 10000 + BARO_MAX_GAP_MS + 1, NAN);
+   check(fabs(estimator.altitude() - 500) < 0.01 && estimator.verticalSpeed() == 0, "gap restarts the filter");
+   estimator.update(NAN, 20000, NAN);
+   check(estimator.updates() == 81, "NaN pressure skipped");
+}
+
+template <typename F> static double nsPerCall(F f, int calls) {
+   auto start = std::chrono::steady_clock::now();
+   f(calls);
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 / calls;
+}
+
+static void cost() {
+   printf("\ncost per call (host)\n");
+   const int calls = 20000000;
+   volatile float sink = 0;
+   AltitudeEstimator estimator;
+   estimator.begin();
+   // Noisy pressures around 900 hPa, so nothing is folded into a constant
+   std::mt19937 random(1);
+   std::normal_distribution<float> noise(900.0f, 0.5f);
+   float pressures[1024];
+   for (float& p : pressures) p = noise(random);
+   double table = nsPerCall([&](int n) {
+     for (int i = 0; i < n; i++) sink = sink + AltitudeEstimator::pressureAltitude(pressures[i & 1023], 1013.25f);
+   }, calls);
+   double exact = nsPerCall([&](int n) {
+     for (int i = 0; i < n; i++) sink = sink + AltitudeEstimator::exactAltitude(pressures[i & 1023], 1013.25f);
+   }, calls);
+   double update = nsPerCall([&](int n) {
+     uint32_t ms = 0;
+     for (int i = 0; i < n; i++, ms += 125) estimator.update(pressures[i & 1023], ms, NAN);
+     sink = sink + estimator.altitude();
+   }, calls);
+   printf("  table lookup   %6.2f ns\n  powf formula   %6.2f ns\n  filter update  %6.2f ns (table + predict + correct)\n",
+          table, exact, update);
+}
+
+int main(int argc, char** argv) {
+   unsigned seed = 1;
+   for (int i = 1; i < argc; i++) {
+     if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = atoi(argv[++i]);
+     else {
+       fprintf(stderr, "usage: altitude_bench [--seed n]\n");
+       return 2;
+     }
+   }
+
+   tableAccuracy();
+   flights(seed);
+   cost();
+
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
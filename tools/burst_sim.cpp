@@ -0,0 +1,347 @@
+// Host test of the event-triggered burst capture
+//
+// Drives the firmware's BurstCapture (src/burst_capture.cpp, compiled in as
+// is) the way loop() does: one sample per BURST_SAMPLE_MS and one chunk
+// publish per BURST_CHUNK_INTERVAL, where a publish can fail and the chunk is
+// then offered again. Triggers arrive at random, also while a capture is
+// filling or being sent. A ground station reassembles every capture from the
+// chunks and it is checked against a reference of what was sampled:
+//   - chunk headers (magic, version, trigger, capture id, index, count,
+//     length) and that a refused chunk comes back byte for byte
+//   - the capture header: trigger, interval, sample counts, trigger times
+//     and the CRC-32 over the samples (computed here with a table, as zlib)
+//   - the samples: up to BURST_PRE_SAMPLES of history ending with the
+//     trigger sample, then BURST_POST_SAMPLES more; samples taken during the
+//     downlink are not kept, so a capture right after one has a short history
+//   - triggers during a capture, or before any sample after re-arming, are
+//     refused and counted by missed()
+//   - the state, sampling() and chunksLeft() at every step
+//   - no heap allocation inside any BurstCapture call
+//
+//   g++ -O2 -std=c++17 -Isrc -o burst_sim tools/burst_sim.cpp src/burst_capture.cpp
+//   burst_sim [--seed n] [--minutes n] [--drop percent]
+
+#include "burst_capture.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#define TRIGGER_MEAN_MS  6000    // Mean time between random triggers
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+   if (condition) return;
+   printf("FAIL: %s\n", what);
+   failures++;
+}
+
+// ---------------------------------------------------------------------------
+// Allocation counter (glibc): every malloc, calloc and realloc goes through here
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+
+static size_t allocations = 0;
+
+extern "C" void* malloc(size_t size) {
+   allocations++;
+   return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+   allocations++;
+   return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+   allocations++;
+   return __libc_realloc(pointer, size);
+}
+
+// ---------------------------------------------------------------------------
+// Ground side
+
+static uint32_t crcTable[256];
+
+static void crcInit() {
+   for (uint32_t n = 0; n < 256; n++) {
+     uint32_t c = n;
+     for (int bit = 0; bit < 8; bit++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+     crcTable[n] = c;
+   }
+}
+
+static uint32_t crc32(const uint8_t* data, size_t length) {
+   uint32_t crc = 0xFFFFFFFF;
+   while (length--) crc = crcTable[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+   return ~crc;
+}
+
+static uint16_t get16(const uint8_t* in) {
+   return in[0] | in[1] << 8;
+}
+
+static uint32_t get32(const uint8_t* in) {
+   return get16(in) | (uint32_t)get16(in + 2) << 16;
+}
+
+struct Expected {
+   BurstTrigger source;
+   uint32_t triggerMs;
+   int64_t triggerUnix;
+   uint16_t preCount;
+   std::vector<BurstSample> samples;
+};
+
+struct Ground {
+   std::vector<uint8_t> capture;
+   uint16_t captureId = 0;
+   uint16_t nextChunk = 0;
+   uint16_t chunkCount = 0;
+   uint32_t completed = 0;
+};
+
+static bool sameSamples(const std::vector<BurstSample>& a, const uint8_t* b, size_t count) {
+   return a.size() == count && memcmp(a.data(), b, count * sizeof(BurstSample)) == 0;
+}
+
+static void checkCapture(const Ground& ground, const Expected& expected) {
+   const uint8_t* header = ground.capture.data();
+   size_t total = expected.samples.size();
+   check(ground.capture.size() == BURST_HEADER_BYTES + total * sizeof(BurstSample), "capture: length");
+   if (ground.capture.size() != BURST_HEADER_BYTES + total * sizeof(BurstSample)) return;
+
+   check(header[0] == expected.source && header[1] == BURST_VERSION, "capture: trigger and version");
+   check(get16(header + 2) == BURST_SAMPLE_MS, "capture: sample interval");
+   check(get16(header + 4) == total && total == expected.preCount + (size_t)BURST_POST_SAMPLES,
+         "capture: pre + post samples");
+   check(get16(header + 6) == expected.preCount && expected.preCount <= BURST_PRE_SAMPLES, "capture: pre count");
+   check(get32(header + 8) == expected.triggerMs, "capture: trigger time");
+   check((int64_t)((uint64_t)get32(header + 16) << 32 | get32(header + 12)) == expected.triggerUnix,
+         "capture: trigger Unix time");
+   const uint8_t* samples = header + BURST_HEADER_BYTES;
+   check(get32(header + 20) == crc32(samples, total * sizeof(BurstSample)), "capture: CRC of the samples");
+   check(sameSamples(expected.samples, samples, total), "capture: samples as taken, in order");
+
+   BurstSample trigger;
+   memcpy(&trigger, samples + (expected.preCount - 1) * sizeof(BurstSample), sizeof(trigger));
+   check(trigger.timeMs == expected.triggerMs, "capture: last pre-trigger sample is the trigger sample");
+}
+
+// One published chunk into the ground's reassembly buffer; true when a capture completed
+static bool receive(Ground& ground, const uint8_t* message, size_t length, uint16_t captures) {
+   check(length >= BURST_CHUNK_HEADER && message[0] == 'B' && message[1] == 'C' && message[2] == BURST_VERSION,
+         "chunk: magic and version");
+   if (length < BURST_CHUNK_HEADER) return false;
+   uint16_t id = get16(message + 4);
+   uint16_t index = get16(message + 6);
+   uint16_t count = get16(message + 8);
+   uint16_t payload = get16(message + 10);
+   check(id == captures, "chunk: capture id");
+   check(payload == length - BURST_CHUNK_HEADER && payload <= BURST_CHUNK_BYTES && payload > 0,
+         "chunk: payload length");
+
+   if (index == 0) {
+     ground.capture.clear();
+     ground.captureId = id;
+     ground.nextChunk = 0;
+     ground.chunkCount = count;
+   }
+   check(id == ground.captureId && index == ground.nextChunk && count == ground.chunkCount,
+         "chunk: in sequence, none lost or repeated after acknowledgement");
+   check(index + 1 == count || payload == BURST_CHUNK_BYTES, "chunk: only the last one short");
+   ground.capture.insert(ground.capture.end(), message + BURST_CHUNK_HEADER, message + length);
+   ground.nextChunk = index + 1;
+   if (ground.nextChunk < ground.chunkCount) return false;
+   ground.completed++;
+   return true;
+}
+
+// ---------------------------------------------------------------------------
+
+struct Stats {
+   uint32_t samples = 0;
+   uint32_t triggers = 0;
+   uint32_t refused = 0;
+   uint32_t shortHistory = 0;
+   uint32_t published = 0;
+   uint32_t dropped = 0;
+};
+
+static BurstSample makeSample(uint32_t n, std::mt19937& random) {
+   BurstSample sample;
+   sample.timeMs = 1000 + n * BURST_SAMPLE_MS;
+   sample.touchRight = 40000 + random() % 20000;
+   sample.touchLeft = 40000 + random() % 20000;
+   sample.pressure = (random() % 50 == 0) ? NAN : 1013.25f - n * 0.001f;   // NaN: BME280 missing
+   return sample;
+}
+
+static void session(BurstCapture& burst, uint32_t seed, uint32_t minutes, int dropPercent, Stats& stats) {
+   std::mt19937 random(seed);
+   std::exponential_distribution<double> gap(1.0 / TRIGGER_MEAN_MS);
+   Ground ground;
+   size_t moduleAllocations = 0;
+
+   // Reference: the samples since the ring was armed, and the capture being filled
+   enum { ARMED, POST, DOWNLINK } model = ARMED;
+   std::vector<BurstSample> history;
+   Expected expected;
+   int postLeft = 0;
+   uint16_t chunkTotal = 0;
+   uint16_t chunksAcked = 0;
+   uint32_t missed = 0;
+   bool stateOk = true;
+   bool refusedRepeats = true;
+   std::vector<uint8_t> refusedChunk;
+
+   uint32_t nextTriggerMs = 1000 + (uint32_t)gap(random);
+   uint32_t steps = minutes * 60000 / BURST_SAMPLE_MS;
+   uint8_t message[BURST_CHUNK_HEADER + BURST_CHUNK_BYTES];
+
+   for (uint32_t n = 0; n < steps; n++) {
+     BurstSample sample = makeSample(n, random);
+     stats.samples++;
+
+     // Right after a re-arm: a trigger before the first sample must be refused
+     bool earlyTrigger = model == ARMED && history.empty() && n > 0 && random() % 4 == 0;
+     if (earlyTrigger) {
+       size_t before = allocations;
+       bool taken = burst.trigger(BURST_TRIGGER_MANUAL, 0);
+       moduleAllocations += allocations - before;
+       check(!taken, "trigger before the first sample refused");
+       missed++;
+       stats.triggers++;
+       stats.refused++;
+     }
+
+     size_t before = allocations;
+     burst.add(sample);
+     moduleAllocations += allocations - before;
+     if (model != DOWNLINK) {
+       history.push_back(sample);
+       if (model == POST) {
+         expected.samples.push_back(sample);
+         if (--postLeft == 0) {
+           model = DOWNLINK;
+           uint32_t bytes = BURST_HEADER_BYTES + expected.samples.size() * sizeof(BurstSample);
+           chunkTotal = (bytes + BURST_CHUNK_BYTES - 1) / BURST_CHUNK_BYTES;
+           chunksAcked = 0;
+         }
+       }
+     }
+
+     if (sample.timeMs >= nextTriggerMs) {
+       nextTriggerMs = sample.timeMs + 1 + (uint32_t)gap(random);
+       BurstTrigger source = (BurstTrigger)(random() % BURST_TRIGGERS);
+       int64_t unixMicros = (random() % 3 == 0) ? 0 : 1700000000000000ll + sample.timeMs * 1000ll;
+       before = allocations;
+       bool taken = burst.trigger(source, unixMicros);
+       moduleAllocations += allocations - before;
+       stats.triggers++;
+       if (model == ARMED && !history.empty()) {
+         check(taken, "trigger while armed taken");
+         size_t pre = history.size() < BURST_PRE_SAMPLES ? history.size() : BURST_PRE_SAMPLES;
+         expected.source = source;
+         expected.triggerMs = sample.timeMs;
+         expected.triggerUnix = unixMicros;
+         expected.preCount = pre;
+         expected.samples.assign(history.end() - pre, history.end());
+         if (pre < BURST_PRE_SAMPLES) stats.shortHistory++;
+         postLeft = BURST_POST_SAMPLES;
+         model = POST;
+       } else {
+         check(!taken, "trigger during a capture refused");
+         missed++;
+         stats.refused++;
+       }
+     }
+
+     // loop()'s chunk pacing, with publishes that fail
+     if (n % (BURST_CHUNK_INTERVAL / BURST_SAMPLE_MS) == 0 && model == DOWNLINK) {
+       before = allocations;
+       size_t length = burst.chunk(message, sizeof(message));
+       size_t tooSmall = burst.chunk(message, BURST_CHUNK_HEADER);
+       moduleAllocations += allocations - before;
+       check(length > 0 && tooSmall == 0, "chunk: offered, refused into a short buffer");
+       if (!refusedChunk.empty() && !(refusedChunk.size() == length && !memcmp(refusedChunk.data(), message, length))) {
+         refusedRepeats = false;
+       }
+       if ((int)(random() % 100) < dropPercent) {
+         refusedChunk.assign(message, message + length);
+         stats.dropped++;
+       } else {
+         refusedChunk.clear();
+         stats.published++;
+         bool complete = receive(ground, message, length, burst.captures());
+         before = allocations;
+         burst.chunkSent();
+         moduleAllocations += allocations - before;
+         chunksAcked++;
+         check(complete == (chunksAcked == chunkTotal), "chunk: capture complete with the last chunk");
+         if (complete) {
+           checkCapture(ground, expected);
+           model = ARMED;
+           history.clear();
+         }
+       }
+     }
+
+     BurstState state = burst.status();
+     bool same = (model == ARMED && state == BURST_ARMED) || (model == POST && state == BURST_POST_TRIGGER) ||
+                 (model == DOWNLINK && state == BURST_DOWNLINK);
+     uint16_t left = model == DOWNLINK ? chunkTotal - chunksAcked : 0;
+     if (!same || burst.sampling() != (model != DOWNLINK) || burst.chunksLeft() != left ||
+         burst.missed() != missed) {
+       stateOk = false;
+     }
+   }
+
+   check(stateOk, "state, sampling(), chunksLeft() and missed() follow the reference at every step");
+   check(refusedRepeats, "a chunk whose publish failed is offered again unchanged");
+   check(ground.completed == burst.captures() || (model == DOWNLINK && ground.completed + 1 == burst.captures()),
+         "every frozen capture reassembled on the ground");
+   check(ground.completed > 2, "several captures completed");
+   check(moduleAllocations == 0, "no heap allocation inside BurstCapture calls");
+   printf("seed %u: %u captures (%u with a short history), %u of %u triggers missed, "
+          "%u chunks published, %u publishes failed\n", seed, ground.completed, stats.shortHistory, burst.missed(),
+          stats.triggers, stats.published, stats.dropped);
+}
+
+int main(int argc, char** argv) {
+   uint32_t seed = 1;
+   uint32_t minutes = 30;
+   int dropPercent = 20;
+   for (int i = 1; i < argc; i++) {
+     if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--minutes") && i + 1 < argc) minutes = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--drop") && i + 1 < argc) dropPercent = atoi(argv[++i]);
+     else {
+       fprintf(stderr, "usage: burst_sim [--seed n] [--minutes n] [--drop percent]\n");
+       return 2;
+     }
+   }
+   crcInit();
+
+   // A fresh object per session; the firmware's is a global
+   for (uint32_t run = 0; run < 3; run++) {
+     BurstCapture* burst = new BurstCapture;
+     Stats stats;
+     session(*burst, seed + run, minutes, run == 2 ? 0 : dropPercent, stats);
+     check(stats.refused > 0 && burst->missed() == stats.refused, "missed() counts every refused trigger");
+     delete burst;
+   }
+
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Reassemble and decode CADSE burst captures.
+
+Boards send each capture as numbered binary chunks on
+cadse/<year>/<board>/burst (see src/burst_capture.h). Record them with
+
+    mosquitto_sub -h <broker> -t 'cadse/+/+/burst' -F '%t %x' > bursts.log
+
+and decode with
+
+    burst_tool.py list bursts.log               # captures, completeness, CRC
+    burst_tool.py csv  bursts.log <board> <id>  # samples of one capture as CSV
+"""
+
+import struct
+import sys
+import zlib
+
+VERSION = 1
+CHUNK_HEADER = 12
+CAPTURE_HEADER = 24
+SAMPLE = struct.Struct("<IIIf")
+TRIGGERS = ["manual", "free_fall", "cat_alert"]
+
+
+def load(path):
+    """Return {(board, capture id): {"count": n, "trigger": t, "chunks": {index: payload}}}."""
+    captures = {}
+    for number, line in enumerate(open(path, encoding="latin-1"), 1):
+        parts = line.split()
+        if len(parts) != 2:
+            continue
+        topic, payload = parts
+        try:
+            data = bytes.fromhex(payload)
+        except ValueError:
+            sys.exit("%s:%d: payload is not hex (use -F '%%t %%x')" % (path, number))
+        if len(data) < CHUNK_HEADER or data[:2] != b"BC" or data[2] != VERSION:
+            continue
+        trigger, capture, index, count, length = struct.unpack_from("<BHHHH", data, 3)
+        if len(data) != CHUNK_HEADER + length:
+            sys.exit("%s:%d: chunk length mismatch" % (path, number))
+        board = topic.split("/")[2] if topic.count("/") >= 3 else topic
+        # Capture ids restart at 1 after a reboot; a new chunk count marks a new capture
+        entry = captures.setdefault((board, capture), {"count": count, "trigger": trigger, "chunks": {}})
+        if entry["count"] != count:
+            entry.update(count=count, trigger=trigger, chunks={})
+        entry["chunks"][index] = data[CHUNK_HEADER:]
+    return captures
+
+
+def assemble(entry):
+    """Return (capture bytes, missing chunk indices)."""
+    missing = [i for i in range(entry["count"]) if i not in entry["chunks"]]
+    if missing:
+        return None, missing
+    return b"".join(entry["chunks"][i] for i in range(entry["count"])), []
+
+
+def decode(blob):
+    """Return (header dict, samples); samples are (time_ms, touch_right, touch_left, pressure)."""
+    trigger, version, interval, total, before, trigger_ms, unix_us, crc = \
+        struct.unpack_from("<BBHHHIqI", blob, 0)
+    if version != VERSION:
+        sys.exit("capture version %d, expected %d" % (version, VERSION))
+    body = blob[CAPTURE_HEADER:]
+    if len(body) != total * SAMPLE.size:
+        sys.exit("capture holds %d bytes of samples, header says %d samples" % (len(body), total))
+    header = {
+        "trigger": TRIGGERS[trigger] if trigger < len(TRIGGERS) else str(trigger),
+        "interval_ms": interval,
+        "samples": total,
+        "before": before,
+        "trigger_ms": trigger_ms,
+        "trigger_unix_us": unix_us,
+        "crc_ok": zlib.crc32(body) == crc,
+    }
+    samples = [SAMPLE.unpack_from(body, i * SAMPLE.size) for i in range(total)]
+    return header, samples
+
+
+def main():
+    if len(sys.argv) < 3 or sys.argv[1] not in ("list", "csv"):
+        sys.exit(__doc__)
+    captures = load(sys.argv[2])
+
+    if sys.argv[1] == "list":
+        if not captures:
+            print("no burst chunks found")
+        for (board, capture), entry in sorted(captures.items()):
+            blob, missing = assemble(entry)
+            if missing:
+                print("%s #%d: incomplete, %d of %d chunks missing (%s)"
+                      % (board, capture, len(missing), entry["count"],
+                         ",".join(str(i) for i in missing[:10])))
+                continue
+            header, samples = decode(blob)
+            span = (samples[-1][0] - samples[0][0]) / 1000.0 if samples else 0
+            gaps = sum(1 for a, b in zip(samples, samples[1:])
+                       if b[0] - a[0] > 2 * header["interval_ms"])
+            print("%s #%d: %s, %d samples (%d before trigger) over %.2f s, %d gaps, CRC %s"
+                  % (board, capture, header["trigger"], header["samples"], header["before"],
+                     span, gaps, "ok" if header["crc_ok"] else "MISMATCH"))
+        return 0
+
+    if len(sys.argv) != 5:
+        sys.exit(__doc__)
+    key = (sys.argv[3], int(sys.argv[4]))
+    if key not in captures:
+        sys.exit("no capture %s #%s" % key)
+    blob, missing = assemble(captures[key])
+    if missing:
+        sys.exit("capture is missing chunks %s" % ",".join(str(i) for i in missing))
+    header, samples = decode(blob)
+    if not header["crc_ok"]:
+        sys.exit("capture CRC mismatch")
+    print("t_ms,touch_right,touch_left,pressure_hpa")
+    for time, right, left, pressure in samples:
+        # Time relative to the trigger; the pressure is NaN without a BME280
+        print("%d,%d,%d,%s" % (time - header["trigger_ms"], right, left,
+                               "" if pressure != pressure else "%.2f" % pressure))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,269 @@
+// Bus occupancy and transfer timing of the asynchronous display driver
+//
+// Runs the firmware's BufferedDisplay and I2cBus (src/buffered_display.cpp,
+// src/i2c_bus.cpp, compiled in as is) on the simulated clock, tasks and I2C
+// bus of tools/host:
+//
+//   g++ -O2 -std=c++17 -Isrc -Itools/host -o display_sim tools/display_sim.cpp src/buffered_display.cpp src/i2c_bus.cpp src/page_canvas.cpp tools/host/host_rtos.cpp -pthread
+//   display_sim [--seconds n] [--trace]
+//
+// Each scenario is a render loop submitting frames at a rate with a drawing
+// cost, next to BME280 reads at 8 Hz through the bus manager. An SSD1306
+// model decodes the traffic into panel RAM. Checked per scenario:
+//   - display() returns without waiting for the bus
+//   - every submitted frame is sent or counted as dropped, none while
+//     frames come slower than the bus and frame interval allow
+//   - frames reach the panel whole and in order, contrast changes only
+//     between frames, and after flush() the panel shows the last frame
+//   - transfers keep the frame interval, chunking costs at most 10% over
+//     the raw frame bytes, and no two transactions overlap on the bus
+//   - a BME280 read waits at most one display chunk
+// and reported: frames/s reached by the render loop and on the panel, bus
+// occupancy per device, transfer time, and the render loop rate the blocking
+// Adafruit_SSD1306::display() would have left.
+
+#include "buffered_display.h"
+#include "i2c_bus.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define SCREEN_WIDTH      128
+#define SCREEN_HEIGHT     64
+#define SCREEN_ADDRESS    0x3C
+#define BME280_ADDRESS    0x76
+#define FRAME_BYTES       (SCREEN_WIDTH * SCREEN_HEIGHT / 8)
+#define BME_PERIOD_MS     125
+
+static int failures = 0;
+static bool trace = false;
+
+static void check(bool condition, const char* scenario, const char* what) {
+   if (condition) return;
+   printf("FAIL: %s: %s\n", scenario, what);
+   failures++;
+}
+
+// SSD1306 in horizontal addressing mode, as far as the driver uses it
+struct Panel {
+   uint8_t ram[FRAME_BYTES];
+   uint8_t contrast = DISPLAY_CONTRAST_FULL;
+   int pointer = 0;
+   int frames = 0;              // Whole frames written
+   int framesOutOfOrder = 0;
+   int commandsInFrame = 0;     // Commands that cut into a frame
+   uint32_t lastTag = 0;
+   int written = 0;             // Data bytes since the last window command
+
+   void command(const uint8_t* data, size_t n) {
+     if (written != 0 && written != FRAME_BYTES) commandsInFrame++;
+     for (size_t i = 0; i < n; i++) {
+       if (data[i] == SSD1306_PAGEADDR || data[i] == SSD1306_COLUMNADDR) {
+         pointer = 0;
+         written = 0;
+         i += 2;
+       } else if (data[i] == SSD1306_SETCONTRAST && i + 1 < n) {
+         contrast = data[++i];
+       }
+     }
+   }
+
+   void data(const uint8_t* bytes, size_t n) {
+     for (size_t i = 0; i < n; i++) {
+       ram[pointer] = bytes[i];
+       pointer = (pointer + 1) % FRAME_BYTES;
+     }
+     written += n;
+     if (written == FRAME_BYTES) {
+       // Frames carry their number in the first four bytes
+       uint32_t tag;
+       memcpy(&tag, ram, sizeof(tag));
+       if (tag <= lastTag) framesOutOfOrder++;
+       lastTag = tag;
+       frames++;
+     }
+   }
+};
+
+struct Scenario {
+   const char* name;
+   uint32_t clock;              // Bus clock (Hz)
+   uint32_t framePeriodMs;      // Render loop submits one frame per period
+   uint32_t drawMs;             // Drawing cost per frame
+   uint32_t intervalMs;         // BufferedDisplay frame interval
+   bool expectDrops;
+};
+
+static const Scenario scenarios[] = {
+   { "mode 3, 20 fps, 400 kHz",         400000,  50,  5, DISPLAY_FRAME_INTERVAL, false },
+   { "mode 0, 1 fps, 400 kHz",          400000, 1000, 2, DISPLAY_FRAME_INTERVAL, false },
+   { "render bench, flat out, 400 kHz", 400000,   2,  2, DISPLAY_FRAME_INTERVAL, true },
+   { "mode 3, 20 fps, 100 kHz",         100000,  50,  5, DISPLAY_FRAME_INTERVAL, true },
+   { "mode 4, 10 fps, 100 kHz",         100000, 100,  5, DISPLAY_FRAME_INTERVAL, false },
+};
+
+struct BusUse {
+   uint64_t displayMicros = 0;
+   uint64_t bmeMicros = 0;
+   uint64_t longestDisplayMicros = 0;
+   uint64_t lastDisplayStart = 0;
+   uint64_t shortestFrameGap = UINT64_MAX;
+};
+
+// Time the blocking library path takes for one frame at a clock
+static uint64_t blockingFrameMicros(uint32_t clock) {
+   Wire.setClock(clock);
+   Adafruit_SSD1306* plain = new Adafruit_SSD1306(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, -1);
+   plain->begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS);
+   uint64_t micros = 0;
+   host::spawn("blocking", [&] {
+     uint64_t start = host::now();
+     plain->display();
+     micros = host::now() - start;
+   });
+   host::run(host::now() + 1000000);
+   return micros;
+}
+
+static void runScenario(const Scenario& s, uint32_t seconds) {
+   // Fresh objects per scenario; the old transfer tasks stay blocked on their notification
+   Panel* panel = new Panel;
+   BusUse* use = new BusUse;
+   I2cBus* bus = new I2cBus(Wire);
+   BufferedDisplay* display = new BufferedDisplay(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, -1);
+
+   int displayId = bus->addDevice("display", SCREEN_ADDRESS, SSD1306_MAX_CLOCK, I2C_PRIORITY_DISPLAY);
+   int bmeId = bus->addDevice("bme280", BME280_ADDRESS, BME280_MAX_CLOCK, I2C_PRIORITY_SENSOR);
+   bus->begin();
+   Wire.setClock(s.clock);
+   display->begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS);
+   display->attachBus(bus, displayId);
+   display->setFrameInterval(s.intervalMs);
+
+   host::setBusObserver([=](const host::BusTransaction& t, const uint8_t* data) {
+     uint64_t duration = t.end - t.start;
+     if (t.address == BME280_ADDRESS) {
+       use->bmeMicros += duration;
+       return;
+     }
+     use->displayMicros += duration;
+     if (duration > use->longestDisplayMicros) use->longestDisplayMicros = duration;
+     if (data[0] == 0x00) {
+       panel->command(data + 1, t.bytes - 1);
+       if (t.bytes > 2) {
+         // Window command: a frame transfer starts
+         if (use->lastDisplayStart && t.start - use->lastDisplayStart < use->shortestFrameGap) {
+           use->shortestFrameGap = t.start - use->lastDisplayStart;
+         }
+         use->lastDisplayStart = t.start;
+       }
+     } else {
+       panel->data(data + 1, t.bytes - 1);
+     }
+     if (trace) printf("  %10llu %-9s 0x%02x %3zu bytes\n", (unsigned long long)t.start, t.task, t.address, t.bytes);
+   });
+
+   const uint64_t start = host::now();
+   const uint32_t collisions = host::busCollisions();
+   const uint64_t end = start + (uint64_t)seconds * 1000000;
+   uint32_t submitted = 0;
+   uint64_t longestCall = 0;
+   uint64_t lastTransfer = 0;
+   uint8_t lastFrame[FRAME_BYTES];
+   bool finished = false;
+
+   host::spawn("loop", [&] {
+     uint64_t next = host::now();
+     while (host::now() < end) {
+       // A moving shape plus the frame number, so every frame differs
+       display->clearDisplay();
+       display->drawLine(0, submitted % SCREEN_HEIGHT, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1, SSD1306_WHITE);
+       display->fillCircle(submitted % SCREEN_WIDTH, 32, 10, SSD1306_WHITE);
+       submitted++;
+       memcpy(display->getBuffer(), &submitted, sizeof(submitted));
+       if (submitted == 3) display->setContrast(DISPLAY_CONTRAST_DIM);
+       delay(s.drawMs);
+
+       memcpy(lastFrame, display->getBuffer(), FRAME_BYTES);
+       uint64_t callStart = host::now();
+       display->display();
+       if (host::now() - callStart > longestCall) longestCall = host::now() - callStart;
+       if (display->lastTransferMicros()) lastTransfer = display->lastTransferMicros();
+
+       next += s.framePeriodMs * 1000;
+       if (next > host::now()) host::sleep(next - host::now());
+     }
+     display->flush();
+     finished = true;
+   });
+
+   host::spawn("bme280", [&] {
+     while (host::now() < end) {
+       {
+         I2cTransaction transaction(*bus, bmeId, BME280_PRESSURE_BYTES);
+         Wire.beginTransmission(BME280_ADDRESS);
+         Wire.write((uint8_t)0xF7);
+         Wire.endTransmission(false);
+         Wire.requestFrom((uint8_t)BME280_ADDRESS, (size_t)BME280_PRESSURE_BYTES - 2);
+       }
+       delay(BME_PERIOD_MS);
+     }
+   });
+
+   host::run(end + 2000000);
+   host::setBusObserver(nullptr);
+
+   double elapsed = seconds;
+   uint32_t sent = display->framesSent();
+   uint32_t dropped = display->framesDropped();
+   uint64_t ideal = (uint64_t)(2 + 9 * (1 + FRAME_BYTES)) * 1000000 / s.clock;
+   uint64_t blocking = blockingFrameMicros(s.clock);
+   double blockingFps = 1.0e6 / fmax(s.framePeriodMs * 1000.0, s.drawMs * 1000.0 + blocking);
+
+   printf("%s\n", s.name);
+   printf("  loop %.1f fps (blocking display() would allow %.1f), panel %.1f fps, %u dropped\n",
+          submitted / elapsed, blockingFps, sent / elapsed, dropped);
+   printf("  transfer %.1f ms (frame bytes alone %.1f ms), bus busy %.0f%% display, %.1f%% bme280\n",
+          lastTransfer / 1000.0, ideal / 1000.0, use->displayMicros / (elapsed * 1e4), use->bmeMicros / (elapsed * 1e4));
+   printf("  bme280 worst wait %u us, longest display transaction %llu us\n", bus->stats(bmeId).maxWaitMicros,
+          (unsigned long long)use->longestDisplayMicros);
+
+   check(finished, s.name, "render loop finished and flushed");
+   check(longestCall == 0, s.name, "display() returns without waiting for the bus");
+   check(sent + dropped == submitted, s.name, "every frame sent or counted as dropped");
+   check(s.expectDrops || dropped == 0, s.name, "no drops while frames come slower than the bus");
+   check(!s.expectDrops || dropped > 0, s.name, "frames faster than the bus are dropped, not queued");
+   check(panel->frames == (int)sent && panel->written == FRAME_BYTES, s.name, "frames reach the panel whole");
+   check(panel->framesOutOfOrder == 0, s.name, "frames reach the panel in order");
+   check(panel->commandsInFrame == 0, s.name, "commands only between frames");
+   check(panel->contrast == DISPLAY_CONTRAST_DIM, s.name, "contrast change reaches the panel");
+   check(memcmp(panel->ram, lastFrame, FRAME_BYTES) == 0, s.name, "panel shows the last frame after flush()");
+   check(use->shortestFrameGap >= s.intervalMs * 1000, s.name, "transfers keep the frame interval");
+   check(lastTransfer <= ideal * 1.1 + bus->stats(bmeId).busyMicros / bus->stats(bmeId).transactions, s.name,
+         "chunking within 10% of the frame bytes");
+   check(host::busCollisions() == collisions, s.name, "no overlapping transactions");
+   check(bus->stats(bmeId).maxWaitMicros <= use->longestDisplayMicros, s.name, "bme280 waits at most one chunk");
+}
+
+int main(int argc, char** argv) {
+   uint32_t seconds = 20;
+   for (int i = 1; i < argc; i++) {
+     if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--trace")) trace = true;
+     else {
+       fprintf(stderr, "usage: display_sim [--seconds n] [--trace]\n");
+       return 2;
+     }
+   }
+   Serial.setOutput(nullptr);
+
+   for (const Scenario& s : scenarios) runScenario(s, seconds);
+
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
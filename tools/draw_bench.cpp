@@ -0,0 +1,459 @@
+// Page-native drawing primitives vs the Adafruit_GFX path
+//
+// Draws the same mode-like scenes through the firmware's PageCanvas
+// (src/page_canvas.cpp, compiled in as is) and through a copy of the code
+// path Adafruit_GFX 1.12 / Adafruit_SSD1306 2.5 take for them: virtual
+// drawPixel with the rotation switch and bounds checks, writeLine, the
+// midpoint drawCircle, fillCircle via fillCircleHelper and the SSD1306
+// page-aware drawFastHLine/VLine internals. Every frame must come out
+// byte-identical, then both are timed:
+//
+//   g++ -O2 -std=c++17 -Isrc -o draw_bench tools/draw_bench.cpp src/page_canvas.cpp
+//   draw_bench [--seed n] [--frames n]
+//
+// Scenes: plotter (Mode 4: axes and 127 connected segments), attitude
+// (Mode 3: horizon, cross, ring r=24, roll mark), orbit (Mode 5: two filled
+// Earth discs, 128-segment orbit, satellite box), lines (random, half of them
+// clipped), rects (random fillRect) and inverse (lines, rects and discs in
+// SSD1306_INVERSE). Pixels/s counts the pixels each primitive covers.
+//
+// Host timings rank the two paths; the on-target numbers come from BENCH.
+
+#include "page_canvas.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#define WIDTH   128
+#define HEIGHT  64
+#define FRAME_BYTES (WIDTH * HEIGHT / 8)
+
+// ---- Reference: the Adafruit_GFX / Adafruit_SSD1306 code path ----
+
+// The library is a separate translation unit: its primitives are real calls,
+// never inlined into the loops that use them
+#define LIBRARY_CALL __attribute__((noinline))
+
+class GfxPath {
+public:
+   explicit GfxPath(uint8_t* frame) : buffer(frame) {}
+   virtual ~GfxPath() {}
+
+   // Adafruit_SSD1306::drawPixel
+   LIBRARY_CALL virtual void drawPixel(int16_t x, int16_t y, uint16_t color) {
+     if (x >= 0 && x < width && y >= 0 && y < height) {
+       switch (rotation) {
+         case 1: { int16_t t = x; x = WIDTH - y - 1; y = t; break; }
+         case 2: x = WIDTH - x - 1; y = HEIGHT - y - 1; break;
+         case 3: { int16_t t = x; x = y; y = HEIGHT - t - 1; break; }
+       }
+       switch (color) {
+         case PAGE_WHITE:   buffer[x + (y / 8) * WIDTH] |= (1 << (y & 7)); break;
+         case PAGE_BLACK:   buffer[x + (y / 8) * WIDTH] &= ~(1 << (y & 7)); break;
+         case PAGE_INVERSE: buffer[x + (y / 8) * WIDTH] ^= (1 << (y & 7)); break;
+       }
+     }
+   }
+
+   virtual void startWrite() {}
+   virtual void endWrite() {}
+   LIBRARY_CALL virtual void writePixel(int16_t x, int16_t y, uint16_t color) { drawPixel(x, y, color); }
+   LIBRARY_CALL virtual void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { drawFastVLine(x, y, h, color); }
+   LIBRARY_CALL virtual void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { drawFastHLine(x, y, w, color); }
+
+   // Adafruit_SSD1306::drawFastHLine at rotation 0
+   LIBRARY_CALL virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+     if (y < 0 || y >= HEIGHT) return;
+     if (x < 0) { w += x; x = 0; }
+     if (x + w > WIDTH) w = WIDTH - x;
+     if (w <= 0) return;
+     uint8_t* p = &buffer[(y / 8) * WIDTH + x];
+     uint8_t mask = 1 << (y & 7);
+     switch (color) {
+       case PAGE_WHITE:   while (w--) *p++ |= mask; break;
+       case PAGE_BLACK:   mask = ~mask; while (w--) *p++ &= mask; break;
+       case PAGE_INVERSE: while (w--) *p++ ^= mask; break;
+     }
+   }
+
+   // Adafruit_SSD1306::drawFastVLineInternal at rotation 0
+   LIBRARY_CALL virtual void drawFastVLine(int16_t x, int16_t yStart, int16_t hStart, uint16_t color) {
+     if (x < 0 || x >= WIDTH) return;
+     if (yStart < 0) { hStart += yStart; yStart = 0; }
+     if (yStart + hStart > HEIGHT) hStart = HEIGHT - yStart;
+     if (hStart <= 0) return;
+     uint8_t y = yStart, h = hStart;
+     uint8_t* p = &buffer[(y / 8) * WIDTH + x];
+     uint8_t mod = y & 7;
+     if (mod) {
+       static const uint8_t premask[8] = { 0x00, 0x80, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC, 0xFE };
+       mod = 8 - mod;
+       uint8_t mask = premask[mod];
+       if (h < mod) mask &= (0xFF >> (mod - h));
+       apply(p, mask, color);
+       p += WIDTH;
+     }
+     if (h >= mod) {
+       h -= mod;
+       if (h >= 8) {
+         if (color == PAGE_INVERSE) {
+           do { *p ^= 0xFF; p += WIDTH; h -= 8; } while (h >= 8);
+         } else {
+           uint8_t value = color != PAGE_BLACK ? 0xFF : 0;
+           do { *p = value; p += WIDTH; h -= 8; } while (h >= 8);
+         }
+       }
+       if (h) {
+         static const uint8_t postmask[8] = { 0x00, 0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F };
+         apply(p, postmask[h & 7], color);
+       }
+     }
+   }
+
+   // Adafruit_GFX::fillRect
+   LIBRARY_CALL virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+     startWrite();
+     for (int16_t i = x; i < x + w; i++) writeFastVLine(i, y, h, color);
+     endWrite();
+   }
+
+   // Adafruit_GFX::writeLine
+   LIBRARY_CALL virtual void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+     int16_t steep = abs(y1 - y0) > abs(x1 - x0);
+     if (steep) { std::swap(x0, y0); std::swap(x1, y1); }
+     if (x0 > x1) { std::swap(x0, x1); std::swap(y0, y1); }
+     int16_t dx = x1 - x0, dy = abs(y1 - y0);
+     int16_t err = dx / 2;
+     int16_t ystep = y0 < y1 ? 1 : -1;
+     for (; x0 <= x1; x0++) {
+       if (steep) writePixel(y0, x0, color); else writePixel(x0, y0, color);
+       err -= dy;
+       if (err < 0) { y0 += ystep; err += dx; }
+     }
+   }
+
+   // Adafruit_GFX::drawLine
+   LIBRARY_CALL virtual void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+     if (x0 == x1) {
+       if (y0 > y1) std::swap(y0, y1);
+       drawFastVLine(x0, y0, y1 - y0 + 1, color);
+     } else if (y0 == y1) {
+       if (x0 > x1) std::swap(x0, x1);
+       drawFastHLine(x0, y0, x1 - x0 + 1, color);
+     } else {
+       startWrite();
+       writeLine(x0, y0, x1, y1, color);
+       endWrite();
+     }
+   }
+
+   // Adafruit_GFX::drawCircle
+   LIBRARY_CALL void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+     int16_t f = 1 - r, ddFx = 1, ddFy = -2 * r, x = 0, y = r;
+     startWrite();
+     writePixel(x0, y0 + r, color);
+     writePixel(x0, y0 - r, color);
+     writePixel(x0 + r, y0, color);
+     writePixel(x0 - r, y0, color);
+     while (x < y) {
+       if (f >= 0) { y--; ddFy += 2; f += ddFy; }
+       x++;
+       ddFx += 2;
+       f += ddFx;
+       writePixel(x0 + x, y0 + y, color);
+       writePixel(x0 - x, y0 + y, color);
+       writePixel(x0 + x, y0 - y, color);
+       writePixel(x0 - x, y0 - y, color);
+       writePixel(x0 + y, y0 + x, color);
+       writePixel(x0 - y, y0 + x, color);
+       writePixel(x0 + y, y0 - x, color);
+       writePixel(x0 - y, y0 - x, color);
+     }
+     endWrite();
+   }
+
+   // Adafruit_GFX::fillCircle / fillCircleHelper
+   LIBRARY_CALL void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+     startWrite();
+     writeFastVLine(x0, y0 - r, 2 * r + 1, color);
+     int16_t f = 1 - r, ddFx = 1, ddFy = -2 * r, x = 0, y = r, px = x, py = y;
+     int16_t delta = 1;
+     while (x < y) {
+       if (f >= 0) { y--; ddFy += 2; f += ddFy; }
+       x++;
+       ddFx += 2;
+       f += ddFx;
+       if (x < y + 1) {
+         writeFastVLine(x0 + x, y0 - y, 2 * y + delta, color);
+         writeFastVLine(x0 - x, y0 - y, 2 * y + delta, color);
+       }
+       if (y != py) {
+         writeFastVLine(x0 + py, y0 - px, 2 * px + delta, color);
+         writeFastVLine(x0 - py, y0 - px, 2 * px + delta, color);
+         py = y;
+       }
+       px = x;
+     }
+     endWrite();
+   }
+
+private:
+   static void apply(uint8_t* p, uint8_t mask, uint16_t color) {
+     switch (color) {
+       case PAGE_WHITE:   *p |= mask; break;
+       case PAGE_BLACK:   *p &= ~mask; break;
+       case PAGE_INVERSE: *p ^= mask; break;
+     }
+   }
+
+   uint8_t* buffer;
+   int16_t width = WIDTH;
+   int16_t height = HEIGHT;
+   uint8_t rotation = 0;
+};
+
+// ---- Scenes ----
+
+enum OpType { OP_LINE, OP_CIRCLE, OP_FILL_CIRCLE, OP_FILL_RECT };
+
+struct Op {
+   OpType type;
+   int16_t a, b, c, d;
+   uint8_t color;
+};
+
+typedef std::vector<Op> Frame;
+
+struct Scene {
+   const char* name;
+   std::vector<Frame> frames;
+   uint64_t pixels = 0;          // Per pass over all frames
+};
+
+static void draw(GfxPath& gfx, const Frame& frame) {
+   for (const Op& op : frame) {
+     switch (op.type) {
+       case OP_LINE:        gfx.drawLine(op.a, op.b, op.c, op.d, op.color); break;
+       case OP_CIRCLE:      gfx.drawCircle(op.a, op.b, op.c, op.color); break;
+       case OP_FILL_CIRCLE: gfx.fillCircle(op.a, op.b, op.c, op.color); break;
+       case OP_FILL_RECT:   gfx.fillRect(op.a, op.b, op.c, op.d, op.color); break;
+     }
+   }
+}
+
+static void draw(PageCanvas& canvas, const Frame& frame) {
+   for (const Op& op : frame) {
+     switch (op.type) {
+       case OP_LINE:        canvas.line(op.a, op.b, op.c, op.d, op.color); break;
+       case OP_CIRCLE:      canvas.circle(op.a, op.b, op.c, op.color); break;
+       case OP_FILL_CIRCLE: canvas.fillCircle(op.a, op.b, op.c, op.color); break;
+       case OP_FILL_RECT:   canvas.fillRect(op.a, op.b, op.c, op.d, op.color); break;
+     }
+   }
+}
+
+static Scene plotterScene(std::mt19937& random, int count) {
+   Scene scene;
+   scene.name = "plotter";
+   std::uniform_int_distribution<int> step(-4, 4);
+   for (int f = 0; f < count; f++) {
+     Frame frame;
+     frame.push_back(Op{ OP_LINE, 0, 63, 127, 63, PAGE_WHITE });
+     frame.push_back(Op{ OP_LINE, 0, 25, 0, 63, PAGE_WHITE });
+     int y = 45;
+     for (int x = 0; x < WIDTH - 1; x++) {
+       int next = std::min(63, std::max(28, y + step(random)));
+       frame.push_back(Op{ OP_LINE, (int16_t)x, (int16_t)y, (int16_t)(x + 1), (int16_t)next, PAGE_WHITE });
+       y = next;
+     }
+     scene.frames.push_back(frame);
+   }
+   return scene;
+}
+
+static Scene attitudeScene(int count) {
+   Scene scene;
+   scene.name = "attitude";
+   const int cx = WIDTH / 2, cy = HEIGHT / 2, r = 24;
+   for (int f = 0; f < count; f++) {
+     double roll = (f * 360.0 / count - 180) * M_PI / 180;
+     double s = sin(roll), c = cos(roll);
+     Frame frame;
+     frame.push_back(Op{ OP_LINE, (int16_t)(cx - r * c), (int16_t)(cy + r * s), (int16_t)(cx + r * c),
+                         (int16_t)(cy - r * s), PAGE_WHITE });
+     frame.push_back(Op{ OP_LINE, cx - 10, cy, cx + 10, cy, PAGE_WHITE });
+     frame.push_back(Op{ OP_LINE, cx, cy - 5, cx, cy + 5, PAGE_WHITE });
+     frame.push_back(Op{ OP_CIRCLE, cx, cy, r, 0, PAGE_WHITE });
+     frame.push_back(Op{ OP_LINE, cx, cy - r, (int16_t)(cx + int(8 * s)), (int16_t)(cy - r + int(8 * c)), PAGE_WHITE });
+     scene.frames.push_back(frame);
+   }
+   return scene;
+}
+
+static Scene orbitScene(int count) {
+   Scene scene;
+   scene.name = "orbit";
+   const int cx = 32, cy = 36;
+   for (int f = 0; f < count; f++) {
+     Frame frame;
+     frame.push_back(Op{ OP_FILL_CIRCLE, cx, cy, 15, 0, PAGE_WHITE });
+     frame.push_back(Op{ OP_FILL_CIRCLE, cx + 2, cy - 2, 11, 0, PAGE_BLACK });
+     int px = 0, py = 0;
+     for (int i = 0; i <= 128; i++) {
+       double angle = i * 2 * M_PI / 128;
+       double radius = 22 + 6 * (0.5 + 0.5 * cos(angle + f * 0.1));
+       int x = cx + int(radius * cos(angle)), y = cy - int(radius * sin(angle));
+       if (i > 0) frame.push_back(Op{ OP_LINE, (int16_t)px, (int16_t)py, (int16_t)x, (int16_t)y, PAGE_WHITE });
+       px = x;
+       py = y;
+     }
+     double sat = f * 2 * M_PI / count;
+     int sx = cx + int(25 * cos(sat)), sy = cy - int(25 * sin(sat));
+     frame.push_back(Op{ OP_FILL_RECT, (int16_t)(sx - 2), (int16_t)(sy - 2), 5, 5, PAGE_WHITE });
+     scene.frames.push_back(frame);
+   }
+   return scene;
+}
+
+static Scene randomScene(const char* name, std::mt19937& random, int count, bool rects, bool inverse) {
+   Scene scene;
+   scene.name = name;
+   std::uniform_int_distribution<int> x(-16, WIDTH + 15), y(-16, HEIGHT + 15), size(1, 48), radius(0, 40);
+   for (int f = 0; f < count; f++) {
+     Frame frame;
+     for (int i = 0; i < 48; i++) {
+       uint8_t color = inverse ? PAGE_INVERSE : (i % 4 == 3 ? PAGE_BLACK : PAGE_WHITE);
+       if (inverse && i % 3 == 2) {
+         frame.push_back(Op{ OP_FILL_CIRCLE, (int16_t)x(random), (int16_t)y(random), (int16_t)radius(random), 0, color });
+       } else if (rects || (inverse && i % 3 == 1)) {
+         frame.push_back(Op{ OP_FILL_RECT, (int16_t)x(random), (int16_t)y(random), (int16_t)size(random),
+                             (int16_t)size(random), color });
+       } else {
+         frame.push_back(Op{ OP_LINE, (int16_t)x(random), (int16_t)y(random), (int16_t)x(random),
+                             (int16_t)y(random), color });
+       }
+     }
+     scene.frames.push_back(frame);
+   }
+   return scene;
+}
+
+// ---- Checks and timing ----
+
+static int popcount(const uint8_t* frame) {
+   int bits = 0;
+   for (int i = 0; i < FRAME_BYTES; i++) bits += __builtin_popcount(frame[i]);
+   return bits;
+}
+
+// Pixels covered by each primitive, drawn alone in white on a blank frame
+static void countPixels(Scene& scene) {
+   uint8_t frame[FRAME_BYTES];
+   GfxPath gfx(frame);
+   for (const Frame& ops : scene.frames) {
+     for (Op op : ops) {
+       memset(frame, 0, sizeof(frame));
+       op.color = PAGE_WHITE;
+       draw(gfx, Frame{ op });
+       scene.pixels += popcount(frame);
+     }
+   }
+}
+
+// Frames that differ between the two paths; radii cover the cached and uncached circles too
+static int mismatches(const Scene& scene) {
+   uint8_t expected[FRAME_BYTES], actual[FRAME_BYTES];
+   GfxPath gfx(expected);
+   PageCanvas canvas;
+   canvas.attach(actual, WIDTH, HEIGHT);
+   int bad = 0;
+   for (const Frame& frame : scene.frames) {
+     // Start from a patterned frame so BLACK and INVERSE have something to clear
+     for (int i = 0; i < FRAME_BYTES; i++) expected[i] = actual[i] = (uint8_t)(i * 37);
+     draw(gfx, frame);
+     draw(canvas, frame);
+     if (memcmp(expected, actual, FRAME_BYTES) != 0) bad++;
+   }
+   return bad;
+}
+
+template <typename Path>
+static double secondsFor(Path& path, uint8_t* frame, const Scene& scene, int passes) {
+   auto start = std::chrono::steady_clock::now();
+   for (int p = 0; p < passes; p++) {
+     for (const Frame& ops : scene.frames) {
+       memset(frame, 0, FRAME_BYTES);
+       draw(path, ops);
+     }
+   }
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+   uint32_t seed = 1;
+   int count = 64;
+   for (int i = 1; i < argc; i++) {
+     if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--frames") && i + 1 < argc) count = atoi(argv[++i]);
+     else {
+       fprintf(stderr, "usage: draw_bench [--seed n] [--frames n]\n");
+       return 2;
+     }
+   }
+   if (count < 1) count = 1;
+
+   std::mt19937 random(seed);
+   std::vector<Scene> scenes;
+   scenes.push_back(plotterScene(random, count));
+   scenes.push_back(attitudeScene(count));
+   scenes.push_back(orbitScene(count));
+   scenes.push_back(randomScene("lines", random, count, false, false));
+   scenes.push_back(randomScene("rects", random, count, true, false));
+   scenes.push_back(randomScene("inverse", random, count, false, true));
+
+   // Circles over every radius the cache and the large-radius walk handle, clipped and not
+   Scene circles;
+   circles.name = "circles";
+   for (int r = 0; r <= 80; r++) {
+     Frame frame;
+     frame.push_back(Op{ OP_CIRCLE, WIDTH / 2, HEIGHT / 2, (int16_t)r, 0, PAGE_WHITE });
+     frame.push_back(Op{ OP_CIRCLE, (int16_t)(r * 5 % WIDTH), (int16_t)(r * 3 % HEIGHT), (int16_t)(r / 2), 0,
+                         PAGE_INVERSE });
+     frame.push_back(Op{ OP_FILL_CIRCLE, (int16_t)(r * 3 % WIDTH), (int16_t)(r * 7 % HEIGHT), (int16_t)r, 0,
+                         (uint8_t)(r % 3) });
+     frame.push_back(Op{ OP_FILL_CIRCLE, WIDTH / 2, HEIGHT / 2, (int16_t)(80 - r), 0, PAGE_BLACK });
+     circles.frames.push_back(frame);
+   }
+   scenes.push_back(circles);
+
+   uint8_t frame[FRAME_BYTES];
+   GfxPath gfx(frame);
+   PageCanvas canvas;
+   canvas.attach(frame, WIDTH, HEIGHT);
+
+   int failed = 0;
+   printf("%-9s %6s %9s %10s %10s %12s %12s %8s\n", "scene", "frames", "mismatch", "gfx us/fr", "page us/fr",
+          "gfx Mpx/s", "page Mpx/s", "speedup");
+   for (Scene& scene : scenes) {
+     int bad = mismatches(scene);
+     failed += bad;
+     countPixels(scene);
+
+     // Aim for ~0.2 s of the slower path
+     int passes = 1;
+     while (secondsFor(gfx, frame, scene, passes) < 0.2 && passes < (1 << 20)) passes *= 2;
+     double gfxSeconds = secondsFor(gfx, frame, scene, passes);
+     double pageSeconds = secondsFor(canvas, frame, scene, passes);
+     double frames = (double)scene.frames.size() * passes;
+     printf("%-9s %6zu %9d %10.2f %10.2f %12.1f %12.1f %7.1fx\n", scene.name, scene.frames.size(), bad,
+            gfxSeconds * 1e6 / frames, pageSeconds * 1e6 / frames, scene.pixels * passes / gfxSeconds / 1e6,
+            scene.pixels * passes / pageSeconds / 1e6, gfxSeconds / pageSeconds);
+   }
+   printf("%s\n", failed ? "FRAMES DIFFER" : "all frames identical to the GFX path");
+   return failed ? 1 : 0;
+}
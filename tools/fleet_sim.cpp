@@ -0,0 +1,783 @@
+// Virtual satellite fleet simulator
+//
+// Runs hundreds of virtual CADSE boards against an in-process broker
+// stand-in and a ground station, to size the broker and ground side before
+// more real boards are added.
+//
+//   g++ -O2 -std=c++17 -Isrc -Itools/host -o fleet_sim tools/fleet_sim.cpp src/telecommand.cpp src/params.cpp src/telemetry_schema.cpp src/baro_altitude.cpp tools/host/host_rtos.cpp -pthread
+//   fleet_sim --sats 300 --rate 2 --duration 20 --commands 50 --capture fleet.txt
+//
+// Each satellite takes its board ID from a synthetic eFuse MAC the same way
+// resolveBoardId() does and uses the firmware's topics
+// (cadse/<year>/<board>/tm, /tc, /response). The firmware code is compiled
+// in as is: every satellite owns a ParameterRegistry (src/params.cpp, on a
+// file-backed Preferences namespace under /tmp), runs its telecommands
+// through parseTelecommand() and runTelecommand() (src/telecommand.cpp) and
+// encodes its telemetry with telemetryJson() (src/telemetry_schema.cpp), so
+// packets carry the current schema and responses are the firmware's own.
+// Sensor channels are simulated; commands that need hardware (TLE, OTA,
+// BURST, ...) are answered "Not simulated". Telemetry goes out every
+// telemetry_period_ms, and the firmware's timing record follows each command
+// on /ack (a mode change is acknowledged on the next pass, after its first
+// frame). Two fields are added for the measurement: "seq" (per board) and
+// "sent_us" (publish time on the reference clock). The /ack record comes from
+// telecommandAck(), so the round trip and command latencies below time the
+// firmware's own command path.
+//
+// Board clocks start up to --skew-ms off and drift by up to --drift-ppm. Like
+// TimeSync they report ts_us = 0 until their first SNTP exchange with the
+// time server stand-in, then resync every --sync-s. The stand-in answers with
+// the reference clock over a path with up to --ntp-jitter-ms of asymmetric
+// delay, which is what limits the offset estimate on a real network too.
+//
+// The broker routes every message through one dispatcher thread with a
+// bounded inbound queue and bounded per-subscriber queues, dropping on
+// overflow like a QoS 0 broker under load. The ground subscribes to
+// cadse/+/+/tm and cadse/+/+/response, sends telecommands at --commands per
+// second (one outstanding per board, matched by the response topic) and
+// reports:
+//   throughput   messages and bytes per second through the broker
+//   latency      publish to ground delivery, p50/p90/p99/max
+//   round trip   telecommand to response, p50/p90/p99/max
+//   clock error  board ts_us minus reference time at publish
+//   staleness    packet age at the ground computed from ts_us, as a ground tool would
+//   command      telecommand to ack, split into uplink (rx_us - sent), execution
+//                (exec_us) and downlink (ack arrival - done_us) on the board clock
+//   loss         sequence gaps seen by the ground vs. drops counted by the broker
+//
+// --capture writes the received telemetry in the "%U %t %p" line format that
+// tools/telemetry_store.cpp ingests.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "baro_altitude.h"
+#include "params.h"
+#include "telecommand.h"
+#include "telemetry_schema.h"
+
+#define MQTT_PREFIX     "cadse"
+#define MQTT_YEAR       2024
+#define QUEUE_CAPACITY  20000   // Messages per broker queue before drops
+#define WORKER_TICK_US  1000    // Scheduler granularity of the satellite workers
+
+static uint64_t nowMicros() {
+   static const auto start = std::chrono::steady_clock::now();
+   return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// ---- Broker stand-in ----
+
+struct Message {
+   std::string topic;
+   std::string payload;
+};
+
+class MessageQueue {
+public:
+   explicit MessageQueue(size_t capacity) : capacity(capacity) {}
+
+   // False (and the message is dropped) when the queue is full
+   bool push(Message&& message) {
+     {
+       std::lock_guard<std::mutex> guard(lock);
+       if (messages.size() >= capacity) return false;
+       messages.push_back(std::move(message));
+     }
+     ready.notify_one();
+     return true;
+   }
+
+   // Wait up to timeoutUs; false on timeout or when closed and empty
+   bool pop(Message& message, uint64_t timeoutUs) {
+     std::unique_lock<std::mutex> guard(lock);
+     if (!ready.wait_for(guard, std::chrono::microseconds(timeoutUs), [this] { return !messages.empty() || closed; })) {
+       return false;
+     }
+     if (messages.empty()) return false;
+     message = std::move(messages.front());
+     messages.pop_front();
+     return true;
+   }
+
+   // Non-blocking; the satellites poll their inboxes on every pass
+   bool tryPop(Message& message) {
+     std::lock_guard<std::mutex> guard(lock);
+     if (messages.empty()) return false;
+     message = std::move(messages.front());
+     messages.pop_front();
+     return true;
+   }
+
+   void close() {
+     {
+       std::lock_guard<std::mutex> guard(lock);
+       closed = true;
+     }
+     ready.notify_all();
+   }
+
+   // Closed and nothing left to pop
+   bool drained() {
+     std::lock_guard<std::mutex> guard(lock);
+     return closed && messages.empty();
+   }
+
+   size_t size() {
+     std::lock_guard<std::mutex> guard(lock);
+     return messages.size();
+   }
+
+private:
+   size_t capacity;
+   std::mutex lock;
+   std::condition_variable ready;
+   std::deque<Message> messages;
+   bool closed = false;
+};
+
+// MQTT topic filter match with + and # wildcards
+static bool topicMatches(const std::string& filter, const std::string& topic) {
+   size_t f = 0, t = 0;
+   while (f < filter.size()) {
+     if (filter[f] == '#') return true;
+     if (filter[f] == '+') {
+       while (t < topic.size() && topic[t] != '/') t++;
+       f++;
+     } else {
+       if (t >= topic.size() || filter[f] != topic[t]) return false;
+       f++;
+       t++;
+     }
+   }
+   return t == topic.size();
+}
+
+class Broker {
+public:
+   Broker() : inbound(QUEUE_CAPACITY) {}
+
+   // Exact topics go to a hash map, wildcard filters are checked in turn
+   void subscribe(const std::string& filter, MessageQueue* queue) {
+     std::lock_guard<std::mutex> guard(lock);
+     if (filter.find_first_of("+#") == std::string::npos) {
+       exact[filter].push_back(queue);
+     } else {
+       wildcards.push_back(std::make_pair(filter, queue));
+     }
+   }
+
+   void publish(Message&& message) {
+     published++;
+     bytes += message.topic.size() + message.payload.size();
+     if (!inbound.push(std::move(message))) inboundDrops++;
+   }
+
+   void start() { dispatcher = std::thread([this] { run(); }); }
+
+   void stop() {
+     inbound.close();
+     dispatcher.join();
+   }
+
+   std::atomic<uint64_t> published{0};
+   std::atomic<uint64_t> bytes{0};
+   std::atomic<uint64_t> inboundDrops{0};
+   std::atomic<uint64_t> routed{0};
+   std::atomic<uint64_t> outboundDrops{0};
+
+private:
+   MessageQueue inbound;
+   std::thread dispatcher;
+   std::mutex lock;
+   std::unordered_map<std::string, std::vector<MessageQueue*>> exact;
+   std::vector<std::pair<std::string, MessageQueue*>> wildcards;
+
+   void deliver(MessageQueue* queue, const Message& message) {
+     Message copy = message;
+     if (queue->push(std::move(copy))) {
+       routed++;
+     } else {
+       outboundDrops++;
+     }
+   }
+
+   void run() {
+     Message message;
+     for (;;) {
+       if (!inbound.pop(message, 100000)) {
+         if (inbound.drained()) return;
+         continue;
+       }
+       std::lock_guard<std::mutex> guard(lock);
+       auto found = exact.find(message.topic);
+       if (found != exact.end()) {
+         for (MessageQueue* queue : found->second) deliver(queue, message);
+       }
+       for (auto& filter : wildcards) {
+         if (topicMatches(filter.first, message.topic)) deliver(filter.second, message);
+       }
+     }
+   }
+};
+
+// ---- Time server stand-in ----
+
+// SNTP server on the reference clock (nowMicros()), reached over a path with
+// random one-way delays of up to jitterUs each
+class TimeServer {
+public:
+   explicit TimeServer(uint64_t jitterUs) : jitterUs(jitterUs) {}
+
+   // One request/response exchange started at reference time now by a client
+   // reading its clock through clientClock; returns the offset the client
+   // computes, ((t2 - t1) + (t3 - t4)) / 2 as in RFC 4330
+   template <typename Clock>
+   int64_t exchange(uint64_t now, Clock clientClock, std::minstd_rand& random) {
+     uint64_t up = jitterUs ? random() % jitterUs : 0;
+     uint64_t down = jitterUs ? random() % jitterUs : 0;
+     int64_t t1 = clientClock(now);
+     int64_t t2 = (int64_t)(now + up);
+     int64_t t3 = t2;
+     int64_t t4 = clientClock(now + up + down);
+     requests++;
+     return ((t2 - t1) + (t3 - t4)) / 2;
+   }
+
+   std::atomic<uint64_t> requests{0};
+
+private:
+   uint64_t jitterUs;
+};
+
+// ---- Virtual satellite ----
+
+struct ClockModel {
+   int64_t skewUs;         // Initial offset bound
+   double driftPpm;        // Oscillator error bound
+   uint64_t syncUs;        // SNTP poll interval
+};
+
+class VirtualSatellite {
+public:
+   VirtualSatellite(Broker& broker, TimeServer& timeServer, const ClockModel& clock, uint64_t mac, int periodMs)
+     : broker(broker), timeServer(timeServer), inbox(256), random((uint32_t)mac) {
+     // Same derivation as resolveBoardId(): device-specific half of the MAC
+     char id[16];
+     snprintf(id, sizeof(id), "%02x%02x%02x", (uint8_t)(mac >> 24), (uint8_t)(mac >> 32), (uint8_t)(mac >> 40));
+     boardId = id;
+     snprintf(id, sizeof(id), "%x%x", (uint32_t)(mac >> 32), (uint32_t)mac);
+     deviceId = id;
+
+     std::string base = std::string(MQTT_PREFIX) + "/" + std::to_string(MQTT_YEAR) + "/" + boardId + "/";
+     telemetryTopic = base + "tm";
+     commandTopic = base + "tc";
+     responseTopic = base + "response";
+     ackTopic = base + "ack";
+     broker.subscribe(commandTopic, &inbox);
+
+     // The firmware's registry on an empty namespace: defaults, then the fleet's rate
+     preferences.begin(boardId.c_str());
+     params.begin(preferences);
+     params.set(PARAM_TELEMETRY_PERIOD, periodMs);
+     bootUs = nowMicros();
+     // Spread the first packets so the fleet does not publish in lockstep
+     nextTelemetryUs = bootUs + random() % (periodMs * 1000ULL);
+
+     clockOffsetUs = clock.skewUs ? (int64_t)(random() % (2 * clock.skewUs)) - clock.skewUs : 0;
+     driftPpm = clock.driftPpm * ((int64_t)(random() % 2001) - 1000) / 1000.0;
+     syncIntervalUs = clock.syncUs;
+     // First sync once WiFi is up, within two seconds of boot
+     nextSyncUs = bootUs + random() % 2000000;
+   }
+
+   const std::string& board() const { return boardId; }
+
+   // Handle pending telecommands and publish when due; returns the next due time
+   uint64_t service(uint64_t now) {
+     if (now >= nextSyncUs) {
+       clockOffsetUs += timeServer.exchange(now, [this](uint64_t at) { return boardClock(at); }, random);
+       synced = true;
+       nextSyncUs = now + syncIntervalUs;
+     }
+     // Mode changes are acknowledged after the first frame in the new mode
+     if (!pendingAck.empty()) {
+       publishAck(pendingAck, pendingAckRx);
+       pendingAck.clear();
+     }
+     Message command;
+     while (inbox.tryPop(command)) {
+       uint64_t received = nowMicros();
+       if (handleCommand(command.payload)) {
+         publishAck(command.payload, received);
+       } else {
+         pendingAck = command.payload;
+         pendingAckRx = received;
+       }
+     }
+     if (now >= nextTelemetryUs) {
+       uint64_t periodUs = params.getInt(PARAM_TELEMETRY_PERIOD) * 1000ULL;
+       publishTelemetry(now);
+       nextTelemetryUs += periodUs;
+       if (nextTelemetryUs < now) nextTelemetryUs = now + periodUs; // Overloaded worker
+     }
+     return nextTelemetryUs;
+   }
+
+   uint64_t sent = 0;
+
+private:
+   Broker& broker;
+   TimeServer& timeServer;
+   MessageQueue inbox;
+   std::minstd_rand random;
+   std::string boardId, deviceId;
+   std::string telemetryTopic, commandTopic, responseTopic, ackTopic;
+   Preferences preferences;
+   ParameterRegistry params;
+   int mode = 0;
+   uint64_t bootUs;
+   uint64_t nextTelemetryUs;
+   uint32_t frames = 0;
+   uint32_t paced = 0;
+   int64_t clockOffsetUs;
+   double driftPpm;
+   uint64_t syncIntervalUs;
+   uint64_t nextSyncUs;
+   bool synced = false;
+   std::string pendingAck;
+   uint64_t pendingAckRx = 0;    // Reference clock, like the monotonic receipt time
+
+   // Free-running board clock on the reference time scale
+   int64_t boardClock(uint64_t now) const {
+     return (int64_t)now + clockOffsetUs + (int64_t)(driftPpm * now / 1e6);
+   }
+
+   // TimeSync::unixMicros(): 0 until the first sync
+   uint64_t wallClock(uint64_t now) const {
+     return synced ? (uint64_t)std::max<int64_t>(boardClock(now), 1) : 0;
+   }
+
+   void respond(const String& text) {
+     broker.publish(Message{ responseTopic, text.c_str() });
+   }
+
+   // publishCommandAck(): wall clock receipt and completion, execution time
+   // from the monotonic clock
+   void publishAck(const std::string& command, uint64_t received) {
+     uint64_t done = nowMicros();
+     String json = telecommandAck(command.c_str(), wallClock(received), wallClock(done), done - received);
+     broker.publish(Message{ ackTopic, json.c_str() });
+   }
+
+   // executeCommand() for the commands telecommand.cpp answers; false when
+   // the command completes on the next pass
+   bool handleCommand(const std::string& text) {
+     Telecommand command = parseTelecommand(text.c_str());
+     String response;
+     switch (runTelecommand(command, params, response)) {
+     case TC_MODE_CHANGE: {
+       bool change = command.number != mode;
+       mode = command.number;
+       respond(response);
+       return !change;
+     }
+     case TC_DONE:
+       respond(response);
+       return true;
+     default:
+       // TLE, OTA, burst capture, mirror, ...: hardware the fleet does not simulate
+       respond("Not simulated");
+       return true;
+     }
+   }
+
+   static StatsSummary stats(uint32_t count, float mean, float spread) {
+     return StatsSummary{ count, mean - spread, mean + spread, mean, spread / 2 };
+   }
+
+   // fillTelemetry() with simulated channels, encoded by the firmware's
+   // telemetryJson(); seq and sent_us are added for the ground's measurement
+   void publishTelemetry(uint64_t now) {
+     uint32_t noise = random();
+     uint32_t periodMs = params.getInt(PARAM_TELEMETRY_PERIOD);
+     frames += periodMs / 20;
+     paced += periodMs / params.modeInterval(mode);
+     char ip[16];
+     snprintf(ip, sizeof(ip), "10.0.%u.%u", (noise >> 8) % 256, noise % 256);
+     char i2c[160];
+     snprintf(i2c, sizeof(i2c),
+              "{\"display\":{\"bytes\":%u,\"busy_us\":%u,\"max_wait_us\":%u},"
+              "\"bme280\":{\"bytes\":%u,\"busy_us\":%u,\"max_wait_us\":%u}}",
+              frames * 1024, frames * 88, noise % 300, (unsigned)sent * 26, (unsigned)sent * 310, noise % 900);
+
+     TelemetryRecord record = {};
+     record.deviceId = deviceId.c_str();
+     record.boardId = boardId.c_str();
+     record.uptime = (uint32_t)((now - bootUs) / 1000000);
+     record.tsUs = wallClock(now);
+     record.monoUs = now - bootUs;
+     record.freeHeap = 180000 + noise % 4000;
+     record.mode = mode;
+     record.periodMs = periodMs;
+     record.batteryVoltage = stats(10, 3.8f + noise % 30 / 100.0f, 0.02f);
+     record.wifiStrength = -55 - (int32_t)(noise % 20);
+     record.defaultMode = params.getInt(PARAM_DEFAULT_MODE);
+     record.paramWrites = params.flashWrites();
+     record.usbVoltage = stats(10, 4.98f, 0.01f);
+     record.displayFrames = frames;
+     record.displayTransferUs = 9000 + noise % 400;
+     record.pacingTargetMs = params.modeInterval(mode);
+     record.pacingFrames = paced;
+     record.pacingLate = noise % 4 == 0;
+     record.powerOn = 5;
+     record.powerBusyPct = (1200 + noise % 300) / 100.0f;
+     record.touchRight = stats(50, 48000 + noise % 900, 120);
+     record.touchLeft = stats(50, 47000 + noise % 800, 110);
+     record.touchUp = stats(50, 51000 + noise % 700, 100);
+     record.touchDown = stats(50, 50500 + noise % 600, 90);
+     record.touchX = stats(50, 49000 + noise % 500, 80);
+     record.accelX = (98 + (int32_t)(noise % 4)) / 10.0f;
+     record.accelY = ((int32_t)((noise >> 4) % 10) - 5) / 10.0f;
+     record.accelZ = ((int32_t)((noise >> 8) % 10) - 5) / 10.0f;
+     record.gyroX = ((int32_t)((noise >> 12) % 40) - 20) / 10.0f;
+     record.gyroY = ((int32_t)((noise >> 16) % 40) - 20) / 10.0f;
+     record.gyroZ = ((int32_t)((noise >> 20) % 40) - 20) / 10.0f;
+     record.temperature = stats(8, 23.0f + noise % 100 / 100.0f, 0.05f);
+     record.pressure = stats(8, 1003.0f + noise % 100 / 100.0f, 0.04f);
+     record.humidity = stats(8, 41.0f + noise % 10 / 10.0f, 0.2f);
+     // Altitude at the qnh_hpa setting, so SET qnh_hpa shows up in the packets
+     record.qnh = params.getFloat(PARAM_QNH);
+     record.altitude = AltitudeEstimator::pressureAltitude(record.pressure.mean, record.qnh);
+     record.verticalSpeed = ((int32_t)(noise % 50) - 25) / 100.0f;
+     record.i2c = i2c;
+     record.ipAddress = ip;
+
+     char json[TELEMETRY_JSON_MAX];
+     size_t length = telemetryJson(record, TM_FULL, json, sizeof(json));
+     if (length == 0) return;
+     char extra[64];
+     snprintf(extra, sizeof(extra), ",\"seq\":%" PRIu64 ",\"sent_us\":%" PRIu64 "}", sent, now);
+     std::string payload(json, length - 1);
+     payload += extra;
+     broker.publish(Message{ telemetryTopic, payload });
+     sent++;
+   }
+};
+
+// ---- Ground station ----
+
+struct Percentiles {
+   std::vector<uint32_t> samples;
+
+   void add(uint64_t value) { samples.push_back((uint32_t)std::min<uint64_t>(value, UINT32_MAX)); }
+
+   std::string describe() {
+     if (samples.empty()) return "no samples";
+     std::sort(samples.begin(), samples.end());
+     auto at = [this](double q) { return samples[std::min(samples.size() - 1, (size_t)(q * samples.size()))]; };
+     char text[160];
+     snprintf(text, sizeof(text), "p50 %.2f ms  p90 %.2f ms  p99 %.2f ms  max %.2f ms  (%zu samples)",
+              at(0.50) / 1000.0, at(0.90) / 1000.0, at(0.99) / 1000.0, samples.back() / 1000.0, samples.size());
+     return text;
+   }
+};
+
+struct BoardTrack {
+   uint64_t expectedSeq = 0;
+   uint64_t received = 0;
+   uint64_t gaps = 0;
+   uint64_t commandSentUs = 0;   // 0 = no command outstanding (cleared by the ack)
+   bool responded = false;
+};
+
+// Durations measured across two clocks can come out negative
+static uint64_t positive(int64_t value) {
+   return value > 0 ? (uint64_t)value : 0;
+}
+
+class GroundStation {
+public:
+   GroundStation(Broker& broker, FILE* capture) : broker(broker), queue(QUEUE_CAPACITY * 4), capture(capture) {
+     broker.subscribe(std::string(MQTT_PREFIX) + "/+/+/tm", &queue);
+     broker.subscribe(std::string(MQTT_PREFIX) + "/+/+/response", &queue);
+     broker.subscribe(std::string(MQTT_PREFIX) + "/+/+/ack", &queue);
+   }
+
+   void start() { receiver = std::thread([this] { run(); }); }
+
+   void stop() {
+     queue.close();
+     receiver.join();
+   }
+
+   // Send one telecommand to a board with nothing outstanding
+   bool command(const std::string& board, const std::string& text) {
+     {
+       std::lock_guard<std::mutex> guard(lock);
+       BoardTrack& track = boards[board];
+       if (track.commandSentUs) return false;
+       track.commandSentUs = nowMicros();
+       track.responded = false;
+     }
+     commandsSent++;
+     broker.publish(Message{ std::string(MQTT_PREFIX) + "/" + std::to_string(MQTT_YEAR) + "/" + board + "/tc", text });
+     return true;
+   }
+
+   void report(uint64_t published) {
+     std::lock_guard<std::mutex> guard(lock);
+     uint64_t received = 0, gaps = 0;
+     for (auto& entry : boards) {
+       received += entry.second.received;
+       gaps += entry.second.gaps;
+     }
+     printf("telemetry:  %" PRIu64 " published, %" PRIu64 " received, %" PRIu64 " missing (%.3f%%), "
+            "%" PRIu64 " sequence gaps\n", published, received, published - received,
+            published ? 100.0 * (published - received) / published : 0.0, gaps);
+     printf("latency:    %s\n", latency.describe().c_str());
+     printf("commands:   %" PRIu64 " sent, %" PRIu64 " answered (%" PRIu64 " refused), %" PRIu64 " acknowledged\n",
+            commandsSent.load(), responses, refused, acks);
+     printf("round trip: %s\n", roundTrip.describe().c_str());
+     printf("clock:      %s\n", clockError.describe().c_str());
+     printf("staleness:  %s, %" PRIu64 " unsynced packets\n", staleness.describe().c_str(), unsynced);
+     printf("command:    %s\n", commandLatency.describe().c_str());
+     printf("  uplink:   %s\n", uplink.describe().c_str());
+     printf("  execute:  %s\n", execution.describe().c_str());
+     printf("  downlink: %s\n", downlink.describe().c_str());
+   }
+
+private:
+   Broker& broker;
+   MessageQueue queue;
+   FILE* capture;
+   std::thread receiver;
+   std::mutex lock;
+   std::map<std::string, BoardTrack> boards;
+   Percentiles latency;
+   Percentiles roundTrip;
+   Percentiles clockError;       // |ts_us - sent_us|
+   Percentiles staleness;        // Arrival - ts_us
+   Percentiles commandLatency;   // Telecommand to ack on the reference clock
+   Percentiles uplink;
+   Percentiles execution;
+   Percentiles downlink;
+   std::atomic<uint64_t> commandsSent{0};
+   uint64_t responses = 0;
+   uint64_t refused = 0;
+   uint64_t acks = 0;
+   uint64_t unsynced = 0;
+
+   // Response texts runTelecommand() and fleet_sim answer failures with
+   static bool refusal(const std::string& text) {
+     return text.rfind("Unknown ", 0) == 0 || text.rfind("Invalid ", 0) == 0 ||
+            text == "Parameter value out of range" || text == "Not simulated";
+   }
+
+   static uint64_t field(const std::string& json, const char* name) {
+     size_t at = json.find(name);
+     return at == std::string::npos ? 0 : strtoull(json.c_str() + at + strlen(name), nullptr, 10);
+   }
+
+   void run() {
+     Message message;
+     while (!queue.drained()) {
+       if (!queue.pop(message, 100000)) continue;
+       uint64_t now = nowMicros();
+       // cadse/<year>/<board>/<kind>
+       size_t kindAt = message.topic.rfind('/');
+       size_t boardAt = message.topic.rfind('/', kindAt - 1);
+       std::string board = message.topic.substr(boardAt + 1, kindAt - boardAt - 1);
+       bool telemetry = message.topic.compare(kindAt + 1, std::string::npos, "tm") == 0;
+       bool ack = message.topic.compare(kindAt + 1, std::string::npos, "ack") == 0;
+
+       std::lock_guard<std::mutex> guard(lock);
+       BoardTrack& track = boards[board];
+       if (telemetry) {
+         uint64_t seq = field(message.payload, "\"seq\":");
+         if (seq > track.expectedSeq) track.gaps += seq - track.expectedSeq;
+         track.expectedSeq = seq + 1;
+         track.received++;
+         uint64_t sentUs = field(message.payload, "\"sent_us\":");
+         latency.add(now - sentUs);
+         uint64_t timestamp = field(message.payload, "\"ts_us\":");
+         if (timestamp) {
+           clockError.add(positive(std::abs((int64_t)(timestamp - sentUs))));
+           staleness.add(positive((int64_t)(now - timestamp)));
+         } else {
+           unsynced++;
+         }
+         if (capture) {
+           auto wall = std::chrono::system_clock::now().time_since_epoch();
+           double seconds = std::chrono::duration<double>(wall).count();
+           fprintf(capture, "%.6f %s %s\n", seconds, message.topic.c_str(), message.payload.c_str());
+         }
+       } else if (ack) {
+         if (!track.commandSentUs) continue;
+         uint64_t received = field(message.payload, "\"rx_us\":");
+         uint64_t done = field(message.payload, "\"done_us\":");
+         commandLatency.add(now - track.commandSentUs);
+         // exec_us is on the monotonic clock, valid before the first sync too
+         execution.add(field(message.payload, "\"exec_us\":"));
+         if (received && done) {
+           uplink.add(positive((int64_t)(received - track.commandSentUs)));
+           downlink.add(positive((int64_t)(now - done)));
+         }
+         track.commandSentUs = 0;
+         acks++;
+       } else if (track.commandSentUs && !track.responded) {
+         roundTrip.add(now - track.commandSentUs);
+         track.responded = true;
+         responses++;
+         // The fleet's commands are all valid; a refusal means the command path broke
+         if (refusal(message.payload)) refused++;
+       }
+     }
+   }
+};
+
+// ---- Driver ----
+
+struct Options {
+   int satellites = 200;
+   double rate = 1.0;          // Telemetry packets per second per satellite
+   double duration = 10.0;     // Seconds
+   double commands = 20.0;     // Telecommands per second across the fleet
+   int workers = 4;
+   const char* capture = nullptr;
+   double skewMs = 500;        // Board clock offset bound before the first sync
+   double driftPpm = 50;
+   double syncS = 10;          // SNTP poll interval
+   double ntpJitterMs = 2;     // One-way delay bound to the time server
+};
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+   for (int i = 1; i < argc; i++) {
+     const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+     if (!value) return false;
+     if (!strcmp(argv[i], "--sats")) options.satellites = atoi(value);
+     else if (!strcmp(argv[i], "--rate")) options.rate = atof(value);
+     else if (!strcmp(argv[i], "--duration")) options.duration = atof(value);
+     else if (!strcmp(argv[i], "--commands")) options.commands = atof(value);
+     else if (!strcmp(argv[i], "--workers")) options.workers = atoi(value);
+     else if (!strcmp(argv[i], "--capture")) options.capture = value;
+     else if (!strcmp(argv[i], "--skew-ms")) options.skewMs = atof(value);
+     else if (!strcmp(argv[i], "--drift-ppm")) options.driftPpm = atof(value);
+     else if (!strcmp(argv[i], "--sync-s")) options.syncS = atof(value);
+     else if (!strcmp(argv[i], "--ntp-jitter-ms")) options.ntpJitterMs = atof(value);
+     else return false;
+     i++;
+   }
+   return options.satellites > 0 && options.rate > 0 && options.duration > 0 && options.workers > 0 &&
+          options.skewMs >= 0 && options.driftPpm >= 0 && options.syncS > 0 && options.ntpJitterMs >= 0;
+}
+
+int main(int argc, char** argv) {
+   Options options;
+   if (!parseOptions(argc, argv, options)) {
+     fprintf(stderr, "usage: fleet_sim [--sats n] [--rate hz] [--duration s] [--commands per_s] "
+                     "[--workers n] [--capture file] [--skew-ms ms] [--drift-ppm ppm] [--sync-s s] "
+                     "[--ntp-jitter-ms ms]\n");
+     return 2;
+   }
+   FILE* capture = options.capture ? fopen(options.capture, "w") : nullptr;
+   char directory[] = "/tmp/fleet_sim.XXXXXX";
+   if (!mkdtemp(directory)) {
+     perror("mkdtemp");
+     return 2;
+   }
+   Preferences::setDirectory(directory);
+   Serial.setOutput(nullptr);
+
+   Broker broker;
+   GroundStation ground(broker, capture);
+   TimeServer timeServer((uint64_t)(options.ntpJitterMs * 1000));
+   ClockModel clock = { (int64_t)(options.skewMs * 1000), options.driftPpm, (uint64_t)(options.syncS * 1e6) };
+   int periodMs = std::max(100, (int)(1000.0 / options.rate)); // telemetry_period_ms lower bound
+   std::vector<std::unique_ptr<VirtualSatellite>> fleet;
+   std::mt19937_64 macs(0xCAD5E);
+   for (int i = 0; i < options.satellites; i++) {
+     // Espressif OUI in the low bytes, random device-specific half
+     uint64_t mac = 0xF412FAULL | ((macs() & 0xFFFFFFULL) << 24);
+     fleet.emplace_back(new VirtualSatellite(broker, timeServer, clock, mac, periodMs));
+   }
+
+   broker.start();
+   ground.start();
+   uint64_t start = nowMicros();
+   uint64_t end = start + (uint64_t)(options.duration * 1e6);
+
+   // Each worker owns a slice of the fleet and sleeps until the earliest packet is due
+   std::vector<std::thread> workers;
+   for (int w = 0; w < options.workers; w++) {
+     workers.emplace_back([&, w] {
+       while (nowMicros() < end) {
+         uint64_t now = nowMicros();
+         uint64_t next = end;
+         for (size_t i = w; i < fleet.size(); i += options.workers) {
+           next = std::min(next, fleet[i]->service(now));
+         }
+         uint64_t after = nowMicros();
+         uint64_t wait = next > after ? std::min<uint64_t>(next - after, WORKER_TICK_US) : 0;
+         if (wait) std::this_thread::sleep_for(std::chrono::microseconds(wait));
+       }
+     });
+   }
+
+   // Telecommands to random boards at the requested rate
+   std::mt19937 pick(7);
+   const char* commandSet[] = { "M3", "GET telemetry_period_ms", "PARAMS", "SET_DEFAULT_M2", "M0",
+                                "SET qnh_hpa 1020.5", "SET mode3_interval_ms 40", "GET qnh_hpa" };
+   const size_t commandCount = sizeof(commandSet) / sizeof(commandSet[0]);
+   double commandInterval = options.commands > 0 ? 1e6 / options.commands : 0;
+   uint64_t nextCommand = start;
+   while (nowMicros() < end) {
+     if (commandInterval > 0 && nowMicros() >= nextCommand) {
+       const VirtualSatellite& target = *fleet[pick() % fleet.size()];
+       ground.command(target.board(), commandSet[pick() % commandCount]);
+       nextCommand += (uint64_t)commandInterval;
+     }
+     std::this_thread::sleep_for(std::chrono::microseconds(200));
+   }
+   for (std::thread& worker : workers) worker.join();
+
+   // Let the last commands reach the satellites and their answers come back
+   for (int round = 0; round < 50; round++) {
+     for (auto& satellite : fleet) satellite->service(0);
+     std::this_thread::sleep_for(std::chrono::milliseconds(2));
+   }
+   broker.stop();
+   ground.stop();
+   rmdir(directory);   // Nothing is committed: virtual millis() never reaches PARAMS_COMMIT_DELAY
+   double seconds = (nowMicros() - start) / 1e6;
+   if (capture) fclose(capture);
+
+   uint64_t published = 0;
+   for (auto& satellite : fleet) published += satellite->sent;
+   printf("fleet:      %d satellites at %.1f Hz for %.1f s, %d workers\n",
+          options.satellites, 1000.0 / periodMs, options.duration, options.workers);
+   printf("time:       %" PRIu64 " SNTP exchanges, skew %.0f ms, drift %.0f ppm, sync every %.0f s\n",
+          timeServer.requests.load(), options.skewMs, options.driftPpm, options.syncS);
+   printf("broker:     %" PRIu64 " in, %" PRIu64 " routed, %.0f msg/s, %.2f MB/s, "
+          "drops %" PRIu64 " inbound / %" PRIu64 " outbound\n",
+          broker.published.load(), broker.routed.load(), broker.published.load() / seconds,
+          broker.bytes.load() / 1e6 / seconds, broker.inboundDrops.load(), broker.outboundDrops.load());
+   ground.report(published);
+   return 0;
+}
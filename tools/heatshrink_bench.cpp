@@ -0,0 +1,327 @@
+// Round-trip test and throughput benchmark for the OTA heatshrink decoder
+//
+// Runs the firmware's HeatshrinkDecoder (src/heatshrink_decoder.cpp,
+// compiled in as is) on the host, writing into a file that stands in for the
+// update partition:
+//
+//   g++ -O2 -std=c++17 -Isrc -o heatshrink_bench tools/heatshrink_bench.cpp src/heatshrink_decoder.cpp
+//   heatshrink_bench [image]
+//
+// The images are compressed by the encoder below (same format as
+// `heatshrink -e -w 11 -l 4`); without an image argument the benchmark's own
+// executable stands in for a firmware image. Checked:
+//   1. A hand-assembled stream (literal plus an overlapping back-reference)
+//      decodes as the format specifies.
+//   2. Every image comes back byte for byte through the partition file, for
+//      empty, tiny, incompressible, all-zero, text and executable inputs.
+//   3. Streaming boundaries: the same output for input chunks of 1 to 33
+//      bytes, around the output block size, OTA_FETCH_BUFFER and random
+//      sizes; the sink only ever sees full blocks until finish().
+//   4. A sink that fails stops decoding and is not called again.
+// Then decode throughput from memory and into the partition file, in the
+// OTA_FETCH_BUFFER chunks runUrlOta() feeds. Host timing only ranks the work.
+
+#include "heatshrink_decoder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#define FETCH_CHUNK      1024    // OTA_FETCH_BUFFER
+#define MIN_MATCH        2       // A 16-bit back-reference beats two 9-bit literals
+#define MAX_MATCH        (1 << HEATSHRINK_LOOKAHEAD_BITS)
+#define WINDOW_SIZE      (1 << HEATSHRINK_WINDOW_BITS)
+#define MAX_CHAIN        256     // Candidates tried per position
+
+typedef std::vector<uint8_t> Bytes;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+   if (condition) return;
+   printf("FAIL: %s\n", what.c_str());
+   failures++;
+}
+
+// ---------------------------------------------------------------------------
+// Encoder: greedy LZSS over hash chains of two-byte prefixes
+
+class BitWriter {
+public:
+   explicit BitWriter(Bytes& out) : out(out) {}
+
+   void put(uint32_t value, int count) {
+     while (count--) {
+       current = (current << 1) | ((value >> count) & 1);
+       if (++used == 8) {
+         out.push_back(current);
+         current = 0;
+         used = 0;
+       }
+     }
+   }
+
+   // Zero padding of the final byte, as heatshrink writes it
+   void flush() {
+     if (used) out.push_back(current << (8 - used));
+     used = 0;
+   }
+
+private:
+   Bytes& out;
+   uint8_t current = 0;
+   int used = 0;
+};
+
+static Bytes compress(const Bytes& in) {
+   Bytes out;
+   BitWriter writer(out);
+   std::vector<int> head(1 << 16, -1);
+   std::vector<int> previous(in.size(), -1);
+   size_t pos = 0;
+
+   auto insert = [&](size_t at) {
+     if (at + 1 >= in.size()) return;
+     int key = in[at] << 8 | in[at + 1];
+     previous[at] = head[key];
+     head[key] = (int)at;
+   };
+
+   while (pos < in.size()) {
+     size_t bestLength = 0;
+     size_t bestDistance = 0;
+     if (pos + 1 < in.size()) {
+       int candidate = head[in[pos] << 8 | in[pos + 1]];
+       for (int tries = 0; candidate >= 0 && tries < MAX_CHAIN; tries++, candidate = previous[candidate]) {
+         size_t distance = pos - candidate;
+         if (distance > WINDOW_SIZE) break;
+         size_t length = 0;
+         while (length < MAX_MATCH && pos + length < in.size() && in[candidate + length] == in[pos + length]) {
+           length++;
+         }
+         if (length > bestLength) {
+           bestLength = length;
+           bestDistance = distance;
+           if (length == MAX_MATCH) break;
+         }
+       }
+     }
+
+     if (bestLength >= MIN_MATCH) {
+       writer.put(0, 1);
+       writer.put(bestDistance - 1, HEATSHRINK_WINDOW_BITS);
+       writer.put(bestLength - 1, HEATSHRINK_LOOKAHEAD_BITS);
+       for (size_t n = 0; n < bestLength; n++) insert(pos++);
+     } else {
+       writer.put(1, 1);
+       writer.put(in[pos], 8);
+       insert(pos++);
+     }
+   }
+   writer.flush();
+   return out;
+}
+
+// ---------------------------------------------------------------------------
+// Partition stand-in and sinks
+
+struct Partition {
+   FILE* file;
+   uint32_t writes = 0;
+   uint32_t shortBlocks = 0;     // Sink calls below the block size
+   uint32_t failAt = 0;          // Refuse the n-th write (1-based), 0 = never
+   uint32_t callsAfterFailure = 0;
+   bool failed = false;
+};
+
+static bool writePartition(const uint8_t* data, size_t length, void* context) {
+   Partition* partition = (Partition*)context;
+   if (partition->failed) partition->callsAfterFailure++;
+   partition->writes++;
+   if (length != HEATSHRINK_OUTPUT_SIZE) partition->shortBlocks++;
+   if (partition->writes == partition->failAt) {
+     partition->failed = true;
+     return false;
+   }
+   return fwrite(data, 1, length, partition->file) == length;
+}
+
+static bool discard(const uint8_t* data, size_t length, void* context) {
+   (void)data;
+   *(size_t*)context += length;
+   return true;
+}
+
+static Bytes readBack(FILE* file) {
+   Bytes data;
+   fflush(file);
+   long size = ftell(file);
+   data.resize(size);
+   rewind(file);
+   if (size > 0 && fread(data.data(), 1, size, file) != (size_t)size) data.clear();
+   return data;
+}
+
+// Decode into a fresh partition file, feeding the chunk sizes in turn
+static bool decodeToPartition(HeatshrinkDecoder& decoder, const Bytes& packed, const std::vector<size_t>& chunks,
+                              Partition& partition, Bytes& image) {
+   partition.file = tmpfile();
+   if (!partition.file) {
+     perror("tmpfile");
+     return false;
+   }
+   decoder.begin(writePartition, &partition);
+   bool ok = true;
+   size_t at = 0;
+   for (size_t n = 0; ok && at < packed.size(); n++) {
+     size_t length = chunks[n % chunks.size()];
+     if (length > packed.size() - at) length = packed.size() - at;
+     ok = decoder.feed(packed.data() + at, length);
+     at += length;
+   }
+   if (ok) ok = decoder.finish();
+   image = readBack(partition.file);
+   fclose(partition.file);
+   return ok;
+}
+
+// ---------------------------------------------------------------------------
+
+static void knownStream(HeatshrinkDecoder& decoder) {
+   // Literal 'a' (1 01100001), back-reference index 1 (0 00000000000),
+   // count 4 (0011, overlapping its own output), then zero padding
+   static const uint8_t stream[] = { 0xB0, 0x80, 0x01, 0x80 };
+   Partition partition;
+   Bytes image;
+   bool ok = decodeToPartition(decoder, Bytes(stream, stream + sizeof(stream)), { 1 }, partition, image);
+   check(ok && image == Bytes(5, 'a'), "hand-assembled stream decodes to \"aaaaa\"");
+   check(decoder.bytesIn() == sizeof(stream) && decoder.bytesOut() == 5, "hand-assembled stream: byte counts");
+}
+
+static void roundTrip(HeatshrinkDecoder& decoder, const char* name, const Bytes& original) {
+   Bytes packed = compress(original);
+   printf("  %-14s %8zu -> %8zu bytes (%5.1f%%)\n", name, original.size(), packed.size(),
+          original.empty() ? 0.0 : 100.0 * packed.size() / original.size());
+
+   std::mt19937 random(7);
+   std::vector<size_t> randomChunks;
+   for (int n = 0; n < 64; n++) randomChunks.push_back(1 + random() % 700);
+
+   std::vector<std::vector<size_t>> schedules;
+   for (size_t size = 1; size <= 33; size++) schedules.push_back({ size });
+   for (size_t size : { 255, 256, 257, 511, 512, 513, FETCH_CHUNK, 4096 }) schedules.push_back({ size });
+   schedules.push_back(randomChunks);
+
+   for (const std::vector<size_t>& chunks : schedules) {
+     std::string label = std::string(name) + ", chunks of " +
+                         (chunks.size() > 1 ? std::string("random size") : std::to_string(chunks[0]));
+     Partition partition;
+     Bytes image;
+     bool ok = decodeToPartition(decoder, packed, chunks, partition, image);
+     check(ok, label + ": decodes");
+     check(image == original, label + ": identical image");
+     check(decoder.bytesIn() == packed.size() && decoder.bytesOut() == original.size(), label + ": byte counts");
+     check(partition.shortBlocks <= 1, label + ": full blocks until finish()");
+     if (image != original) break;
+   }
+}
+
+static void failingSink(HeatshrinkDecoder& decoder, const Bytes& original) {
+   Bytes packed = compress(original);
+   Partition partition;
+   partition.failAt = 3;
+   Bytes image;
+   bool ok = decodeToPartition(decoder, packed, { FETCH_CHUNK }, partition, image);
+   check(!ok, "failing sink: decoding reports the failure");
+   check(partition.callsAfterFailure == 0, "failing sink: not called again");
+   check(image.size() == 2 * HEATSHRINK_OUTPUT_SIZE, "failing sink: only the blocks before it written");
+}
+
+static void throughput(HeatshrinkDecoder& decoder, const Bytes& original) {
+   Bytes packed = compress(original);
+   const size_t target = 64u << 20;
+   int rounds = (int)(target / (original.size() + 1)) + 1;
+
+   auto run = [&](bool toFile) {
+     size_t produced = 0;
+     Partition partition;
+     auto begin = std::chrono::steady_clock::now();
+     for (int round = 0; round < rounds; round++) {
+       if (toFile) {
+         partition.file = tmpfile();
+         decoder.begin(writePartition, &partition);
+       } else {
+         decoder.begin(discard, &produced);
+       }
+       for (size_t at = 0; at < packed.size(); at += FETCH_CHUNK) {
+         decoder.feed(packed.data() + at, std::min((size_t)FETCH_CHUNK, packed.size() - at));
+       }
+       decoder.finish();
+       if (toFile) fclose(partition.file);
+     }
+     double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+     double mbIn = (double)packed.size() * rounds / 1e6;
+     double mbOut = (double)original.size() * rounds / 1e6;
+     printf("  %-15s %7.1f MB/s compressed in, %7.1f MB/s image out\n", toFile ? "to partition" : "to memory",
+            mbIn / seconds, mbOut / seconds);
+   };
+   printf("\nthroughput, %d x %zu-byte image in %d-byte chunks\n", rounds, original.size(), FETCH_CHUNK);
+   run(false);
+   run(true);
+}
+
+static Bytes readFile(const char* path) {
+   Bytes data;
+   FILE* file = fopen(path, "rb");
+   if (!file) return data;
+   uint8_t buffer[4096];
+   size_t length;
+   while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) data.insert(data.end(), buffer, buffer + length);
+   fclose(file);
+   return data;
+}
+
+int main(int argc, char** argv) {
+   const char* imagePath = argc > 1 ? argv[1] : "/proc/self/exe";
+   Bytes executable = readFile(imagePath);
+   if (executable.empty()) {
+     fprintf(stderr, "cannot read %s\nusage: heatshrink_bench [image]\n", imagePath);
+     return 2;
+   }
+
+   // Heap-allocated like in runUrlOta()
+   HeatshrinkDecoder* decoder = new HeatshrinkDecoder;
+
+   knownStream(*decoder);
+
+   std::mt19937 random(1);
+   Bytes noise(65536);
+   for (uint8_t& value : noise) value = (uint8_t)random();
+   std::string text;
+   for (int line = 0; text.size() < 65536; line++) {
+     text += "frame " + std::to_string(line) + ": T=" + std::to_string(20 + line % 7) + ".5 C, p=" +
+             std::to_string(1000 + line % 31) + " hPa\n";
+   }
+
+   printf("round trips\n");
+   roundTrip(*decoder, "empty", Bytes());
+   roundTrip(*decoder, "one byte", Bytes(1, 0x5A));
+   roundTrip(*decoder, "random", noise);
+   roundTrip(*decoder, "zeros", Bytes(65536, 0));
+   roundTrip(*decoder, "text", Bytes(text.begin(), text.end()));
+   roundTrip(*decoder, "executable", executable);
+   failingSink(*decoder, executable);
+
+   throughput(*decoder, executable);
+   delete decoder;
+
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
@@ -0,0 +1,7 @@
+#ifndef HOST_ADAFRUIT_BME280_H
+#define HOST_ADAFRUIT_BME280_H
+
+// Declared only: host builds include cadse.h but never read the sensor
+class Adafruit_BME280;
+
+#endif
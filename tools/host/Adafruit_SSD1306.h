@@ -0,0 +1,119 @@
+#ifndef HOST_ADAFRUIT_SSD1306_H
+#define HOST_ADAFRUIT_SSD1306_H
+
+// Adafruit_SSD1306 subset for host builds (see host_rtos.h)
+//
+// Keeps the page-ordered frame buffer and the library's bus traffic:
+// display() sends the addressing commands and then the frame in
+// transactions of I2C_BUFFER_LENGTH bytes, blocking until it is out, as
+// Adafruit_SSD1306 2.5 does. Drawing is plain per-pixel code without text.
+
+#include "Arduino.h"
+#include "Wire.h"
+
+#define SSD1306_BLACK          0
+#define SSD1306_WHITE          1
+#define SSD1306_INVERSE        2
+#define SSD1306_SWITCHCAPVCC   0x02
+#define SSD1306_SETCONTRAST    0x81
+#define SSD1306_COLUMNADDR     0x21
+#define SSD1306_PAGEADDR       0x22
+
+class Adafruit_SSD1306 {
+public:
+   Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* twi, int8_t rstPin)
+     : WIDTH(w), HEIGHT(h), wire(twi) {
+     (void)rstPin;
+   }
+   virtual ~Adafruit_SSD1306() { free(buffer); }
+
+   bool begin(uint8_t switchvcc, uint8_t i2caddr) {
+     (void)switchvcc;
+     buffer = (uint8_t*)calloc(WIDTH * ((HEIGHT + 7) / 8), 1);
+     address = i2caddr;
+     return buffer != nullptr;
+   }
+
+   void display() {
+     static const uint8_t window[] = { SSD1306_PAGEADDR, 0, 0xFF, SSD1306_COLUMNADDR, 0 };
+     wire->beginTransmission(address);
+     wire->write((uint8_t)0x00);
+     wire->write(window, sizeof(window));
+     wire->write((uint8_t)(WIDTH - 1));
+     wire->endTransmission();
+     size_t bytes = WIDTH * ((HEIGHT + 7) / 8);
+     for (size_t offset = 0; offset < bytes; offset += I2C_BUFFER_LENGTH - 1) {
+       size_t count = bytes - offset < I2C_BUFFER_LENGTH - 1 ? bytes - offset : I2C_BUFFER_LENGTH - 1;
+       wire->beginTransmission(address);
+       wire->write((uint8_t)0x40);
+       wire->write(buffer + offset, count);
+       wire->endTransmission();
+     }
+   }
+
+   void ssd1306_command(uint8_t c) {
+     wire->beginTransmission(address);
+     wire->write((uint8_t)0x00);
+     wire->write(c);
+     wire->endTransmission();
+   }
+
+   void clearDisplay() { memset(buffer, 0, WIDTH * ((HEIGHT + 7) / 8)); }
+   uint8_t* getBuffer() { return buffer; }
+   uint8_t getRotation() const { return 0; }
+   int16_t width() const { return WIDTH; }
+   int16_t height() const { return HEIGHT; }
+
+   void drawPixel(int16_t x, int16_t y, uint16_t color) {
+     if (x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) return;
+     uint8_t& byte = buffer[x + (y / 8) * WIDTH];
+     uint8_t mask = 1 << (y & 7);
+     if (color == SSD1306_WHITE) byte |= mask;
+     else if (color == SSD1306_BLACK) byte &= ~mask;
+     else byte ^= mask;
+   }
+   void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+     for (int16_t i = 0; i < w; i++) drawPixel(x + i, y, color);
+   }
+   void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+     for (int16_t i = 0; i < h; i++) drawPixel(x, y + i, color);
+   }
+   void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+     for (int16_t i = 0; i < w; i++) drawFastVLine(x + i, y, h, color);
+   }
+   void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+     int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1, dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1, e = dx + dy;
+     for (;;) {
+       drawPixel(x0, y0, color);
+       if (x0 == x1 && y0 == y1) break;
+       int e2 = 2 * e;
+       if (e2 >= dy) { e += dy; x0 += sx; }
+       if (e2 <= dx) { e += dx; y0 += sy; }
+     }
+   }
+   void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+     for (int y = -r; y <= r; y++) {
+       for (int x = -r; x <= r; x++) {
+         int d = x * x + y * y;
+         if (d <= r * r && d > (r - 1) * (r - 1)) drawPixel(x0 + x, y0 + y, color);
+       }
+     }
+   }
+   void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+     for (int y = -r; y <= r; y++) {
+       for (int x = -r; x <= r; x++) {
+         if (x * x + y * y <= r * r) drawPixel(x0 + x, y0 + y, color);
+       }
+     }
+   }
+
+protected:
+   const int16_t WIDTH, HEIGHT;
+
+private:
+   TwoWire* wire;
+   uint8_t address = 0;
+   uint8_t* buffer = nullptr;
+};
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef HOST_ADAFRUIT_SENSOR_H
+#define HOST_ADAFRUIT_SENSOR_H
+
+// Nothing from this library is used by the modules built on the host
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Arduino core and FreeRTOS subset for host builds (see host_rtos.h)
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "host_rtos.h"
+
+class Print;
+
+// Arduino String, as far as firmware modules built on the host use it
+class String {
+public:
+   String(const char* text = "") : text(text) {}
+   explicit String(int value) : text(std::to_string(value)) {}
+   explicit String(long value) : text(std::to_string(value)) {}
+   explicit String(unsigned long value) : text(std::to_string(value)) {}
+   String(float value, unsigned int decimals) : text(format(value, decimals)) {}
+   String(double value, unsigned int decimals) : text(format(value, decimals)) {}
+
+   const char* c_str() const { return text.c_str(); }
+   unsigned int length() const { return text.size(); }
+   String& operator+=(const String& other) { text += other.text; return *this; }
+   String operator+(const String& other) const { String sum(*this); sum += other; return sum; }
+   bool operator==(const char* other) const { return text == other; }
+   float toFloat() const { return atof(text.c_str()); }
+   long toInt() const { return atol(text.c_str()); }
+
+private:
+   static std::string format(double value, unsigned int decimals) {
+     char buffer[48];
+     snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+     return buffer;
+   }
+
+   std::string text;
+};
+
+inline unsigned long micros() { return (unsigned long)(uint32_t)host::now(); }
+inline unsigned long millis() { return (unsigned long)(uint32_t)(host::now() / 1000); }
+inline void delay(unsigned long ms) { host::sleep((uint64_t)ms * 1000); }
+inline void delayMicroseconds(unsigned int us) { host::sleep(us); }
+
+// Serial prints to stdout; setOutput(nullptr) discards
+class HardwareSerial {
+public:
+   void setOutput(FILE* file) { out = file; }
+   void print(const char* text) { if (out) fputs(text, out); }
+   void print(unsigned long value) { if (out) fprintf(out, "%lu", value); }
+   void println(const char* text = "") { if (out) fprintf(out, "%s\n", text); }
+   void println(unsigned long value) { if (out) fprintf(out, "%lu\n", value); }
+   int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+     if (!out) return 0;
+     va_list args;
+     va_start(args, format);
+     int n = vfprintf(out, format, args);
+     va_end(args);
+     return n;
+   }
+
+private:
+   FILE* out = stdout;
+};
+
+extern HardwareSerial Serial;
+
+// FreeRTOS: one tick is 1 ms, tasks and semaphores run on the host scheduler
+typedef void* TaskHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE            0
+#define pdTRUE             1
+#define pdPASS             1
+#define portMAX_DELAY      0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(ms))
+
+// Only one task runs at a time, so critical sections need no lock
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux)  ((void)(mux))
+
+BaseType_t xTaskCreatePinnedToCore(void (*code)(void*), const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+void vTaskDelay(TickType_t ticks);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
+void xTaskNotifyGive(TaskHandle_t task);
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initial);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+// File type of the Arduino FS layer, declared so headers holding one compile
+// on the host; nothing here opens files (host builds use stdio directly)
+
+#include "Arduino.h"
+
+namespace fs {
+
+class File {
+public:
+   explicit operator bool() const { return false; }
+};
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+// Preferences (NVS) backed by one file per namespace, for host builds
+//
+// begin("cadse") reads <directory>/cadse.nvs into memory and every put
+// rewrites it, so a harness can reopen the namespace as after a reboot,
+// look at the stored bytes, and count writes the way flash wear would.
+
+#include "Arduino.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences {
+public:
+   // Where namespace files go (default: the working directory)
+   static void setDirectory(const char* path) { directory() = path; }
+
+   bool begin(const char* name, bool readOnly = false) {
+     path = directory() + "/" + name + ".nvs";
+     this->readOnly = readOnly;
+     entries.clear();
+     FILE* file = fopen(path.c_str(), "rb");
+     if (!file) return true;
+     // Records: key length, key, value length (uint32), value
+     uint8_t keyLength;
+     while (fread(&keyLength, 1, 1, file) == 1) {
+       std::string key(keyLength, '\0');
+       uint32_t length;
+       if (fread(&key[0], 1, keyLength, file) != keyLength || fread(&length, sizeof(length), 1, file) != 1) break;
+       std::vector<uint8_t> value(length);
+       if (length && fread(value.data(), 1, length, file) != length) break;
+       entries[key] = value;
+     }
+     fclose(file);
+     return true;
+   }
+   void end() {}
+
+   size_t putBytes(const char* key, const void* value, size_t length) {
+     if (readOnly) return 0;
+     entries[key].assign((const uint8_t*)value, (const uint8_t*)value + length);
+     return save() ? length : 0;
+   }
+   size_t getBytesLength(const char* key) const {
+     auto entry = entries.find(key);
+     return entry == entries.end() ? 0 : entry->second.size();
+   }
+   size_t getBytes(const char* key, void* buffer, size_t length) const {
+     auto entry = entries.find(key);
+     if (entry == entries.end() || entry->second.size() > length) return 0;
+     memcpy(buffer, entry->second.data(), entry->second.size());
+     return entry->second.size();
+   }
+
+   size_t putInt(const char* key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+   int32_t getInt(const char* key, int32_t defaultValue = 0) const {
+     int32_t value;
+     return getBytesLength(key) == sizeof(value) && getBytes(key, &value, sizeof(value)) ? value : defaultValue;
+   }
+
+   bool remove(const char* key) {
+     if (readOnly || !entries.erase(key)) return false;
+     return save();
+   }
+   bool clear() {
+     if (readOnly) return false;
+     entries.clear();
+     return save();
+   }
+
+   // Host only: puts and removes that rewrote the file since begin()
+   uint32_t writes() const { return writeCount; }
+
+private:
+   static std::string& directory() {
+     static std::string path = ".";
+     return path;
+   }
+
+   bool save() {
+     FILE* file = fopen(path.c_str(), "wb");
+     if (!file) return false;
+     for (const auto& entry : entries) {
+       uint8_t keyLength = entry.first.size();
+       uint32_t length = entry.second.size();
+       fwrite(&keyLength, 1, 1, file);
+       fwrite(entry.first.data(), 1, keyLength, file);
+       fwrite(&length, sizeof(length), 1, file);
+       fwrite(entry.second.data(), 1, length, file);
+     }
+     writeCount++;
+     return fclose(file) == 0;
+   }
+
+   std::string path;
+   bool readOnly = false;
+   std::map<std::string, std::vector<uint8_t>> entries;
+   uint32_t writeCount = 0;
+};
+
+#endif
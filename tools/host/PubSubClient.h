@@ -0,0 +1,7 @@
+#ifndef HOST_PUBSUBCLIENT_H
+#define HOST_PUBSUBCLIENT_H
+
+// Declared only: host builds include cadse.h but never publish
+class PubSubClient;
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+// Nothing from this library is used by the modules built on the host
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+// Simulated I2C master for host builds (see host_rtos.h)
+//
+// Writes are buffered until endTransmission(), which holds the bus for the
+// start condition, the address byte, the data bytes (9 bit times each with
+// the ACK) and the stop condition at the set clock, like the ESP32-S3 driver
+// sends its transmit buffer. requestFrom() does the same for a read.
+
+#include "Arduino.h"
+
+#define I2C_BUFFER_LENGTH 128   // ESP32 Arduino core transmit buffer
+
+class TwoWire {
+public:
+   bool begin() { return true; }
+   bool begin(int sda, int scl, uint32_t frequency = 0);
+   bool setClock(uint32_t frequency) { clock = frequency; return true; }
+   uint32_t getClock() const { return clock; }
+
+   void beginTransmission(uint8_t address);
+   size_t write(uint8_t value);
+   size_t write(const uint8_t* data, size_t count);
+   uint8_t endTransmission(bool sendStop = true);
+
+   uint8_t requestFrom(uint8_t address, size_t count, bool sendStop = true);
+   int available() { return pendingRead; }
+   int read() { return pendingRead > 0 ? (pendingRead--, 0) : -1; }
+
+private:
+   void hold(uint8_t address, const uint8_t* data, size_t bytes);
+
+   uint32_t clock = 100000;
+   uint8_t address = 0;
+   uint8_t buffer[I2C_BUFFER_LENGTH];
+   size_t length = 0;
+   int pendingRead = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,306 @@
+#include "host_rtos.h"
+
+#include "Arduino.h"
+#include "Wire.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+TwoWire Wire;
+
+namespace {
+
+struct Task {
+   std::string name;
+   std::function<void()> body;
+   std::condition_variable wake;
+   uint64_t wakeAt = 0;
+   uint64_t order = 0;          // FIFO among tasks ready at the same time
+   bool blocked = false;        // On a semaphore or a notification
+   bool waitingNotify = false;
+   bool done = false;
+   uint32_t notifications = 0;
+};
+
+struct Semaphore {
+   uint32_t count;
+   uint32_t max;
+   std::deque<Task*> waiters;
+};
+
+// Never destroyed: tasks blocked for good still wait on it at exit
+struct Scheduler {
+   std::mutex mutex;
+   std::condition_variable idle;
+   std::vector<Task*> tasks;
+   Task* current = nullptr;
+   uint64_t time = 0;
+   uint64_t readySequence = 0;
+   std::function<uint32_t()> wakeJitter;
+   std::function<void(const host::BusTransaction&, const uint8_t*)> busObserver;
+   uint64_t busFreeAt = 0;
+   uint32_t collisions = 0;
+};
+
+Scheduler& scheduler() {
+   static Scheduler* instance = new Scheduler;
+   return *instance;
+}
+
+thread_local Task* self = nullptr;
+
+void makeReady(Task* task, uint64_t at) {
+   task->blocked = false;
+   task->wakeAt = at;
+   task->order = ++scheduler().readySequence;
+}
+
+uint64_t jitter() {
+   return scheduler().wakeJitter ? scheduler().wakeJitter() : 0;
+}
+
+// Hand the CPU back to the scheduler and wait until picked again (lock held)
+void yield(std::unique_lock<std::mutex>& lock) {
+   Scheduler& s = scheduler();
+   Task* me = self;
+   s.current = nullptr;
+   s.idle.notify_one();
+   me->wake.wait(lock, [&] { return s.current == me; });
+}
+
+void entry(Task* task) {
+   Scheduler& s = scheduler();
+   std::unique_lock<std::mutex> lock(s.mutex);
+   task->wake.wait(lock, [&] { return s.current == task; });
+   self = task;
+   lock.unlock();
+   task->body();
+   lock.lock();
+   task->done = true;
+   s.current = nullptr;
+   s.idle.notify_one();
+}
+
+Task* spawnTask(const char* name, std::function<void()> body) {
+   Scheduler& s = scheduler();
+   Task* task = new Task;
+   task->name = name;
+   task->body = body;
+   std::lock_guard<std::mutex> lock(s.mutex);
+   makeReady(task, s.time);
+   s.tasks.push_back(task);
+   std::thread(entry, task).detach();
+   return task;
+}
+
+}
+
+namespace host {
+
+uint64_t now() {
+   return scheduler().time;
+}
+
+void advance(uint64_t micros) {
+   std::lock_guard<std::mutex> lock(scheduler().mutex);
+   scheduler().time += micros;
+}
+
+void spawn(const char* name, std::function<void()> body) {
+   spawnTask(name, body);
+}
+
+void run(uint64_t untilMicros) {
+   Scheduler& s = scheduler();
+   std::unique_lock<std::mutex> lock(s.mutex);
+   for (;;) {
+     Task* next = nullptr;
+     for (Task* task : s.tasks) {
+       if (task->done || task->blocked) continue;
+       if (!next || task->wakeAt < next->wakeAt || (task->wakeAt == next->wakeAt && task->order < next->order)) {
+         next = task;
+       }
+     }
+     if (!next || next->wakeAt > untilMicros) break;
+     if (next->wakeAt > s.time) s.time = next->wakeAt;
+     s.current = next;
+     next->wake.notify_one();
+     s.idle.wait(lock, [&] { return s.current == nullptr; });
+   }
+   if (s.time < untilMicros) s.time = untilMicros;
+}
+
+void sleep(uint64_t micros) {
+   Scheduler& s = scheduler();
+   std::unique_lock<std::mutex> lock(s.mutex);
+   if (!self) {
+     s.time += micros;
+     return;
+   }
+   makeReady(self, s.time + micros);
+   yield(lock);
+}
+
+void setWakeJitter(std::function<uint32_t()> jitter) {
+   scheduler().wakeJitter = jitter;
+}
+
+const char* taskName() {
+   return self ? self->name.c_str() : "main";
+}
+
+void setBusObserver(std::function<void(const BusTransaction&, const uint8_t* data)> observer) {
+   scheduler().busObserver = observer;
+}
+
+uint32_t busCollisions() {
+   return scheduler().collisions;
+}
+
+}
+
+// ---------------------------------------------------------------------------
+// FreeRTOS
+
+BaseType_t xTaskCreatePinnedToCore(void (*code)(void*), const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+   (void)stack;
+   (void)priority;
+   (void)core;
+   Task* task = spawnTask(name, [code, arg] { code(arg); });
+   if (handle) *handle = task;
+   return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) {
+   host::sleep((uint64_t)ticks * 1000);
+}
+
+// Only portMAX_DELAY and 0 are supported as waits
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) {
+   Scheduler& s = scheduler();
+   std::unique_lock<std::mutex> lock(s.mutex);
+   if (self->notifications == 0) {
+     if (wait == 0) return 0;
+     self->waitingNotify = true;
+     self->blocked = true;
+     yield(lock);
+   }
+   uint32_t count = self->notifications;
+   self->notifications = clear ? 0 : count - 1;
+   return count;
+}
+
+void xTaskNotifyGive(TaskHandle_t handle) {
+   Scheduler& s = scheduler();
+   std::lock_guard<std::mutex> lock(s.mutex);
+   Task* task = (Task*)handle;
+   task->notifications++;
+   if (task->waitingNotify) {
+     task->waitingNotify = false;
+     makeReady(task, s.time + jitter());
+   }
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initial) {
+   Semaphore* semaphore = new Semaphore;
+   semaphore->count = initial;
+   semaphore->max = maxCount;
+   return semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t wait) {
+   Scheduler& s = scheduler();
+   std::unique_lock<std::mutex> lock(s.mutex);
+   Semaphore* semaphore = (Semaphore*)handle;
+   if (semaphore->count > 0) {
+     semaphore->count--;
+     return pdTRUE;
+   }
+   if (wait == 0 || !self) return pdFALSE;
+   // The giver hands the count straight to the first waiter
+   semaphore->waiters.push_back(self);
+   self->blocked = true;
+   yield(lock);
+   return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle) {
+   Scheduler& s = scheduler();
+   std::lock_guard<std::mutex> lock(s.mutex);
+   Semaphore* semaphore = (Semaphore*)handle;
+   if (!semaphore->waiters.empty()) {
+     Task* task = semaphore->waiters.front();
+     semaphore->waiters.pop_front();
+     makeReady(task, s.time + jitter());
+     return pdTRUE;
+   }
+   if (semaphore->count >= semaphore->max) return pdFALSE;
+   semaphore->count++;
+   return pdTRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Wire
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+   (void)sda;
+   (void)scl;
+   if (frequency) clock = frequency;
+   return true;
+}
+
+void TwoWire::beginTransmission(uint8_t to) {
+   address = to;
+   length = 0;
+}
+
+size_t TwoWire::write(uint8_t value) {
+   if (length >= I2C_BUFFER_LENGTH) return 0;
+   buffer[length++] = value;
+   return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t count) {
+   size_t written = 0;
+   while (written < count && write(data[written])) written++;
+   return written;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+   (void)sendStop;
+   hold(address, buffer, length);
+   length = 0;
+   return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t from, size_t count, bool sendStop) {
+   (void)sendStop;
+   hold(from, nullptr, count);
+   pendingRead = count;
+   return count;
+}
+
+void TwoWire::hold(uint8_t to, const uint8_t* data, size_t bytes) {
+   Scheduler& s = scheduler();
+   host::BusTransaction transaction;
+   transaction.address = to;
+   transaction.start = s.time;
+   transaction.bytes = bytes;
+   transaction.task = host::taskName();
+   if (s.time < s.busFreeAt) s.collisions++;
+
+   // Start and stop conditions, then address and data bytes with their ACK
+   uint64_t bits = 2 + 9 * (1 + bytes);
+   uint64_t duration = (bits * 1000000 + clock - 1) / clock;
+   s.busFreeAt = s.time + duration;
+   host::sleep(duration);
+
+   transaction.end = s.time;
+   if (s.busObserver) s.busObserver(transaction, data);
+}
@@ -0,0 +1,66 @@
+#ifndef HOST_RTOS_H
+#define HOST_RTOS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+// Virtual time and cooperative tasks for host builds of firmware modules
+//
+// The headers in tools/host stand in for Arduino, FreeRTOS and Wire so that
+// modules which talk to the bus or start tasks (buffered_display.cpp,
+// i2c_bus.cpp, log.cpp, params.cpp) compile unchanged on a PC. Each task is
+// a thread, but only one runs at a time and the clock only moves while every
+// task is blocked or sleeping: micros() is simulated time, delay() and
+// vTaskDelay() sleep in it and an I2C transaction occupies the bus for as
+// long as its bits take at the set clock. Runs are deterministic for a
+// given seed, whatever the host load.
+//
+// Code between two blocking calls runs in zero simulated time, as if each
+// task had a core of its own; harnesses model CPU work with delay().
+//
+// Outside hostRun() (plain single-threaded harnesses) delay() just moves the
+// clock forward.
+
+namespace host {
+
+// Simulated time in µs since start
+uint64_t now();
+
+// Move the clock forward from outside a task
+void advance(uint64_t micros);
+
+// Create a task; it starts at the current time once run() is called
+void spawn(const char* name, std::function<void()> body);
+
+// Run tasks until the clock reaches untilMicros or every task is blocked for good
+void run(uint64_t untilMicros);
+
+// Sleep in simulated time (from a task; advances the clock otherwise)
+void sleep(uint64_t micros);
+
+// Latency added whenever a blocked task is made ready (semaphore give,
+// task notify): scheduler and context-switch jitter. Default none.
+void setWakeJitter(std::function<uint32_t()> jitter);
+
+// Name of the running task, "main" outside run()
+const char* taskName();
+
+// Every I2C transaction on the simulated bus, in the order they ended
+struct BusTransaction {
+   uint8_t address;
+   uint64_t start;          // µs
+   uint64_t end;
+   size_t bytes;            // Written bytes, address byte not included
+   const char* task;
+};
+
+// Called for each transaction with the bytes written (device models)
+void setBusObserver(std::function<void(const BusTransaction&, const uint8_t* data)> observer);
+
+// Transactions that started while another one was still on the bus
+uint32_t busCollisions();
+
+}
+
+#endif
@@ -0,0 +1,301 @@
+// Lossy link simulation for the telemetry rate control
+//
+// Drives the firmware's LinkController (src/link_control.cpp, compiled in as
+// is) through an hour of a WiFi link that degrades, drops out and recovers,
+// and compares it with fixed-rate telemetry:
+//
+//   g++ -O2 -std=c++17 -Isrc -o link_sim tools/link_sim.cpp src/link_control.cpp
+//   link_sim [--seed n] [--deadline-ms 5000] [--trace]
+//
+// Link model (one tick per 10 ms):
+//   RSSI       scripted phases (good, slow fade, poor with fading, outage,
+//              recovery) plus +-3 dB of per-second fading
+//   capacity   goodput in bytes/s after WiFi retries, interpolated from RSSI
+//   send path  the TCP send buffer (lwIP TCP_SND_BUF) drains at capacity; a
+//              publish that does not fit blocks the loop until it does and
+//              fails after PUBLISH_TIMEOUT_MS, like the TLS write does
+//   session    no capacity for DROP_AFTER_MS drops the MQTT session and
+//              everything still buffered; reconnecting takes RECONNECT_MS
+//              once the link is back, and publishes fail meanwhile
+//
+// A sample counts as useful when it reaches the ground within --deadline-ms of
+// being taken. Housekeeping packets count as samples too (they carry the
+// health values); full packets are also reported separately.
+//
+// Checked for the adaptive run, exit status 1 if any fails:
+//   - at least MIN_USEFUL_GAIN times the useful samples of the better fixed rate
+//   - p99 age of delivered samples within the deadline
+//   - the loop blocked in publish for at most MAX_BLOCKED_MS over the hour
+//   - fewer failed publishes than fixed 1 s telemetry
+
+#include "link_control.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+
+#define TICK_MS             10
+#define DURATION_MS         3600000
+#define TCP_SEND_BUFFER     5744     // Bytes, ESP32 lwIP default
+#define PUBLISH_TIMEOUT_MS  3000
+#define DROP_AFTER_MS       10000
+#define RECONNECT_MS        5000
+#define PROPAGATION_MS      20
+#define FULL_BYTES          1600     // Telemetry packet incl. MQTT/TLS framing
+#define HOUSEKEEPING_BYTES  360
+#define PERIOD_MIN_MS       1000     // telemetry_period_ms default
+#define PERIOD_MAX_MS       10000    // telemetry_max_period_ms default
+#define MIN_USEFUL_GAIN     1.05
+#define MAX_BLOCKED_MS      1000
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+   if (condition) return;
+   printf("FAIL: %s\n", what);
+   failures++;
+}
+
+// ---- Link model ----
+
+static double scriptedRssi(uint32_t t) {
+   double s = t / 1000.0;
+   if (s < 600)  return -58;
+   if (s < 1200) return -58 - 25 * (s - 600) / 600;     // Slow fade to -83
+   if (s < 1500) return -87;
+   if (s < 1620) return -96;                             // Outage
+   if (s < 2400) return -87 + 17 * (s - 1620) / 780;     // Recovery to -70
+   return -60;
+}
+
+// Goodput in bytes/s at a given RSSI
+static double capacity(double rssi) {
+   static const double table[][2] = {
+     { -93, 0 }, { -90, 150 }, { -85, 500 }, { -80, 1500 }, { -75, 4000 }, { -65, 15000 }, { -55, 30000 }
+   };
+   const int rows = sizeof(table) / sizeof(table[0]);
+   if (rssi <= table[0][0]) return 0;
+   if (rssi >= table[rows - 1][0]) return table[rows - 1][1];
+   for (int i = 1; i < rows; i++) {
+     if (rssi < table[i][0]) {
+       double f = (rssi - table[i - 1][0]) / (table[i][0] - table[i - 1][0]);
+       return table[i - 1][1] + f * (table[i][1] - table[i - 1][1]);
+     }
+   }
+   return 0;
+}
+
+struct InFlight {
+   uint32_t sampledMs;
+   uint32_t bytesLeft;
+   bool full;
+};
+
+struct RunResult {
+   const char* name;
+   uint64_t attempts = 0;
+   uint64_t failed = 0;
+   uint64_t delivered = 0;
+   uint64_t useful = 0;
+   uint64_t usefulFull = 0;
+   uint64_t stale = 0;
+   uint64_t flushed = 0;
+   uint64_t bytes = 0;
+   uint64_t blockedMs = 0;
+   std::vector<uint32_t> ages;
+};
+
+class Link {
+public:
+   explicit Link(uint32_t seed) : random(seed) {}
+
+   // Advance one tick; delivered packets are reported through result
+   void tick(uint32_t now, RunResult& result, uint32_t deadlineMs) {
+     if (now % 1000 == 0) fading = std::uniform_real_distribution<double>(-3, 3)(random);
+     rssi = scriptedRssi(now) + fading;
+     double budget = capacity(rssi) * TICK_MS / 1000.0 + carry;
+     carry = 0;
+
+     if (budget < 1) {
+       outageMs += TICK_MS;
+       if (connected && outageMs >= DROP_AFTER_MS) {
+         connected = false;
+         result.flushed += queue.size();
+         queue.clear();
+         buffered = 0;
+       }
+       carry = budget;
+       return;
+     }
+     outageMs = 0;
+     if (!connected) {
+       reconnectMs += TICK_MS;
+       if (reconnectMs >= RECONNECT_MS) {
+         connected = true;
+         reconnectMs = 0;
+       }
+       return;
+     }
+
+     while (!queue.empty() && budget >= 1) {
+       InFlight& head = queue.front();
+       uint32_t sent = std::min<uint32_t>(head.bytesLeft, (uint32_t)budget);
+       head.bytesLeft -= sent;
+       buffered -= sent;
+       budget -= sent;
+       if (head.bytesLeft == 0) {
+         uint32_t age = now + TICK_MS + PROPAGATION_MS - head.sampledMs;
+         result.delivered++;
+         result.ages.push_back(age);
+         if (age <= deadlineMs) {
+           result.useful++;
+           if (head.full) result.usefulFull++;
+         } else {
+           result.stale++;
+         }
+         queue.pop_front();
+       }
+     }
+     if (queue.empty()) carry = 0;
+   }
+
+   // Free space in the send buffer
+   uint32_t space() const { return TCP_SEND_BUFFER - buffered; }
+
+   void enqueue(uint32_t now, uint32_t bytes, bool full) {
+     queue.push_back(InFlight{ now, bytes, full });
+     buffered += bytes;
+   }
+
+   bool connected = true;
+   double rssi = -58;
+
+private:
+   std::minstd_rand random;
+   std::deque<InFlight> queue;
+   uint32_t buffered = 0;
+   double carry = 0;
+   double fading = 0;
+   uint32_t outageMs = 0;
+   uint32_t reconnectMs = 0;
+};
+
+// ---- Telemetry sender (sendTelemetry() with the loop's period check) ----
+
+static RunResult run(const char* name, bool adaptive, uint32_t fixedPeriodMs, uint32_t seed,
+                     uint32_t deadlineMs, bool trace) {
+   RunResult result;
+   result.name = name;
+   Link link(seed);
+   LinkController control;
+   control.begin(adaptive ? PERIOD_MIN_MS : fixedPeriodMs, PERIOD_MAX_MS, adaptive);
+
+   uint32_t nextAttempt = 0;
+   // A blocked publish stalls the loop: the attempt stays open until it fits or times out
+   bool blocking = false;
+   uint32_t blockStart = 0, pendingBytes = 0;
+   bool pendingFull = false;
+
+   for (uint32_t now = 0; now < DURATION_MS; now += TICK_MS) {
+     link.tick(now, result, deadlineMs);
+     int rssi = (int)lround(link.rssi);
+
+     if (!blocking && now >= nextAttempt) {
+       result.attempts++;
+       if (!link.connected) {
+         control.record(false, 0, rssi);
+         result.failed++;
+         nextAttempt = now + control.periodMs();
+         continue;
+       }
+       pendingFull = control.nextPayload(rssi) == LINK_FULL;
+       pendingBytes = pendingFull ? FULL_BYTES : HOUSEKEEPING_BYTES;
+       blocking = true;
+       blockStart = now;
+     }
+
+     if (blocking) {
+       uint32_t waited = now - blockStart;
+       if (link.connected && link.space() >= pendingBytes) {
+         link.enqueue(blockStart, pendingBytes, pendingFull);
+         result.bytes += pendingBytes;
+         control.record(true, waited * 1000 + 2000, rssi);   // ~2 ms for an unblocked TLS write
+         blocking = false;
+       } else if (!link.connected || waited >= PUBLISH_TIMEOUT_MS) {
+         control.record(false, waited * 1000, rssi);
+         result.failed++;
+         blocking = false;
+       }
+       if (!blocking) {
+         result.blockedMs += waited;
+         nextAttempt = now + control.periodMs();
+       }
+     }
+
+     if (trace && now % 60000 == 0) {
+       printf("# %-9s t=%4us rssi=%4d period=%5u ms connected=%d\n",
+              name, now / 1000, rssi, control.periodMs(), link.connected ? 1 : 0);
+     }
+   }
+   return result;
+}
+
+static uint32_t percentile(std::vector<uint32_t>& values, double q) {
+   if (values.empty()) return 0;
+   std::sort(values.begin(), values.end());
+   return values[std::min(values.size() - 1, (size_t)(q * values.size()))];
+}
+
+int main(int argc, char** argv) {
+   uint32_t seed = 1;
+   uint32_t deadlineMs = 5000;
+   bool trace = false;
+   for (int i = 1; i < argc; i++) {
+     if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--deadline-ms") && i + 1 < argc) deadlineMs = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--trace")) trace = true;
+     else {
+       fprintf(stderr, "usage: link_sim [--seed n] [--deadline-ms ms] [--trace]\n");
+       return 2;
+     }
+   }
+
+   RunResult results[] = {
+     run("fixed 1s", false, PERIOD_MIN_MS, seed, deadlineMs, trace),
+     run("fixed 10s", false, PERIOD_MAX_MS, seed, deadlineMs, trace),
+     run("adaptive", true, 0, seed, deadlineMs, trace),
+   };
+
+   printf("1 h scripted link, deadline %u ms, seed %u\n", deadlineMs, seed);
+   printf("%-10s %8s %7s %9s %7s %6s %6s %7s %8s %8s %8s %9s\n", "run", "attempts", "failed", "delivered",
+          "useful", "full", "stale", "flushed", "kB", "p50 ms", "p99 ms", "blocked s");
+   for (RunResult& r : results) {
+     printf("%-10s %8" PRIu64 " %7" PRIu64 " %9" PRIu64 " %7" PRIu64 " %6" PRIu64 " %6" PRIu64 " %7" PRIu64
+            " %8.1f %8u %8u %9.1f\n",
+            r.name, r.attempts, r.failed, r.delivered, r.useful, r.usefulFull, r.stale, r.flushed,
+            r.bytes / 1000.0, percentile(r.ages, 0.5), percentile(r.ages, 0.99), r.blockedMs / 1000.0);
+   }
+
+   const RunResult& fast = results[0];
+   const RunResult& slow = results[1];
+   RunResult& adaptive = results[2];
+   uint64_t bestFixed = std::max(fast.useful, slow.useful);
+   printf("\nadaptive: %.2f x the useful samples of the better fixed rate\n", (double)adaptive.useful / bestFixed);
+   check(adaptive.useful >= MIN_USEFUL_GAIN * bestFixed, "adaptive delivers more useful samples than either fixed rate");
+   check(percentile(adaptive.ages, 0.99) <= deadlineMs, "adaptive p99 sample age within the deadline");
+   check(adaptive.blockedMs <= MAX_BLOCKED_MS, "adaptive blocks the loop at most MAX_BLOCKED_MS");
+   check(adaptive.failed < fast.failed, "adaptive fails fewer publishes than fixed 1 s");
+
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
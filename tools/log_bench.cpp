@@ -0,0 +1,272 @@
+// Latency benchmark and drop-accounting test for the asynchronous logger
+//
+// Runs the firmware's Logger (src/log.cpp, compiled in as is) on the host
+// with real threads as producers and the consumer; Serial output goes to a
+// temporary file that is parsed back:
+//
+//   g++ -O2 -std=c++17 -Isrc -Itools/host -o log_bench tools/log_bench.cpp src/log.cpp tools/host/host_rtos.cpp -pthread
+//   log_bench [--messages n]
+//
+// Checked:
+//   1. Filling the ring without draining: exactly LOG_SLOTS messages are
+//      taken, the rest are refused and counted, the drain prints the kept
+//      ones in order and reports the drops once.
+//   2. Long messages are truncated to LOG_LINE_SIZE - 1 characters.
+//   3. Calls below LOG_LEVEL do not evaluate their arguments.
+//   4. Four producers logging in bursts against a draining consumer, so the
+//      ring both fills and empties: every attempt is either printed exactly
+//      once or counted as dropped, the drop reports add up, and each
+//      producer's messages come out in the order it logged them.
+// Then the cost of a log call: with room in the ring, with four producers
+// contending, and on a full ring (the drop path), next to what a blocking
+// Serial.println of the same line costs at 115200 baud.
+
+#include "log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define PRODUCERS       4
+#define BURST           12
+#define BURST_PAUSE_US  50
+#define UART_BAUD       115200
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+   if (condition) return;
+   printf("FAIL: %s\n", what);
+   failures++;
+}
+
+struct Output {
+   std::vector<std::string> messages;   // Text after the level tag
+   std::vector<char> levels;
+   uint32_t reportedDrops = 0;
+   uint32_t dropReports = 0;
+};
+
+// Parse what drain() printed: "[ms] L text" lines and drop reports
+static Output readOutput(FILE* file) {
+   Output output;
+   fflush(file);
+   rewind(file);
+   char line[LOG_LINE_SIZE + 64];
+   while (fgets(line, sizeof(line), file)) {
+     line[strcspn(line, "\n")] = 0;
+     char* text = strchr(line, ']');
+     if (!text || strlen(text) < 4) continue;
+     unsigned long drops;
+     if (sscanf(text, "] W log: %lu messages dropped", &drops) == 1) {
+       output.reportedDrops += drops;
+       output.dropReports++;
+       continue;
+     }
+     output.levels.push_back(text[2]);
+     output.messages.push_back(text + 4);
+   }
+   ftruncate(fileno(file), 0);
+   rewind(file);
+   return output;
+}
+
+static int evaluations = 0;
+
+__attribute__((unused)) static int counted() {
+   return ++evaluations;
+}
+
+static void fullRing(FILE* file) {
+   Logger* log = new Logger;
+   int taken = 0;
+   for (int n = 0; n < LOG_SLOTS + 10; n++) {
+     if (log->write(LOG_LEVEL_WARN, "message %d", n)) taken++;
+   }
+   check(taken == LOG_SLOTS && log->written() == LOG_SLOTS && log->dropped() == 10,
+         "full ring: LOG_SLOTS taken, the rest dropped and counted");
+
+   int printed = log->drain();
+   Output output = readOutput(file);
+   check(printed == LOG_SLOTS && output.messages.size() == LOG_SLOTS, "full ring: drain prints the kept messages");
+   bool inOrder = true;
+   for (size_t n = 0; n < output.messages.size(); n++) {
+     if (output.messages[n] != "message " + std::to_string(n) || output.levels[n] != 'W') inOrder = false;
+   }
+   check(inOrder, "full ring: oldest messages kept, in order, with their level");
+   check(output.dropReports == 1 && output.reportedDrops == 10, "full ring: drops reported once");
+
+   check(log->write(LOG_LEVEL_INFO, "after"), "full ring: room again after the drain");
+   log->drain();
+   output = readOutput(file);
+   check(output.messages.size() == 1 && output.dropReports == 0, "full ring: drops not reported twice");
+
+   std::string longText(3 * LOG_LINE_SIZE, 'x');
+   log->write(LOG_LEVEL_ERROR, "%s", longText.c_str());
+   log->drain();
+   output = readOutput(file);
+   check(output.messages.size() == 1 && output.messages[0].size() == LOG_LINE_SIZE - 1,
+         "long message truncated to LOG_LINE_SIZE - 1");
+
+   LOGD("%d", counted());
+   check(evaluations == (LOG_LEVEL >= LOG_LEVEL_DEBUG ? 1 : 0), "calls below LOG_LEVEL do not evaluate arguments");
+   delete log;
+}
+
+static void producers(FILE* file, uint32_t messages) {
+   Logger* log = new Logger;
+   std::atomic<bool> stop(false);
+   std::atomic<uint32_t> accepted(0);
+   std::atomic<uint32_t> refused(0);
+
+   std::thread consumer([&] {
+     while (!stop.load()) {
+       if (log->drain() == 0) std::this_thread::yield();
+     }
+   });
+   std::vector<std::thread> threads;
+   for (int p = 0; p < PRODUCERS; p++) {
+     threads.emplace_back([&, p] {
+       // Bursts of BURST messages, more than the ring holds when they coincide
+       for (uint32_t n = 0; n < messages; n++) {
+         if (log->write(LOG_LEVEL_INFO, "p%d %u", p, n)) accepted++;
+         else refused++;
+         if (n % BURST == BURST - 1) std::this_thread::sleep_for(std::chrono::microseconds(BURST_PAUSE_US));
+       }
+     });
+   }
+   for (std::thread& thread : threads) thread.join();
+   stop = true;
+   consumer.join();
+   log->drain();
+
+   Output output = readOutput(file);
+   uint32_t attempts = PRODUCERS * messages;
+   printf("%d producers: %u messages, %u printed, %u dropped (%.1f%%)\n", PRODUCERS, attempts,
+          (unsigned)output.messages.size(), log->dropped(), 100.0 * log->dropped() / attempts);
+   check(log->written() + log->dropped() == attempts, "producers: written + dropped == attempts");
+   check(log->written() == accepted && log->dropped() == refused, "producers: counters match write() results");
+   check(output.messages.size() == log->written(), "producers: every written message printed once");
+   check(output.reportedDrops == log->dropped(), "producers: drop reports add up to dropped()");
+
+   std::vector<long> last(PRODUCERS, -1);
+   bool ordered = true;
+   bool wellFormed = true;
+   for (const std::string& message : output.messages) {
+     int p;
+     unsigned n;
+     if (sscanf(message.c_str(), "p%d %u", &p, &n) != 2 || p < 0 || p >= PRODUCERS || n >= messages) {
+       wellFormed = false;
+       continue;
+     }
+     if ((long)n <= last[p]) ordered = false;
+     last[p] = n;
+   }
+   check(wellFormed, "producers: no torn or foreign messages");
+   check(ordered, "producers: each producer's messages in order, none twice");
+   delete log;
+}
+
+struct Latency {
+   std::vector<uint32_t> ns;
+
+   void print(const char* name) {
+     std::sort(ns.begin(), ns.end());
+     double mean = 0;
+     for (uint32_t value : ns) mean += value;
+     mean /= ns.size();
+     printf("  %-24s mean %6.0f ns, p50 %6u, p99 %6u, max %8u\n", name, mean, ns[ns.size() / 2],
+            ns[ns.size() * 99 / 100], ns.back());
+   }
+};
+
+static uint32_t timedWrite(Logger& log, uint32_t n) {
+   auto begin = std::chrono::steady_clock::now();
+   log.write(LOG_LEVEL_INFO, "alt %.2f m, T %.1f C, n %u", 123.45 + n, 21.5, n);
+   return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin)
+       .count();
+}
+
+static void latency(uint32_t messages) {
+   printf("\nlog call latency (host)\n");
+   Logger* log = new Logger;
+
+   Latency room;
+   for (uint32_t n = 0; n < messages; n++) {
+     room.ns.push_back(timedWrite(*log, n));
+     if (n % (LOG_SLOTS / 2) == 0) log->drain();
+   }
+   room.print("ring with room");
+
+   Latency full;
+   while (log->write(LOG_LEVEL_INFO, "fill")) {}
+   for (uint32_t n = 0; n < messages; n++) full.ns.push_back(timedWrite(*log, n));
+   full.print("full ring (dropped)");
+   log->drain();
+
+   std::atomic<bool> stop(false);
+   std::thread consumer([&] {
+     while (!stop.load()) {
+       if (log->drain() == 0) std::this_thread::yield();
+     }
+   });
+   std::vector<Latency> contended(PRODUCERS);
+   std::vector<std::thread> threads;
+   for (int p = 0; p < PRODUCERS; p++) {
+     threads.emplace_back([&, p] {
+       for (uint32_t n = 0; n < messages / PRODUCERS; n++) {
+         contended[p].ns.push_back(timedWrite(*log, n));
+         if (n % BURST == BURST - 1) std::this_thread::sleep_for(std::chrono::microseconds(BURST_PAUSE_US));
+       }
+     });
+   }
+   for (std::thread& thread : threads) thread.join();
+   stop = true;
+   consumer.join();
+   Latency all;
+   for (const Latency& one : contended) all.ns.insert(all.ns.end(), one.ns.begin(), one.ns.end());
+   all.print("4 producers, bursts");
+   delete log;
+
+   // 10 bits per character on the UART, line plus "\r\n"
+   const size_t line = strlen("alt 123.45 m, T 21.5 C, n 1000") + 2;
+   printf("  %-24s %6.0f us per line at %d baud\n", "blocking Serial.println", line * 10 * 1e6 / UART_BAUD,
+          UART_BAUD);
+}
+
+int main(int argc, char** argv) {
+   uint32_t messages = 50000;
+   for (int i = 1; i < argc; i++) {
+     if (!strcmp(argv[i], "--messages") && i + 1 < argc) messages = atoi(argv[++i]);
+     else {
+       fprintf(stderr, "usage: log_bench [--messages n]\n");
+       return 2;
+     }
+   }
+   FILE* file = tmpfile();
+   if (!file) {
+     perror("tmpfile");
+     return 2;
+   }
+   Serial.setOutput(file);
+
+   fullRing(file);
+   producers(file, messages);
+
+   Serial.setOutput(nullptr);
+   latency(messages);
+   fclose(file);
+
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
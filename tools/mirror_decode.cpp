@@ -0,0 +1,444 @@
+// Decoder and benchmark for the display mirror stream
+//
+// Boards with mirror_period_ms > 0 send their OLED frames, run-length coded
+// as keyframes or XOR deltas, on cadse/<year>/<board>/display (see
+// src/display_mirror.h). Record them with
+//
+//   mosquitto_sub -h <broker> -t 'cadse/+/+/display' -F '%t %x' > display.log
+//
+// and decode with
+//
+//   g++ -O2 -std=c++17 -Isrc -o mirror_decode tools/mirror_decode.cpp src/display_mirror.cpp src/page_canvas.cpp
+//   mirror_decode frames display.log [--out dir] [--png] [--scale n]
+//   mirror_decode bench [--frames n]
+//
+// frames writes every decoded frame as <board>_<n>.pgm (or .png) and lists
+// each message with its size. Deltas after a lost message are skipped until
+// the next keyframe; every decoded frame is checked against its CRC-32.
+// bench renders mode-like scenes with PageCanvas, runs them through the
+// firmware's encoder (compiled in as is) and this decoder, and reports the
+// bytes per frame against the raw 1024.
+
+#include "display_mirror.h"
+#include "page_canvas.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+static uint16_t get16(const uint8_t* in) {
+   return in[0] | in[1] << 8;
+}
+
+static uint32_t get32(const uint8_t* in) {
+   return get16(in) | (uint32_t)get16(in + 2) << 16;
+}
+
+// Inverse of DisplayMirror::rle(); false unless exactly length bytes come out
+static bool unrle(const uint8_t* in, size_t size, uint8_t* out, size_t length) {
+   size_t used = 0, written = 0;
+   while (used < size) {
+     uint8_t control = in[used++];
+     if (control < 0x80) {
+       size_t count = control + 1;
+       if (used + count > size || written + count > length) return false;
+       memcpy(out + written, in + used, count);
+       used += count;
+       written += count;
+     } else {
+       size_t count = control - 0x80 + MIRROR_MIN_RUN;
+       if (used >= size || written + count > length) return false;
+       memset(out + written, in[used++], count);
+       written += count;
+     }
+   }
+   return written == length;
+}
+
+enum DecodeResult {
+   DECODE_OK,
+   DECODE_BAD_MESSAGE,        // Truncated, wrong magic, version or geometry
+   DECODE_WAITING,            // Delta without the frame it applies to
+   DECODE_CRC                 // Decoded frame does not match its CRC
+};
+
+struct MirrorStream {
+   std::vector<uint8_t> frame;
+   uint16_t width = 0;
+   uint16_t height = 0;
+   bool synced = false;
+   uint16_t expected = 0;     // Sequence number of the next message
+
+   uint32_t messages = 0;
+   uint32_t keys = 0;
+   uint32_t bytes = 0;
+   uint32_t lost = 0;
+   uint32_t skipped = 0;
+   uint32_t crcErrors = 0;
+   uint32_t decoded = 0;
+
+   DecodeResult apply(const uint8_t* message, size_t size) {
+     if (size < MIRROR_HEADER_BYTES || message[0] != 'D' || message[1] != 'M' || message[2] != MIRROR_VERSION) {
+       return DECODE_BAD_MESSAGE;
+     }
+     uint8_t type = message[3];
+     uint16_t sequence = get16(message + 4);
+     uint16_t w = get16(message + 6);
+     uint16_t h = get16(message + 8);
+     uint16_t length = get16(message + 10);
+     uint32_t crc = get32(message + 12);
+     size_t frameBytes = (size_t)w * h / 8;
+     if (MIRROR_HEADER_BYTES + (size_t)length != size || frameBytes == 0 || frameBytes > MIRROR_MAX_FRAME ||
+         type > MIRROR_DELTA) {
+       return DECODE_BAD_MESSAGE;
+     }
+
+     messages++;
+     bytes += size;
+     if (messages > 1 && sequence != expected) lost += (uint16_t)(sequence - expected);
+     bool inOrder = sequence == expected;
+     expected = sequence + 1;
+
+     std::vector<uint8_t> payload(frameBytes);
+     if (!unrle(message + MIRROR_HEADER_BYTES, length, payload.data(), frameBytes)) return DECODE_BAD_MESSAGE;
+     if (type == MIRROR_KEY) {
+       keys++;
+       frame = payload;
+       width = w;
+       height = h;
+     } else {
+       if (!synced || !inOrder || w != width || h != height) {
+         synced = false;
+         skipped++;
+         return DECODE_WAITING;
+       }
+       for (size_t i = 0; i < frameBytes; i++) frame[i] ^= payload[i];
+     }
+
+     synced = DisplayMirror::crc32(frame.data(), frameBytes) == crc;
+     if (!synced) {
+       crcErrors++;
+       return DECODE_CRC;
+     }
+     decoded++;
+     return DECODE_OK;
+   }
+
+   bool pixel(int x, int y) const {
+     return frame[(y / 8) * width + x] >> (y & 7) & 1;
+   }
+};
+
+// ---------------------------------------------------------------------------
+// Image output
+
+static std::vector<uint8_t> grey(const MirrorStream& stream, int scale) {
+   std::vector<uint8_t> image((size_t)stream.width * scale * stream.height * scale);
+   for (int y = 0; y < stream.height * scale; y++) {
+     for (int x = 0; x < stream.width * scale; x++) {
+       image[(size_t)y * stream.width * scale + x] = stream.pixel(x / scale, y / scale) ? 255 : 0;
+     }
+   }
+   return image;
+}
+
+static bool writePgm(const std::string& path, const MirrorStream& stream, int scale) {
+   FILE* file = fopen(path.c_str(), "wb");
+   if (!file) return false;
+   std::vector<uint8_t> image = grey(stream, scale);
+   fprintf(file, "P5\n%d %d\n255\n", stream.width * scale, stream.height * scale);
+   fwrite(image.data(), 1, image.size(), file);
+   return fclose(file) == 0;
+}
+
+static void pngChunk(FILE* file, const char* type, const std::vector<uint8_t>& data) {
+   std::vector<uint8_t> body(type, type + 4);
+   body.insert(body.end(), data.begin(), data.end());
+   uint8_t length[4] = { (uint8_t)(data.size() >> 24), (uint8_t)(data.size() >> 16),
+                         (uint8_t)(data.size() >> 8), (uint8_t)data.size() };
+   uint32_t crc = DisplayMirror::crc32(body.data(), body.size());
+   uint8_t tail[4] = { (uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc };
+   fwrite(length, 1, 4, file);
+   fwrite(body.data(), 1, body.size(), file);
+   fwrite(tail, 1, 4, file);
+}
+
+// 8-bit greyscale PNG with stored (uncompressed) deflate blocks: no zlib needed
+static bool writePng(const std::string& path, const MirrorStream& stream, int scale) {
+   FILE* file = fopen(path.c_str(), "wb");
+   if (!file) return false;
+   uint32_t w = stream.width * scale, h = stream.height * scale;
+   std::vector<uint8_t> image = grey(stream, scale);
+
+   std::vector<uint8_t> raw;
+   for (uint32_t y = 0; y < h; y++) {
+     raw.push_back(0);                                  // Filter: none
+     raw.insert(raw.end(), image.begin() + y * w, image.begin() + (y + 1) * w);
+   }
+   std::vector<uint8_t> z = { 0x78, 0x01 };
+   for (size_t start = 0; start < raw.size(); start += 65535) {
+     size_t n = raw.size() - start < 65535 ? raw.size() - start : 65535;
+     z.push_back(start + n == raw.size());
+     z.push_back(n);
+     z.push_back(n >> 8);
+     z.push_back(~n);
+     z.push_back(~n >> 8);
+     z.insert(z.end(), raw.begin() + start, raw.begin() + start + n);
+   }
+   uint32_t a = 1, b = 0;
+   for (uint8_t byte : raw) {
+     a = (a + byte) % 65521;
+     b = (b + a) % 65521;
+   }
+   uint32_t adler = b << 16 | a;
+   for (int shift = 24; shift >= 0; shift -= 8) z.push_back(adler >> shift);
+
+   static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+   fwrite(signature, 1, 8, file);
+   std::vector<uint8_t> header = { (uint8_t)(w >> 24), (uint8_t)(w >> 16), (uint8_t)(w >> 8), (uint8_t)w,
+                                   (uint8_t)(h >> 24), (uint8_t)(h >> 16), (uint8_t)(h >> 8), (uint8_t)h,
+                                   8, 0, 0, 0, 0 };    // 8-bit greyscale
+   pngChunk(file, "IHDR", header);
+   pngChunk(file, "IDAT", z);
+   pngChunk(file, "IEND", {});
+   return fclose(file) == 0;
+}
+
+// ---------------------------------------------------------------------------
+// frames: decode a mosquitto_sub capture
+
+static bool parseHex(const std::string& hex, std::vector<uint8_t>& out) {
+   if (hex.size() % 2) return false;
+   out.clear();
+   for (size_t i = 0; i < hex.size(); i += 2) {
+     char byte[3] = { hex[i], hex[i + 1], 0 };
+     char* end;
+     out.push_back((uint8_t)strtoul(byte, &end, 16));
+     if (*end) return false;
+   }
+   return true;
+}
+
+static int frames(int argc, char** argv) {
+   if (argc < 3) {
+     fprintf(stderr, "usage: mirror_decode frames <capture> [--out dir] [--png] [--scale n]\n");
+     return 2;
+   }
+   const char* path = argv[2];
+   std::string outDir = ".";
+   bool png = false;
+   int scale = 1;
+   for (int i = 3; i < argc; i++) {
+     if (!strcmp(argv[i], "--out") && i + 1 < argc) outDir = argv[++i];
+     else if (!strcmp(argv[i], "--png")) png = true;
+     else if (!strcmp(argv[i], "--scale") && i + 1 < argc) scale = atoi(argv[++i]);
+     else {
+       fprintf(stderr, "unknown option %s\n", argv[i]);
+       return 2;
+     }
+   }
+   if (scale < 1 || scale > 16) scale = 1;
+
+   FILE* file = fopen(path, "r");
+   if (!file) {
+     perror(path);
+     return 1;
+   }
+   static const char* const results[] = { "ok", "bad message", "waiting for keyframe", "CRC mismatch" };
+   std::map<std::string, MirrorStream> streams;
+   std::vector<uint8_t> message;
+   char line[8192];
+   int number = 0;
+   printf("%-8s %6s %-5s %6s  %s\n", "board", "seq", "type", "bytes", "result");
+   while (fgets(line, sizeof(line), file)) {
+     number++;
+     char topic[256], hex[8000];
+     if (sscanf(line, "%255s %7999s", topic, hex) != 2) continue;
+     if (!parseHex(hex, message)) {
+       fprintf(stderr, "%s:%d: payload is not hex (use -F '%%t %%x')\n", path, number);
+       return 1;
+     }
+     std::string board = topic;
+     size_t slash = board.find('/');
+     if (slash != std::string::npos && board.find('/', slash + 1) != std::string::npos) {
+       size_t start = board.find('/', slash + 1) + 1;
+       board = board.substr(start, board.find('/', start) - start);
+     }
+
+     MirrorStream& stream = streams[board];
+     DecodeResult result = stream.apply(message.data(), message.size());
+     if (result == DECODE_BAD_MESSAGE && message.size() < MIRROR_HEADER_BYTES) continue;
+     printf("%-8s %6u %-5s %6zu  %s\n", board.c_str(), message.size() >= 6 ? get16(message.data() + 4) : 0,
+            message.size() > 3 && message[3] == MIRROR_KEY ? "key" : "delta", message.size(), results[result]);
+     if (result == DECODE_OK) {
+       char name[64];
+       snprintf(name, sizeof(name), "/%s_%06u.%s", board.c_str(), stream.decoded, png ? "png" : "pgm");
+       bool written = png ? writePng(outDir + name, stream, scale) : writePgm(outDir + name, stream, scale);
+       if (!written) {
+         perror((outDir + name).c_str());
+         return 1;
+       }
+     }
+   }
+   fclose(file);
+
+   printf("\n%-8s %8s %6s %8s %10s %6s %8s %6s\n", "board", "messages", "keys", "decoded", "bytes/msg", "lost",
+          "skipped", "crc");
+   for (const auto& entry : streams) {
+     const MirrorStream& s = entry.second;
+     printf("%-8s %8u %6u %8u %10.1f %6u %8u %6u\n", entry.first.c_str(), s.messages, s.keys, s.decoded,
+            s.messages ? (double)s.bytes / s.messages : 0.0, s.lost, s.skipped, s.crcErrors);
+   }
+   return 0;
+}
+
+// ---------------------------------------------------------------------------
+// bench: mode-like scenes through the encoder and back
+
+#define BENCH_WIDTH    128
+#define BENCH_HEIGHT   64
+#define BENCH_PERIOD   200      // ms between offered frames (mirror_period_ms)
+
+// Seven-segment digit in a 6 x 10 cell, standing in for the 5x7 font
+static void digit(PageCanvas& canvas, int x, int y, int value) {
+   static const uint8_t segments[10] = { 0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F };
+   uint8_t s = segments[value % 10];
+   if (s & 0x01) canvas.hline(x, y, 5, PAGE_WHITE);
+   if (s & 0x02) canvas.vline(x + 4, y, 5, PAGE_WHITE);
+   if (s & 0x04) canvas.vline(x + 4, y + 4, 5, PAGE_WHITE);
+   if (s & 0x08) canvas.hline(x, y + 8, 5, PAGE_WHITE);
+   if (s & 0x10) canvas.vline(x, y + 4, 5, PAGE_WHITE);
+   if (s & 0x20) canvas.vline(x, y, 5, PAGE_WHITE);
+   if (s & 0x40) canvas.hline(x, y + 4, 5, PAGE_WHITE);
+}
+
+static void number(PageCanvas& canvas, int x, int y, int value, int digits) {
+   for (int i = digits - 1; i >= 0; i--, value /= 10) digit(canvas, x + i * 6, y, value % 10);
+}
+
+// Mode 0 style status page: labels and a few slowly changing readings
+static void statusScene(PageCanvas& canvas, int frame) {
+   for (int row = 0; row < 6; row++) {
+     canvas.fillRect(0, row * 10 + 2, 30, 6, PAGE_WHITE);         // Label
+   }
+   number(canvas, 40, 1, 1013 + (frame / 25) % 3, 4);             // Pressure, changes every 5 s
+   number(canvas, 40, 11, 21, 2);
+   number(canvas, 40, 21, 45, 2);
+   number(canvas, 40, 31, 4100 - frame / 50, 4);
+   number(canvas, 40, 41, frame / 5, 5);                          // Uptime, ticks every second
+}
+
+// Mode 3 style horizon turning slowly
+static void horizonScene(PageCanvas& canvas, int frame) {
+   double roll = frame * 0.05;
+   int dx = (int)(cos(roll) * 60), dy = (int)(sin(roll) * 60);
+   canvas.line(64 - dx, 32 - dy, 64 + dx, 32 + dy, PAGE_WHITE);
+   canvas.circle(64, 32, 4, PAGE_WHITE);
+   canvas.hline(44, 32, 12, PAGE_WHITE);
+   canvas.hline(72, 32, 12, PAGE_WHITE);
+   number(canvas, 0, 54, frame % 360, 3);
+}
+
+// Mode 4 style plotter, scrolling one column per frame
+static void plotterScene(PageCanvas& canvas, int frame) {
+   for (int x = 0; x < BENCH_WIDTH; x++) {
+     int t = frame + x;
+     int y = 32 + (int)(20 * sin(t * 0.1) + 6 * sin(t * 0.37));
+     canvas.pixel(x, y, PAGE_WHITE);
+   }
+   canvas.hline(0, 63, BENCH_WIDTH, PAGE_WHITE);
+}
+
+// Mode 5 style orbit: planet, orbit ring and a moving satellite
+static void orbitScene(PageCanvas& canvas, int frame) {
+   canvas.fillCircle(40, 32, 15, PAGE_WHITE);
+   canvas.circle(40, 32, 25, PAGE_WHITE);
+   double angle = frame * 0.08;
+   canvas.fillCircle(40 + (int)(25 * cos(angle)), 32 + (int)(25 * sin(angle)), 2, PAGE_WHITE);
+   number(canvas, 80, 10, 400 + frame % 20, 3);
+   number(canvas, 80, 30, frame / 5, 5);
+}
+
+// Nothing compresses: the worst case
+static void noiseScene(PageCanvas& canvas, int frame) {
+   std::mt19937 random(frame);
+   for (int y = 0; y < BENCH_HEIGHT; y++) {
+     for (int x = 0; x < BENCH_WIDTH; x++) {
+       if (random() & 1) canvas.pixel(x, y, PAGE_WHITE);
+     }
+   }
+}
+
+struct Scene {
+   const char* name;
+   void (*draw)(PageCanvas& canvas, int frame);
+};
+
+static const Scene scenes[] = {
+   { "status", statusScene },
+   { "horizon", horizonScene },
+   { "plotter", plotterScene },
+   { "orbit", orbitScene },
+   { "noise", noiseScene },
+};
+
+static int bench(int argc, char** argv) {
+   int frameCount = 300;
+   for (int i = 2; i < argc; i++) {
+     if (!strcmp(argv[i], "--frames") && i + 1 < argc) frameCount = atoi(argv[++i]);
+     else {
+       fprintf(stderr, "usage: mirror_decode bench [--frames n]\n");
+       return 2;
+     }
+   }
+   if (frameCount < 1) frameCount = 1;
+
+   printf("%d frames per scene offered every %d ms, raw frame %d bytes\n", frameCount, BENCH_PERIOD,
+          BENCH_WIDTH * BENCH_HEIGHT / 8);
+   printf("%-10s %6s %6s %10s %10s %12s %12s %6s\n", "scene", "sent", "keys", "unchanged", "bytes/sent",
+          "bytes/frame", "key bytes", "exact");
+
+   bool ok = true;
+   for (const Scene& scene : scenes) {
+     static uint8_t frame[BENCH_WIDTH * BENCH_HEIGHT / 8];
+     static uint8_t message[MIRROR_MESSAGE_BYTES];
+     PageCanvas canvas;
+     canvas.attach(frame, BENCH_WIDTH, BENCH_HEIGHT);
+     DisplayMirror mirror;
+     mirror.begin(BENCH_WIDTH, BENCH_HEIGHT);
+     MirrorStream ground;
+     bool exact = true;
+     uint32_t keyBytes = 0;
+
+     for (int i = 0; i < frameCount; i++) {
+       memset(frame, 0, sizeof(frame));
+       scene.draw(canvas, i);
+       size_t length = mirror.encode(frame, (uint32_t)i * BENCH_PERIOD, message, sizeof(message));
+       if (length == 0) continue;
+       mirror.sent();
+       if (message[3] == MIRROR_KEY) keyBytes += length;
+       if (ground.apply(message, length) != DECODE_OK || memcmp(ground.frame.data(), frame, sizeof(frame))) {
+         exact = false;
+       }
+     }
+     if (!exact) ok = false;
+     printf("%-10s %6u %6u %10u %10.1f %12.1f %12.1f %6s\n", scene.name, mirror.frames(), mirror.keys(),
+            mirror.unchanged(), mirror.frames() ? (double)mirror.bytes() / mirror.frames() : 0.0,
+            (double)mirror.bytes() / frameCount, mirror.keys() ? (double)keyBytes / mirror.keys() : 0.0,
+            exact ? "yes" : "NO");
+   }
+   return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+   if (argc >= 2 && !strcmp(argv[1], "frames")) return frames(argc, argv);
+   if (argc >= 2 && !strcmp(argv[1], "bench")) return bench(argc, argv);
+   fprintf(stderr, "usage: mirror_decode frames <capture> [--out dir] [--png] [--scale n]\n"
+                   "       mirror_decode bench [--frames n]\n");
+   return 2;
+}
@@ -0,0 +1,190 @@
+// Frame pacing and fixed-timestep simulation against a fake clock
+//
+// Runs the firmware's FramePacer (src/frame_pacing.cpp, compiled in as is)
+// in a simulated loop() and compares it with the scheduling the modes used
+// before: next frame one interval after the frame actually ran, and motion
+// applied per frame (Mode 3 turned 1 degree per tick while a pad was held).
+//
+//   g++ -O2 -std=c++17 -Isrc -o pacing_sim tools/pacing_sim.cpp src/frame_pacing.cpp
+//   pacing_sim [--seconds n] [--seed n]
+//
+// Each scenario is a loop cost (the time one pass of loop() takes besides the
+// mode, with jitter) and optional stalls (MQTT reconnects blocking for 2 s).
+// The pad is held for the whole run. Reported per scheduler:
+//   fps      frames per second reached, target 20 (Mode 3, 50 ms)
+//   roll     degrees turned, ideally 20 deg/s times the simulated time
+//   jump     largest change of the rendered roll between two frames
+// and for the pacer its late/dropped frame and dropped simulation counters.
+//
+// Checked per scenario, for the pacer:
+//   - drift: at the last frame the rendered roll is ROLL_RATE times the
+//     simulated time (time less dropped simulation) minus the one step the
+//     interpolation trails by, to float precision
+//   - catch-up: no frame moves the picture by more than FRAME_MAX_CATCHUP_MS
+//     of simulation, and simulation is dropped exactly by what a gap between
+//     frames exceeds FRAME_MAX_CATCHUP_MS, so never without a stall
+//   - cadence: every frame slot up to the last frame is either rendered or
+//     counted as dropped; with a loop faster than the frame interval none are
+//     dropped and the frame count matches the time to one frame, i.e. the
+//     schedule does not drift
+
+#include "frame_pacing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#define FRAME_INTERVAL_MS   50        // Mode 3 updateInterval
+#define STEP_INTERVAL_MS    20        // Mode 3 stepInterval
+#define ROLL_RATE           20.0      // Degrees per second, as in mode3_attitude_indicator.cpp
+#define STALL_MS            2000      // Blocking MQTT reconnect
+
+struct Scenario {
+   const char* name;
+   uint32_t loopMs;             // Mean loop() cost outside the mode
+   uint32_t jitterMs;           // Uniform 0..jitter added per pass
+   int stalls;                  // Evenly spread over the run
+};
+
+static const Scenario scenarios[] = {
+   { "idle loop",       1,  1, 0 },
+   { "busy loop",       7,  6, 0 },
+   { "slow loop",      30, 20, 0 },
+   { "very slow loop", 60, 30, 0 },
+   { "reconnects",      7,  6, 3 },
+};
+
+static int failures = 0;
+
+static void check(bool condition, const char* scenario, const char* what) {
+   if (condition) return;
+   printf("FAIL: %s: %s\n", scenario, what);
+   failures++;
+}
+
+struct Result {
+   uint32_t frames = 0;
+   double roll = 0;
+   double maxJump = 0;
+};
+
+// The rate limiter in InputTrace::due(): run when interval has passed since last
+static bool due(uint32_t now, uint32_t& last, uint32_t interval) {
+   if (now - last < interval) return false;
+   last = now;
+   return true;
+}
+
+int main(int argc, char** argv) {
+   uint32_t seconds = 60;
+   unsigned seed = 1;
+   for (int i = 1; i < argc; i++) {
+     if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = atoi(argv[++i]);
+     else {
+       fprintf(stderr, "usage: pacing_sim [--seconds n] [--seed n]\n");
+       return 2;
+     }
+   }
+   if (seconds < 5) seconds = 5;
+   const uint32_t runMs = seconds * 1000;
+
+   printf("%-15s | %-28s | %-28s | %s\n", "", "per-frame (before)", "fixed step (pacer)", "pacer counters");
+   printf("%-15s | %6s %10s %9s | %6s %10s %9s | %6s %8s %13s\n", "scenario", "fps", "roll", "jump",
+          "fps", "roll", "jump", "late", "dropped", "sim dropped");
+
+   for (const Scenario& scenario : scenarios) {
+     std::mt19937 random(seed);
+     std::uniform_int_distribution<uint32_t> jitter(0, scenario.jitterMs);
+
+     Result before, after;
+     uint32_t lastBefore = 0 - FRAME_INTERVAL_MS;
+     uint32_t lastAfter = 0 - FRAME_INTERVAL_MS;
+     double renderedBefore = 0, renderedAfter = 0;
+
+     FramePacer pacer;
+     pacer.begin(0, STEP_INTERVAL_MS);
+     double roll = 0, previousRoll = 0;
+     uint32_t nextStall = scenario.stalls ? runMs / (scenario.stalls + 1) : runMs + 1;
+
+     uint32_t now = 0;
+     uint32_t lastFrame = 0;
+     uint32_t catchUpDropped = 0;     // Reference for simDroppedMs()
+     while (now < runMs) {
+       // Before: one degree per frame, next frame one interval after this one ran
+       if (due(now, lastBefore, FRAME_INTERVAL_MS)) {
+         before.frames++;
+         before.roll += 1.0;
+         before.maxJump = std::max(before.maxJump, before.roll - renderedBefore);
+         renderedBefore = before.roll;
+       }
+
+       // After: modeTick() as in mode_registry.h
+       uint32_t scheduled = lastAfter;
+       if (due(now, lastAfter, FRAME_INTERVAL_MS)) {
+         lastAfter = pacer.frame(scheduled, lastAfter, FRAME_INTERVAL_MS);
+         if (now - lastFrame > FRAME_MAX_CATCHUP_MS) catchUpDropped += now - lastFrame - FRAME_MAX_CATCHUP_MS;
+         for (uint32_t steps = pacer.advance(now); steps > 0; steps--) {
+           previousRoll = roll;
+           roll += ROLL_RATE * STEP_INTERVAL_MS / 1000.0;
+         }
+         double rendered = previousRoll + (roll - previousRoll) * pacer.alpha();
+         after.frames++;
+         after.maxJump = std::max(after.maxJump, rendered - renderedAfter);
+         renderedAfter = rendered;
+         after.roll = rendered;
+         lastFrame = now;
+       }
+
+       now += scenario.loopMs + jitter(random);
+       if (now >= nextStall) {
+         now += STALL_MS;
+         nextStall += runMs / (scenario.stalls + 1);
+       }
+     }
+
+     printf("%-15s | %6.1f %10.1f %9.2f | %6.1f %10.1f %9.2f | %6u %8u %10u ms\n", scenario.name,
+            before.frames * 1000.0 / runMs, before.roll, before.maxJump,
+            after.frames * 1000.0 / runMs, after.roll, after.maxJump,
+            pacer.late(), pacer.dropped(), pacer.simDroppedMs());
+
+     const uint32_t loopMaxMs = scenario.loopMs + scenario.jitterMs;
+     const uint32_t slots = lastFrame / FRAME_INTERVAL_MS;
+     const uint32_t simulatedMs = lastFrame - pacer.simDroppedMs();
+     double expected = ROLL_RATE * ((double)simulatedMs - STEP_INTERVAL_MS) / 1000.0;
+     check(fabs(after.roll - expected) < 1e-3 * ROLL_RATE, scenario.name,
+           "rendered roll follows the simulated time, one step behind");
+     check(pacer.steps() * STEP_INTERVAL_MS <= simulatedMs && simulatedMs - pacer.steps() * STEP_INTERVAL_MS < STEP_INTERVAL_MS,
+           scenario.name, "steps account for the simulated time");
+
+     check(after.maxJump <= ROLL_RATE * FRAME_MAX_CATCHUP_MS / 1000.0 + 1e-6, scenario.name,
+           "no frame catches up more than FRAME_MAX_CATCHUP_MS");
+     check(pacer.simDroppedMs() == catchUpDropped, scenario.name,
+           "simulation dropped by what gaps exceed FRAME_MAX_CATCHUP_MS");
+     if (scenario.stalls == 0) check(pacer.simDroppedMs() == 0, scenario.name, "no simulation dropped without stalls");
+
+     check(pacer.frames() == after.frames, scenario.name, "pacer counts every frame");
+     check(after.frames + pacer.dropped() <= slots + 1, scenario.name, "no more frames than slots");
+     check(after.frames + pacer.dropped() + pacer.late() >= slots - 1, scenario.name,
+           "every slot rendered or dropped (a restart after a drop may lose part of one)");
+     if (loopMaxMs < FRAME_INTERVAL_MS && scenario.stalls == 0) {
+       check(pacer.dropped() == 0, scenario.name, "no frames dropped when the loop keeps up");
+       check(after.frames + 1 >= slots && after.frames <= slots + 1, scenario.name, "frame cadence does not drift");
+     }
+     if (loopMaxMs <= FRAME_INTERVAL_MS / FRAME_LATE_DIVISOR) {
+       check(pacer.late() == 0, scenario.name, "no late frames when a pass is shorter than the lateness margin");
+     }
+   }
+
+   printf("\nexpected roll %.0f deg over %u s, less %.0f deg per second of dropped simulation\n",
+          ROLL_RATE * seconds, seconds, ROLL_RATE);
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
@@ -0,0 +1,306 @@
+// Persistence test for the runtime parameter registry
+//
+// Runs the firmware's ParameterRegistry (src/params.cpp, compiled in as is)
+// against the file-backed Preferences and simulated clock of tools/host:
+//
+//   g++ -O2 -std=c++17 -Isrc -Itools/host -o params_sim tools/params_sim.cpp src/params.cpp tools/host/host_rtos.cpp -pthread
+//   params_sim
+//
+// Namespace files go to a fresh directory under /tmp. Checked:
+//   - a fresh store starts from the defaults without writing
+//   - a burst of SETs is written once, PARAMS_COMMIT_DELAY after the last
+//     change, and not before; commit() writes at once, and only when dirty
+//   - values survive a reopen (reboot)
+//   - a blob from older firmware (fewer parameters) loads its prefix and
+//     leaves the newer parameters at their defaults
+//   - wrong version, newer (longer) blobs and truncated blobs fall back to
+//     the defaults; a stored value outside its range falls back alone
+//   - without a blob the default mode of the oldest firmware is migrated
+//   - a version 1 blob (mode intervals inside the list) is migrated to the
+//     current layout and rewritten; the interval blob loads by mode number,
+//     a shorter one (fewer modes) leaves the later modes at their defaults,
+//     and changing an interval leaves the parameter blob alone
+//   - telecommand text: only whole, finite numbers are accepted, whole
+//     numbers for integer parameters, and set() refuses NaN and the range ends
+
+#include "params.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#define NAMESPACE "cadse"
+
+static int failures = 0;
+static int changes = 0;
+
+static void check(bool condition, const char* what) {
+   if (condition) return;
+   printf("FAIL: %s\n", what);
+   failures++;
+}
+
+static void countChange(int) {
+   changes++;
+}
+
+// Layout of the stored blobs (ParameterRegistry::Blob)
+struct StoredBlob {
+   uint16_t version;
+   uint16_t count;
+   ParamValue values[PARAM_COUNT + PARAMS_MAX_MODES];
+};
+
+static size_t blobBytes(int count) {
+   return offsetof(StoredBlob, values) + count * sizeof(ParamValue);
+}
+
+static void defaultsAndDebounce() {
+   Preferences prefs;
+   prefs.begin(NAMESPACE);
+   ParameterRegistry registry;
+   registry.begin(prefs);
+   registry.setChangeHandler(countChange);
+   check(registry.getInt(PARAM_TELEMETRY_PERIOD) == 1000 && registry.getInt(PARAM_BOARD_ID) == -1,
+         "fresh store: defaults");
+   check(!registry.pending() && prefs.writes() == 0, "fresh store: nothing written");
+
+   // Twenty SETs 200 ms apart, servicing every 10 ms like loop()
+   int id = registry.find("telemetry_period_ms");
+   uint64_t lastSet = 0;
+   bool early = false;
+   for (int tick = 0; tick < 2000; tick++) {
+     if (tick % 20 == 0 && tick / 20 < 20) {
+       registry.set(id, 500 + tick);
+       lastSet = host::now();
+     }
+     registry.service();
+     if (registry.flashWrites() > 0 && host::now() - lastSet < PARAMS_COMMIT_DELAY * 1000ull) early = true;
+     host::advance(10000);
+   }
+   printf("burst: 20 sets, %u flash write(s), %u file write(s)\n", registry.flashWrites(), prefs.writes());
+   check(changes == 20, "change handler called per set");
+   check(!early, "no write before the values settled");
+   check(registry.flashWrites() == 1 && prefs.writes() == 1, "burst written once");
+   check(!registry.pending(), "nothing pending after the write");
+
+   registry.commit();
+   check(prefs.writes() == 1, "commit() without changes does not write");
+   registry.set(registry.find("qnh_hpa"), 1020.5f);
+   registry.commit();
+   check(prefs.writes() == 2 && !registry.pending(), "commit() writes pending changes at once");
+   registry.service();
+   host::advance(PARAMS_COMMIT_DELAY * 1000ull);
+   registry.service();
+   check(prefs.writes() == 2, "no second write after commit()");
+
+   // Reboot
+   Preferences reopened;
+   reopened.begin(NAMESPACE);
+   ParameterRegistry loaded;
+   loaded.begin(reopened);
+   check(loaded.getInt(PARAM_TELEMETRY_PERIOD) == 880 && loaded.getFloat(PARAM_QNH) == 1020.5f,
+         "values survive a reopen");
+}
+
+static void storeBlob(const StoredBlob& blob, size_t length) {
+   Preferences prefs;
+   prefs.begin(NAMESPACE);
+   prefs.clear();
+   prefs.putBytes(PARAMS_KEY, &blob, length);
+}
+
+static ParameterRegistry loadStore() {
+   Preferences prefs;
+   prefs.begin(NAMESPACE);
+   ParameterRegistry registry;
+   registry.begin(prefs);
+   return registry;
+}
+
+static void olderBlobs() {
+   // Firmware from before qnh_hpa and telemetry_format
+   const int oldCount = PARAM_QNH;
+   StoredBlob blob = {};
+   blob.version = PARAMS_VERSION;
+   blob.count = oldCount;
+   Preferences prefs;
+   prefs.begin(NAMESPACE);
+   prefs.clear();
+   ParameterRegistry defaults = loadStore();
+   for (int id = 0; id < PARAM_COUNT; id++) {
+     blob.values[id].i = defaults.getInt((ParamId)id);
+   }
+   blob.values[PARAM_TELEMETRY_PERIOD].i = 2500;
+   blob.values[PARAM_ALERT_THRESHOLD].f = 7.5f;
+   blob.values[PARAM_BOARD_ID].i = 42;
+   blob.values[PARAM_MIRROR_PERIOD].i = 200;
+
+   storeBlob(blob, blobBytes(oldCount));
+   ParameterRegistry registry = loadStore();
+   check(registry.getInt(PARAM_TELEMETRY_PERIOD) == 2500 && registry.getFloat(PARAM_ALERT_THRESHOLD) == 7.5f &&
+         registry.getInt(PARAM_BOARD_ID) == 42 && registry.getInt(PARAM_MIRROR_PERIOD) == 200,
+         "older blob: stored prefix loaded");
+   check(registry.getFloat(PARAM_QNH) == defaults.getFloat(PARAM_QNH) &&
+         registry.getInt(PARAM_TELEMETRY_FORMAT) == defaults.getInt(PARAM_TELEMETRY_FORMAT),
+         "older blob: newer parameters at their defaults");
+   check(!registry.pending(), "older blob: loading does not write");
+
+   // One value outside its range falls back alone
+   StoredBlob bad = blob;
+   bad.values[PARAM_TELEMETRY_PERIOD].i = 5;
+   storeBlob(bad, blobBytes(oldCount));
+   registry = loadStore();
+   check(registry.getInt(PARAM_TELEMETRY_PERIOD) == 1000 && registry.getInt(PARAM_BOARD_ID) == 42,
+         "out-of-range value: that one at its default");
+
+   StoredBlob other = blob;
+   other.version = PARAMS_VERSION + 1;
+   storeBlob(other, blobBytes(oldCount));
+   check(loadStore().getInt(PARAM_BOARD_ID) == -1, "other version: defaults");
+
+   storeBlob(blob, blobBytes(oldCount) - 2);
+   check(loadStore().getInt(PARAM_BOARD_ID) == -1, "truncated blob: defaults");
+
+   StoredBlob lying = blob;
+   lying.count = PARAM_COUNT;
+   storeBlob(lying, blobBytes(oldCount));
+   check(loadStore().getInt(PARAM_BOARD_ID) == -1, "count not matching the length: defaults");
+
+   // Newer firmware with more parameters
+   StoredBlob newer = blob;
+   newer.count = PARAM_COUNT + 2;
+   storeBlob(newer, blobBytes(PARAM_COUNT + 2));
+   check(loadStore().getInt(PARAM_BOARD_ID) == -1, "newer, longer blob: defaults");
+
+   // Oldest firmware: no blob, the default mode under its own key
+   prefs.clear();
+   prefs.putInt("defMode", 3);
+   check(loadStore().getInt(PARAM_DEFAULT_MODE) == 3, "default mode migrated without a blob");
+}
+
+static void modeIntervals() {
+   Preferences prefs;
+   prefs.begin(NAMESPACE);
+   prefs.clear();
+   ParameterRegistry defaults = loadStore();
+   int mode5 = defaults.find("mode5_interval_ms");
+   check(ParameterRegistry::count() == PARAM_COUNT + 6 && mode5 == PARAM_MODE_INTERVAL + 5 &&
+         defaults.modeInterval(5) == 50 && defaults.find("mode6_interval_ms") == -1,
+         "one interval per registered mode, defaulted from the registry");
+
+   // Version 1: default_mode, mode0..5 intervals, then board_id
+   StoredBlob old = {};
+   old.version = 1;
+   old.count = 17;
+   old.values[0].i = 2500;
+   old.values[1].f = 7.5f;
+   old.values[2].i = 40000;
+   old.values[3].i = 15000;
+   old.values[4].i = 3;
+   for (int mode = 0; mode < 6; mode++) old.values[5 + mode].i = 100 + mode;
+   old.values[11].i = 42;
+   old.values[12].i = 20000;
+   old.values[13].i = 0;
+   old.values[14].i = 200;
+   old.values[15].f = 1020.5f;
+   old.values[16].i = 1;
+   storeBlob(old, blobBytes(17));
+   prefs.begin(NAMESPACE);
+   ParameterRegistry migrated;
+   migrated.begin(prefs);
+   bool intervals = true;
+   for (int mode = 0; mode < 6; mode++) intervals = intervals && migrated.modeInterval(mode) == 100 + mode;
+   check(intervals, "version 1: mode intervals migrated");
+   check(migrated.getInt(PARAM_TELEMETRY_PERIOD) == 2500 && migrated.getInt(PARAM_DEFAULT_MODE) == 3 &&
+         migrated.getInt(PARAM_BOARD_ID) == 42 && migrated.getInt(PARAM_TELEMETRY_MAX_PERIOD) == 20000 &&
+         migrated.getInt(PARAM_RATE_CONTROL) == 0 && migrated.getFloat(PARAM_QNH) == 1020.5f &&
+         migrated.getInt(PARAM_TELEMETRY_FORMAT) == 1,
+         "version 1: later parameters moved to their new ids");
+   check(migrated.pending(), "version 1: rewritten in the current layout");
+   uint32_t writes = prefs.writes();
+   migrated.commit();
+   check(prefs.writes() == writes + 2 && prefs.getBytesLength(PARAMS_KEY) == blobBytes(PARAM_COUNT) &&
+         prefs.getBytesLength(PARAMS_INTERVALS_KEY) == blobBytes(6),
+         "version 1: both blobs written");
+   ParameterRegistry reloaded = loadStore();
+   check(reloaded.modeInterval(3) == 103 && reloaded.getInt(PARAM_BOARD_ID) == 42 && !reloaded.pending(),
+         "version 1: migrated values survive a reopen");
+
+   // Interval blob from firmware with four modes
+   StoredBlob four = {};
+   four.version = PARAMS_INTERVALS_VERSION;
+   four.count = 4;
+   for (int mode = 0; mode < 4; mode++) four.values[mode].i = 300 + mode;
+   prefs.begin(NAMESPACE);
+   prefs.putBytes(PARAMS_INTERVALS_KEY, &four, blobBytes(4));
+   ParameterRegistry fewer = loadStore();
+   check(fewer.modeInterval(3) == 303 && fewer.modeInterval(4) == defaults.modeInterval(4) &&
+         fewer.modeInterval(5) == defaults.modeInterval(5) && fewer.getInt(PARAM_BOARD_ID) == 42,
+         "shorter interval blob: later modes at their defaults, other parameters untouched");
+
+   four.count = PARAMS_MAX_MODES + 1;
+   prefs.putBytes(PARAMS_INTERVALS_KEY, &four, blobBytes(PARAMS_MAX_MODES + 1));
+   check(loadStore().modeInterval(0) == defaults.modeInterval(0), "interval blob over capacity: defaults");
+
+   // An interval change rewrites only the interval blob
+   prefs.begin(NAMESPACE);
+   ParameterRegistry registry;
+   registry.begin(prefs);
+   uint32_t before = prefs.writes();
+   check(registry.set(mode5, 75) && registry.modeInterval(5) == 75, "set mode5_interval_ms");
+   registry.commit();
+   check(prefs.writes() == before + 1 && loadStore().modeInterval(5) == 75, "interval change: one blob written");
+}
+
+static void telecommandText() {
+   ParameterRegistry registry = loadStore();
+   int board = registry.find("board_id");
+   int qnh = registry.find("qnh_hpa");
+   float value = -99;
+   const char* refused[] = { "abc", "", " ", "12abc", "1.5", "nan", "inf", "-inf", "1e40", "0x", "4 2" };
+   for (const char* text : refused) {
+     if (registry.parse(board, text, value)) {
+       printf("FAIL: board_id accepted \"%s\"\n", text);
+       failures++;
+     }
+   }
+   check(registry.parse(board, "42", value) && value == 42, "board_id 42");
+   check(registry.parse(board, "-1 ", value) && value == -1, "board_id -1 with a trailing space");
+   check(registry.parse(board, "1e3", value) && value == 1000, "board_id 1e3 is whole");
+   check(registry.parse(qnh, "1013.25", value) && value == 1013.25f, "qnh_hpa 1013.25");
+   check(!registry.parse(-1, "1", value) && !registry.parse(ParameterRegistry::count(), "1", value),
+         "unknown id refused");
+
+   check(!registry.set(qnh, NAN), "set() refuses NaN");
+   check(registry.set(board, 9999) && !registry.set(board, 10000) && !registry.set(board, -2), "set() range ends");
+   check(registry.set(qnh, 850) && registry.set(qnh, 1100) && !registry.set(qnh, 1100.01f), "float range ends");
+}
+
+int main() {
+   char directory[] = "/tmp/params_sim.XXXXXX";
+   if (!mkdtemp(directory)) {
+     perror("mkdtemp");
+     return 2;
+   }
+   Preferences::setDirectory(directory);
+   Serial.setOutput(nullptr);
+
+   defaultsAndDebounce();
+   olderBlobs();
+   modeIntervals();
+   telecommandText();
+
+   remove((std::string(directory) + "/" NAMESPACE ".nvs").c_str());
+   rmdir(directory);
+
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
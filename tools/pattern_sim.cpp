@@ -0,0 +1,301 @@
+// Host test of the buzzer and LED pattern sequencer
+//
+// Drives the firmware's PatternSequencer and patterns (src/pattern_sequencer.cpp,
+// compiled in as is) with a fake one-shot timer the way FeedbackPlayer does:
+// after every play(), stop() and advance() the timer is armed for due(), and
+// it fires late by a random jitter (the esp_timer task being held up). Every
+// output change is recorded and checked
+//   - against the nominal step boundaries: never early, late by no more than
+//     the jitter, and no drift over long and endless patterns
+//   - for priorities: an alarm cuts UI beeps short, UI feedback is refused
+//     during an alarm, equal priorities replace each other, stop()
+//   - after a long stall: outputs jump to the step due, the end stays put
+// then on a seeded random session against an analytic reference of which
+// step should be playing at any time.
+//
+//   g++ -O2 -std=c++17 -Isrc -o pattern_sim tools/pattern_sim.cpp src/pattern_sequencer.cpp
+//   pattern_sim [--seed n] [--jitter us] [--events n]
+
+#include "pattern_sequencer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+   if (condition) return;
+   printf("FAIL: %s\n", what);
+   failures++;
+}
+
+struct Change {
+   int64_t us;
+   uint16_t toneHz;
+   bool led;
+};
+
+// Output callbacks are plain function pointers: one recorder at a time
+static std::vector<Change>* recording = nullptr;
+static int64_t clockUs = 0;
+static uint16_t toneNow = 0;
+static bool ledNow = false;
+
+static void recordTone(uint16_t hz) {
+   toneNow = hz;
+   recording->push_back({ clockUs, toneNow, ledNow });
+}
+
+static void recordLed(bool on) {
+   ledNow = on;
+   recording->push_back({ clockUs, toneNow, ledNow });
+}
+
+// PatternSequencer behind a fake esp_timer
+struct Rig {
+   PatternSequencer sequencer;
+   std::vector<Change> changes;
+   std::mt19937 random;
+   int64_t jitterUs;
+   int64_t armedAt = PATTERN_IDLE;
+
+   Rig(unsigned seed, int64_t jitter) : random(seed), jitterUs(jitter) {
+     recording = &changes;
+     clockUs = 0;
+     sequencer.begin(recordTone, recordLed);
+     changes.clear();
+   }
+   void arm() {
+     int64_t due = sequencer.due();
+     armedAt = due == PATTERN_IDLE ? PATTERN_IDLE : due + (jitterUs ? random() % (jitterUs + 1) : 0);
+   }
+   // Let simulated time pass up to us, firing the timer on the way
+   void run(int64_t us) {
+     while (armedAt != PATTERN_IDLE && armedAt <= us) {
+       clockUs = armedAt;
+       sequencer.advance(clockUs);
+       arm();
+     }
+     clockUs = us;
+   }
+   // Timer held up until us: fires once there, late
+   void stall(int64_t us) {
+     if (armedAt != PATTERN_IDLE && armedAt < us) armedAt = us;
+     run(us);
+   }
+   bool play(const Pattern& pattern, uint8_t repeats, int64_t us) {
+     run(us);
+     bool started = sequencer.play(pattern, repeats, clockUs);
+     arm();
+     return started;
+   }
+   void stop(const Pattern& pattern, int64_t us) {
+     run(us);
+     sequencer.stop(pattern, clockUs);
+     arm();
+   }
+};
+
+// Nominal change times of a pattern started at startUs, repeats times
+static std::vector<Change> nominal(const Pattern& pattern, uint8_t repeats, int64_t startUs) {
+   std::vector<Change> out;
+   int64_t t = startUs;
+   uint16_t tone = 0;
+   bool led = false;
+   for (int r = 0; r < repeats; r++) {
+     for (int i = 0; i < pattern.count; i++) {
+       const PatternStep& step = pattern.steps[i];
+       if (step.toneHz != tone) out.push_back({ t, tone = step.toneHz, led });
+       if (step.led != led) out.push_back({ t, tone, led = step.led });
+       t += step.ms * 1000;
+     }
+   }
+   if (tone) out.push_back({ t, tone = 0, led });
+   if (led) out.push_back({ t, tone, led = false });
+   return out;
+}
+
+static void compareTiming(const std::vector<Change>& got, const std::vector<Change>& want, int64_t jitterUs,
+                          const char* what) {
+   bool ok = got.size() == want.size();
+   for (size_t i = 0; ok && i < got.size(); i++) {
+     int64_t late = got[i].us - want[i].us;
+     ok = got[i].toneHz == want[i].toneHz && got[i].led == want[i].led && late >= 0 && late <= jitterUs;
+   }
+   if (!ok) {
+     printf("  %s: %zu changes, expected %zu\n", what, got.size(), want.size());
+     for (size_t i = 0; i < got.size() && i < 20; i++) {
+       printf("    %8lld us %5u Hz led %d", (long long)got[i].us, got[i].toneHz, got[i].led);
+       if (i < want.size()) printf("   want %8lld us %5u Hz led %d", (long long)want[i].us, want[i].toneHz, want[i].led);
+       printf("\n");
+     }
+   }
+   check(ok, what);
+}
+
+static void fixed(unsigned seed, int64_t jitterUs) {
+   {
+     Rig rig(seed, jitterUs);
+     rig.play(patternBoot, 1, 1000);
+     rig.run(2000000);
+     compareTiming(rig.changes, nominal(patternBoot, 1, 1000), jitterUs, "boot chime timing");
+     check(rig.sequencer.due() == PATTERN_IDLE, "idle after the chime");
+   }
+   {
+     // Mode 5: six beeps, the longest UI pattern; the old loop blocked 1.2 s for it
+     Rig rig(seed, jitterUs);
+     rig.play(patternModeChange, 6, 0);
+     rig.run(3000000);
+     compareTiming(rig.changes, nominal(patternModeChange, 6, 0), jitterUs, "six mode beeps timing");
+   }
+   {
+     // An endless alarm does not drift: boundary 600 still on the nominal grid
+     Rig rig(seed, jitterUs);
+     rig.play(patternCatAlarm, 0, 0);
+     rig.run(720000000);
+     std::vector<Change> want = nominal(patternCatAlarm, 100, 0);
+     want.resize(rig.changes.size() < want.size() ? rig.changes.size() : want.size());
+     std::vector<Change> got(rig.changes.begin(), rig.changes.begin() + want.size());
+     compareTiming(got, want, jitterUs, "endless alarm stays on the grid");
+     rig.stop(patternCatAlarm, 720000000);
+     check(!rig.changes.empty() && rig.changes.back().toneHz == 0 && !rig.changes.back().led, "stop silences");
+   }
+   {
+     Rig rig(seed, jitterUs);
+     rig.play(patternModeChange, 6, 0);
+     check(rig.play(patternCatAlarm, 0, 350000), "alarm preempts mode beeps");
+     check(rig.sequencer.preempted() == 1, "preemption counted");
+     check(rig.changes.back().us == 350000 && rig.changes.back().led, "alarm starts at once");
+     check(!rig.play(patternModeChange, 1, 500000), "mode beeps refused during an alarm");
+     check(!rig.play(patternWarning, 1, 600000), "warning refused during an alarm");
+     rig.stop(patternModeChange, 700000);
+     check(rig.sequencer.playing(patternCatAlarm), "stop() of another pattern ignored");
+     check(rig.play(patternPowerAlarm, 0, 900000), "equal priority replaces");
+     rig.stop(patternPowerAlarm, 1000000);
+     check(rig.sequencer.due() == PATTERN_IDLE && rig.changes.back().toneHz == 0, "stopped");
+     rig.run(5000000);
+     check(rig.changes.back().us == 1000000, "replaced and preempted patterns do not resume");
+   }
+   {
+     // Timer held up 350 ms into six beeps: straight into beep 3, same end
+     Rig rig(seed, 0);
+     rig.play(patternModeChange, 6, 0);
+     rig.run(120000);
+     rig.stall(450000);
+     Change last = rig.changes.back();
+     check(last.us == 450000 && last.toneHz == 2000, "after the stall: beep 3");
+     rig.run(1199999);
+     check(rig.sequencer.due() == 1200000 && rig.changes.back().us == 1100000, "last pause on time after a stall");
+     rig.run(1200000);
+     check(rig.sequencer.due() == PATTERN_IDLE, "ends on time after a stall");
+   }
+   {
+     Rig rig(seed, jitterUs);
+     static const PatternStep empty[] = { { 1000, true, 0 } };
+     static const Pattern zero = { "zero", PATTERN_PRIORITY_ALARM, 1, empty };
+     check(!rig.play(zero, 0, 0) && rig.changes.empty(), "pattern without duration refused");
+   }
+}
+
+// Expected step of the current pattern at us, from its start alone
+struct Reference {
+   const Pattern* pattern = nullptr;
+   int64_t start = 0;
+   int repeats = 0;
+
+   void play(const Pattern& p, int r, int64_t us) {
+     if (pattern && p.priority < pattern->priority) return;
+     pattern = &p;
+     start = us;
+     repeats = r;
+   }
+   void settle(int64_t us) {
+     if (!pattern || repeats == 0) return;
+     int64_t period = 0;
+     for (int i = 0; i < pattern->count; i++) period += pattern->steps[i].ms * 1000;
+     if (us >= start + period * repeats) pattern = nullptr;
+   }
+   Change at(int64_t us) {
+     settle(us);
+     if (!pattern) return { us, 0, false };
+     int64_t period = 0;
+     for (int i = 0; i < pattern->count; i++) period += pattern->steps[i].ms * 1000;
+     int64_t offset = (us - start) % period;
+     for (int i = 0; i < pattern->count; i++) {
+       offset -= pattern->steps[i].ms * 1000;
+       if (offset < 0) return { us, pattern->steps[i].toneHz, pattern->steps[i].led };
+     }
+     return { us, 0, false };
+   }
+};
+
+static void session(unsigned seed, int events) {
+   // No jitter here: outputs must match the reference exactly at every callback
+   static const Pattern* const patterns[] = {
+     &patternBoot, &patternModeChange, &patternWarning, &patternFreeFall, &patternCatAlarm, &patternPowerAlarm
+   };
+   Rig rig(seed, 0);
+   Reference reference;
+   std::mt19937 random(seed * 7 + 1);
+   int64_t now = 0;
+   int mismatches = 0;
+   for (int i = 0; i < events; i++) {
+     int64_t next = now + 1000 * (1 + random() % 3000);
+     // Check at a few points on the way: the last change before each point is the reference's step
+     for (int k = 0; k < 4; k++) {
+       int64_t probe = now + (next - now) * (k + 1) / 5;
+       rig.run(probe);
+       reference.settle(probe);
+       Change want = reference.at(probe);
+       if (toneNow != want.toneHz || ledNow != want.led) mismatches++;
+     }
+     rig.run(next);
+     now = next;
+     const Pattern& p = *patterns[random() % 6];
+     if (random() % 5 == 0) {
+       rig.stop(p, now);
+       reference.settle(now);
+       if (reference.pattern == &p) reference.pattern = nullptr;
+     } else {
+       int repeats = p.priority == PATTERN_PRIORITY_ALARM && random() % 2 ? 0 : 1 + random() % 6;
+       reference.settle(now);
+       rig.play(p, repeats, now);
+       reference.play(p, repeats, now);
+     }
+   }
+   check(mismatches == 0, "random session matches the reference");
+   printf("random session: %d plays/stops, %u played, %u preempted, %u refused, %d mismatches\n", events,
+          rig.sequencer.played(), rig.sequencer.preempted(), rig.sequencer.refused(), mismatches);
+}
+
+int main(int argc, char** argv) {
+   unsigned seed = 1;
+   int64_t jitterUs = 2000;
+   int events = 20000;
+   for (int i = 1; i < argc; i++) {
+     if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--jitter") && i + 1 < argc) jitterUs = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--events") && i + 1 < argc) events = atoi(argv[++i]);
+     else {
+       fprintf(stderr, "usage: pattern_sim [--seed n] [--jitter us] [--events n]\n");
+       return 2;
+     }
+   }
+
+   fixed(seed, jitterUs);
+   printf("fixed cases: callback jitter up to %lld us\n", (long long)jitterUs);
+   session(seed, events);
+
+   // What the callers no longer wait for
+   printf("\nblocking per call, before -> now: boot chime 400 ms -> 0, mode change (mode + 1) x 200 ms -> 0\n");
+
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
@@ -0,0 +1,246 @@
+// Host test of the per-mode power gating state machine
+//
+// Drives the firmware's PowerGate (src/power_gate.cpp, compiled in as is)
+// the way switchMode() does: exit() back to the baseline, mode-change screen,
+// enter() with the mode's declared needs. Checks after every step
+//   - the powered set is the mode's needs inside a mode, everything outside
+//   - enter()/exit() report exactly the peripherals that changed
+//   - resident and per-peripheral on-times add up to the simulated clock,
+//     busy time only counts while a mode is current, also past 2^32 us
+//   - the BME280 is reconfigured on a switch only when the new mode gates it
+//     differently (switchMode() defers it past the exit)
+// first on a fixed walk through the edge cases, then on a seeded random
+// session. Finally it estimates what the gating saves per mode with
+// datasheet-typical currents (assumptions, see below; the board reports the
+// measured times through the POWER command).
+//
+//   g++ -O2 -std=c++17 -Isrc -o power_sim tools/power_sim.cpp src/power_gate.cpp
+//   power_sim [--seed n] [--switches n]
+
+#include "power_gate.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+// As declared in src/modes.h
+static const int modeCount = 6;
+static const char* const names[modeCount] = {
+   "Basic Monitoring", "Micro-G Detection", "Pressure Monitor",
+   "Attitude Indicator", "Rolling Plotter", "Orbit Sim"
+};
+static const uint8_t needs[modeCount] = {
+   POWER_NONE,
+   POWER_DISPLAY,
+   POWER_DISPLAY | POWER_BME280,
+   POWER_DISPLAY,
+   POWER_DISPLAY | POWER_BME280,
+   POWER_DISPLAY
+};
+
+// Typical currents for the estimate (mA). BME280: pressure measurement
+// current with conversions back to back at x16, vs one forced x1 conversion
+// (about 8 ms) per second. SSD1306: a text-heavy 128x64 frame, segment
+// current scaling with contrast 0xCF vs 0x10 on top of the controller's own.
+#define BME_NORMAL_MA      0.714
+#define BME_GATED_MA       0.006
+#define DISPLAY_FULL_MA    8.0
+#define DISPLAY_DIM_MA     1.2
+#define STATS_TOUCH_MS     20       // As in src/cadse.h
+
+static int failures = 0;
+
+static void check(bool condition, const char* what, int step) {
+   if (condition) return;
+   printf("FAIL step %d: %s\n", step, what);
+   failures++;
+}
+
+static int bits(uint8_t value) {
+   int n = 0;
+   for (; value; value &= value - 1) n++;
+   return n;
+}
+
+// Reference model of the accounting, kept next to the gate
+struct Model {
+   uint8_t powered = POWER_ALL;
+   int current = -1;
+   uint32_t transitions = 0;
+   ModePower modes[POWER_MAX_MODES] = {};
+
+   void elapse(uint32_t ms) {
+     if (current < 0) return;
+     modes[current].residentMs += ms;
+     for (int bit = 0; bit < POWER_PERIPHERALS; bit++) {
+       if (powered & (1 << bit)) modes[current].onMs[bit] += ms;
+     }
+   }
+   uint8_t set(uint8_t target) {
+     uint8_t changed = powered ^ target;
+     transitions += bits(changed);
+     powered = target;
+     return changed;
+   }
+};
+
+static void compare(PowerGate& gate, Model& model, uint32_t now, int step) {
+   check(gate.state() == model.powered, "powered set", step);
+   check(gate.mode() == model.current, "current mode", step);
+   check(gate.transitions() == model.transitions, "transition count", step);
+   for (int mode = 0; mode < POWER_MAX_MODES; mode++) {
+     ModePower got = gate.stats(mode, now);
+     const ModePower& want = model.modes[mode];
+     check(got.entries == want.entries && got.residentMs == want.residentMs && got.busyUs == want.busyUs,
+           "entries, resident or busy time", step);
+     for (int bit = 0; bit < POWER_PERIPHERALS; bit++) {
+       check(got.onMs[bit] == want.onMs[bit], "peripheral on-time", step);
+     }
+   }
+}
+
+struct Session {
+   PowerGate gate;
+   Model model;
+   uint32_t now = 1000;
+   int step = 0;
+   bool bmeNormal = true;       // BME280 configuration, as applyPower() keeps it
+   uint32_t bmeWrites = 0;
+   uint32_t bmeWritesUndeferred = 0;
+
+   Session() { gate.begin(now); }
+
+   void stay(uint32_t ms, uint32_t busyUs) {
+     now += ms;
+     model.elapse(ms);
+     gate.busy(busyUs);
+     if (model.current >= 0) model.modes[model.current].busyUs += busyUs;
+     compare(gate, model, now, ++step);
+   }
+   void enter(int mode, uint8_t needs) {
+     uint8_t changed = gate.enter(mode, needs, now);
+     uint8_t expected;
+     if (mode >= 0 && mode < POWER_MAX_MODES) {
+       model.current = mode;
+       model.modes[mode].entries++;
+       expected = model.set(needs);
+     } else {
+       expected = model.set(POWER_ALL);
+     }
+     check(changed == expected, "enter() change mask", ++step);
+     compare(gate, model, now, step);
+   }
+   void exit() {
+     uint8_t changed = gate.exit(now);
+     model.current = -1;
+     check(changed == model.set(POWER_ALL), "exit() change mask", ++step);
+     compare(gate, model, now, step);
+   }
+   // switchMode(): exit, beeps and mode screen, enter. Reconfiguring the
+   // BME280 at the exit too would write it on both ends of every switch
+   // away from a mode that gates it.
+   void change(int mode, uint32_t screenMs) {
+     bool before = bmeNormal;
+     exit();
+     stay(screenMs, 500);       // Not charged to any mode
+     enter(mode, needs[mode]);
+     bmeNormal = gate.on(POWER_BME280);
+     if (bmeNormal != before) bmeWrites++;
+     bmeWritesUndeferred += (!before) + (!bmeNormal);
+     check(bmeNormal == ((needs[mode] & POWER_BME280) != 0), "BME280 configured for the new mode", step);
+   }
+};
+
+int main(int argc, char** argv) {
+   unsigned seed = 1;
+   int switches = 2000;
+   for (int i = 1; i < argc; i++) {
+     if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--switches") && i + 1 < argc) switches = atoi(argv[++i]);
+     else {
+       fprintf(stderr, "usage: power_sim [--seed n] [--switches n]\n");
+       return 2;
+     }
+   }
+
+   // Fixed walk: boot into mode 0, a mode with the same needs as the last,
+   // a mode needing everything, a mode number past the table, re-entering
+   Session walk;
+   walk.enter(0, needs[0]);
+   check(walk.gate.state() == POWER_NONE, "mode 0 gates everything", walk.step);
+   walk.stay(5000, 1200);
+   walk.change(2, 400);
+   check(walk.gate.on(POWER_BME280) && walk.gate.on(POWER_DISPLAY) && !walk.gate.on(POWER_TOUCH_AUX),
+         "mode 2 keeps BME280 and display", walk.step);
+   walk.stay(3000, 900);
+   walk.change(4, 1000);
+   walk.stay(2000, 800);
+   walk.change(3, 800);
+   check(!walk.gate.on(POWER_BME280), "mode 3 sleeps the BME280", walk.step);
+   walk.stay(1000, 300);
+   walk.exit();
+   walk.stay(100, 50);
+   walk.enter(POWER_MAX_MODES, POWER_NONE);
+   check(walk.gate.state() == POWER_ALL, "unknown mode leaves everything on", walk.step);
+   walk.stay(100, 50);
+   walk.change(3, 200);
+   walk.stay(1000, 300);
+   walk.change(3, 200);
+   check(walk.gate.stats(3, walk.now).entries == 3, "re-entries counted", walk.step);
+   printf("fixed walk: %d steps, %u transitions\n", walk.step, walk.gate.transitions());
+
+   // Random session: about a week of mode changes, 2 s to 10 min per stay
+   Session session;
+   std::mt19937 random(seed);
+   session.enter(0, needs[0]);
+   for (int i = 0; i < switches; i++) {
+     session.stay(2000 + random() % 600000, random() % 200000);
+     session.change(random() % modeCount, 200 * (1 + random() % modeCount));
+   }
+   session.stay(60000, 1000);
+   printf("random session: %d switches, %u transitions, %.1f h\n", switches, session.gate.transitions(),
+          (session.now - 1000) / 3600000.0);
+   printf("BME280 reconfigurations: %u (%u when also switched at each exit)\n", session.bmeWrites,
+          session.bmeWritesUndeferred);
+   check(session.bmeWrites <= session.bmeWritesUndeferred, "deferring never adds BME280 writes", session.step);
+
+   // Three hours in one mode at half load: busy time passes 2^32 us at 71.6 min
+   Session longStay;
+   longStay.enter(2, needs[2]);
+   for (int minute = 0; minute < 180; minute++) {
+     for (int tick = 0; tick < 60; tick++) longStay.gate.busy(500000);
+     longStay.now += 60000;
+   }
+   ModePower stats = longStay.gate.stats(2, longStay.now);
+   check(stats.busyUs == 180ull * 60 * 500000 && stats.residentMs == 180u * 60000, "busy time past 2^32 us",
+         longStay.step);
+   check(stats.busyUs / (stats.residentMs * 10.0) == 50.0, "busy_pct after three hours", longStay.step);
+
+   // Savings estimate over the random session, per mode
+   printf("\n%-20s %6s %10s %8s %8s %12s %12s %8s\n", "mode", "needs", "resident s", "bme on", "disp on",
+          "gated mA", "ungated mA", "aux rd/s");
+   for (int mode = 0; mode < modeCount; mode++) {
+     ModePower stats = session.gate.stats(mode, session.now);
+     if (stats.residentMs == 0) continue;
+     double bmeShare = (double)stats.onMs[0] / stats.residentMs;
+     double auxShare = (double)stats.onMs[1] / stats.residentMs;
+     double displayShare = (double)stats.onMs[2] / stats.residentMs;
+     check(bmeShare == ((needs[mode] & POWER_BME280) ? 1.0 : 0.0), "BME280 on exactly while needed", mode);
+     check(displayShare == ((needs[mode] & POWER_DISPLAY) ? 1.0 : 0.0), "display full exactly while needed", mode);
+     double gated = bmeShare * BME_NORMAL_MA + (1 - bmeShare) * BME_GATED_MA +
+                    displayShare * DISPLAY_FULL_MA + (1 - displayShare) * DISPLAY_DIM_MA;
+     double ungated = BME_NORMAL_MA + DISPLAY_FULL_MA;
+     double auxReads = 3 * (auxShare * 1000.0 / STATS_TOUCH_MS + (1 - auxShare) * 1000.0 / POWER_TOUCH_IDLE_MS);
+     printf("%-20s %6u %10.0f %7.0f%% %7.0f%% %12.3f %12.3f %8.0f\n", names[mode], needs[mode],
+            stats.residentMs / 1000.0, bmeShare * 100, displayShare * 100, gated, ungated, auxReads);
+   }
+   printf("(auxiliary pad reads per second were %d before gating)\n", 3 * 1000 / STATS_TOUCH_MS);
+
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
@@ -0,0 +1,233 @@
+// Verification test and throughput benchmark for the SGP4 propagator
+//
+// Runs the firmware's OrbitPropagator (src/orbit_propagator.cpp, compiled in
+// as is) on the host:
+//
+//   g++ -O2 -std=c++17 -Isrc -o sgp4_bench tools/sgp4_bench.cpp src/orbit_propagator.cpp
+//   sgp4_bench [--verbose]
+//
+// 1. The near-earth cases of Vallado's verification set (SGP4-VER.TLE,
+//    reference output tcppver.out from "Revisiting Spacetrack Report #3",
+//    AIAA 2006-6753) against the published TEME positions and velocities.
+//    Deep-space elements fall back to two-body here and are not compared.
+// 2. Error returns: a decaying orbit must end in an error code, not in
+//    positions below the surface.
+// 3. Propagations per second for one orbit of each case, and the cost of an
+//    Ephemeris::build (one per orbit in mode 5) next to direct propagation of
+//    every frame.
+//
+// Host timing only ranks the work: the ESP32-S3 has a single-precision FPU,
+// so the double arithmetic of SGP4 runs in software there.
+
+#include "orbit_propagator.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define POSITION_TOLERANCE_KM   1.0e-3
+#define VELOCITY_TOLERANCE_KMS  1.0e-6
+
+static int failures = 0;
+static bool verbose = false;
+
+static void check(bool condition, const char* what) {
+   if (condition) return;
+   printf("FAIL: %s\n", what);
+   failures++;
+}
+
+struct Reference {
+   double tsince;        // Minutes after epoch
+   double r[3];          // km, TEME
+   double v[3];          // km/s, TEME
+};
+
+struct VerificationCase {
+   const char* name;
+   const char* line1;
+   const char* line2;
+   const Reference* points;
+   int count;
+};
+
+// 00005: Vanguard 1, e = 0.186 (tcppver.out)
+static const Reference vanguard[] = {
+   {    0.0, {  7022.46529266, -1400.08296755,     0.03995155 }, {  1.893841015,  6.405893759,  4.534807250 } },
+   {  360.0, { -7154.03120202, -3783.17682504, -3536.19412294 }, {  4.741887409, -4.151817765, -2.093935425 } },
+   {  720.0, { -7134.59340119,  6531.68641334,  3260.27186483 }, { -4.113793027, -2.911922039, -2.557327851 } },
+   { 1080.0, {  5568.53901181,  4492.06992591,  3863.87641983 }, { -4.209106476,  5.159719888,  2.744852980 } },
+   { 1440.0, {  -938.55923943, -6268.18748831, -4294.02924751 }, {  7.536105209, -0.427127707,  0.989878080 } },
+   { 1800.0, { -9680.56121728,  2802.47771354,   124.10688038 }, { -0.905874102, -4.659467970, -3.227347517 } },
+   { 2160.0, {   190.19796988,  7746.96653614,  5110.00675412 }, { -6.112325142,  1.527008184, -0.139152358 } },
+   { 2520.0, {  5579.55640116, -3995.61396789, -1518.82108966 }, {  4.767927483,  5.123185301,  4.276837355 } },
+   { 2880.0, { -8650.73082219, -1914.93811525, -3007.03603443 }, {  3.067165127, -4.828384068, -2.515322836 } },
+   { 3240.0, { -5429.79204164,  7574.36493792,  3747.39305236 }, { -4.999442110, -1.800561422, -2.229392830 } },
+   { 3600.0, {  6759.04583722,  2001.58198220,  2783.55192533 }, { -2.180993947,  6.402085603,  3.644723952 } },
+   { 3960.0, { -3791.44531559, -5712.95617894, -4533.48630714 }, {  6.668817493, -2.516382327, -0.082384354 } },
+   { 4320.0, { -9060.47373569,  4658.70952502,   813.68673153 }, { -2.232832783, -4.110453490, -3.157345433 } },
+};
+
+// 88888: the Spacetrack Report #3 test case, in Vallado's corrected run
+static const Reference strTest[] = {
+   {    0.0, {  2328.96975262, -5995.22051338,  1719.97297192 }, {  2.912073281, -0.983417956, -7.090816210 } },
+   {  360.0, {  2456.10706533, -6071.93855503,  1222.89768554 }, {  2.679390040, -0.448290811, -7.228792155 } },
+};
+
+// 06251: low perigee with drag, the non-simplified drag path (isimp = 0)
+static const Reference dragLow[] = {
+   {    0.0, {  3988.31022699,  5498.96657235,     0.90055879 }, { -3.290032738,  2.357652820,  6.496623475 } },
+};
+
+static const VerificationCase cases[] = {
+   { "00005 Vanguard 1",
+     "1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753",
+     "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667",
+     vanguard, sizeof(vanguard) / sizeof(vanguard[0]) },
+   { "88888 STR#3",
+     "1 88888U          80275.98708465  .00073094  13844-3  66816-4 0    87",
+     "2 88888  72.8435 115.9689 0086731  52.6988 110.5714 16.05824518  1058",
+     strTest, sizeof(strTest) / sizeof(strTest[0]) },
+   { "06251 low perigee",
+     "1 06251U 62025E   06176.82412014  .00008885  00000-0  12808-3 0  3985",
+     "2 06251  58.0579  54.0425 0030035 139.1568 221.1854 15.56387291  6774",
+     dragLow, sizeof(dragLow) / sizeof(dragLow[0]) },
+};
+
+static bool load(const VerificationCase& test, OrbitPropagator& propagator) {
+   TleElements elements;
+   return parseTle(test.line1, test.line2, elements) && propagator.init(elements);
+}
+
+static void verification() {
+   printf("Vallado verification set, tolerance %.0f m and %.0f mm/s\n", POSITION_TOLERANCE_KM * 1000,
+          VELOCITY_TOLERANCE_KMS * 1.0e6);
+   for (const VerificationCase& test : cases) {
+     OrbitPropagator propagator;
+     if (!load(test, propagator)) {
+       printf("FAIL: %s: elements rejected\n", test.name);
+       failures++;
+       continue;
+     }
+     check(!propagator.isDeepSpace(), "verification case is near-earth");
+     double worstR = 0, worstV = 0;
+     for (int i = 0; i < test.count; i++) {
+       const Reference& ref = test.points[i];
+       double r[3], v[3];
+       int status = propagator.propagate(ref.tsince, r, v);
+       double dr = 0, dv = 0;
+       for (int k = 0; k < 3; k++) {
+         dr = fmax(dr, fabs(r[k] - ref.r[k]));
+         dv = fmax(dv, fabs(v[k] - ref.v[k]));
+       }
+       if (verbose) {
+         printf("    %7.1f  %16.8f %16.8f %16.8f  %12.9f %12.9f %12.9f\n", ref.tsince, r[0], r[1], r[2], v[0], v[1],
+                v[2]);
+       }
+       if (status != ORBIT_OK || dr > POSITION_TOLERANCE_KM || dv > VELOCITY_TOLERANCE_KMS) {
+         printf("FAIL: %s at %.1f min: status %d, position off %.6f km, velocity off %.9f km/s\n", test.name,
+                ref.tsince, status, dr, dv);
+         failures++;
+       }
+       worstR = fmax(worstR, dr);
+       worstV = fmax(worstV, dv);
+     }
+     printf("  %-20s %2d points, worst %.3f mm and %.3f um/s\n", test.name, test.count, worstR * 1.0e6,
+            worstV * 1.0e9);
+   }
+}
+
+static void errors() {
+   printf("\nerror returns\n");
+   // The 06251 elements with a thousand times the drag: the orbit decays within days
+   char line1[70];
+   strcpy(line1, cases[2].line1);
+   memcpy(line1 + 53, " 12808+0", 8);
+   int sum = 0;
+   for (int i = 0; i < 68; i++) {
+     if (line1[i] >= '0' && line1[i] <= '9') sum += line1[i] - '0';
+     else if (line1[i] == '-') sum += 1;
+   }
+   line1[68] = '0' + sum % 10;
+
+   TleElements elements;
+   OrbitPropagator propagator;
+   check(parseTle(line1, cases[2].line2, elements) && propagator.init(elements), "heavy-drag elements load");
+   int status = ORBIT_OK;
+   double t = 0, lowest = 1.0e9;
+   for (; t < 30 * 1440.0 && status == ORBIT_OK; t += 1.0) {
+     double r[3], v[3];
+     status = propagator.propagate(t, r, v);
+     if (status == ORBIT_OK) lowest = fmin(lowest, sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]) - 6378.135);
+   }
+   printf("  heavy drag: status %d after %.0f min, lowest altitude while OK %.1f km\n", status, t - 1, lowest);
+   check(status != ORBIT_OK, "decaying orbit ends in an error");
+   check(lowest > 0, "no position below the surface is reported as OK");
+
+   Ephemeris ephemeris;
+   check(ephemeris.build(propagator, t) != ORBIT_OK && !ephemeris.contains(t), "ephemeris refuses a decayed orbit");
+}
+
+template <typename F> static double nsPerCall(F f, int calls) {
+   auto start = std::chrono::steady_clock::now();
+   f(calls);
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 / calls;
+}
+
+static void throughput() {
+   printf("\nthroughput (host)\n");
+   volatile double sink = 0;
+   const int calls = 2000000;
+   for (const VerificationCase& test : cases) {
+     OrbitPropagator propagator;
+     if (!load(test, propagator)) continue;
+     double period = propagator.periodMinutes();
+     double ns = nsPerCall([&](int n) {
+       double r[3], v[3];
+       for (int i = 0; i < n; i++) {
+         propagator.propagate(period * (i % 1000) / 1000.0, r, v);
+         sink = sink + r[0];
+       }
+     }, calls);
+     printf("  %-20s %7.0f ns per propagation, %5.2f M/s\n", test.name, ns, 1.0e3 / ns);
+   }
+
+   // Mode 5 at 30 fps and x300: one table per orbit of ~100 min (18 s on
+   // screen) instead of one propagation per frame
+   OrbitPropagator propagator;
+   load(cases[1], propagator);
+   Ephemeris ephemeris;
+   double build = nsPerCall([&](int n) {
+     for (int i = 0; i < n; i++) ephemeris.build(propagator, i % 64);
+   }, calls / 100);
+   EphemerisPoint point;
+   double lookup = nsPerCall([&](int n) {
+     for (int i = 0; i < n; i++) {
+       ephemeris.sample(63 + propagator.periodMinutes() * (i % 1000) / 1000.0, point);
+       sink = sink + point.altitude;
+     }
+   }, calls);
+   printf("  ephemeris build %.1f us (%d propagations), sample %.1f ns\n", build / 1000, EPHEMERIS_SIZE + 1, lookup);
+}
+
+int main(int argc, char** argv) {
+   for (int i = 1; i < argc; i++) {
+     if (!strcmp(argv[i], "--verbose")) verbose = true;
+     else {
+       fprintf(stderr, "usage: sgp4_bench [--verbose]\n");
+       return 2;
+     }
+   }
+
+   verification();
+   errors();
+   throughput();
+
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
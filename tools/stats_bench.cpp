@@ -0,0 +1,171 @@
+// Benchmark and accuracy check for the windowed channel statistics
+//
+// Feeds the firmware's WindowStats (src/window_stats.cpp, compiled in as is)
+// with synthetic channel data and compares it with a two-pass reference in
+// double precision (mean first, then the sum of squared deviations):
+//
+//   g++ -O2 -std=c++17 -Isrc -o stats_bench tools/stats_bench.cpp src/window_stats.cpp
+//   stats_bench [--seed n] [--samples n]
+//
+// The float sum / sum-of-squares form is run alongside to show what the
+// streaming update avoids. Window lengths cover one BME280 second (8), a
+// 10 s touch window (500) and a long outage of touch samples (--samples).
+// Errors are relative to the reference standard deviation, the scale that
+// matters for a noise figure; min, max and count must match exactly.
+//
+// Update cost is measured on the host, so it only ranks the methods; both
+// are a handful of float operations per sample on the ESP32-S3 too.
+
+#include "window_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct Channel {
+   const char* name;
+   double offset;
+   double noise;
+   double quantum;              // Sensor resolution, 0 for continuous
+};
+
+// Offsets and noise as seen on the bench; the offset to noise ratio is what
+// hurts the sum-of-squares form
+static const Channel channels[] = {
+   { "pressure",    1013.25, 0.012,  0 },
+   { "temperature", 23.5,    0.02,   0 },
+   { "humidity",    41.0,    0.15,   0 },
+   { "battery",     3.92,    0.004,  3.3 / 4095 * 1.7 },
+   { "touch",       48000,   150,    1 },
+};
+
+struct Reference {
+   uint32_t count;
+   double min, max, mean, stddev;
+};
+
+static Reference twoPass(const std::vector<float>& values) {
+   Reference r = { (uint32_t)values.size(), values[0], values[0], 0, 0 };
+   double sum = 0;
+   for (float v : values) {
+     sum += v;
+     r.min = std::min<double>(r.min, v);
+     r.max = std::max<double>(r.max, v);
+   }
+   r.mean = sum / values.size();
+   double squares = 0;
+   for (float v : values) squares += (v - r.mean) * (v - r.mean);
+   r.stddev = values.size() > 1 ? sqrt(squares / (values.size() - 1)) : 0;
+   return r;
+}
+
+// Textbook single pass in float, what a naive port would do
+struct NaiveStats {
+   uint32_t n = 0;
+   float sum = 0, squares = 0;
+   void add(float v) { n++; sum += v; squares += v * v; }
+   float mean() const { return sum / n; }
+   float stddev() const {
+     float variance = (squares - sum * sum / n) / (n - 1);
+     return variance > 0 ? sqrtf(variance) : 0;    // Cancellation can leave it negative
+   }
+};
+
+static std::vector<float> generate(const Channel& channel, size_t count, std::mt19937& random) {
+   std::normal_distribution<double> noise(0, channel.noise);
+   std::vector<float> values(count);
+   for (size_t i = 0; i < count; i++) {
+     double v = channel.offset + noise(random);
+     if (channel.quantum > 0) v = round(v / channel.quantum) * channel.quantum;
+     values[i] = (float)v;
+   }
+   return values;
+}
+
+static double relative(double error, const Reference& ref) {
+   return ref.stddev > 0 ? fabs(error) / ref.stddev : 0;
+}
+
+template <typename Add>
+static double nsPerSample(const std::vector<float>& values, int repeats, Add add) {
+   auto start = std::chrono::steady_clock::now();
+   for (int r = 0; r < repeats; r++) {
+     for (float v : values) add(v);
+   }
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   return seconds * 1e9 / ((double)values.size() * repeats);
+}
+
+int main(int argc, char** argv) {
+   uint32_t seed = 1;
+   size_t longWindow = 100000;
+   for (int i = 1; i < argc; i++) {
+     if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--samples") && i + 1 < argc) longWindow = strtoul(argv[++i], nullptr, 10);
+     else {
+       fprintf(stderr, "usage: stats_bench [--seed n] [--samples n]\n");
+       return 2;
+     }
+   }
+   if (longWindow < 2) longWindow = 2;
+
+   std::mt19937 random(seed);
+   const size_t windows[] = { 8, 500, longWindow };
+   bool exact = true;
+   double worstWelford = 0;
+
+   printf("accuracy vs two-pass double, error in units of the reference stddev\n");
+   printf("%-12s %7s %12s %10s %12s %12s %12s %12s\n", "channel", "n", "ref mean", "ref sd",
+          "welford mean", "welford sd", "naive mean", "naive sd");
+   for (const Channel& channel : channels) {
+     for (size_t window : windows) {
+       std::vector<float> values = generate(channel, window, random);
+       Reference ref = twoPass(values);
+       WindowStats stats;
+       NaiveStats naive;
+       for (float v : values) {
+         stats.add(v);
+         naive.add(v);
+       }
+       StatsSummary s = stats.take();
+       if (s.count != ref.count || s.min != (float)ref.min || s.max != (float)ref.max) exact = false;
+
+       double welfordMean = relative(s.mean - ref.mean, ref);
+       double welfordSd = relative(s.stddev - ref.stddev, ref);
+       worstWelford = std::max(worstWelford, std::max(welfordMean, welfordSd));
+       printf("%-12s %7zu %12.4f %10.5f %12.2e %12.2e %12.2e %12.2e\n", channel.name, window, ref.mean,
+              ref.stddev, welfordMean, welfordSd, relative(naive.mean() - ref.mean, ref),
+              relative(naive.stddev() - ref.stddev, ref));
+     }
+   }
+
+   // An empty window and a NaN (missing BME280) must not disturb the summary
+   WindowStats edge;
+   StatsSummary empty = edge.summary();
+   edge.add(NAN);
+   edge.add(5);
+   StatsSummary single = edge.summary();
+   bool edges = empty.count == 0 && single.count == 1 && single.mean == 5 && single.stddev == 0;
+
+   printf("\nmin/max/count exact: %s, edge cases: %s, worst welford error: %.2e sd\n",
+          exact ? "yes" : "NO", edges ? "ok" : "FAILED", worstWelford);
+
+   // Update cost: the touch channel, the one sampled fastest
+   std::vector<float> values = generate(channels[4], 4096, random);
+   const int repeats = 5000;
+   WindowStats stats;
+   NaiveStats naive;
+   double welfordNs = nsPerSample(values, repeats, [&](float v) { stats.add(v); });
+   double naiveNs = nsPerSample(values, repeats, [&](float v) { naive.add(v); });
+   // Keep the results alive so the loops are not optimised away
+   volatile float sink = stats.summary().mean + naive.mean();
+   (void)sink;
+   printf("update cost (host): welford %.2f ns/sample, sum of squares %.2f ns/sample\n", welfordNs, naiveNs);
+
+   return exact && edges && worstWelford < 1e-2 ? 0 : 1;
+}
@@ -0,0 +1,495 @@
+// Ground decoder, schema export and benchmark for the telemetry schema
+//
+// Everything telemetry carries is declared once in src/telemetry_schema.h;
+// this tool is built from the same header, so it decodes exactly what the
+// firmware encodes and refuses packets from firmware with another schema.
+//
+//   g++ -O2 -std=c++17 -Isrc -o telemetry_codec tools/telemetry_codec.cpp src/telemetry_schema.cpp
+//   telemetry_codec schema                       # field list as JSON, for analysis scripts
+//   telemetry_codec decode <capture>             # binary packets to JSON lines
+//   telemetry_codec bench [--packets n] [--seed n]
+//
+// schema prints every field with its dotted name (as tools/telemetry_store.cpp
+// flattens them), type, unit, decimals and packets, plus the schema hash.
+//
+// decode reads a capture of boards sending with telemetry_format=1
+//
+//   mosquitto_sub -h <broker> -t 'cadse/+/+/tm/bin' -F '%t %x' > tm.log
+//
+// and writes "<topic> <json>" lines, the same JSON the board would have sent
+// with telemetry_format=0 (pipe into telemetry_store ingest). Packets with
+// another schema hash, a bad version or a bad length are reported on stderr
+// and skipped.
+//
+// bench fills random records and checks that pack, unpack and JSON give the
+// same text as encoding the record directly, that the JSON matches the old
+// hand-written string concatenation (std::string standing in for Arduino's
+// String) to the last printed digit, and that a foreign hash or a short
+// packet is refused. It then reports bytes per packet and the time per
+// packet of each encoder. Host timing only ranks them; the ESP32-S3 pays
+// more for every heap allocation the string building makes.
+
+#include "telemetry_schema.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+static const char* typeName(TelemetryType type) {
+   static const char* const names[] = { "bool", "u32", "i32", "i64", "fixed", "stats", "string", "json",
+                                        "object", "end" };
+   return names[type];
+}
+
+// ---------------------------------------------------------------------------
+// schema
+
+static int schema() {
+   printf("{\"hash\":\"%08x\",\"version\":%d,\"fields\":[", TELEMETRY_SCHEMA_HASH, TELEMETRY_BINARY_VERSION);
+   std::string group;
+   bool first = true;
+   for (const TelemetryEntry& entry : telemetryEntries) {
+     if (entry.type == TM_OBJECT) {
+       group = std::string(entry.key) + ".";
+       continue;
+     }
+     if (entry.type == TM_END) {
+       group.clear();
+       continue;
+     }
+     printf("%s\n {\"name\":\"%s%s\",\"type\":\"%s\",\"unit\":\"%s\",\"decimals\":%u,\"packets\":[%s%s%s]}",
+            first ? "" : ",", group.c_str(), entry.key, typeName(entry.type), entry.unit, entry.decimals,
+            entry.packets & TM_FULL ? "\"full\"" : "", entry.packets == TM_BOTH ? "," : "",
+            entry.packets & TM_HK ? "\"hk\"" : "");
+     first = false;
+   }
+   printf("\n]}\n");
+   return 0;
+}
+
+// ---------------------------------------------------------------------------
+// decode: binary capture to JSON lines
+
+static bool parseHex(const char* hex, std::vector<uint8_t>& out) {
+   size_t length = strlen(hex);
+   if (length % 2) return false;
+   out.clear();
+   for (size_t i = 0; i < length; i += 2) {
+     char byte[3] = { hex[i], hex[i + 1], 0 };
+     char* end;
+     out.push_back((uint8_t)strtoul(byte, &end, 16));
+     if (*end) return false;
+   }
+   return true;
+}
+
+static int decode(int argc, char** argv) {
+   if (argc != 3) {
+     fprintf(stderr, "usage: telemetry_codec decode <capture>\n");
+     return 2;
+   }
+   const char* path = argv[2];
+   FILE* file = fopen(path, "r");
+   if (!file) {
+     perror(path);
+     return 1;
+   }
+   static const char* const results[] = { "ok", "truncated", "bad version", "schema mismatch" };
+   unsigned counts[4] = {};
+   std::vector<uint8_t> message;
+   std::vector<char> text;
+   static char json[TELEMETRY_JSON_MAX * 2];
+   static char line[TELEMETRY_BINARY_MAX * 4];
+   int number = 0;
+   while (fgets(line, sizeof(line), file)) {
+     number++;
+     char topic[256];
+     static char hex[sizeof(line)];
+     if (sscanf(line, "%255s %s", topic, hex) != 2) continue;
+     if (!parseHex(hex, message)) {
+       fprintf(stderr, "%s:%d: payload is not hex (use -F '%%t %%x')\n", path, number);
+       return 1;
+     }
+     TelemetryRecord record;
+     uint8_t packet;
+     text.resize(message.size() + 1);
+     TelemetryDecodeResult result = telemetryUnpack(message.data(), message.size(), record, packet, text.data(),
+                                                    text.size());
+     counts[result]++;
+     if (result == TELEMETRY_SCHEMA_MISMATCH) {
+       fprintf(stderr, "%s:%d: %s: schema %08x, this decoder has %08x\n", path, number, topic,
+               telemetryPacketHash(message.data(), message.size()), TELEMETRY_SCHEMA_HASH);
+       continue;
+     }
+     if (result != TELEMETRY_DECODED) {
+       fprintf(stderr, "%s:%d: %s: %s (%zu bytes)\n", path, number, topic, results[result], message.size());
+       continue;
+     }
+     // Same topic as the JSON packets, so the store files both alike
+     std::string jsonTopic = topic;
+     if (jsonTopic.size() > 4 && jsonTopic.compare(jsonTopic.size() - 4, 4, "/bin") == 0) {
+       jsonTopic.resize(jsonTopic.size() - 4);
+     }
+     if (telemetryJson(record, packet, json, sizeof(json))) printf("%s %s\n", jsonTopic.c_str(), json);
+   }
+   fclose(file);
+   fprintf(stderr, "%u decoded, %u schema mismatch, %u bad version, %u truncated\n", counts[TELEMETRY_DECODED],
+           counts[TELEMETRY_SCHEMA_MISMATCH], counts[TELEMETRY_BAD_VERSION], counts[TELEMETRY_TRUNCATED]);
+   return 0;
+}
+
+// ---------------------------------------------------------------------------
+// bench
+
+// Variable-shape sections, about the size the firmware sends
+static const char* const memJson =
+   "{\"heap_free\":201344,\"heap_min\":187220,\"largest_block\":110580,\"frag_pct\":45.1,"
+   "\"psram_free\":0,\"stacks\":{\"loopTask\":5120,\"log\":1880,\"init\":2300},"
+   "\"allocs\":{\"telemetry\":41,\"mqtt\":3,\"display\":0,\"log\":0,\"other\":12}}";
+static const char* const bootJson =
+   "{\"fast\":true,\"reset\":\"power-on\",\"phases_us\":{\"serial\":1200,\"params\":8800,\"display\":41000,"
+   "\"wifi\":1804000,\"mqtt\":2410000}}";
+static const char* const mirrorJson = "{\"frames\":120,\"unchanged\":480,\"bytes\":7321,\"last_bytes\":58}";
+static const char* const i2cJson =
+   "{\"display\":{\"bytes\":1048576,\"busy_us\":9123456,\"max_wait_us\":812},"
+   "\"bme280\":{\"bytes\":41234,\"busy_us\":381234,\"max_wait_us\":2304}}";
+
+struct Sample {
+   TelemetryRecord record;
+   char deviceId[24];
+   char ipAddress[16];
+};
+
+static StatsSummary randomStats(std::mt19937& random, float center, float spread, bool present) {
+   StatsSummary s = {};
+   if (!present) return s;
+   std::uniform_real_distribution<float> u(-1, 1);
+   s.count = 1 + random() % 600;
+   s.mean = center + spread * u(random);
+   s.min = s.mean - spread * fabsf(u(random));
+   s.max = s.mean + spread * fabsf(u(random));
+   s.stddev = spread * 0.3f * fabsf(u(random));
+   return s;
+}
+
+static void randomRecord(std::mt19937& random, Sample& sample) {
+   std::uniform_real_distribution<float> u(-1, 1);
+   TelemetryRecord& r = sample.record;
+   r = TelemetryRecord();
+   snprintf(sample.deviceId, sizeof(sample.deviceId), "%012llx", (unsigned long long)random() * 65537);
+   snprintf(sample.ipAddress, sizeof(sample.ipAddress), "192.168.1.%u", (unsigned)(random() % 250 + 2));
+   bool bme = random() % 8 != 0;
+   r.deviceId = sample.deviceId;
+   r.boardId = sample.deviceId + 6;
+   r.hk = true;
+   r.uptime = random() % 1000000;
+   r.tsUs = random() % 16 ? 1760860000000000LL + (int64_t)random() * 1000 : 0;
+   r.monoUs = (int64_t)r.uptime * 1000000 + random() % 1000000;
+   r.freeHeap = 150000 + random() % 60000;
+   r.mode = random() % 6;
+   r.defaultMode = random() % 6;
+   r.paramWrites = random() % 40;
+   r.logDropped = random() % 3;
+   r.periodMs = 1000 + random() % 9000;
+   r.linkFailures = random() % 20;
+   r.mem = memJson;
+   r.boot = random() % 50 ? nullptr : bootJson;
+   r.batteryVoltage = randomStats(random, 3.7f, 0.3f, true);
+   r.usbVoltage = randomStats(random, 4.9f, 0.2f, true);
+   r.lowBattery = random() % 10 == 0;
+   r.alerts = random() % 4 ? 0 : random() % 64;
+   r.displayFrames = random() % 100000;
+   r.displayDropped = random() % 100;
+   r.displayTransferUs = 2000 + random() % 30000;
+   r.mirror = random() % 4 ? nullptr : mirrorJson;
+   r.pacingTargetMs = 50 + random() % 950;
+   r.pacingFrames = random() % 100000;
+   r.pacingLate = random() % 100;
+   r.pacingDropped = random() % 50;
+   r.pacingStepMs = 20;
+   r.pacingSteps = random() % 500000;
+   r.pacingSimDroppedMs = random() % 1000;
+   r.powerOn = random() % 32;
+   r.powerBusyPct = 100 * fabsf(u(random));
+   r.touchRight = randomStats(random, 40000, 15000, true);
+   r.touchLeft = randomStats(random, 40000, 15000, true);
+   r.touchUp = randomStats(random, 40000, 15000, true);
+   r.touchDown = randomStats(random, 40000, 15000, true);
+   r.touchX = randomStats(random, 40000, 15000, true);
+   r.accelX = (98 + random() % 4) / 10.0f;
+   r.accelY = ((int)(random() % 10) - 5) / 10.0f;
+   r.accelZ = ((int)(random() % 10) - 5) / 10.0f;
+   r.gyroX = ((int)(random() % 40) - 20) / 10.0f;
+   r.gyroY = ((int)(random() % 40) - 20) / 10.0f;
+   r.gyroZ = ((int)(random() % 40) - 20) / 10.0f;
+   r.temperature = randomStats(random, 22, 5, bme);
+   r.pressure = randomStats(random, 990, 30, bme);
+   r.humidity = randomStats(random, 45, 20, bme);
+   r.altitude = bme ? 200 + 300 * u(random) : NAN;
+   r.verticalSpeed = bme ? u(random) : NAN;
+   r.qnh = 1013.25f;
+   r.i2c = i2cJson;
+   r.wifiStrength = -40 - (int)(random() % 50);
+   r.ipAddress = sample.ipAddress;
+}
+
+// Arduino String stand-ins: String(float, d) is dtostrf(), i.e. "%.*f"
+static std::string str(double value, int decimals) {
+   char buffer[32];
+   snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+   return buffer;
+}
+
+static std::string str(unsigned long value) {
+   return std::to_string(value);
+}
+
+static std::string statsJson(const StatsSummary& stats, int decimals) {
+   if (stats.count == 0) return "null";
+   std::string json = "{";
+   json += "\"n\":" + str(stats.count) + ",";
+   json += "\"min\":" + str(stats.min, decimals) + ",";
+   json += "\"max\":" + str(stats.max, decimals) + ",";
+   json += "\"mean\":" + str(stats.mean, decimals) + ",";
+   json += "\"sd\":" + str(stats.stddev, decimals + 1);
+   json += "}";
+   return json;
+}
+
+// createJSONTelemetry() before the schema, fed from the same record
+static std::string handWritten(const TelemetryRecord& r) {
+   char schema[16];
+   snprintf(schema, sizeof(schema), "%08x", TELEMETRY_SCHEMA_HASH);
+   std::string json = "{";
+   json += "\"schema\":\"" + std::string(schema) + "\",";
+   json += "\"device_id\":\"" + std::string(r.deviceId) + "\",";
+   json += "\"board_id\":\"" + std::string(r.boardId) + "\",";
+   json += "\"uptime\":" + str(r.uptime) + ",";
+   json += "\"ts_us\":" + std::to_string(r.tsUs) + ",";
+   json += "\"mono_us\":" + std::to_string(r.monoUs) + ",";
+   json += "\"free_heap\":" + str(r.freeHeap) + ",";
+   json += "\"mode\":" + str(r.mode) + ",";
+   json += "\"default_mode\":" + str(r.defaultMode) + ",";
+   json += "\"param_writes\":" + str(r.paramWrites) + ",";
+   json += "\"log_dropped\":" + str(r.logDropped) + ",";
+   json += "\"period_ms\":" + str(r.periodMs) + ",";
+   json += "\"link_failures\":" + str(r.linkFailures) + ",";
+   json += "\"mem\":" + std::string(r.mem) + ",";
+   if (r.boot) json += "\"boot\":" + std::string(r.boot) + ",";
+   json += "\"battery_voltage\":" + statsJson(r.batteryVoltage, 2) + ",";
+   json += "\"usb_voltage\":" + statsJson(r.usbVoltage, 2) + ",";
+   json += "\"low_battery\":" + std::string(r.lowBattery ? "true" : "false") + ",";
+   json += "\"alerts\":" + str(r.alerts) + ",";
+   json += "\"display_frames\":" + str(r.displayFrames) + ",";
+   json += "\"display_dropped\":" + str(r.displayDropped) + ",";
+   json += "\"display_transfer_us\":" + str(r.displayTransferUs) + ",";
+   if (r.mirror) json += "\"mirror\":" + std::string(r.mirror) + ",";
+   json += "\"pacing\":{";
+   json += "\"target_ms\":" + str(r.pacingTargetMs) + ",";
+   json += "\"frames\":" + str(r.pacingFrames) + ",";
+   json += "\"late\":" + str(r.pacingLate) + ",";
+   json += "\"dropped\":" + str(r.pacingDropped) + ",";
+   json += "\"step_ms\":" + str(r.pacingStepMs) + ",";
+   json += "\"steps\":" + str(r.pacingSteps) + ",";
+   json += "\"sim_dropped_ms\":" + str(r.pacingSimDroppedMs);
+   json += "},";
+   json += "\"power\":{";
+   json += "\"on\":" + str(r.powerOn) + ",";
+   json += "\"busy_pct\":" + str(r.powerBusyPct, 2);
+   json += "},";
+   json += "\"touch_right\":" + statsJson(r.touchRight, 0) + ",";
+   json += "\"touch_left\":" + statsJson(r.touchLeft, 0) + ",";
+   json += "\"touch_up\":" + statsJson(r.touchUp, 0) + ",";
+   json += "\"touch_down\":" + statsJson(r.touchDown, 0) + ",";
+   json += "\"touch_x\":" + statsJson(r.touchX, 0) + ",";
+   json += "\"acceleration\":{";
+   json += "\"x\":" + str(r.accelX, 1) + ",";
+   json += "\"y\":" + str(r.accelY, 1) + ",";
+   json += "\"z\":" + str(r.accelZ, 1);
+   json += "},";
+   json += "\"gyro\":{";
+   json += "\"x\":" + str(r.gyroX, 1) + ",";
+   json += "\"y\":" + str(r.gyroY, 1) + ",";
+   json += "\"z\":" + str(r.gyroZ, 1);
+   json += "},";
+   json += "\"temperature\":" + statsJson(r.temperature, 2) + ",";
+   json += "\"pressure\":" + statsJson(r.pressure, 2) + ",";
+   json += "\"humidity\":" + statsJson(r.humidity, 1) + ",";
+   if (!std::isnan(r.altitude)) {
+     json += "\"altitude\":" + str(r.altitude, 1) + ",";
+     json += "\"vertical_speed\":" + str(r.verticalSpeed, 2) + ",";
+   } else {
+     json += "\"altitude\":null,";
+     json += "\"vertical_speed\":null,";
+   }
+   json += "\"qnh\":" + str(r.qnh, 2) + ",";
+   json += "\"i2c\":" + std::string(r.i2c) + ",";
+   json += "\"wifi_strength\":" + std::to_string(r.wifiStrength) + ",";
+   json += "\"ip_address\":\"" + std::string(r.ipAddress) + "\"";
+   json += "}";
+   return json;
+}
+
+// Same text, except numbers may differ by one in their last printed digit:
+// printf rounds the exact binary value, the encoder value * 10^decimals
+static bool sameJson(const char* a, const char* b, int& lastDigit) {
+   while (*a && *b) {
+     bool number = (*a == '-' || (*a >= '0' && *a <= '9')) && (*b == '-' || (*b >= '0' && *b <= '9'));
+     if (!number) {
+       if (*a++ != *b++) return false;
+       continue;
+     }
+     char* endA;
+     char* endB;
+     double x = strtod(a, &endA);
+     double y = strtod(b, &endB);
+     if (endA == a || endB == b) {
+       if (*a++ != *b++) return false;
+       continue;
+     }
+     const char* point = (const char*)memchr(a, '.', endA - a);
+     double unit = point ? pow(10.0, -(endA - point - 1)) : 1.0;
+     if (x != y) {
+       if (fabs(x - y) > unit * 1.01) return false;
+       lastDigit++;
+     }
+     a = endA;
+     b = endB;
+   }
+   return *a == *b;
+}
+
+template <typename F> static double nsPerPacket(int packets, F f) {
+   auto start = std::chrono::steady_clock::now();
+   f();
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 / packets;
+}
+
+static int bench(int argc, char** argv) {
+   int packets = 20000;
+   unsigned seed = 1;
+   for (int i = 2; i < argc; i++) {
+     if (!strcmp(argv[i], "--packets") && i + 1 < argc) packets = atoi(argv[++i]);
+     else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = atoi(argv[++i]);
+     else {
+       fprintf(stderr, "usage: telemetry_codec bench [--packets n] [--seed n]\n");
+       return 2;
+     }
+   }
+
+   std::mt19937 random(seed);
+   std::vector<Sample> samples(256);
+   for (Sample& sample : samples) randomRecord(random, sample);
+
+   static char json[TELEMETRY_JSON_MAX];
+   static char decodedJson[TELEMETRY_JSON_MAX];
+   static uint8_t binary[TELEMETRY_BINARY_MAX];
+   static char text[TELEMETRY_BINARY_MAX];
+   int failures = 0, lastDigit = 0;
+   size_t bytes[2][2] = {};     // [full, hk][json, binary]
+   for (const Sample& sample : samples) {
+     for (int k = 0; k < 2; k++) {
+       uint8_t packet = k == 0 ? TM_FULL : TM_HK;
+       size_t jsonLength = telemetryJson(sample.record, packet, json, sizeof(json));
+       size_t binaryLength = telemetryPack(sample.record, packet, binary, sizeof(binary));
+       bytes[k][0] += jsonLength;
+       bytes[k][1] += binaryLength;
+       TelemetryRecord decoded;
+       uint8_t decodedPacket;
+       bool ok = jsonLength && binaryLength &&
+                 telemetryUnpack(binary, binaryLength, decoded, decodedPacket, text, sizeof(text)) == TELEMETRY_DECODED &&
+                 decodedPacket == packet && telemetryJson(decoded, packet, decodedJson, sizeof(decodedJson)) &&
+                 !strcmp(json, decodedJson);
+       if (!ok) {
+         if (!failures) printf("FAIL: binary round trip\n  %s\n  %s\n", json, decodedJson);
+         failures++;
+       }
+       if (packet == TM_FULL && !sameJson(handWritten(sample.record).c_str(), json, lastDigit)) {
+         if (!failures) printf("FAIL: differs from the hand-written packet\n  %s\n  %s\n",
+                               handWritten(sample.record).c_str(), json);
+         failures++;
+       }
+     }
+   }
+
+   // Mismatches a receiver must refuse
+   TelemetryRecord decoded;
+   uint8_t packet;
+   size_t length = telemetryPack(samples[0].record, TM_FULL, binary, sizeof(binary));
+   binary[3] ^= 1;
+   bool refused = telemetryUnpack(binary, length, decoded, packet, text, sizeof(text)) == TELEMETRY_SCHEMA_MISMATCH;
+   binary[3] ^= 1;
+   refused &= telemetryUnpack(binary, length - 1, decoded, packet, text, sizeof(text)) == TELEMETRY_TRUNCATED;
+   binary[0]++;
+   refused &= telemetryUnpack(binary, length, decoded, packet, text, sizeof(text)) == TELEMETRY_BAD_VERSION;
+   if (!refused) {
+     printf("FAIL: foreign, short or bad version packet accepted\n");
+     failures++;
+   }
+   char tiny[64];
+   if (telemetryJson(samples[0].record, TM_FULL, tiny, sizeof(tiny)) != 0) {
+     printf("FAIL: JSON overflow not reported\n");
+     failures++;
+   }
+
+   printf("schema %08x, %d entries\n", TELEMETRY_SCHEMA_HASH, TELEMETRY_ENTRY_COUNT);
+   printf("%zu records: binary round trip and hand-written comparison %s (%d numbers differ in the last digit)\n",
+          samples.size(), failures ? "FAILED" : "ok", lastDigit);
+   printf("\n%-14s %10s %10s\n", "bytes/packet", "json", "binary");
+   printf("%-14s %10.1f %10.1f\n", "full", (double)bytes[0][0] / samples.size(), (double)bytes[0][1] / samples.size());
+   printf("%-14s %10.1f %10.1f\n", "housekeeping", (double)bytes[1][0] / samples.size(),
+          (double)bytes[1][1] / samples.size());
+
+   volatile size_t sink = 0;
+   double hand = nsPerPacket(packets, [&] {
+     for (int i = 0; i < packets; i++) sink = sink + handWritten(samples[i & 255].record).size();
+   });
+   double generated = nsPerPacket(packets, [&] {
+     for (int i = 0; i < packets; i++) sink = sink + telemetryJson(samples[i & 255].record, TM_FULL, json, sizeof(json));
+   });
+   double pack = nsPerPacket(packets, [&] {
+     for (int i = 0; i < packets; i++) sink = sink + telemetryPack(samples[i & 255].record, TM_FULL, binary, sizeof(binary));
+   });
+   std::vector<std::vector<uint8_t>> packed(256);
+   for (int i = 0; i < 256; i++) {
+     size_t n = telemetryPack(samples[i].record, TM_FULL, binary, sizeof(binary));
+     packed[i].assign(binary, binary + n);
+   }
+   double unpack = nsPerPacket(packets, [&] {
+     for (int i = 0; i < packets; i++) {
+       const std::vector<uint8_t>& message = packed[i & 255];
+       sink = sink + telemetryUnpack(message.data(), message.size(), decoded, packet, text, sizeof(text));
+     }
+   });
+   printf("\n%-30s %10s\n", "full packet (host)", "ns/packet");
+   printf("%-30s %10.0f\n", "hand-written string building", hand);
+   printf("%-30s %10.0f  (%.1fx)\n", "generated JSON", generated, hand / generated);
+   printf("%-30s %10.0f\n", "generated binary pack", pack);
+   printf("%-30s %10.0f\n", "generated binary unpack", unpack);
+
+   if (generated > hand) {
+     printf("FAIL: generated JSON slower than the hand-written packet\n");
+     failures++;
+   }
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
+
+int main(int argc, char** argv) {
+   if (argc >= 2 && !strcmp(argv[1], "schema")) return schema();
+   if (argc >= 2 && !strcmp(argv[1], "decode")) return decode(argc, argv);
+   if (argc >= 2 && !strcmp(argv[1], "bench")) return bench(argc, argv);
+   fprintf(stderr, "usage: telemetry_codec schema\n"
+                   "       telemetry_codec decode <capture>\n"
+                   "       telemetry_codec bench [--packets n] [--seed n]\n");
+   return 2;
+}
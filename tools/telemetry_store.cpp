@@ -0,0 +1,1239 @@
+// Ground-side telemetry store
+//
+// Appends the JSON telemetry published on cadse/<year>/<board>/tm to a
+// compressed columnar file and answers range queries by device and time.
+//
+//   g++ -O2 -std=c++17 -Isrc -o telemetry_store tools/telemetry_store.cpp src/telemetry_schema.cpp
+//
+//   mosquitto_sub -h <broker> -p 8883 -u <user> -P <pass> -t 'cadse/+/+/tm' -F '%U %t %p' |
+//       telemetry_store ingest fleet.cts
+//   telemetry_store ingest fleet.cts capture.txt      # captured stream, same line format
+//   telemetry_store query fleet.cts --device 01234 --from 1760860000 --to 1760863600
+//       --fields uptime,pressure.mean,pressure.sd,i2c.bme280.bytes
+//   telemetry_store info fleet.cts
+//   telemetry_store bench [messages] [devices]        # synthetic ingest + query benchmark and check
+//
+// Input lines are "[<unix time>] [<topic>] <json>"; mosquitto_sub -F '%U %t %p'
+// produces exactly that. Rows are stamped with the line's unix time, else the
+// packet's "ts" field (ms), else the time of ingest. The device is the
+// packet's device_id, else the board segment of the topic.
+//
+// Parsing is a single forward scan per message: strings are skipped with
+// memchr, numbers are read as exact decimal mantissa/scale pairs without any
+// floating point, and nested objects are flattened to dotted names
+// ("acceleration.x"). Field order is stable between packets, so columns are
+// resolved by position first and only fall back to a hash lookup on change.
+//
+// File layout (little endian, append-only):
+//   header  "CTMS", version u8
+//   chunk   "CHNK", body length u32, rows u32, min time i64, max time i64,
+//           device length u8, device, then the body:
+//           time column, column count varint, columns
+//   column  name (varint length, bytes), type u8, presence, values
+//
+// A chunk holds up to --chunk rows (default 8192) of one device. Chunk
+// headers are the time index: a query reads only the headers and seeks past
+// every chunk whose device or time range does not match. Numbers are stored
+// as decimal fixed point at the column's largest scale, delta coded and either
+// varint or run-length encoded, whichever is smaller; strings use a per-chunk
+// dictionary with run-length coded indexes. Nulls are absent in the presence
+// bitmap.
+
+#include "telemetry_schema.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#define STORE_MAGIC      "CTMS"
+#define STORE_VERSION    1
+#define CHUNK_MAGIC      "CHNK"
+#define CHUNK_ROWS       8192
+#define CHUNK_FIXED      21      // Header bytes after the length field, without the device
+#define MAX_SCALE        9       // Decimal places kept exactly
+#define MAX_LINE         16384
+
+enum ColumnType : uint8_t {
+   COL_NUMBER = 1,
+   COL_BOOL = 2,
+   COL_STRING = 3
+};
+
+enum Encoding : uint8_t {
+   ENC_DELTA = 0,      // zigzag varint per value
+   ENC_DELTA_RLE = 1   // (zigzag delta, run length) pairs
+};
+
+static const int64_t POW10[MAX_SCALE + 1] = {
+   1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+// ---- Byte coding ----
+
+static void putVarint(std::string& out, uint64_t value) {
+   while (value >= 0x80) {
+     out.push_back((char)(value | 0x80));
+     value >>= 7;
+   }
+   out.push_back((char)value);
+}
+
+static uint64_t zigzag(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+static int64_t unzigzag(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+template <typename T>
+static void putFixed(std::string& out, T value) {
+   out.append((const char*)&value, sizeof(value));
+}
+
+struct Reader {
+   const uint8_t* p;
+   const uint8_t* end;
+
+   bool ok() const { return p <= end; }
+   uint8_t byte() { return p < end ? *p++ : (p = end + 1, 0); }
+
+   uint64_t varint() {
+     uint64_t value = 0;
+     for (int shift = 0; shift < 64; shift += 7) {
+       uint8_t b = byte();
+       value |= (uint64_t)(b & 0x7F) << shift;
+       if (!(b & 0x80)) break;
+     }
+     return value;
+   }
+
+   std::string_view bytes(size_t length) {
+     if ((size_t)(end - p) < length) {
+       p = end + 1;
+       return std::string_view();
+     }
+     std::string_view view((const char*)p, length);
+     p += length;
+     return view;
+   }
+};
+
+// Delta code a column, picking plain varints or runs of equal deltas
+static void encodeIntegers(std::string& out, const std::vector<int64_t>& values) {
+   std::string plain, runs;
+   int64_t previous = 0;
+   uint64_t runDelta = 0, runLength = 0;
+   for (int64_t value : values) {
+     uint64_t delta = zigzag(value - previous);
+     previous = value;
+     putVarint(plain, delta);
+     if (runLength > 0 && delta == runDelta) {
+       runLength++;
+     } else {
+       if (runLength > 0) {
+         putVarint(runs, runDelta);
+         putVarint(runs, runLength);
+       }
+       runDelta = delta;
+       runLength = 1;
+     }
+   }
+   if (runLength > 0) {
+     putVarint(runs, runDelta);
+     putVarint(runs, runLength);
+   }
+
+   const std::string& best = runs.size() < plain.size() ? runs : plain;
+   out.push_back(runs.size() < plain.size() ? ENC_DELTA_RLE : ENC_DELTA);
+   putVarint(out, best.size());
+   out += best;
+}
+
+static bool decodeIntegers(Reader& in, size_t count, std::vector<int64_t>& values) {
+   uint8_t encoding = in.byte();
+   std::string_view data = in.bytes(in.varint());
+   Reader body = { (const uint8_t*)data.data(), (const uint8_t*)data.data() + data.size() };
+   values.clear();
+   values.reserve(count);
+   int64_t previous = 0;
+   while (values.size() < count && body.p < body.end) {
+     int64_t delta = unzigzag(body.varint());
+     uint64_t run = encoding == ENC_DELTA_RLE ? body.varint() : 1;
+     for (uint64_t i = 0; i < run && values.size() < count; i++) {
+       previous += delta;
+       values.push_back(previous);
+     }
+   }
+   return in.ok() && body.ok() && values.size() == count;
+}
+
+// ---- Chunk building ----
+
+struct ColumnBuilder {
+   std::string name;
+   ColumnType type;
+   uint8_t scale = 0;                   // Largest decimal scale seen
+   std::vector<uint64_t> present;       // One bit per row
+   std::vector<int64_t> values;         // Mantissas or dictionary indexes, present rows only
+   std::vector<uint8_t> scales;         // Per value, numbers only
+   std::unordered_map<std::string, int64_t> dictionary;
+   std::vector<std::string_view> words; // Dictionary order, views into the map keys
+
+   void mark(uint32_t row) {
+     if (present.size() <= row / 64) present.resize(row / 64 + 1, 0);
+     present[row / 64] |= 1ULL << (row % 64);
+   }
+};
+
+struct Value {
+   ColumnType type;
+   int64_t mantissa;
+   uint8_t scale;
+   std::string_view text;
+};
+
+struct ParsedField {
+   uint32_t nameOffset;
+   uint32_t nameLength;
+   Value value;
+};
+
+struct ChunkBuilder {
+   std::string device;
+   uint32_t rows = 0;
+   std::vector<int64_t> times;
+   std::vector<std::unique_ptr<ColumnBuilder>> columns;
+   std::unordered_map<std::string, int> index;
+   std::vector<int> lastOrder;          // Column of the n-th field in the previous packet
+   uint64_t typeConflicts = 0;
+
+   int column(size_t position, std::string_view name, ColumnType type) {
+     if (position < lastOrder.size()) {
+       int guess = lastOrder[position];
+       if (columns[guess]->name == name) return guess;
+     }
+     std::string key(name);
+     auto found = index.find(key);
+     int column;
+     if (found != index.end()) {
+       column = found->second;
+     } else {
+       column = (int)columns.size();
+       columns.emplace_back(new ColumnBuilder());
+       columns.back()->name = key;
+       columns.back()->type = type;
+       index.emplace(std::move(key), column);
+     }
+     if (position >= lastOrder.size()) lastOrder.resize(position + 1);
+     lastOrder[position] = column;
+     return column;
+   }
+
+   void add(int64_t time, const std::vector<ParsedField>& fields, const std::string& names) {
+     uint32_t row = rows++;
+     times.push_back(time);
+     for (size_t i = 0; i < fields.size(); i++) {
+       const ParsedField& field = fields[i];
+       std::string_view name(names.data() + field.nameOffset, field.nameLength);
+       ColumnBuilder& col = *columns[column(i, name, field.value.type)];
+       if (col.type != field.value.type) {
+         typeConflicts++;
+         continue;
+       }
+       col.mark(row);
+       if (col.type == COL_STRING) {
+         auto entry = col.dictionary.find(std::string(field.value.text));
+         if (entry == col.dictionary.end()) {
+           entry = col.dictionary.emplace(std::string(field.value.text), (int64_t)col.words.size()).first;
+           col.words.push_back(entry->first);
+         }
+         col.values.push_back(entry->second);
+       } else {
+         col.values.push_back(field.value.mantissa);
+         col.scales.push_back(field.value.scale);
+         if (field.value.scale > col.scale) col.scale = field.value.scale;
+       }
+     }
+   }
+
+   // Serialize and reset; returns the chunk bytes
+   std::string finish() {
+     std::string body;
+     encodeIntegers(body, times);
+     putVarint(body, columns.size());
+     for (auto& colPointer : columns) {
+       ColumnBuilder& col = *colPointer;
+       putVarint(body, col.name.size());
+       body += col.name;
+       body.push_back((char)col.type);
+
+       // Presence: 1 = every row, 0 = bitmap follows
+       col.present.resize((rows + 63) / 64, 0);
+       bool all = col.values.size() == rows;
+       body.push_back(all ? 1 : 0);
+       if (!all) body.append((const char*)col.present.data(), (rows + 7) / 8);
+
+       if (col.type == COL_STRING) {
+         putVarint(body, col.words.size());
+         for (std::string_view word : col.words) {
+           putVarint(body, word.size());
+           body.append(word.data(), word.size());
+         }
+       } else {
+         body.push_back((char)col.scale);
+         for (size_t i = 0; i < col.values.size(); i++) {
+           col.values[i] *= POW10[col.scale - col.scales[i]];
+         }
+       }
+       encodeIntegers(body, col.values);
+     }
+
+     int64_t minTime = INT64_MAX, maxTime = INT64_MIN;
+     for (int64_t t : times) {
+       if (t < minTime) minTime = t;
+       if (t > maxTime) maxTime = t;
+     }
+
+     std::string chunk = CHUNK_MAGIC;
+     putFixed<uint32_t>(chunk, (uint32_t)(CHUNK_FIXED + device.size() + body.size()));
+     putFixed<uint32_t>(chunk, rows);
+     putFixed<int64_t>(chunk, minTime);
+     putFixed<int64_t>(chunk, maxTime);
+     chunk.push_back((char)device.size());
+     chunk += device;
+     chunk += body;
+
+     rows = 0;
+     times.clear();
+     columns.clear();
+     index.clear();
+     lastOrder.clear();
+     return chunk;
+   }
+};
+
+// ---- JSON scanning ----
+
+class TelemetryParser {
+public:
+   std::vector<ParsedField> fields;
+   std::string names;                   // Flattened field names, referenced by offset
+
+   bool parse(const char* p, const char* end) {
+     fields.clear();
+     names.clear();
+     path.clear();
+     cursor = p;
+     limit = end;
+     skipSpace();
+     return object();
+   }
+
+private:
+   const char* cursor;
+   const char* limit;
+   std::string path;                    // "outer.inner." while inside nested objects
+
+   void skipSpace() {
+     while (cursor < limit && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n')) cursor++;
+   }
+
+   bool string(std::string_view& out) {
+     if (cursor >= limit || *cursor != '"') return false;
+     const char* start = ++cursor;
+     for (;;) {
+       const char* quote = (const char*)memchr(cursor, '"', limit - cursor);
+       if (!quote) return false;
+       // An escaped quote has an odd number of backslashes in front of it
+       const char* back = quote;
+       while (back > start && back[-1] == '\\') back--;
+       cursor = quote + 1;
+       if ((quote - back) % 2 == 0) {
+         out = std::string_view(start, quote - start);
+         return true;
+       }
+     }
+   }
+
+   bool number(Value& value) {
+     bool negative = false;
+     if (*cursor == '-') {
+       negative = true;
+       cursor++;
+     }
+     int64_t mantissa = 0;
+     int digits = 0, scale = 0;
+     bool fraction = false;
+     for (; cursor < limit; cursor++) {
+       char c = *cursor;
+       if (c >= '0' && c <= '9') {
+         if (++digits > 18) return false;
+         mantissa = mantissa * 10 + (c - '0');
+         if (fraction) scale++;
+       } else if (c == '.' && !fraction) {
+         fraction = true;
+       } else {
+         break;
+       }
+     }
+     if (digits == 0) return false;
+     if (cursor < limit && (*cursor == 'e' || *cursor == 'E')) {
+       cursor++;
+       bool negativeExp = false;
+       if (cursor < limit && (*cursor == '+' || *cursor == '-')) negativeExp = *cursor++ == '-';
+       int exponent = 0;
+       while (cursor < limit && *cursor >= '0' && *cursor <= '9') exponent = exponent * 10 + (*cursor++ - '0');
+       scale += negativeExp ? exponent : -exponent;
+     }
+     while (scale < 0) {
+       if (mantissa > INT64_MAX / 10) return false;
+       mantissa *= 10;
+       scale++;
+     }
+     while (scale > MAX_SCALE && mantissa % 10 == 0) {
+       mantissa /= 10;
+       scale--;
+     }
+     if (scale > MAX_SCALE) return false;
+     value.type = COL_NUMBER;
+     value.mantissa = negative ? -mantissa : mantissa;
+     value.scale = (uint8_t)scale;
+     return true;
+   }
+
+   bool literal(const char* word, size_t length) {
+     if ((size_t)(limit - cursor) < length || memcmp(cursor, word, length) != 0) return false;
+     cursor += length;
+     return true;
+   }
+
+   // Arrays are not part of the telemetry; skip them whole
+   bool skipArray() {
+     int depth = 0;
+     while (cursor < limit) {
+       char c = *cursor;
+       if (c == '"') {
+         std::string_view ignored;
+         if (!string(ignored)) return false;
+         continue;
+       }
+       cursor++;
+       if (c == '[') depth++;
+       if (c == ']' && --depth == 0) return true;
+     }
+     return false;
+   }
+
+   void addField(std::string_view key, const Value& value) {
+     ParsedField field;
+     field.nameOffset = (uint32_t)names.size();
+     names += path;
+     names.append(key.data(), key.size());
+     field.nameLength = (uint32_t)(names.size() - field.nameOffset);
+     field.value = value;
+     fields.push_back(field);
+   }
+
+   bool object() {
+     if (cursor >= limit || *cursor != '{') return false;
+     cursor++;
+     skipSpace();
+     if (cursor < limit && *cursor == '}') {
+       cursor++;
+       return true;
+     }
+     for (;;) {
+       std::string_view key;
+       skipSpace();
+       if (!string(key)) return false;
+       skipSpace();
+       if (cursor >= limit || *cursor++ != ':') return false;
+       skipSpace();
+       if (cursor >= limit) return false;
+
+       Value value;
+       char c = *cursor;
+       if (c == '"') {
+         if (!string(value.text)) return false;
+         value.type = COL_STRING;
+         addField(key, value);
+       } else if (c == '{') {
+         size_t saved = path.size();
+         path.append(key.data(), key.size());
+         path.push_back('.');
+         if (!object()) return false;
+         path.resize(saved);
+       } else if (c == '[') {
+         if (!skipArray()) return false;
+       } else if (c == 't' || c == 'f') {
+         bool truth = c == 't';
+         if (!literal(truth ? "true" : "false", truth ? 4 : 5)) return false;
+         value.type = COL_BOOL;
+         value.mantissa = truth;
+         value.scale = 0;
+         addField(key, value);
+       } else if (c == 'n') {
+         if (!literal("null", 4)) return false; // Nulls stay absent
+       } else {
+         if (!number(value)) return false;
+         addField(key, value);
+       }
+
+       skipSpace();
+       if (cursor >= limit) return false;
+       if (*cursor == ',') {
+         cursor++;
+         continue;
+       }
+       if (*cursor == '}') {
+         cursor++;
+         return true;
+       }
+       return false;
+     }
+   }
+};
+
+// ---- Store writer ----
+
+struct IngestStats {
+   uint64_t messages = 0;
+   uint64_t rejected = 0;
+   uint64_t inputBytes = 0;
+   uint64_t chunks = 0;
+   uint64_t typeConflicts = 0;
+};
+
+class StoreWriter {
+public:
+   bool open(const char* path, uint32_t rowsPerChunk) {
+     chunkRows = rowsPerChunk;
+     file = fopen(path, "ab");
+     if (!file) return false;
+     setvbuf(file, nullptr, _IOFBF, 1 << 20);
+     if (ftell(file) == 0) {
+       fwrite(STORE_MAGIC, 1, 4, file);
+       fputc(STORE_VERSION, file);
+     }
+     return true;
+   }
+
+   // One input line: "[<unix time>] [<topic>] <json>"
+   void line(const char* text, size_t length) {
+     const char* p = text;
+     const char* end = text + length;
+     while (end > p && (end[-1] == '\n' || end[-1] == '\r')) end--;
+     stats.inputBytes += length;
+
+     int64_t time = INT64_MIN;
+     std::string_view topic;
+     while (p < end && *p != '{') {
+       const char* space = (const char*)memchr(p, ' ', end - p);
+       if (!space) break;
+       std::string_view word(p, space - p);
+       if (time == INT64_MIN && !word.empty() && word[0] >= '0' && word[0] <= '9' && topic.empty()) {
+         time = parseUnixMillis(word);
+       } else {
+         topic = word;
+       }
+       p = space + 1;
+     }
+
+     if (!parser.parse(p, end)) {
+       stats.rejected++;
+       return;
+     }
+
+     std::string_view device;
+     for (const ParsedField& field : parser.fields) {
+       std::string_view name(parser.names.data() + field.nameOffset, field.nameLength);
+       if (name == "device_id" && field.value.type == COL_STRING) device = field.value.text;
+       if (name == "ts" && field.value.type == COL_NUMBER && time == INT64_MIN && field.value.scale == 0) {
+         time = field.value.mantissa;
+       }
+     }
+     if (device.empty()) device = boardFromTopic(topic);
+     if (time == INT64_MIN) {
+       time = std::chrono::duration_cast<std::chrono::milliseconds>(
+         std::chrono::system_clock::now().time_since_epoch()).count();
+     }
+
+     ChunkBuilder& builder = builderFor(device);
+     builder.add(time, parser.fields, parser.names);
+     stats.messages++;
+     if (builder.rows >= chunkRows) flush(builder);
+   }
+
+   void close() {
+     if (!file) return;
+     for (auto& entry : builders) {
+       if (entry.second->rows > 0) flush(*entry.second);
+     }
+     fclose(file);
+     file = nullptr;
+   }
+
+   const IngestStats& summary() const { return stats; }
+
+private:
+   FILE* file = nullptr;
+   uint32_t chunkRows = CHUNK_ROWS;
+   TelemetryParser parser;
+   std::map<std::string, std::unique_ptr<ChunkBuilder>, std::less<>> builders;
+   ChunkBuilder* lastBuilder = nullptr;
+   IngestStats stats;
+
+   static int64_t parseUnixMillis(std::string_view word) {
+     int64_t seconds = 0, millis = 0;
+     size_t i = 0;
+     for (; i < word.size() && word[i] >= '0' && word[i] <= '9'; i++) seconds = seconds * 10 + (word[i] - '0');
+     if (i < word.size() && word[i] == '.') {
+       int places = 0;
+       for (i++; i < word.size() && places < 3 && word[i] >= '0' && word[i] <= '9'; i++, places++) {
+         millis = millis * 10 + (word[i] - '0');
+       }
+       while (places++ < 3) millis *= 10;
+     }
+     return seconds * 1000 + millis;
+   }
+
+   // cadse/<year>/<board>/tm
+   static std::string_view boardFromTopic(std::string_view topic) {
+     size_t first = topic.find('/');
+     size_t second = first == std::string_view::npos ? first : topic.find('/', first + 1);
+     size_t third = second == std::string_view::npos ? second : topic.find('/', second + 1);
+     if (third == std::string_view::npos) return "unknown";
+     return topic.substr(second + 1, third - second - 1);
+   }
+
+   ChunkBuilder& builderFor(std::string_view device) {
+     if (lastBuilder && lastBuilder->device == device) return *lastBuilder;
+     auto found = builders.find(device);
+     if (found == builders.end()) {
+       std::unique_ptr<ChunkBuilder> builder(new ChunkBuilder());
+       builder->device = std::string(device.substr(0, 255));
+       found = builders.emplace(builder->device, std::move(builder)).first;
+     }
+     lastBuilder = found->second.get();
+     return *lastBuilder;
+   }
+
+   void flush(ChunkBuilder& builder) {
+     stats.typeConflicts += builder.typeConflicts;
+     builder.typeConflicts = 0;
+     std::string chunk = builder.finish();
+     fwrite(chunk.data(), 1, chunk.size(), file);
+     stats.chunks++;
+   }
+};
+
+// ---- Store reader ----
+
+struct ChunkHeader {
+   uint32_t rows;
+   int64_t minTime;
+   int64_t maxTime;
+   std::string device;
+   long bodyOffset;
+   uint32_t bodyLength;
+};
+
+struct DecodedColumn {
+   std::string name;
+   ColumnType type;
+   uint8_t scale;
+   std::vector<bool> present;
+   std::vector<int64_t> values;        // Indexed by row; undefined where absent
+   std::vector<std::string> words;
+};
+
+class StoreReader {
+public:
+   bool open(const char* path) {
+     file = fopen(path, "rb");
+     if (!file) return false;
+     char magic[5];
+     return fread(magic, 1, 5, file) == 5 && memcmp(magic, STORE_MAGIC, 4) == 0 && magic[4] == STORE_VERSION;
+   }
+
+   ~StoreReader() {
+     if (file) fclose(file);
+   }
+
+   // Read the next chunk header and position after the chunk
+   bool next(ChunkHeader& header) {
+     uint8_t fixed[8 + CHUNK_FIXED];
+     if (fread(fixed, 1, sizeof(fixed), file) != sizeof(fixed) || memcmp(fixed, CHUNK_MAGIC, 4) != 0) return false;
+     uint32_t length;
+     memcpy(&length, fixed + 4, 4);
+     memcpy(&header.rows, fixed + 8, 4);
+     memcpy(&header.minTime, fixed + 12, 8);
+     memcpy(&header.maxTime, fixed + 20, 8);
+     uint8_t deviceLength = fixed[28];
+     header.device.resize(deviceLength);
+     if (fread(&header.device[0], 1, deviceLength, file) != deviceLength) return false;
+     header.bodyOffset = ftell(file);
+     header.bodyLength = length - CHUNK_FIXED - deviceLength;
+     return fseek(file, header.bodyLength, SEEK_CUR) == 0;
+   }
+
+   // Decode a chunk body; wanted == nullptr decodes every column
+   bool load(const ChunkHeader& header, const std::vector<std::string>* wanted,
+             std::vector<int64_t>& times, std::vector<DecodedColumn>& columns) {
+     std::string body(header.bodyLength, '\0');
+     long resume = ftell(file);
+     if (fseek(file, header.bodyOffset, SEEK_SET) != 0 ||
+         fread(&body[0], 1, body.size(), file) != body.size()) return false;
+     fseek(file, resume, SEEK_SET);
+
+     Reader in = { (const uint8_t*)body.data(), (const uint8_t*)body.data() + body.size() };
+     if (!decodeIntegers(in, header.rows, times)) return false;
+     uint64_t count = in.varint();
+     columns.clear();
+     std::vector<int64_t> packed;
+     for (uint64_t c = 0; c < count && in.ok(); c++) {
+       DecodedColumn col;
+       col.name = std::string(in.bytes(in.varint()));
+       col.type = (ColumnType)in.byte();
+       col.scale = 0;
+       col.present.assign(header.rows, true);
+       size_t presentRows = header.rows;
+       if (in.byte() == 0) {
+         std::string_view bits = in.bytes((header.rows + 7) / 8);
+         presentRows = 0;
+         for (uint32_t row = 0; row < header.rows && !bits.empty(); row++) {
+           col.present[row] = (bits[row / 8] >> (row % 8)) & 1;
+           presentRows += col.present[row];
+         }
+       }
+       if (col.type == COL_STRING) {
+         uint64_t words = in.varint();
+         for (uint64_t w = 0; w < words && in.ok(); w++) col.words.push_back(std::string(in.bytes(in.varint())));
+       } else {
+         col.scale = in.byte();
+         if (col.scale > MAX_SCALE) return false;
+       }
+
+       bool keep = !wanted;
+       if (wanted) {
+         for (const std::string& name : *wanted) keep = keep || name == col.name;
+       }
+       if (!keep) {
+         // Skip the value block without decoding it
+         in.byte();
+         in.bytes(in.varint());
+         continue;
+       }
+       if (!decodeIntegers(in, presentRows, packed)) return false;
+       col.values.assign(header.rows, 0);
+       size_t next = 0;
+       for (uint32_t row = 0; row < header.rows; row++) {
+         if (col.present[row]) col.values[row] = packed[next++];
+       }
+       columns.push_back(std::move(col));
+     }
+     return in.ok();
+   }
+
+private:
+   FILE* file = nullptr;
+};
+
+static std::string formatValue(const DecodedColumn& col, uint32_t row) {
+   if (!col.present[row]) return "";
+   int64_t value = col.values[row];
+   if (col.type == COL_STRING) {
+     if (value >= (int64_t)col.words.size()) return "";
+     const std::string& word = col.words[value];
+     if (word.find_first_of(",\"\n") == std::string::npos) return word;
+     std::string quoted = "\"";
+     for (char c : word) {
+       quoted += c;
+       if (c == '"') quoted += '"';
+     }
+     return quoted + "\"";
+   }
+   if (col.type == COL_BOOL) return value ? "true" : "false";
+   if (col.scale == 0) return std::to_string(value);
+   uint64_t magnitude = value < 0 ? -(uint64_t)value : value;
+   std::string fraction = std::to_string(magnitude % POW10[col.scale]);
+   return (value < 0 ? "-" : "") + std::to_string(magnitude / POW10[col.scale]) + "." +
+          std::string(col.scale - fraction.size(), '0') + fraction;
+}
+
+// ---- Commands ----
+
+static volatile sig_atomic_t interrupted = 0;
+
+static int ingest(int argc, char** argv) {
+   if (argc < 1) return 2;
+   uint32_t chunkRows = CHUNK_ROWS;
+   const char* input = nullptr;
+   for (int i = 1; i < argc; i++) {
+     if (!strcmp(argv[i], "--chunk") && i + 1 < argc) {
+       chunkRows = (uint32_t)atoi(argv[++i]);
+     } else {
+       input = argv[i];
+     }
+   }
+   if (chunkRows == 0) chunkRows = CHUNK_ROWS;
+
+   FILE* in = input ? fopen(input, "rb") : stdin;
+   StoreWriter writer;
+   if (!in || !writer.open(argv[0], chunkRows)) {
+     fprintf(stderr, "cannot open %s\n", in ? argv[0] : input);
+     return 1;
+   }
+   // Ctrl-C on a live mosquitto_sub pipe still writes the open chunks
+   signal(SIGINT, [](int) { interrupted = 1; });
+
+   auto start = std::chrono::steady_clock::now();
+   static char line[MAX_LINE];
+   while (!interrupted && fgets(line, sizeof(line), in)) {
+     writer.line(line, strlen(line));
+   }
+   writer.close();
+   if (in != stdin) fclose(in);
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   const IngestStats& stats = writer.summary();
+   fprintf(stderr, "%" PRIu64 " messages (%" PRIu64 " rejected, %" PRIu64 " type conflicts) in %" PRIu64
+           " chunks, %.2f s, %.0f msg/s\n", stats.messages, stats.rejected, stats.typeConflicts,
+           stats.chunks, seconds, stats.messages / (seconds > 0 ? seconds : 1));
+   return 0;
+}
+
+struct Query {
+   const char* device = nullptr;
+   int64_t from = INT64_MIN;
+   int64_t to = INT64_MAX;
+   std::vector<std::string> fields;
+};
+
+static int64_t parseTimeArgument(const char* text) {
+   return (int64_t)(atof(text) * 1000.0);
+}
+
+// Matching rows as CSV on out; returns the number of rows
+static uint64_t runQuery(const char* path, const Query& query, FILE* out) {
+   StoreReader reader;
+   if (!reader.open(path)) {
+     fprintf(stderr, "%s is not a telemetry store\n", path);
+     return 0;
+   }
+
+   std::vector<std::string> fields = query.fields;
+   std::vector<ChunkHeader> matches;
+   ChunkHeader header;
+   while (reader.next(header)) {
+     if (query.device && header.device != query.device) continue;
+     if (header.maxTime < query.from || header.minTime > query.to) continue;
+     matches.push_back(header);
+   }
+
+   std::vector<int64_t> times;
+   std::vector<DecodedColumn> columns;
+   if (fields.empty()) {
+     // Union of the columns of every matching chunk, in first-seen order
+     for (const ChunkHeader& match : matches) {
+       if (!reader.load(match, nullptr, times, columns)) continue;
+       for (const DecodedColumn& col : columns) {
+         bool known = false;
+         for (const std::string& name : fields) known = known || name == col.name;
+         if (!known) fields.push_back(col.name);
+       }
+     }
+   }
+
+   if (out) {
+     fprintf(out, "time_ms,device");
+     for (const std::string& name : fields) fprintf(out, ",%s", name.c_str());
+     fputc('\n', out);
+   }
+
+   uint64_t rows = 0;
+   std::vector<int> slot;
+   for (const ChunkHeader& match : matches) {
+     if (!reader.load(match, &fields, times, columns)) {
+       fprintf(stderr, "corrupt chunk at offset %ld\n", match.bodyOffset);
+       continue;
+     }
+     slot.assign(fields.size(), -1);
+     for (size_t f = 0; f < fields.size(); f++) {
+       for (size_t c = 0; c < columns.size(); c++) {
+         if (columns[c].name == fields[f]) slot[f] = (int)c;
+       }
+     }
+     for (uint32_t row = 0; row < match.rows; row++) {
+       if (times[row] < query.from || times[row] > query.to) continue;
+       rows++;
+       if (!out) continue;
+       fprintf(out, "%" PRId64 ",%s", times[row], match.device.c_str());
+       for (int c : slot) {
+         fputc(',', out);
+         if (c >= 0) fputs(formatValue(columns[c], row).c_str(), out);
+       }
+       fputc('\n', out);
+     }
+   }
+   return rows;
+}
+
+static int query(int argc, char** argv) {
+   if (argc < 1) return 2;
+   Query q;
+   for (int i = 1; i + 1 < argc; i += 2) {
+     if (!strcmp(argv[i], "--device")) {
+       q.device = argv[i + 1];
+     } else if (!strcmp(argv[i], "--from")) {
+       q.from = parseTimeArgument(argv[i + 1]);
+     } else if (!strcmp(argv[i], "--to")) {
+       q.to = parseTimeArgument(argv[i + 1]);
+     } else if (!strcmp(argv[i], "--fields")) {
+       for (const char* p = argv[i + 1]; *p;) {
+         const char* comma = strchr(p, ',');
+         size_t length = comma ? (size_t)(comma - p) : strlen(p);
+         q.fields.push_back(std::string(p, length));
+         p += length + (comma ? 1 : 0);
+       }
+     } else {
+       return 2;
+     }
+   }
+   runQuery(argv[0], q, stdout);
+   return 0;
+}
+
+static int info(int argc, char** argv) {
+   if (argc < 1) return 2;
+   StoreReader reader;
+   if (!reader.open(argv[0])) {
+     fprintf(stderr, "%s is not a telemetry store\n", argv[0]);
+     return 1;
+   }
+   struct DeviceSummary {
+     uint64_t rows = 0, chunks = 0, bytes = 0;
+     int64_t first = INT64_MAX, last = INT64_MIN;
+   };
+   std::map<std::string, DeviceSummary> devices;
+   ChunkHeader header;
+   while (reader.next(header)) {
+     DeviceSummary& device = devices[header.device];
+     device.rows += header.rows;
+     device.chunks++;
+     device.bytes += header.bodyLength;
+     if (header.minTime < device.first) device.first = header.minTime;
+     if (header.maxTime > device.last) device.last = header.maxTime;
+   }
+   printf("device            rows  chunks      bytes  B/row  first_ms       last_ms\n");
+   for (auto& entry : devices) {
+     const DeviceSummary& d = entry.second;
+     printf("%-12s %9" PRIu64 " %7" PRIu64 " %10" PRIu64 " %6.1f  %-13" PRId64 "  %" PRId64 "\n",
+            entry.first.c_str(), d.rows, d.chunks, d.bytes, (double)d.bytes / d.rows, d.first, d.last);
+   }
+   return 0;
+}
+
+// ---- Benchmark ----
+
+// Synthetic telemetry as a board would report it, encoded by the firmware's
+// telemetryJson(). Fixed point values and statistics are whole multiples of
+// their last decimal, so the digits a query returns can be compared exactly.
+// Every tenth packet is housekeeping only, and humidity has an empty window
+// now and then (null statistics).
+struct Synthetic {
+   TelemetryRecord record;
+   uint8_t packet;
+   char deviceId[12];
+   char boardId[12];
+   char ip[16];
+   char i2c[160];
+};
+
+static StatsSummary syntheticStats(uint32_t count, int32_t base, uint32_t noise, int scale) {
+   StatsSummary stats = {};
+   if (count == 0) return stats;
+   stats.count = count;
+   stats.min = (base - (int32_t)(noise % 40)) / (float)scale;
+   stats.max = (base + (int32_t)((noise >> 6) % 40)) / (float)scale;
+   stats.mean = (base + (int32_t)((noise >> 12) % 20) - 10) / (float)scale;
+   stats.stddev = (1 + (noise >> 18) % 90) / (10.0f * scale);
+   return stats;
+}
+
+static void syntheticRecord(Synthetic& s, int device, uint64_t n, int64_t timeMs) {
+   uint32_t noise = (uint32_t)(n * 2654435761u + device * 40503u);
+   TelemetryRecord& r = s.record;
+   r = TelemetryRecord();
+   s.packet = (n % 10 == 9) ? TM_HK : TM_FULL;
+   snprintf(s.deviceId, sizeof(s.deviceId), "%06X", 0xA00000 + device);
+   snprintf(s.boardId, sizeof(s.boardId), "%06x", 0xA00000 + device);
+   snprintf(s.ip, sizeof(s.ip), "192.168.1.%d", 10 + device % 200);
+   snprintf(s.i2c, sizeof(s.i2c),
+            "{\"display\":{\"bytes\":%" PRIu64 ",\"busy_us\":%" PRIu64 ",\"max_wait_us\":%u},"
+            "\"bme280\":{\"bytes\":%" PRIu64 ",\"busy_us\":%" PRIu64 ",\"max_wait_us\":%u}}",
+            n * 51200, n * 4400, noise % 300, n * 26, n * 310, noise % 900);
+
+   r.deviceId = s.deviceId;
+   r.boardId = s.boardId;
+   r.hk = s.packet == TM_HK;
+   r.uptime = (uint32_t)n;
+   r.tsUs = timeMs * 1000;
+   r.monoUs = (int64_t)n * 1000000 + noise % 1000;
+   r.freeHeap = 180000 + noise % 4000;
+   r.mode = (uint32_t)((n / 60) % 6);
+   r.paramWrites = 2;
+   r.periodMs = 1000;
+   r.i2c = s.i2c;
+   r.batteryVoltage = syntheticStats(100, 380 + (int32_t)(noise % 30), noise, 100);
+   r.usbVoltage = syntheticStats(100, 498, noise >> 3, 100);
+   r.displayFrames = (uint32_t)(n * 50);
+   r.displayDropped = noise % 3;
+   r.displayTransferUs = 9000 + noise % 400;
+   r.pacingTargetMs = 200;
+   r.pacingFrames = (uint32_t)(n * 5);
+   r.pacingLate = noise % 4;
+   r.powerOn = 5;
+   r.powerBusyPct = (1200 + (int32_t)(noise % 300)) / 100.0f;
+   r.touchRight = syntheticStats(50, 48000 + (int32_t)(noise % 900), noise, 1);
+   r.touchLeft = syntheticStats(50, 47000 + (int32_t)(noise % 800), noise >> 2, 1);
+   r.touchUp = syntheticStats(50, 51000, noise >> 4, 1);
+   r.touchDown = syntheticStats(50, 50500, noise >> 5, 1);
+   r.touchX = syntheticStats(50, 49000, noise >> 7, 1);
+   r.accelX = (90 + (int32_t)(noise % 20)) / 10.0f;
+   r.accelY = ((int32_t)((noise >> 4) % 10) - 5) / 10.0f;
+   r.accelZ = -((int32_t)((noise >> 8) % 10)) / 10.0f;
+   r.gyroX = (10 + (int32_t)((noise >> 12) % 10)) / 10.0f;
+   r.gyroY = -((int32_t)((noise >> 16) % 10)) / 10.0f;
+   r.gyroZ = ((int32_t)((noise >> 20) % 10)) / 10.0f;
+   r.temperature = syntheticStats(8, 2300 + (int32_t)(noise % 100), noise >> 1, 100);
+   r.pressure = syntheticStats(8, 100300 + (int32_t)(noise % 100), noise >> 9, 100);
+   r.humidity = syntheticStats(noise % 16 == 0 ? 0 : 8, 410 + (int32_t)(noise % 10), noise >> 11, 10);
+   r.altitude = (810 + (int32_t)(noise % 10)) / 10.0f;
+   r.verticalSpeed = ((int32_t)(noise % 50) - 25) / 100.0f;
+   r.qnh = 1013.25f;
+   r.wifiStrength = -55 - (int32_t)(noise % 20);
+   r.ipAddress = s.ip;
+}
+
+// One capture line ("<unix s> <topic> <json>"); 0 if the packet does not fit
+static int syntheticMessage(char* out, size_t size, const Synthetic& s, int device, int64_t timeMs) {
+   int prefix = snprintf(out, size, "%" PRId64 ".%03d cadse/2024/%d/tm ", timeMs / 1000, (int)(timeMs % 1000), device);
+   size_t json = telemetryJson(s.record, s.packet, out + prefix, size - prefix - 1);
+   if (json == 0) return 0;
+   out[prefix + json] = '\n';
+   return prefix + (int)json + 1;
+}
+
+// A field as the packet carried it, "" where it was null or not sent
+static std::string expectedValue(const Synthetic& s, const std::string& field) {
+   const TelemetryRecord& r = s.record;
+   bool full = s.packet == TM_FULL;
+   char text[32];
+   size_t dot = field.find('.');
+   std::string name = field.substr(0, dot);
+   std::string part = dot == std::string::npos ? "" : field.substr(dot + 1);
+
+   auto fixed = [&](float value, int decimals) -> std::string {
+     snprintf(text, sizeof(text), "%.*f", decimals, value);
+     return text;
+   };
+   auto stats = [&](const StatsSummary& value, int decimals) -> std::string {
+     if (value.count == 0) return "";
+     if (part == "n") return std::to_string(value.count);
+     if (part == "min") return fixed(value.min, decimals);
+     if (part == "max") return fixed(value.max, decimals);
+     if (part == "mean") return fixed(value.mean, decimals);
+     return fixed(value.stddev, decimals + 1);
+   };
+
+   if (field == "uptime") return std::to_string(r.uptime);
+   if (field == "mode") return std::to_string(r.mode);
+   if (field == "hk") return full ? "" : "true";
+   if (field == "altitude") return full ? fixed(r.altitude, 1) : "";
+   if (field == "i2c.bme280.bytes") return full ? std::to_string((uint64_t)r.uptime * 26) : "";
+   if (name == "battery_voltage") return stats(r.batteryVoltage, 2);
+   if (name == "pressure") return full ? stats(r.pressure, 2) : "";
+   if (name == "humidity") return full ? stats(r.humidity, 1) : "";
+   return "?";
+}
+
+static std::vector<std::string> splitCsv(const std::string& line) {
+   std::vector<std::string> cells;
+   size_t at = 0;
+   while (true) {
+     size_t comma = line.find(',', at);
+     cells.push_back(line.substr(at, comma == std::string::npos ? std::string::npos : comma - at));
+     if (comma == std::string::npos) return cells;
+     at = comma + 1;
+   }
+}
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+   if (condition) return;
+   printf("FAIL: %s\n", what);
+   failures++;
+}
+
+// Query one device over packets first..last and compare every cell with what was sent
+static void checkQuery(const char* path, int device, uint64_t first, uint64_t last, int64_t epoch) {
+   Query q;
+   char id[16];
+   snprintf(id, sizeof(id), "%06X", 0xA00000 + device);
+   q.device = id;
+   q.from = epoch + (int64_t)first * 1000 + device;   // Both ends on a row: the range is inclusive
+   q.to = epoch + (int64_t)last * 1000 + device;
+   q.fields = { "uptime", "mode", "hk", "altitude", "i2c.bme280.bytes", "pressure.n", "pressure.min",
+                "pressure.max", "pressure.mean", "pressure.sd", "humidity.mean", "battery_voltage.mean" };
+
+   char* text = nullptr;
+   size_t textSize = 0;
+   FILE* out = open_memstream(&text, &textSize);
+   uint64_t rows = runQuery(path, q, out);
+   fclose(out);
+   std::vector<std::string> lines;
+   for (size_t at = 0; at < textSize;) {
+     const char* newline = (const char*)memchr(text + at, '\n', textSize - at);
+     size_t length = newline ? (size_t)(newline - (text + at)) : textSize - at;
+     lines.push_back(std::string(text + at, length));
+     at += length + 1;
+   }
+   free(text);
+
+   check(rows == last - first + 1 && lines.size() == rows + 1, "query: one row per packet in the range");
+   bool rowsMatch = true;
+   bool valuesMatch = true;
+   bool nulls = false;
+   Synthetic s;
+   for (size_t row = 1; row < lines.size(); row++) {
+     uint64_t n = first + row - 1;
+     int64_t timeMs = epoch + (int64_t)n * 1000 + device;
+     syntheticRecord(s, device, n, timeMs);
+     std::vector<std::string> cells = splitCsv(lines[row]);
+     if (cells.size() != q.fields.size() + 2 || cells[0] != std::to_string(timeMs) || cells[1] != id) {
+       rowsMatch = false;
+       continue;
+     }
+     for (size_t f = 0; f < q.fields.size(); f++) {
+       std::string expected = expectedValue(s, q.fields[f]);
+       if (cells[f + 2] != expected) {
+         if (valuesMatch) {
+           printf("  packet %" PRIu64 " %s: stored \"%s\", sent \"%s\"\n", n, q.fields[f].c_str(),
+                  cells[f + 2].c_str(), expected.c_str());
+         }
+         valuesMatch = false;
+       }
+       if (expected.empty()) nulls = true;
+     }
+   }
+   check(rowsMatch, "query: time and device of every row");
+   check(valuesMatch, "query: every value as sent, statistics n/min/max/mean/sd included");
+   check(nulls, "query: null statistics and fields missing from housekeeping packets come back empty");
+}
+
+static int bench(int argc, char** argv) {
+   uint64_t messages = argc > 0 ? strtoull(argv[0], nullptr, 10) : 1000000;
+   int devices = argc > 1 ? atoi(argv[1]) : 16;
+   if (messages == 0 || devices <= 0) return 2;
+   const char* path = "telemetry_bench.cts";
+
+   // Build the input in memory first so the timing covers parsing and storage only
+   std::vector<char> input;
+   input.reserve(messages * 1500);
+   const int64_t epoch = 1760860000000LL;
+   char line[MAX_LINE];
+   Synthetic synthetic;
+   uint64_t encoded = 0;
+   for (uint64_t n = 0; n < messages; n++) {
+     int device = (int)(n % devices);
+     uint64_t sequence = n / devices;
+     int64_t timeMs = epoch + sequence * 1000 + device;
+     syntheticRecord(synthetic, device, sequence, timeMs);
+     int length = syntheticMessage(line, sizeof(line), synthetic, device, timeMs);
+     if (length > 0) encoded++;
+     input.insert(input.end(), line, line + length);
+   }
+   check(encoded == messages, "every synthetic packet fits TELEMETRY_JSON_MAX");
+
+   remove(path);
+   StoreWriter writer;
+   if (!writer.open(path, CHUNK_ROWS)) return 1;
+   auto start = std::chrono::steady_clock::now();
+   const char* p = input.data();
+   const char* end = p + input.size();
+   while (p < end) {
+     const char* newline = (const char*)memchr(p, '\n', end - p);
+     size_t length = newline ? (size_t)(newline - p + 1) : (size_t)(end - p);
+     writer.line(p, length);
+     p += length;
+   }
+   writer.close();
+   double ingestSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   FILE* stored = fopen(path, "rb");
+   fseek(stored, 0, SEEK_END);
+   long storedBytes = ftell(stored);
+   fclose(stored);
+
+   // One device, the middle tenth of its time span, three columns
+   uint64_t perDevice = messages / devices;
+   Query q;
+   char device[16];
+   snprintf(device, sizeof(device), "%06X", 0xA00000 + devices / 2);
+   q.device = device;
+   q.from = epoch + (int64_t)(perDevice * 45 / 100) * 1000;
+   q.to = epoch + (int64_t)(perDevice * 55 / 100) * 1000;
+   q.fields = { "uptime", "pressure.mean", "i2c.bme280.bytes" };
+   start = std::chrono::steady_clock::now();
+   uint64_t rows = runQuery(path, q, nullptr);
+   double querySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   const IngestStats& stats = writer.summary();
+   printf("ingest: %" PRIu64 " messages, %d devices, %.1f MB JSON in %.3f s\n",
+          stats.messages, devices, input.size() / 1e6, ingestSeconds);
+   printf("        %.0f msg/s, %.1f MB/s, %" PRIu64 " rejected\n",
+          stats.messages / ingestSeconds, input.size() / 1e6 / ingestSeconds, stats.rejected);
+   printf("store:  %.2f MB in %" PRIu64 " chunks, %.1f bytes/message, %.1fx smaller than JSON\n",
+          storedBytes / 1e6, stats.chunks, (double)storedBytes / stats.messages, (double)input.size() / storedBytes);
+   printf("query:  device %s, 10%% of its time range, 3 columns: %" PRIu64 " rows in %.2f ms\n",
+          device, rows, querySeconds * 1000);
+
+   check(stats.messages == messages && stats.rejected == 0 && stats.typeConflicts == 0,
+         "ingest: every packet stored, no rejects or type conflicts");
+   checkQuery(path, devices / 2, perDevice * 45 / 100, perDevice * 55 / 100, epoch);
+   checkQuery(path, 0, 0, perDevice - 1, epoch);
+   remove(path);
+
+   if (failures) {
+     printf("\n%d checks failed\n", failures);
+     return 1;
+   }
+   printf("\nall checks passed\n");
+   return 0;
+}
+
+int main(int argc, char** argv) {
+   int result = 2;
+   if (argc >= 2) {
+     std::string command = argv[1];
+     if (command == "ingest") result = ingest(argc - 2, argv + 2);
+     else if (command == "query") result = query(argc - 2, argv + 2);
+     else if (command == "info") result = info(argc - 2, argv + 2);
+     else if (command == "bench") result = bench(argc - 2, argv + 2);
+   }
+   if (result == 2) {
+     fprintf(stderr,
+       "usage: telemetry_store ingest <store> [capture] [--chunk rows]\n"
+       "       telemetry_store query <store> [--device id] [--from unix_s] [--to unix_s] [--fields a,b]\n"
+       "       telemetry_store info <store>\n"
+       "       telemetry_store bench [messages] [devices]\n");
+   }
+   return result;
+}
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""Decode and compare CADSE input traces.
+
+A trace is the file written by the TRACE RECORD telecommand (see
+src/input_trace.h). Get it off the board with TRACE DUMP, which prints
+"TRACE <offset> <hex>" lines on the serial console; this tool accepts either
+such a console log or the raw binary.
+
+    trace_tool.py show  capture.log          # one line per record
+    trace_tool.py stats capture.log          # record counts and time span
+    trace_tool.py diff  before.log after.log # first difference in inputs/frames
+"""
+
+import re
+import struct
+import sys
+
+MAGIC = b"CTRC"
+VERSION = 1
+
+TICK, TOUCH, ANALOG, SENSOR, STATUS, MODE, COMMAND, FRAME = range(1, 9)
+NAMES = {TICK: "tick", TOUCH: "touch", ANALOG: "analog", SENSOR: "sensor",
+         STATUS: "status", MODE: "mode", COMMAND: "command", FRAME: "frame"}
+SITES = ["mode_tick", "touch_scan", "battery"]
+SENSORS = ["pressure", "temperature", "humidity"]
+STATUSES = ["wifi", "rssi", "mqtt", "bme"]
+
+
+def load(path):
+    data = open(path, "rb").read()
+    if data.startswith(MAGIC):
+        return data
+    # Serial console log with TRACE DUMP lines
+    chunks = {}
+    for line in data.decode("latin-1").splitlines():
+        m = re.search(r"TRACE ([0-9a-f]{6}) ([0-9a-f]+)", line)
+        if m:
+            chunks[int(m.group(1), 16)] = bytes.fromhex(m.group(2))
+    out = b""
+    for offset in sorted(chunks):
+        if offset != len(out):
+            sys.exit("%s: dump is missing bytes at offset %d" % (path, len(out)))
+        out += chunks[offset]
+    return out
+
+
+def varint(data, pos):
+    value = shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+        shift += 7
+
+
+def parse(data):
+    """Return (mode, records); each record is (time_ms, kind, channel, value)."""
+    if data[:4] != MAGIC or data[4] != VERSION:
+        sys.exit("not a version %d trace" % VERSION)
+    mode = data[5]
+    start = struct.unpack_from("<I", data, 8)[0]
+    time, pos, records = start, 12, []
+    while pos < len(data):
+        kind = data[pos]
+        delta, pos = varint(data, pos + 1)
+        time += delta
+        channel = None
+        if kind <= STATUS:
+            channel = data[pos]
+            pos += 1
+        if kind == TICK:
+            value = None
+        elif kind in (TOUCH, ANALOG):
+            value, pos = varint(data, pos)
+        elif kind == STATUS:
+            raw, pos = varint(data, pos)
+            value = (raw >> 1) ^ -(raw & 1)
+        elif kind == SENSOR:
+            value = round(struct.unpack_from("<f", data, pos)[0], 3)
+            pos += 4
+        elif kind == MODE:
+            value = data[pos]
+            pos += 1
+        elif kind == COMMAND:
+            length, pos = varint(data, pos)
+            value = data[pos:pos + length].decode("utf-8", "replace")
+            pos += length
+        elif kind == FRAME:
+            value = "%08x" % struct.unpack_from("<I", data, pos)[0]
+            pos += 4
+        else:
+            sys.exit("unknown record type %d at offset %d" % (kind, pos))
+        records.append((time - start, kind, channel, value))
+    return mode, records
+
+
+def describe(record):
+    time, kind, channel, value = record
+    if kind == TICK:
+        label = SITES[channel] if channel < len(SITES) else channel
+    elif kind == SENSOR:
+        label = SENSORS[channel] if channel < len(SENSORS) else channel
+    elif kind == STATUS:
+        label = STATUSES[channel] if channel < len(STATUSES) else channel
+    elif channel is not None:
+        label = "pin %d" % channel
+    else:
+        label = ""
+    text = "%8d ms  %-7s %-11s" % (time, NAMES[kind], label)
+    return text + ("" if value is None else " %s" % value)
+
+
+def main():
+    if len(sys.argv) < 3 or sys.argv[1] not in ("show", "stats", "diff"):
+        sys.exit(__doc__)
+    command = sys.argv[1]
+    mode, records = parse(load(sys.argv[2]))
+
+    if command == "show":
+        print("start mode %d" % mode)
+        for record in records:
+            print(describe(record))
+
+    elif command == "stats":
+        counts = {}
+        for record in records:
+            counts[NAMES[record[1]]] = counts.get(NAMES[record[1]], 0) + 1
+        span = records[-1][0] if records else 0
+        print("start mode %d, %d records over %.1f s" % (mode, len(records), span / 1000.0))
+        for name in sorted(counts):
+            print("  %-8s %d" % (name, counts[name]))
+
+    else:
+        if len(sys.argv) != 4:
+            sys.exit(__doc__)
+        other_mode, other = parse(load(sys.argv[3]))
+        if mode != other_mode:
+            print("start mode differs: %d vs %d" % (mode, other_mode))
+        # Timestamps legitimately differ between recordings; compare content
+        for i, (a, b) in enumerate(zip(records, other)):
+            if a[1:] != b[1:]:
+                print("first difference at record %d:" % i)
+                print("  < " + describe(a))
+                print("  > " + describe(b))
+                return 1
+        if len(records) != len(other):
+            print("traces agree for %d records, lengths differ (%d vs %d)"
+                  % (min(len(records), len(other)), len(records), len(other)))
+            return 1
+        print("traces are identical (%d records)" % len(records))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())